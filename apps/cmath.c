@@ -32,6 +32,10 @@
  *
  * To run a script (e.g., mymacro.m):
  *     ./cmath mymacro.m
+ *
+ * To compile a script once and run it as bytecode, with ranges, loops and
+ * conditionals (see "Batch Mode" below):
+ *     ./cmath -b sweep.m
  */
 
 #include <stdio.h>
@@ -39,12 +43,16 @@
 #include <string.h>
 #include <math.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
 #include <termios.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #define MAX_VARS 100
-#define MAX_MATRIX_ROWS 100
-#define MAX_MATRIX_COLS 100
 
 /* --- Command History and Line Editing --- */
 #define MAX_HISTORY 100
@@ -193,6 +201,7 @@ Value parse_factor(void);
 Value parse_primary(void);
 Value parse_matrix_literal(void);
 Value call_function(const char *func, Value arg);
+Value parse_csv_call(const char *func);
 
 Value deep_copy_value(Value v);
 
@@ -335,6 +344,15 @@ void print_help(void) {
     printf("  abs (absolute value),\n");
     printf("  sinh, cosh, tanh,\n");
     printf("  floor, ceil\n\n");
+    printf("Batch Mode (cmath -b script.m):\n");
+    printf("  Compiles the script once and runs it as bytecode. Adds ranges (t = 0:0.001:10),\n");
+    printf("  comparisons (< <= > >= == ~=), indexing (x(3), x(2:5), x(i) = v; matrices\n");
+    printf("  are indexed column by column), for/while/if ... end blocks with break and\n");
+    printf("  continue, and sum, mean, min, max, length, zeros(n), ones(n), zeros(r,c), ones(r,c).\n\n");
+    printf("CSV Files (both modes):\n");
+    printf("  X = load(\"data.csv\")         -> All columns, one matrix row per line\n");
+    printf("  X = load(\"data.csv\", [1, 3]) -> Columns 1 and 3 only\n");
+    printf("  save(\"out.csv\", X)           -> Write X, returns the number of rows\n\n");
     printf("Examples:\n");
     printf("  2 + 3 * 4            -> Evaluates to 14\n");
     printf("  x = 3.14             -> Assigns 3.14 to variable x\n");
@@ -468,6 +486,10 @@ Value parse_primary(void) {
         }
         ident[i] = '\0';
         skip_whitespace();
+        if (*p == '(' && (strcmp(ident, "load") == 0 || strcmp(ident, "save") == 0)) {
+            p++;
+            return parse_csv_call(ident);
+        }
         if (*p == '(') {
             p++;
             skip_whitespace();
@@ -514,10 +536,12 @@ Value parse_primary(void) {
 /*
  * parse_matrix_literal:
  *   Parses a matrix literal of the form: [num, num, ...; num, num, ...]
+ *   The elements are collected in a buffer that grows as needed.
  */
 Value parse_matrix_literal(void) {
     p++;
-    double temp[MAX_MATRIX_ROWS][MAX_MATRIX_COLS];
+    double *temp = NULL;
+    size_t count = 0, cap = 0;
     int row_count = 0;
     int col_count = -1;
 
@@ -533,6 +557,7 @@ Value parse_matrix_literal(void) {
             if (!isdigit(*p) && *p != '.' && *p != '-' && *p != '+') {
                 printf("Error: Expected number in matrix literal\n");
                 error_flag = 1;
+                free(temp);
                 Value err = { .type = VAL_SCALAR, .scalar = 0 };
                 return err;
             }
@@ -541,16 +566,20 @@ Value parse_matrix_literal(void) {
             if (p == endptr) {
                 printf("Error: Invalid number in matrix literal\n");
                 error_flag = 1;
+                free(temp);
                 Value err = { .type = VAL_SCALAR, .scalar = 0 };
                 return err;
             }
-            if (row_count >= MAX_MATRIX_ROWS || col >= MAX_MATRIX_COLS) {
-                printf("Error: Matrix literal exceeds maximum dimensions\n");
-                error_flag = 1;
-                Value err = { .type = VAL_SCALAR, .scalar = 0 };
-                return err;
+            if (count == cap) {
+                cap = cap ? cap * 2 : 64;
+                double *grown = realloc(temp, cap * sizeof(double));
+                if (!grown) {
+                    printf("Error: Memory allocation failed for matrix\n");
+                    exit(1);
+                }
+                temp = grown;
             }
-            temp[row_count][col] = num;
+            temp[count++] = num;
             col++;
             p = endptr;
             skip_whitespace();
@@ -582,8 +611,9 @@ Value parse_matrix_literal(void) {
         }
     }
 
-    if (row_count == 0 || col_count <= 0) {
+    if (row_count == 0 || col_count <= 0 || count != (size_t)row_count * col_count) {
         /* Return an empty 0×0 matrix */
+        free(temp);
         Value val;
         val.type = VAL_MATRIX;
         val.matrix.rows = 0;
@@ -596,17 +626,7 @@ Value parse_matrix_literal(void) {
     val.type = VAL_MATRIX;
     val.matrix.rows = row_count;
     val.matrix.cols = col_count;
-    int size = row_count * col_count;
-    val.matrix.data = malloc(size * sizeof(double));
-    if (!val.matrix.data) {
-        printf("Error: Memory allocation failed for matrix\n");
-        exit(1);
-    }
-    for (int i = 0; i < row_count; i++) {
-        for (int j = 0; j < col_count; j++) {
-            val.matrix.data[i * col_count + j] = temp[i][j];
-        }
-    }
+    val.matrix.data = temp;
     return val;
 }
 
@@ -1046,11 +1066,1783 @@ Value elementwise_pow_values(Value a, Value b) {
     return (Value){ .type = VAL_SCALAR, .scalar = 0 };
 }
 
+/* --- CSV Load and Save --- */
+
+/*
+ * load("file.csv") returns the numeric columns of a CSV file as a matrix with one
+ * row per line; load("file.csv", [1, 3]) picks columns by 1-based number.
+ * The CSV model is the one of the csv tools: CR stripped, blank lines skipped,
+ * fields split at ',' and trimmed, the first line is a header if any field is not
+ * a number, and lines with a different number of fields are skipped. Fields that
+ * are not numbers load as NaN. A fresh "file.csv.bcol" sidecar (see csvbcol) is
+ * copied from directly; otherwise the mapped file is parsed by one thread per CPU,
+ * each writing its rows straight into the result.
+ *
+ * save("file.csv", X) writes X one row per line and returns the number of rows.
+ */
+
+#define CSV_MAX_THREADS 64
+#define CSV_MIN_CHUNK (1 << 20)
+#define CSV_MAX_FIELD 256
+
+/* Extern declarations from lib/libbcol.c */
+typedef struct BcolFile BcolFile;
+extern BcolFile *bcol_open(const char *csv_path);
+extern void bcol_close(BcolFile *b);
+extern size_t bcol_rows(const BcolFile *b);
+extern size_t bcol_cols(const BcolFile *b);
+extern size_t bcol_skipped_lines(const BcolFile *b);
+extern const double *bcol_column(const BcolFile *b, size_t col);
+
+typedef struct {
+    const char *begin, *end;    // whole lines of the file
+    int ncols;                  // fields per row
+    const int *sel;             // columns to keep, 0-based
+    int nsel;
+    double *out;                // where this piece's first row goes
+    size_t lines;               // upper bound of rows, from the first pass
+    size_t rows;                // rows stored
+    size_t skipped;             // lines with a different number of fields
+    int pass;
+} CsvJob;
+
+/* Parse a field [s, e) into *out; returns 0 and stores NaN if it is not a number */
+static int csv_field(const char *s, const char *e, double *out) {
+    while (s < e && isspace((unsigned char)*s))
+        s++;
+    while (e > s && isspace((unsigned char)e[-1]))
+        e--;
+    size_t len = (size_t)(e - s);
+    *out = NAN;
+    if (len == 0 || len >= CSV_MAX_FIELD)
+        return 0;
+    char buf[CSV_MAX_FIELD];
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+    char *endptr;
+    double v = strtod(buf, &endptr);
+    if (*endptr != '\0')
+        return 0;
+    *out = v;
+    return 1;
+}
+
+/* Line [s, e) without its '\n' and trailing CRs */
+static const char *csv_line(const char *s, const char *end, const char **next) {
+    const char *nl = memchr(s, '\n', (size_t)(end - s));
+    const char *e = nl ? nl : end;
+    *next = nl ? nl + 1 : end;
+    while (e > s && e[-1] == '\r')
+        e--;
+    return e;
+}
+
+static void *csv_worker(void *arg) {
+    CsvJob *job = arg;
+    if (job->pass == 0) {
+        size_t lines = 0;
+        for (const char *p = job->begin; p < job->end; lines++) {
+            const char *nl = memchr(p, '\n', (size_t)(job->end - p));
+            p = nl ? nl + 1 : job->end;
+        }
+        job->lines = lines;
+        return NULL;
+    }
+    const char **start = malloc(sizeof(const char *) * (size_t)(job->ncols + 1));
+    if (!start)
+        return NULL;
+    double *row = job->out;
+    for (const char *p = job->begin, *next; p < job->end; p = next) {
+        const char *e = csv_line(p, job->end, &next);
+        if (e == p)
+            continue;
+        /* field i spans [start[i], start[i + 1] - 1) */
+        int n = 0;
+        start[n++] = p;
+        for (const char *q = p; q < e && n <= job->ncols; q++)
+            if (*q == ',')
+                start[n++] = q + 1;
+        if (n != job->ncols) {
+            job->skipped++;
+            continue;
+        }
+        start[n] = e + 1;
+        for (int k = 0; k < job->nsel; k++) {
+            int c = job->sel[k];
+            csv_field(start[c], start[c + 1] - 1, &row[k]);
+        }
+        row += job->nsel;
+        job->rows++;
+    }
+    free(start);
+    return NULL;
+}
+
+/* Run the jobs on worker threads; the calling thread takes the last one */
+static void csv_run(CsvJob *jobs, int k) {
+    pthread_t tids[CSV_MAX_THREADS];
+    int started[CSV_MAX_THREADS];
+    for (int i = 0; i < k; i++) {
+        started[i] = i < k - 1 && pthread_create(&tids[i], NULL, csv_worker, &jobs[i]) == 0;
+        if (!started[i])
+            csv_worker(&jobs[i]);
+    }
+    for (int i = 0; i < k; i++)
+        if (started[i])
+            pthread_join(tids[i], NULL);
+}
+
+/* Turn the 1-based column numbers sel[0..nsel) into 0-based indices, or all
+   columns when nsel is 0. Returns NULL and sets err if one is out of range. */
+static int *csv_columns(const double *sel, size_t nsel, int ncols, int *nout, char *err, size_t errlen) {
+    size_t n = nsel ? nsel : (size_t)ncols;
+    int *cols = malloc(sizeof(int) * (n ? n : 1));
+    if (!cols) {
+        printf("Error: Memory allocation failed\n");
+        exit(1);
+    }
+    for (size_t k = 0; k < n; k++) {
+        if (!nsel) {
+            cols[k] = (int)k;
+            continue;
+        }
+        if (sel[k] != floor(sel[k]) || sel[k] < 1 || sel[k] > ncols) {
+            snprintf(err, errlen, "Column %g not in the file (1..%d)", sel[k], ncols);
+            free(cols);
+            return NULL;
+        }
+        cols[k] = (int)sel[k] - 1;
+    }
+    *nout = (int)n;
+    return cols;
+}
+
+/* Copy the selected columns out of a fresh sidecar */
+static double *csv_load_sidecar(BcolFile *b, const double *sel, size_t nsel,
+                                int *rows, int *cols, char *err, size_t errlen) {
+    int nc;
+    int *cidx = csv_columns(sel, nsel, (int)bcol_cols(b), &nc, err, errlen);
+    if (!cidx)
+        return NULL;
+    size_t nr = bcol_rows(b);
+    if (nr > INT_MAX) {
+        snprintf(err, errlen, "Too many rows for a matrix");
+        free(cidx);
+        return NULL;
+    }
+    size_t cells = nr * (size_t)nc;
+    double *data = malloc(sizeof(double) * (cells ? cells : 1));
+    if (!data) {
+        printf("Error: Memory allocation failed\n");
+        exit(1);
+    }
+    for (int k = 0; k < nc; k++) {
+        const double *col = bcol_column(b, (size_t)cidx[k]);
+        for (size_t r = 0; r < nr; r++)
+            data[r * (size_t)nc + (size_t)k] = col[r];
+    }
+    if (bcol_skipped_lines(b) > 0)
+        fprintf(stderr, "load: skipped %zu lines with a different number of fields\n",
+                bcol_skipped_lines(b));
+    free(cidx);
+    *rows = (int)nr;
+    *cols = nc;
+    return data;
+}
+
+/*
+ * csv_load:
+ *   Loads columns sel[0..nsel) (1-based; all columns when nsel is 0) of a CSV file
+ *   into a new row-major rows x cols array. Returns NULL with a message in err on
+ *   failure.
+ */
+double *csv_load(const char *path, const double *sel, size_t nsel,
+                 int *rows, int *cols, char *err, size_t errlen) {
+    BcolFile *b = bcol_open(path);
+    if (b) {
+        double *data = csv_load_sidecar(b, sel, nsel, rows, cols, err, errlen);
+        bcol_close(b);
+        return data;
+    }
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        snprintf(err, errlen, "%s: %s", path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    const char *map = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (map == MAP_FAILED) {
+        snprintf(err, errlen, "%s: %s", path, strerror(errno));
+        return NULL;
+    }
+    const char *end = map + size;
+
+    /* The first non-blank line fixes the column count and may be a header */
+    const char *p = map, *next = map, *e = map;
+    while (p < end && (e = csv_line(p, end, &next)) == p)
+        p = next;
+    if (p >= end) {
+        snprintf(err, errlen, "%s: no data", path);
+        if (map)
+            munmap((void *)map, size);
+        return NULL;
+    }
+    int ncols = 1, header = 0;
+    const char *f = p;
+    for (const char *q = p; q <= e; q++) {
+        if (q == e || *q == ',') {
+            double v;
+            if (!csv_field(f, q, &v))
+                header = 1;
+            if (q < e)
+                ncols++;
+            f = q + 1;
+        }
+    }
+    if (header)
+        p = next;
+
+    int nc;
+    int *cidx = csv_columns(sel, nsel, ncols, &nc, err, errlen);
+    if (!cidx) {
+        munmap((void *)map, size);
+        return NULL;
+    }
+
+    /* Split at line starts, count lines, then parse every piece in place */
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (cpus > CSV_MAX_THREADS ? CSV_MAX_THREADS : (int)cpus) : 1;
+    size_t span = (size_t)(end - p);
+    int n = (int)(span / CSV_MIN_CHUNK + 1);
+    if (n > threads)
+        n = threads;
+    CsvJob jobs[CSV_MAX_THREADS];
+    int k = 0;
+    const char *from = p;
+    for (int i = 1; i < n && from < end; i++) {
+        const char *cut = p + span * (size_t)i / (size_t)n;
+        if (cut < from)
+            cut = from;
+        const char *nl = memchr(cut, '\n', (size_t)(end - cut));
+        if (!nl)
+            break;
+        jobs[k++] = (CsvJob){ .begin = from, .end = nl + 1 };
+        from = nl + 1;
+    }
+    jobs[k++] = (CsvJob){ .begin = from, .end = end };
+    csv_run(jobs, k);
+
+    size_t bound = 0;
+    for (int i = 0; i < k; i++)
+        bound += jobs[i].lines;
+    size_t cells = bound * (size_t)nc;
+    double *data = malloc(sizeof(double) * (cells ? cells : 1));
+    if (!data) {
+        printf("Error: Memory allocation failed\n");
+        exit(1);
+    }
+    size_t at = 0;
+    for (int i = 0; i < k; i++) {
+        jobs[i].ncols = ncols;
+        jobs[i].sel = cidx;
+        jobs[i].nsel = nc;
+        jobs[i].out = data + at * (size_t)nc;
+        jobs[i].pass = 1;
+        at += jobs[i].lines;
+    }
+    csv_run(jobs, k);
+    munmap((void *)map, size);
+    free(cidx);
+
+    /* Close the gaps left by blank and skipped lines */
+    size_t total = 0, skipped = 0;
+    for (int i = 0; i < k; i++) {
+        double *dst = data + total * (size_t)nc;
+        if (dst != jobs[i].out)
+            memmove(dst, jobs[i].out, sizeof(double) * jobs[i].rows * (size_t)nc);
+        total += jobs[i].rows;
+        skipped += jobs[i].skipped;
+    }
+    if (total > INT_MAX) {
+        snprintf(err, errlen, "Too many rows for a matrix");
+        free(data);
+        return NULL;
+    }
+    if (total < bound) {
+        cells = total * (size_t)nc;
+        double *shrunk = realloc(data, sizeof(double) * (cells ? cells : 1));
+        if (shrunk)
+            data = shrunk;
+    }
+    if (skipped > 0)
+        fprintf(stderr, "load: skipped %zu lines with a different number of fields\n", skipped);
+    *rows = (int)total;
+    *cols = nc;
+    return data;
+}
+
+/* Write a rows x cols matrix as CSV; returns the rows written or -1 (errno set) */
+long csv_save(const char *path, const double *data, int rows, int cols) {
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return -1;
+    for (int r = 0; r < rows; r++) {
+        const double *row = data + (size_t)r * (size_t)cols;
+        for (int c = 0; c < cols; c++)
+            fprintf(f, c ? ",%.15g" : "%.15g", row[c]);
+        fputc('\n', f);
+    }
+    if (fclose(f) != 0)
+        return -1;
+    return rows;
+}
+
+/*
+ * parse_csv_call:
+ *   After "load(" or "save(": '"' path '"' [ ',' expression ] ')'
+ */
+Value parse_csv_call(const char *func) {
+    Value err = { .type = VAL_SCALAR, .scalar = 0 };
+    skip_whitespace();
+    if (*p != '"' || !strchr(p + 1, '"')) {
+        printf("Error: Expected a quoted file name in %s()\n", func);
+        error_flag = 1;
+        return err;
+    }
+    const char *q = strchr(p + 1, '"');
+    char path[256];
+    snprintf(path, sizeof(path), "%.*s", (int)(q - p - 1), p + 1);
+    p = q + 1;
+    skip_whitespace();
+    int has_arg = 0;
+    Value arg = err;
+    if (*p == ',') {
+        p++;
+        arg = parse_expression();
+        has_arg = 1;
+        skip_whitespace();
+    }
+    if (*p != ')') {
+        printf("Error: Expected ')' after %s arguments\n", func);
+        error_flag = 1;
+        free_value(&arg);
+        return err;
+    }
+    p++;
+    if (error_flag) {
+        free_value(&arg);
+        return err;
+    }
+
+    const double *elems = arg.type == VAL_MATRIX ? arg.matrix.data : &arg.scalar;
+    size_t n = arg.type == VAL_MATRIX ? (size_t)arg.matrix.rows * arg.matrix.cols : 1;
+    if (strcmp(func, "save") == 0) {
+        if (!has_arg) {
+            printf("Error: save() needs a value to write\n");
+            error_flag = 1;
+            return err;
+        }
+        long rows = csv_save(path, elems, arg.type == VAL_MATRIX ? arg.matrix.rows : 1,
+                             arg.type == VAL_MATRIX ? arg.matrix.cols : 1);
+        free_value(&arg);
+        if (rows < 0) {
+            printf("Error: %s: %s\n", path, strerror(errno));
+            error_flag = 1;
+            return err;
+        }
+        return (Value){ .type = VAL_SCALAR, .scalar = (double)rows };
+    }
+
+    char msg[300];
+    int rows, cols;
+    double *data = csv_load(path, elems, has_arg ? n : 0, &rows, &cols, msg, sizeof(msg));
+    free_value(&arg);
+    if (!data) {
+        printf("Error: %s\n", msg);
+        error_flag = 1;
+        return err;
+    }
+    Value ret = { .type = VAL_MATRIX, .matrix = { rows, cols, data } };
+    return ret;
+}
+
+/* --- Batch Mode: Compiled Scripts --- */
+
+/*
+ * "cmath -b script.m" compiles the whole script to bytecode once and runs it
+ * on a small stack machine instead of re-parsing every line. On top of the
+ * interactive syntax, batch scripts support:
+ *   - ranges:       t = 0:0.001:10 (start:step:stop) or k = 1:n
+ *   - comparisons:  <, <=, >, >=, ==, ~= (element-wise, giving 1 or 0)
+ *   - indexing:     x(3), x(2:5) and x(i) = value (1-based, over all elements
+ *                   in column-major order, as in MATLAB)
+ *   - loops:        for k = 1:10 ... end, while cond ... end, break, continue
+ *   - conditionals: if cond ... elseif cond ... else ... end
+ *   - functions:    sum, mean, min, max, length, zeros(n), ones(n), zeros(r, c),
+ *                   ones(r, c)
+ *   - files:        load("file.csv", cols) and save("file.csv", X)
+ *   - comments:     from '%' or '#' to the end of the line
+ * Errors stop the script and report its line number.
+ * Variable names are hashed to fixed slots at compile time. Every stack cell
+ * owns an element buffer that is reused from one operation to the next, so
+ * vector math inside loops stops allocating after the first iteration.
+ */
+
+#define BATCH_MAX_NESTING 64
+
+typedef enum {
+    TOK_EOF,
+    TOK_NEWLINE,
+    TOK_NUM,
+    TOK_IDENT,
+    TOK_STR,
+    TOK_OP
+} TokenKind;
+
+typedef struct {
+    TokenKind kind;
+    int line;
+    double num;
+    char text[32];      // identifier or operator spelling
+    int str;            // index into the string table for TOK_STR
+} Token;
+
+typedef enum {
+    OP_CONST, OP_LOAD, OP_STORE, OP_INDEX, OP_STORE_INDEX,
+    OP_PRINT, OP_PRINT_VAR, OP_PRINT_STR, OP_POP, OP_LIST, OP_HALT,
+    OP_NEG, OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_POW,
+    OP_EMUL, OP_EDIV, OP_EPOW,
+    OP_LT, OP_LE, OP_GT, OP_GE, OP_EQ, OP_NE,
+    OP_RANGE, OP_RANGE_STEP, OP_MATRIX, OP_CALL, OP_REDUCE, OP_LOAD_CSV, OP_SAVE_CSV,
+    OP_JUMP, OP_JUMP_FALSE, OP_FOR_INIT, OP_FOR_NEXT
+} OpCode;
+
+typedef struct {
+    OpCode op;
+    int a, b, c;        // operands: constant, slot, loop, jump target...
+    int line;           // script line for error messages
+} Instr;
+
+/* Element-wise functions, the same set call_function() knows */
+static const struct {
+    const char *name;
+    double (*fn)(double);
+} batch_math[] = {
+    { "sin", sin }, { "cos", cos }, { "tan", tan },
+    { "asin", asin }, { "acos", acos }, { "atan", atan },
+    { "log", log }, { "log10", log10 }, { "sqrt", sqrt }, { "exp", exp },
+    { "abs", fabs }, { "sinh", sinh }, { "cosh", cosh }, { "tanh", tanh },
+    { "floor", floor }, { "ceil", ceil }
+};
+
+enum { FN_SUM, FN_MEAN, FN_MIN, FN_MAX, FN_LENGTH, FN_ZEROS, FN_ONES };
+static const char *const batch_reduce[] = {
+    "sum", "mean", "min", "max", "length", "zeros", "ones"
+};
+
+static const char *const batch_keywords[] = {
+    "for", "while", "if", "elseif", "else", "end", "break", "continue",
+    "print", "list", "exit", "quit"
+};
+
+typedef struct {
+    int continue_target;
+    int *breaks;        // JUMPs to patch with the loop exit
+    int nbreaks, capbreaks;
+} LoopContext;
+
+typedef struct {
+    Token *toks;
+    int ntoks, captoks, pos;
+    Instr *code;
+    int ncode, capcode;
+    double *consts;
+    int nconsts, capconsts;
+    char **strs;
+    int nstrs, capstrs;
+    char (*names)[32];  // variable name of each slot
+    int nvars, capvars;
+    int *hash;          // open addressing, slot + 1 or 0 when empty
+    int hashcap;
+    int nloops;         // for-loop states needed at run time
+    LoopContext loops[BATCH_MAX_NESTING];
+    int depth;
+    int failed;
+} Compiler;
+
+/* Grow a dynamic array to hold at least need elements */
+static void *batch_grow(void *arr, int *cap, int need, size_t size) {
+    if (need <= *cap)
+        return arr;
+    int ncap = *cap ? *cap * 2 : 16;
+    while (ncap < need)
+        ncap *= 2;
+    void *grown = realloc(arr, (size_t)ncap * size);
+    if (!grown) {
+        printf("Error: Memory allocation failed\n");
+        exit(1);
+    }
+    *cap = ncap;
+    return grown;
+}
+
+static void compile_error(Compiler *C, int line, const char *msg, const char *what) {
+    if (C->failed)
+        return;
+    fprintf(stderr, "Error: line %d: %s%s%s\n", line, msg, what ? " " : "", what ? what : "");
+    C->failed = 1;
+}
+
+static int is_keyword(const char *s) {
+    for (size_t i = 0; i < sizeof(batch_keywords) / sizeof(batch_keywords[0]); i++)
+        if (strcmp(s, batch_keywords[i]) == 0)
+            return 1;
+    return 0;
+}
+
+/* Split the script into tokens */
+static void batch_lex(Compiler *C, const char *src) {
+    int line = 1;
+    const char *s = src;
+    while (!C->failed) {
+        while (*s == ' ' || *s == '\t' || *s == '\r')
+            s++;
+        if (*s == '%' || *s == '#') {
+            while (*s && *s != '\n')
+                s++;
+        }
+        C->toks = batch_grow(C->toks, &C->captoks, C->ntoks + 1, sizeof(Token));
+        Token *t = &C->toks[C->ntoks++];
+        memset(t, 0, sizeof(*t));
+        t->line = line;
+        if (*s == '\0') {
+            t->kind = TOK_EOF;
+            return;
+        }
+        if (*s == '\n') {
+            t->kind = TOK_NEWLINE;
+            line++;
+            s++;
+        } else if (isdigit((unsigned char)*s) || (*s == '.' && isdigit((unsigned char)s[1]))) {
+            char *end;
+            t->kind = TOK_NUM;
+            t->num = strtod(s, &end);
+            /* "2.^x" is 2 .^ x, not 2. ^ x */
+            if (end[-1] == '.' && (*end == '*' || *end == '/' || *end == '^')) {
+                end--;
+                t->num = strtod(s, NULL);
+            }
+            s = end;
+        } else if (isalpha((unsigned char)*s) || *s == '_') {
+            int i = 0;
+            t->kind = TOK_IDENT;
+            while (isalnum((unsigned char)*s) || *s == '_') {
+                if (i < (int)sizeof(t->text) - 1)
+                    t->text[i++] = *s;
+                s++;
+            }
+            t->text[i] = '\0';
+        } else if (*s == '"') {
+            const char *end = strchr(s + 1, '"');
+            const char *nl = strchr(s + 1, '\n');
+            if (!end || (nl && nl < end)) {
+                compile_error(C, line, "Unterminated string literal", NULL);
+                return;
+            }
+            C->strs = batch_grow(C->strs, &C->capstrs, C->nstrs + 1, sizeof(char *));
+            C->strs[C->nstrs] = strndup(s + 1, (size_t)(end - s - 1));
+            t->kind = TOK_STR;
+            t->str = C->nstrs++;
+            s = end + 1;
+        } else {
+            static const char *const two[] = { ".*", "./", ".^", "==", "~=", "!=", "<=", ">=" };
+            t->kind = TOK_OP;
+            for (size_t i = 0; i < sizeof(two) / sizeof(two[0]); i++) {
+                if (s[0] == two[i][0] && s[1] == two[i][1]) {
+                    memcpy(t->text, s, 2);
+                    s += 2;
+                    break;
+                }
+            }
+            if (t->text[0] == '\0') {
+                if (!strchr("+-*/^()[],;:=<>", *s)) {
+                    char bad[2] = { *s, '\0' };
+                    compile_error(C, line, "Unexpected character", bad);
+                    return;
+                }
+                t->text[0] = *s++;
+            }
+        }
+    }
+}
+
+static Token *peek(Compiler *C) {
+    return &C->toks[C->pos];
+}
+
+static int is_op(const Token *t, const char *op) {
+    return t->kind == TOK_OP && strcmp(t->text, op) == 0;
+}
+
+static int is_word(const Token *t, const char *word) {
+    return t->kind == TOK_IDENT && strcmp(t->text, word) == 0;
+}
+
+static int accept_op(Compiler *C, const char *op) {
+    if (!is_op(peek(C), op))
+        return 0;
+    C->pos++;
+    return 1;
+}
+
+static const char *token_desc(const Token *t) {
+    switch (t->kind) {
+    case TOK_EOF:     return "end of script";
+    case TOK_NEWLINE: return "end of line";
+    case TOK_NUM:     return "number";
+    case TOK_STR:     return "string";
+    default:          return t->text;
+    }
+}
+
+static void expect_op(Compiler *C, const char *op) {
+    if (!accept_op(C, op)) {
+        char msg[48];
+        snprintf(msg, sizeof(msg), "Expected '%s' but found", op);
+        compile_error(C, peek(C)->line, msg, token_desc(peek(C)));
+    }
+}
+
+static int emit(Compiler *C, OpCode op, int a, int b, int line) {
+    C->code = batch_grow(C->code, &C->capcode, C->ncode + 1, sizeof(Instr));
+    C->code[C->ncode] = (Instr){ .op = op, .a = a, .b = b, .c = -1, .line = line };
+    return C->ncode++;
+}
+
+static unsigned name_hash(const char *s) {
+    unsigned h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Slot of a variable, assigned on first use */
+static int symbol_slot(Compiler *C, const char *name) {
+    if ((C->nvars + 1) * 2 > C->hashcap) {
+        int cap = C->hashcap ? C->hashcap * 2 : 64;
+        int *hash = calloc((size_t)cap, sizeof(int));
+        if (!hash) {
+            printf("Error: Memory allocation failed\n");
+            exit(1);
+        }
+        for (int i = 0; i < C->nvars; i++) {
+            unsigned h = name_hash(C->names[i]) & (unsigned)(cap - 1);
+            while (hash[h])
+                h = (h + 1) & (unsigned)(cap - 1);
+            hash[h] = i + 1;
+        }
+        free(C->hash);
+        C->hash = hash;
+        C->hashcap = cap;
+    }
+    unsigned h = name_hash(name) & (unsigned)(C->hashcap - 1);
+    while (C->hash[h]) {
+        if (strcmp(C->names[C->hash[h] - 1], name) == 0)
+            return C->hash[h] - 1;
+        h = (h + 1) & (unsigned)(C->hashcap - 1);
+    }
+    C->names = batch_grow(C->names, &C->capvars, C->nvars + 1, sizeof(*C->names));
+    strcpy(C->names[C->nvars], name);
+    C->hash[h] = C->nvars + 1;
+    return C->nvars++;
+}
+
+static int find_name(const char *name, const char *const *names, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        if (strcmp(name, names[i]) == 0)
+            return (int)i;
+    return -1;
+}
+
+static int is_csv_call(const char *name) {
+    return strcmp(name, "load") == 0 || strcmp(name, "save") == 0;
+}
+
+static int find_math(const char *name) {
+    for (size_t i = 0; i < sizeof(batch_math) / sizeof(batch_math[0]); i++)
+        if (strcmp(name, batch_math[i].name) == 0)
+            return (int)i;
+    return -1;
+}
+
+static void compile_expr(Compiler *C);
+
+/*
+ * compile_matrix:
+ *   '[' [ expr { ',' expr } { (';' | newline) expr { ',' expr } } ] ']'
+ */
+static void compile_matrix(Compiler *C) {
+    int line = peek(C)->line;
+    int rows = 0, cols = -1;
+    C->pos++;
+    while (peek(C)->kind == TOK_NEWLINE)
+        C->pos++;
+    while (!C->failed && !accept_op(C, "]")) {
+        int n = 0;
+        do {
+            compile_expr(C);
+            n++;
+        } while (!C->failed && accept_op(C, ","));
+        if (cols == -1)
+            cols = n;
+        else if (n != cols)
+            compile_error(C, line, "Inconsistent number of columns in matrix literal", NULL);
+        rows++;
+        if (is_op(peek(C), ";") || peek(C)->kind == TOK_NEWLINE) {
+            while (is_op(peek(C), ";") || peek(C)->kind == TOK_NEWLINE)
+                C->pos++;
+        } else if (!is_op(peek(C), "]")) {
+            compile_error(C, peek(C)->line, "Expected ';' or ']' in matrix literal, found",
+                          token_desc(peek(C)));
+        }
+    }
+    emit(C, OP_MATRIX, rows, rows ? cols : 0, line);
+}
+
+/*
+ * compile_primary:
+ *   primary -> number | variable | variable '(' expr ')' | function '(' expr ')'
+ *            | matrix_literal | '(' expr ')' | unary +/- primary
+ */
+static void compile_primary(Compiler *C) {
+    Token *t = peek(C);
+    int line = t->line;
+    if (t->kind == TOK_NUM) {
+        C->pos++;
+        C->consts = batch_grow(C->consts, &C->capconsts, C->nconsts + 1, sizeof(double));
+        C->consts[C->nconsts] = t->num;
+        emit(C, OP_CONST, C->nconsts++, 0, line);
+    } else if (is_op(t, "(")) {
+        C->pos++;
+        compile_expr(C);
+        expect_op(C, ")");
+    } else if (is_op(t, "[")) {
+        compile_matrix(C);
+    } else if (is_op(t, "-")) {
+        C->pos++;
+        compile_primary(C);
+        emit(C, OP_NEG, 0, 0, line);
+    } else if (is_op(t, "+")) {
+        C->pos++;
+        compile_primary(C);
+    } else if (t->kind == TOK_IDENT && is_csv_call(t->text) && is_op(&t[1], "(")) {
+        /* load("file.csv"[, cols]) or save("file.csv", value) */
+        int save = t->text[0] == 's';
+        C->pos += 2;
+        Token *path = peek(C);
+        if (path->kind != TOK_STR) {
+            compile_error(C, line, "Expected a quoted file name in", t->text);
+            return;
+        }
+        C->pos++;
+        int has_arg = accept_op(C, ",");
+        if (has_arg)
+            compile_expr(C);
+        else if (save)
+            compile_error(C, line, "save() needs a value to write", NULL);
+        expect_op(C, ")");
+        emit(C, save ? OP_SAVE_CSV : OP_LOAD_CSV, path->str, has_arg, line);
+    } else if (t->kind == TOK_IDENT && !is_keyword(t->text)) {
+        C->pos++;
+        if (accept_op(C, "(")) {
+            int fn = find_math(t->text);
+            int red = find_name(t->text, batch_reduce, sizeof(batch_reduce) / sizeof(batch_reduce[0]));
+            int slot = (fn < 0 && red < 0) ? symbol_slot(C, t->text) : -1;
+            compile_expr(C);
+            /* zeros(r, c) and ones(r, c) take a second size */
+            int nargs = 1;
+            if ((red == FN_ZEROS || red == FN_ONES) && accept_op(C, ",")) {
+                compile_expr(C);
+                nargs = 2;
+            }
+            expect_op(C, ")");
+            if (fn >= 0)
+                emit(C, OP_CALL, fn, 0, line);
+            else if (red >= 0)
+                emit(C, OP_REDUCE, red, nargs, line);
+            else
+                emit(C, OP_INDEX, slot, 0, line);
+        } else {
+            emit(C, OP_LOAD, symbol_slot(C, t->text), 0, line);
+        }
+    } else {
+        compile_error(C, line, "Unexpected", token_desc(t));
+    }
+}
+
+/*
+ * compile_factor:
+ *   factor -> primary { (".^" | "^") factor }
+ */
+static void compile_factor(Compiler *C) {
+    compile_primary(C);
+    while (!C->failed) {
+        int line = peek(C)->line;
+        OpCode op;
+        if (accept_op(C, ".^"))
+            op = OP_EPOW;
+        else if (accept_op(C, "^"))
+            op = OP_POW;
+        else
+            break;
+        compile_factor(C);
+        emit(C, op, 0, 0, line);
+    }
+}
+
+/*
+ * compile_term:
+ *   term -> factor { (".*" | "./" | "*" | "/") factor }
+ */
+static void compile_term(Compiler *C) {
+    compile_factor(C);
+    while (!C->failed) {
+        int line = peek(C)->line;
+        OpCode op;
+        if (accept_op(C, ".*"))
+            op = OP_EMUL;
+        else if (accept_op(C, "./"))
+            op = OP_EDIV;
+        else if (accept_op(C, "*"))
+            op = OP_MUL;
+        else if (accept_op(C, "/"))
+            op = OP_DIV;
+        else
+            break;
+        compile_factor(C);
+        emit(C, op, 0, 0, line);
+    }
+}
+
+/*
+ * compile_sum:
+ *   sum -> term { ('+' | '-') term }
+ */
+static void compile_sum(Compiler *C) {
+    compile_term(C);
+    while (!C->failed) {
+        int line = peek(C)->line;
+        OpCode op;
+        if (accept_op(C, "+"))
+            op = OP_ADD;
+        else if (accept_op(C, "-"))
+            op = OP_SUB;
+        else
+            break;
+        compile_term(C);
+        emit(C, op, 0, 0, line);
+    }
+}
+
+/*
+ * compile_range:
+ *   range -> sum [ ':' sum [ ':' sum ] ]
+ */
+static void compile_range(Compiler *C) {
+    compile_sum(C);
+    int line = peek(C)->line;
+    if (accept_op(C, ":")) {
+        compile_sum(C);
+        if (accept_op(C, ":")) {
+            compile_sum(C);
+            emit(C, OP_RANGE_STEP, 0, 0, line);
+        } else {
+            emit(C, OP_RANGE, 0, 0, line);
+        }
+    }
+}
+
+/*
+ * compile_expr:
+ *   expr -> range { ('<' | "<=" | '>' | ">=" | "==" | "~=") range }
+ */
+static void compile_expr(Compiler *C) {
+    static const struct { const char *op; OpCode code; } cmp[] = {
+        { "<", OP_LT }, { "<=", OP_LE }, { ">", OP_GT }, { ">=", OP_GE },
+        { "==", OP_EQ }, { "~=", OP_NE }, { "!=", OP_NE }
+    };
+    compile_range(C);
+    while (!C->failed) {
+        int line = peek(C)->line;
+        int found = -1;
+        for (size_t i = 0; i < sizeof(cmp) / sizeof(cmp[0]) && found < 0; i++)
+            if (accept_op(C, cmp[i].op))
+                found = (int)i;
+        if (found < 0)
+            break;
+        compile_range(C);
+        emit(C, cmp[found].code, 0, 0, line);
+    }
+}
+
+/* Consume the end of a statement; returns 1 if a ';' suppresses its output */
+static int compile_terminator(Compiler *C) {
+    Token *t = peek(C);
+    if (accept_op(C, ";"))
+        return 1;
+    if (accept_op(C, ",") || t->kind == TOK_NEWLINE || t->kind == TOK_EOF ||
+        is_word(t, "end") || is_word(t, "else") || is_word(t, "elseif"))
+        return 0;
+    compile_error(C, t->line, "Unexpected", token_desc(t));
+    return 0;
+}
+
+static void compile_block(Compiler *C);
+
+static void expect_end(Compiler *C, const char *what, int line) {
+    if (is_word(peek(C), "end")) {
+        C->pos++;
+    } else {
+        char msg[48];
+        snprintf(msg, sizeof(msg), "Missing 'end' for '%s' started on line %d", what, line);
+        compile_error(C, peek(C)->line, msg, NULL);
+    }
+}
+
+static void loop_begin(Compiler *C, int continue_target, int line) {
+    if (C->depth == BATCH_MAX_NESTING) {
+        compile_error(C, line, "Loops nested too deeply", NULL);
+        return;
+    }
+    LoopContext *L = &C->loops[C->depth++];
+    L->continue_target = continue_target;
+    L->nbreaks = 0;
+}
+
+static void loop_end(Compiler *C, int exit_target) {
+    if (C->failed)
+        return;
+    LoopContext *L = &C->loops[--C->depth];
+    for (int i = 0; i < L->nbreaks; i++)
+        C->code[L->breaks[i]].a = exit_target;
+}
+
+/* Compile one statement, including any block it opens */
+static void compile_statement(Compiler *C) {
+    Token *t = peek(C);
+    int line = t->line;
+    if (is_word(t, "for")) {
+        C->pos++;
+        Token *var = peek(C);
+        if (var->kind != TOK_IDENT || is_keyword(var->text)) {
+            compile_error(C, line, "Expected a loop variable after 'for'", NULL);
+            return;
+        }
+        C->pos++;
+        int slot = symbol_slot(C, var->text);
+        expect_op(C, "=");
+        compile_expr(C);
+        int loop = C->nloops++;
+        emit(C, OP_FOR_INIT, loop, 0, line);
+        int top = emit(C, OP_FOR_NEXT, loop, slot, line);
+        loop_begin(C, top, line);
+        compile_block(C);
+        expect_end(C, "for", line);
+        emit(C, OP_JUMP, top, 0, line);
+        if (!C->failed)
+            C->code[top].c = C->ncode;
+        loop_end(C, C->ncode);
+    } else if (is_word(t, "while")) {
+        C->pos++;
+        int top = C->ncode;
+        compile_expr(C);
+        int jf = emit(C, OP_JUMP_FALSE, -1, 0, line);
+        loop_begin(C, top, line);
+        compile_block(C);
+        expect_end(C, "while", line);
+        emit(C, OP_JUMP, top, 0, line);
+        C->code[jf].a = C->ncode;
+        loop_end(C, C->ncode);
+    } else if (is_word(t, "if")) {
+        int ends[BATCH_MAX_NESTING + 1], nends = 0;
+        C->pos++;
+        compile_expr(C);
+        int jf = emit(C, OP_JUMP_FALSE, -1, 0, line);
+        compile_block(C);
+        while (!C->failed && is_word(peek(C), "elseif")) {
+            if (nends == BATCH_MAX_NESTING) {
+                compile_error(C, peek(C)->line, "Too many 'elseif' branches", NULL);
+                return;
+            }
+            ends[nends++] = emit(C, OP_JUMP, -1, 0, line);
+            C->code[jf].a = C->ncode;
+            C->pos++;
+            compile_expr(C);
+            jf = emit(C, OP_JUMP_FALSE, -1, 0, line);
+            compile_block(C);
+        }
+        if (!C->failed && is_word(peek(C), "else")) {
+            ends[nends++] = emit(C, OP_JUMP, -1, 0, line);
+            C->code[jf].a = C->ncode;
+            jf = -1;
+            C->pos++;
+            compile_block(C);
+        }
+        expect_end(C, "if", line);
+        if (jf >= 0)
+            C->code[jf].a = C->ncode;
+        for (int i = 0; i < nends; i++)
+            C->code[ends[i]].a = C->ncode;
+    } else if (is_word(t, "break") || is_word(t, "continue")) {
+        C->pos++;
+        if (C->depth == 0) {
+            compile_error(C, line, t->text, "outside of a loop");
+            return;
+        }
+        LoopContext *L = &C->loops[C->depth - 1];
+        if (t->text[0] == 'c') {
+            emit(C, OP_JUMP, L->continue_target, 0, line);
+        } else {
+            L->breaks = batch_grow(L->breaks, &L->capbreaks, L->nbreaks + 1, sizeof(int));
+            L->breaks[L->nbreaks++] = emit(C, OP_JUMP, -1, 0, line);
+        }
+        compile_terminator(C);
+    } else if (is_word(t, "print")) {
+        C->pos++;
+        Token *s = peek(C);
+        if (s->kind != TOK_STR) {
+            compile_error(C, line, "Expected string literal after print command", NULL);
+            return;
+        }
+        C->pos++;
+        if (!compile_terminator(C))
+            emit(C, OP_PRINT_STR, s->str, 0, line);
+    } else if (is_word(t, "list")) {
+        C->pos++;
+        compile_terminator(C);
+        emit(C, OP_LIST, 0, 0, line);
+    } else if (is_word(t, "exit") || is_word(t, "quit")) {
+        C->pos++;
+        compile_terminator(C);
+        emit(C, OP_HALT, 0, 0, line);
+    } else if (t->kind == TOK_IDENT && !is_keyword(t->text) && is_op(&t[1], "=")) {
+        /* variable = expression */
+        int slot = symbol_slot(C, t->text);
+        C->pos += 2;
+        compile_expr(C);
+        int quiet = compile_terminator(C);
+        emit(C, OP_STORE, slot, 0, line);
+        if (!quiet)
+            emit(C, OP_PRINT_VAR, slot, 0, line);
+    } else {
+        /* variable(index) = expression, or an expression to print */
+        int assign = 0;
+        if (t->kind == TOK_IDENT && is_op(&t[1], "(") && !is_keyword(t->text) &&
+            find_math(t->text) < 0 && !is_csv_call(t->text) &&
+            find_name(t->text, batch_reduce, sizeof(batch_reduce) / sizeof(batch_reduce[0])) < 0) {
+            int depth = 0, i = C->pos + 1;
+            for (; C->toks[i].kind != TOK_EOF && C->toks[i].kind != TOK_NEWLINE; i++) {
+                if (is_op(&C->toks[i], "(") || is_op(&C->toks[i], "["))
+                    depth++;
+                else if ((is_op(&C->toks[i], ")") || is_op(&C->toks[i], "]")) && --depth == 0)
+                    break;
+            }
+            assign = depth == 0 && is_op(&C->toks[i], ")") && is_op(&C->toks[i + 1], "=");
+        }
+        if (assign) {
+            int slot = symbol_slot(C, t->text);
+            C->pos += 2;
+            compile_expr(C);
+            expect_op(C, ")");
+            expect_op(C, "=");
+            compile_expr(C);
+            int quiet = compile_terminator(C);
+            emit(C, OP_STORE_INDEX, slot, 0, line);
+            if (!quiet)
+                emit(C, OP_PRINT_VAR, slot, 0, line);
+        } else {
+            compile_expr(C);
+            emit(C, compile_terminator(C) ? OP_POP : OP_PRINT, 0, 0, line);
+        }
+    }
+}
+
+/* Compile statements up to 'end', 'else', 'elseif' or the end of the script */
+static void compile_block(Compiler *C) {
+    while (!C->failed) {
+        Token *t = peek(C);
+        if (t->kind == TOK_NEWLINE || is_op(t, ";") || is_op(t, ",")) {
+            C->pos++;
+            continue;
+        }
+        if (t->kind == TOK_EOF || is_word(t, "end") || is_word(t, "else") || is_word(t, "elseif"))
+            return;
+        compile_statement(C);
+    }
+}
+
+/* --- Batch Mode: Stack Machine --- */
+
+typedef struct {
+    int is_matrix;
+    int rows, cols;
+    double scalar;
+    double *data;       // matrix elements; equal to buf when the cell owns them
+    double *buf;        // element buffer owned by the cell, reused between operations
+    size_t cap;
+} Cell;
+
+typedef struct {
+    Cell seq;           // values the loop walks through
+    size_t pos;
+} ForState;
+
+typedef struct {
+    Cell *vars;
+    unsigned char *defined;
+    Cell *stack;
+    ForState *fors;
+    Cell scratch;       // matrix products are built here and swapped in
+} Machine;
+
+static size_t cell_count(const Cell *c) {
+    return c->is_matrix ? (size_t)c->rows * (size_t)c->cols : 1;
+}
+
+static const double *cell_elems(const Cell *c) {
+    return c->is_matrix ? c->data : &c->scalar;
+}
+
+static int cell_owned(const Cell *c) {
+    return c->is_matrix && c->data == c->buf;
+}
+
+/* Make the cell's own buffer hold at least n elements */
+static double *cell_reserve(Cell *c, size_t n) {
+    if (n > c->cap) {
+        double *buf = realloc(c->buf, n * sizeof(double));
+        if (!buf) {
+            printf("Error: Memory allocation failed\n");
+            exit(1);
+        }
+        c->buf = buf;
+        c->cap = n;
+    }
+    return c->buf;
+}
+
+static void cell_swap_buffers(Cell *a, Cell *b) {
+    double *buf = a->buf;
+    size_t cap = a->cap;
+    a->buf = b->buf;
+    a->cap = b->cap;
+    b->buf = buf;
+    b->cap = cap;
+}
+
+static void cell_set_matrix(Cell *c, int rows, int cols) {
+    c->is_matrix = 1;
+    c->rows = rows;
+    c->cols = cols;
+    c->data = c->buf;
+}
+
+/* Move or copy the value of src into dst, keeping dst's buffer when possible */
+static void cell_assign(Cell *dst, Cell *src) {
+    if (!src->is_matrix) {
+        dst->is_matrix = 0;
+        dst->scalar = src->scalar;
+        return;
+    }
+    if (cell_owned(src)) {
+        cell_swap_buffers(dst, src);
+    } else if (src->data != dst->buf) {
+        size_t n = cell_count(src);
+        cell_reserve(dst, n);
+        if (n)
+            memcpy(dst->buf, src->data, n * sizeof(double));
+    }
+    cell_set_matrix(dst, src->rows, src->cols);
+}
+
+static Value cell_value(const Cell *c) {
+    Value v;
+    if (c->is_matrix) {
+        v.type = VAL_MATRIX;
+        v.matrix.rows = c->rows;
+        v.matrix.cols = c->cols;
+        v.matrix.data = c->data;
+    } else {
+        v.type = VAL_SCALAR;
+        v.scalar = c->scalar;
+    }
+    return v;
+}
+
+static int vm_error(const Instr *in, const char *msg, const char *what) {
+    fprintf(stderr, "Error: line %d: %s%s%s\n", in->line, msg, what ? " " : "", what ? what : "");
+    return -1;
+}
+
+/* Output buffer for an element-wise result of n elements left in cell a,
+   computed in place over an operand whenever one owns its elements. */
+static double *elementwise_dest(Cell *a, Cell *b, size_t n) {
+    if (cell_owned(a))
+        return a->buf;
+    if (b && cell_owned(b)) {
+        cell_swap_buffers(a, b);
+        return a->buf;
+    }
+    return cell_reserve(a, n);
+}
+
+#define VEC_APPLY(expr)                                                           \
+    do {                                                                          \
+        if (xs && ys) {                                                           \
+            for (size_t i = 0; i < n; i++) {                                      \
+                double u = x[i], v = y[i];                                        \
+                out[i] = (expr);                                                  \
+            }                                                                     \
+        } else if (xs) {                                                          \
+            double v = y[0];                                                      \
+            for (size_t i = 0; i < n; i++) {                                      \
+                double u = x[i];                                                  \
+                out[i] = (expr);                                                  \
+            }                                                                     \
+        } else {                                                                  \
+            double u = x[0];                                                      \
+            for (size_t i = 0; i < n; i++) {                                      \
+                double v = y[i];                                                  \
+                out[i] = (expr);                                                  \
+            }                                                                     \
+        }                                                                         \
+    } while (0)
+
+/* out[i] = x[i] op y[i] over n elements; a stride of 0 repeats a scalar */
+static void vec_binary(OpCode op, const double *x, int xs, const double *y, int ys,
+                       double *out, size_t n) {
+    switch (op) {
+    case OP_ADD:  VEC_APPLY(u + v); break;
+    case OP_SUB:  VEC_APPLY(u - v); break;
+    case OP_MUL:
+    case OP_EMUL: VEC_APPLY(u * v); break;
+    case OP_DIV:
+    case OP_EDIV: VEC_APPLY(u / v); break;
+    case OP_EPOW: VEC_APPLY(pow(u, v)); break;
+    case OP_LT:   VEC_APPLY((double)(u < v)); break;
+    case OP_LE:   VEC_APPLY((double)(u <= v)); break;
+    case OP_GT:   VEC_APPLY((double)(u > v)); break;
+    case OP_GE:   VEC_APPLY((double)(u >= v)); break;
+    case OP_EQ:   VEC_APPLY((double)(u == v)); break;
+    case OP_NE:   VEC_APPLY((double)(u != v)); break;
+    default: break;
+    }
+}
+
+static int vm_matmul(Machine *M, const Instr *in, Cell *a, const Cell *b) {
+    if (a->cols != b->rows)
+        return vm_error(in, "Matrix dimensions do not match for multiplication", NULL);
+    int m = a->rows, n = a->cols, p_ = b->cols;
+    double *out = cell_reserve(&M->scratch, (size_t)m * p_);
+    for (int i = 0; i < m; i++) {
+        double *row = out + (size_t)i * p_;
+        for (int j = 0; j < p_; j++)
+            row[j] = 0;
+        for (int k = 0; k < n; k++) {
+            double aik = a->data[(size_t)i * n + k];
+            const double *brow = b->data + (size_t)k * p_;
+            for (int j = 0; j < p_; j++)
+                row[j] += aik * brow[j];
+        }
+    }
+    cell_swap_buffers(a, &M->scratch);
+    cell_set_matrix(a, m, p_);
+    return 0;
+}
+
+/* a = a op b for arithmetic and comparison operators */
+static int vm_binary(Machine *M, const Instr *in, Cell *a, Cell *b) {
+    OpCode op = in->op;
+    if (!a->is_matrix && !b->is_matrix) {
+        double x = a->scalar, y = b->scalar;
+        if ((op == OP_DIV || op == OP_EDIV) && y == 0)
+            return vm_error(in, "Division by zero", NULL);
+        if (op == OP_POW)
+            op = OP_EPOW;
+        vec_binary(op, &x, 0, &y, 0, &a->scalar, 1);
+        return 0;
+    }
+    if (op == OP_MUL && a->is_matrix && b->is_matrix)
+        return vm_matmul(M, in, a, b);
+    if (op == OP_POW)
+        return vm_error(in, "Exponentiation (^) is only supported for scalars", NULL);
+    if (op == OP_DIV && b->is_matrix)
+        return vm_error(in, "Division is only supported scalar/scalar or matrix/scalar", NULL);
+    if (a->is_matrix && b->is_matrix && (a->rows != b->rows || a->cols != b->cols))
+        return vm_error(in, "Matrix dimension mismatch", NULL);
+    const Cell *m = a->is_matrix ? a : b;
+    int rows = m->rows, cols = m->cols;
+    size_t n = cell_count(m);
+    const double *x = cell_elems(a), *y = cell_elems(b);
+    int xs = a->is_matrix, ys = b->is_matrix;
+    if (op == OP_DIV || op == OP_EDIV) {
+        size_t zeros = 0, ny = ys ? n : 1;
+        for (size_t i = 0; i < ny; i++)
+            zeros += y[i] == 0;
+        if (zeros)
+            return vm_error(in, "Division by zero", NULL);
+    }
+    double *out = elementwise_dest(a, b, n);
+    vec_binary(op, x, xs, y, ys, out, n);
+    cell_set_matrix(a, rows, cols);
+    return 0;
+}
+
+/* Replace the scalars start[:step]:stop at c with the row vector they span */
+static int vm_range(const Instr *in, Cell *c, int nargs) {
+    for (int i = 0; i < nargs; i++)
+        if (c[i].is_matrix && cell_count(&c[i]) != 1)
+            return vm_error(in, "Range bounds must be scalars", NULL);
+    double start = cell_elems(&c[0])[0];
+    double step = nargs == 3 ? cell_elems(&c[1])[0] : 1;
+    double stop = cell_elems(&c[nargs - 1])[0];
+    double q = (stop - start) / step;
+    size_t n = 0;
+    if (step != 0 && !isnan(q) && q >= 0) {
+        if (q > INT_MAX - 1)
+            return vm_error(in, "Range too large", NULL);
+        n = (size_t)floor(q + 1e-10) + 1;
+    }
+    double *out = cell_reserve(c, n);
+    for (size_t i = 0; i < n; i++)
+        out[i] = start + (double)i * step;
+    cell_set_matrix(c, 1, (int)n);
+    return 0;
+}
+
+/* Functions of one cell; zeros(r, c) and ones(r, c) also get the column count in cc */
+static int vm_reduce(const Instr *in, Cell *c, const Cell *cc) {
+    size_t n = cell_count(c);
+    const double *x = cell_elems(c);
+    double r = 0;
+    switch (in->a) {
+    case FN_SUM:
+    case FN_MEAN:
+        for (size_t i = 0; i < n; i++)
+            r += x[i];
+        if (in->a == FN_MEAN)
+            r /= (double)n;
+        break;
+    case FN_MIN:
+    case FN_MAX:
+        if (n == 0)
+            return vm_error(in, batch_reduce[in->a], "of an empty matrix");
+        r = x[0];
+        for (size_t i = 1; i < n; i++)
+            if (in->a == FN_MIN ? x[i] < r : x[i] > r)
+                r = x[i];
+        break;
+    case FN_LENGTH:
+        r = !c->is_matrix ? 1 : (c->rows == 0 || c->cols == 0) ? 0
+            : (c->rows > c->cols ? c->rows : c->cols);
+        break;
+    case FN_ZEROS:
+    case FN_ONES: {
+        /* zeros(n) is a 1 x n row, zeros(r, c) an r x c matrix */
+        double rows = 1, cols = n == 1 ? x[0] : -1;
+        if (cc) {
+            rows = cols;
+            cols = cell_count(cc) == 1 ? cell_elems(cc)[0] : -1;
+        }
+        if (rows < 0 || rows != floor(rows) || cols < 0 || cols != floor(cols) ||
+            rows * cols > INT_MAX)
+            return vm_error(in, batch_reduce[in->a],
+                            cc ? "needs non-negative integer sizes" : "needs a non-negative integer length");
+        size_t len = (size_t)rows * (size_t)cols;
+        double *out = cell_reserve(c, len);
+        double fill = in->a == FN_ONES ? 1 : 0;
+        for (size_t i = 0; i < len; i++)
+            out[i] = fill;
+        cell_set_matrix(c, (int)rows, (int)cols);
+        return 0;
+    }
+    }
+    c->is_matrix = 0;
+    c->scalar = r;
+    return 0;
+}
+
+/* Validate a 1-based index into n elements; returns it 0-based or -1 */
+static long vm_index(const Instr *in, double k, size_t n) {
+    if (k != floor(k) || k < 1 || k > (double)n) {
+        char what[48];
+        snprintf(what, sizeof(what), "%g out of bounds (1..%zu)", k, n);
+        vm_error(in, "Index", what);
+        return -1;
+    }
+    return (long)k - 1;
+}
+
+/* Offset of the 0-based linear index k, which runs down the columns, in row-major v */
+static size_t vm_linear(const Cell *v, long k) {
+    if (!v->is_matrix || v->rows <= 1 || v->cols <= 1)
+        return (size_t)k;
+    return (size_t)(k % v->rows) * (size_t)v->cols + (size_t)(k / v->rows);
+}
+
+static int cell_true(const Cell *c) {
+    size_t n = cell_count(c);
+    const double *x = cell_elems(c);
+    if (n == 0)
+        return 0;
+    for (size_t i = 0; i < n; i++)
+        if (x[i] == 0)
+            return 0;
+    return 1;
+}
+
+static int batch_execute(const Compiler *C) {
+    Machine M;
+    memset(&M, 0, sizeof(M));
+    M.vars = calloc((size_t)C->nvars + 1, sizeof(Cell));
+    M.defined = calloc((size_t)C->nvars + 1, 1);
+    M.stack = calloc((size_t)C->ncode + 1, sizeof(Cell));
+    M.fors = calloc((size_t)C->nloops + 1, sizeof(ForState));
+    if (!M.vars || !M.defined || !M.stack || !M.fors) {
+        printf("Error: Memory allocation failed\n");
+        exit(1);
+    }
+
+    int sp = 0, status = 0;
+    for (int pc = 0; pc < C->ncode && status == 0;) {
+        const Instr *in = &C->code[pc++];
+        Cell *top = sp > 0 ? &M.stack[sp - 1] : NULL;
+        switch (in->op) {
+        case OP_CONST: {
+            Cell *d = &M.stack[sp++];
+            d->is_matrix = 0;
+            d->scalar = C->consts[in->a];
+            break;
+        }
+        case OP_LOAD: {
+            Cell *v = &M.vars[in->a];
+            if (!M.defined[in->a]) {
+                char what[40];
+                snprintf(what, sizeof(what), "'%s'", C->names[in->a]);
+                status = vm_error(in, "Unknown variable", what);
+                break;
+            }
+            Cell *d = &M.stack[sp++];
+            d->is_matrix = v->is_matrix;
+            d->rows = v->rows;
+            d->cols = v->cols;
+            d->scalar = v->scalar;
+            d->data = v->data;
+            break;
+        }
+        case OP_STORE:
+            cell_assign(&M.vars[in->a], top);
+            M.defined[in->a] = 1;
+            sp--;
+            break;
+        case OP_INDEX: {
+            Cell *v = &M.vars[in->a];
+            if (!M.defined[in->a]) {
+                char what[40];
+                snprintf(what, sizeof(what), "'%s'", C->names[in->a]);
+                status = vm_error(in, "Unknown variable or function", what);
+                break;
+            }
+            size_t n = cell_count(v);
+            const double *src = cell_elems(v);
+            if (!top->is_matrix) {
+                long k = vm_index(in, top->scalar, n);
+                if (k < 0)
+                    status = -1;
+                else
+                    top->scalar = src[vm_linear(v, k)];
+                break;
+            }
+            size_t len = cell_count(top);
+            const double *idx = top->data;
+            double *out = elementwise_dest(top, NULL, len);
+            for (size_t i = 0; i < len && status == 0; i++) {
+                long k = vm_index(in, idx[i], n);
+                if (k < 0)
+                    status = -1;
+                else
+                    out[i] = src[vm_linear(v, k)];
+            }
+            /* a column vector gives a column, anything else a row */
+            if (v->is_matrix && v->cols == 1)
+                cell_set_matrix(top, (int)len, 1);
+            else
+                cell_set_matrix(top, 1, (int)len);
+            break;
+        }
+        case OP_STORE_INDEX: {
+            Cell *v = &M.vars[in->a], *idx = &M.stack[sp - 2];
+            if (!M.defined[in->a]) {
+                char what[40];
+                snprintf(what, sizeof(what), "'%s'", C->names[in->a]);
+                status = vm_error(in, "Unknown variable", what);
+                break;
+            }
+            if (cell_count(idx) != 1 || cell_count(top) != 1) {
+                status = vm_error(in, "Indexed assignment needs a scalar index and value", NULL);
+                break;
+            }
+            long k = vm_index(in, cell_elems(idx)[0], cell_count(v));
+            if (k < 0) {
+                status = -1;
+                break;
+            }
+            double x = cell_elems(top)[0];
+            if (v->is_matrix)
+                v->data[vm_linear(v, k)] = x;
+            else
+                v->scalar = x;
+            sp -= 2;
+            break;
+        }
+        case OP_PRINT:
+            print_value(cell_value(top));
+            sp--;
+            break;
+        case OP_PRINT_VAR:
+            printf("%s = ", C->names[in->a]);
+            print_value(cell_value(&M.vars[in->a]));
+            break;
+        case OP_PRINT_STR:
+            printf("%s\n", C->strs[in->a]);
+            break;
+        case OP_POP:
+            sp--;
+            break;
+        case OP_LIST: {
+            int any = 0;
+            for (int i = 0; i < C->nvars; i++) {
+                if (!M.defined[i])
+                    continue;
+                if (!any)
+                    printf("Stored variables:\n");
+                any = 1;
+                printf("  %s = ", C->names[i]);
+                print_value(cell_value(&M.vars[i]));
+            }
+            if (!any)
+                printf("No variables stored.\n");
+            break;
+        }
+        case OP_HALT:
+            pc = C->ncode;
+            break;
+        case OP_NEG:
+        case OP_CALL: {
+            double (*fn)(double) = in->op == OP_CALL ? batch_math[in->a].fn : NULL;
+            if (!top->is_matrix) {
+                top->scalar = fn ? fn(top->scalar) : -top->scalar;
+                break;
+            }
+            size_t n = cell_count(top);
+            const double *x = top->data;
+            double *out = elementwise_dest(top, NULL, n);
+            if (fn) {
+                for (size_t i = 0; i < n; i++)
+                    out[i] = fn(x[i]);
+            } else {
+                for (size_t i = 0; i < n; i++)
+                    out[i] = -x[i];
+            }
+            cell_set_matrix(top, top->rows, top->cols);
+            break;
+        }
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW:
+        case OP_EMUL: case OP_EDIV: case OP_EPOW:
+        case OP_LT: case OP_LE: case OP_GT: case OP_GE: case OP_EQ: case OP_NE:
+            status = vm_binary(&M, in, &M.stack[sp - 2], top);
+            sp--;
+            break;
+        case OP_RANGE:
+        case OP_RANGE_STEP: {
+            int nargs = in->op == OP_RANGE ? 2 : 3;
+            sp -= nargs;
+            status = vm_range(in, &M.stack[sp], nargs);
+            sp++;
+            break;
+        }
+        case OP_MATRIX: {
+            size_t n = (size_t)in->a * (size_t)in->b;
+            Cell *d = &M.stack[sp - n];
+            if (n == 0) {
+                d = &M.stack[sp++];
+                cell_set_matrix(d, 0, 0);
+                break;
+            }
+            for (size_t i = 0; i < n && status == 0; i++)
+                if (cell_count(&d[i]) != 1)
+                    status = vm_error(in, "Matrix literal elements must be scalars", NULL);
+            if (status)
+                break;
+            double first = cell_elems(d)[0];
+            double *out = cell_reserve(d, n);
+            out[0] = first;
+            for (size_t i = 1; i < n; i++)
+                out[i] = cell_elems(&d[i])[0];
+            cell_set_matrix(d, in->a, in->b);
+            sp -= (int)n - 1;
+            break;
+        }
+        case OP_REDUCE:
+            if (in->b == 2) {
+                sp--;
+                status = vm_reduce(in, &M.stack[sp - 1], top);
+            } else {
+                status = vm_reduce(in, top, NULL);
+            }
+            break;
+        case OP_LOAD_CSV: {
+            Cell *d = in->b ? top : &M.stack[sp++];
+            char msg[300];
+            int rows, cols;
+            double *data = csv_load(C->strs[in->a], in->b ? cell_elems(d) : NULL,
+                                    in->b ? cell_count(d) : 0, &rows, &cols, msg, sizeof(msg));
+            if (!data) {
+                status = vm_error(in, msg, NULL);
+                break;
+            }
+            free(d->buf);
+            d->buf = data;
+            d->cap = (size_t)rows * (size_t)cols;
+            cell_set_matrix(d, rows, cols);
+            break;
+        }
+        case OP_SAVE_CSV: {
+            long rows = top->is_matrix ? csv_save(C->strs[in->a], top->data, top->rows, top->cols)
+                                       : csv_save(C->strs[in->a], &top->scalar, 1, 1);
+            if (rows < 0) {
+                status = vm_error(in, C->strs[in->a], strerror(errno));
+                break;
+            }
+            top->is_matrix = 0;
+            top->scalar = (double)rows;
+            break;
+        }
+        case OP_JUMP:
+            pc = in->a;
+            break;
+        case OP_JUMP_FALSE:
+            if (!cell_true(top))
+                pc = in->a;
+            sp--;
+            break;
+        case OP_FOR_INIT:
+            cell_assign(&M.fors[in->a].seq, top);
+            M.fors[in->a].pos = 0;
+            sp--;
+            break;
+        case OP_FOR_NEXT: {
+            ForState *f = &M.fors[in->a];
+            if (f->pos >= cell_count(&f->seq)) {
+                pc = in->c;
+                break;
+            }
+            Cell *v = &M.vars[in->b];
+            v->is_matrix = 0;
+            v->scalar = cell_elems(&f->seq)[f->pos++];
+            M.defined[in->b] = 1;
+            break;
+        }
+        }
+    }
+
+    for (int i = 0; i < C->nvars; i++)
+        free(M.vars[i].buf);
+    for (int i = 0; i <= C->ncode; i++)
+        free(M.stack[i].buf);
+    for (int i = 0; i < C->nloops; i++)
+        free(M.fors[i].seq.buf);
+    free(M.scratch.buf);
+    free(M.vars);
+    free(M.defined);
+    free(M.stack);
+    free(M.fors);
+    return status;
+}
+
+static void compiler_free(Compiler *C) {
+    for (int i = 0; i < C->nstrs; i++)
+        free(C->strs[i]);
+    for (int i = 0; i < BATCH_MAX_NESTING; i++)
+        free(C->loops[i].breaks);
+    free(C->strs);
+    free(C->toks);
+    free(C->code);
+    free(C->consts);
+    free(C->names);
+    free(C->hash);
+}
+
+/* Compile and run a script file; returns the process exit status */
+int run_batch(const char *path) {
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!f) {
+        perror("Error opening script file");
+        return 1;
+    }
+    size_t len = 0, cap = 4096;
+    char *src = malloc(cap);
+    size_t got;
+    while (src && (got = fread(src + len, 1, cap - len - 1, f)) > 0) {
+        len += got;
+        if (cap - len - 1 == 0) {
+            char *grown = realloc(src, cap * 2);
+            if (!grown)
+                free(src);
+            src = grown;
+            cap *= 2;
+        }
+    }
+    if (f != stdin)
+        fclose(f);
+    if (!src) {
+        printf("Error: Memory allocation failed\n");
+        return 1;
+    }
+    src[len] = '\0';
+
+    Compiler C;
+    memset(&C, 0, sizeof(C));
+    batch_lex(&C, src);
+    free(src);
+    if (!C.failed) {
+        compile_block(&C);
+        if (!C.failed && peek(&C)->kind != TOK_EOF)
+            compile_error(&C, peek(&C)->line, "Unexpected", token_desc(peek(&C)));
+    }
+    int status = C.failed ? 1 : (batch_execute(&C) != 0);
+    compiler_free(&C);
+    fflush(stdout);
+    return status;
+}
+
 /* --- Main REPL Loop --- */
 int main(int argc, char *argv[]) {
     int interactive = 1;
-    char line[256]; // used for script input
-    
+    char *line = NULL; // used for script input
+    size_t line_cap = 0;
+
+    /* "-b script.m" compiles and runs the script in batch mode */
+    if (argc > 2 && strcmp(argv[1], "-b") == 0)
+        return run_batch(argv[2]);
+
     /* If a script file is provided, use it as input */
     if (argc > 1) {
         if (freopen(argv[1], "r", stdin) == NULL) {
@@ -1070,7 +2862,7 @@ int main(int argc, char *argv[]) {
             if (!input)
                 break;
         } else {
-            if (!fgets(line, sizeof(line), stdin))
+            if (getline(&line, &line_cap, stdin) == -1)
                 break;
             line[strcspn(line, "\n")] = '\0';
             input = line;
@@ -1213,5 +3005,6 @@ int main(int argc, char *argv[]) {
         }
     }
     printf("Goodbye.\n");
+    free(line);
     return 0;
 }
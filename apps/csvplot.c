@@ -1,165 +1,461 @@
-#define _POSIX_C_SOURCE 200112L
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 
+/* Extern declarations from lib/libbcol.c (binary sidecar, see csvbcol) */
+typedef struct BcolFile BcolFile;
+extern BcolFile *bcol_open(const char *csv_path);
+extern void bcol_close(BcolFile *b);
+extern size_t bcol_rows(const BcolFile *b);
+extern size_t bcol_skipped_lines(const BcolFile *b);
+extern size_t bcol_blank_lines(const BcolFile *b);
+extern int bcol_has_header(const BcolFile *b);
+extern int bcol_has_empty_fields(const BcolFile *b);
+extern int bcol_column_numeric(const BcolFile *b, size_t col);
+extern const double *bcol_column(const BcolFile *b, size_t col);
+
 /* csvplot.c
  *
  * Usage:
- *   csvplot <file.csv>
+ *   csvplot [-m mode] <file.csv>
  *     -> plots column 1 (x) vs column 2 (y)
  *
- *   csvplot <file.csv> <xcol> <ycol1> [<ycol2> ...]
+ *   csvplot [-m mode] <file.csv> <xcol> <ycol1> [<ycol2> ...]
  *     -> plots each ycol against xcol.
  *        Columns are 0-based indices.
  *
+ * Modes:
+ *   minmax  (default) every plot column shows the min..max of its rows
+ *   mean    one marker per bucket at the mean of its rows
+ *   lttb    Largest-Triangle-Three-Buckets: the row of each bucket that best
+ *           keeps the shape of the curve (reads the file twice)
+ *   points  exact scatter of every row (reads the file twice)
+ *
  * Examples:
  *   csvplot data.csv
  *   csvplot data.csv 0 1
- *   csvplot data.csv 0 1 2 4
+ *   csvplot -m lttb data.csv 0 1 2 4
  *
  * Reads CSV with a header line, extracts the specified columns,
  * scales to terminal size, and draws an ASCII scatter plot.
+ * When a fresh binary sidecar exists (see csvbcol) and the requested
+ * columns are numeric, the columns are taken from it instead.
+ *
+ * Rows are streamed, never stored: they are summarized into at most two
+ * buckets of consecutive rows per plot column, so memory depends on the
+ * plot width only. When the buckets fill up, neighbours are merged and
+ * each bucket covers twice as many rows. Bucketing by row assumes x is
+ * ordered (a capture); when it is not, minmax and mean fall back to the
+ * exact scatter.
  */
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        fprintf(stderr,
-                "Usage: %s <file.csv> [xcol ycol1 [ycol2 ...]]\n",
-                argv[0]);
-        return 1;
-    }
+enum { MODE_MINMAX, MODE_MEAN, MODE_LTTB, MODE_POINTS };
 
-    const char *filename = argv[1];
+/* Marker characters for multiple series */
+static const char markers[] = { '*', 'o', '+', 'x', 's', 'd', '#' };
+#define NMARK ((int)(sizeof markers / sizeof *markers))
 
-    /* Determine x column and y columns */
+/* Where the rows come from: a usable sidecar or the CSV text. */
+typedef struct {
+    const char *filename;
     int xcol;
+    const int *ycols;
     int ycount;
-    int *ycols;
+    BcolFile *bc;
+} Source;
 
-    if (argc == 2) {
-        /* defaults: x = 0, single y = 1 */
-        xcol  = 0;
-        ycount = 1;
-        ycols = malloc(sizeof *ycols);
-        ycols[0] = 1;
-    } else {
-        /* at least: argv[2] = xcol, argv[3...] = ycols */
-        xcol = atoi(argv[2]);
-        ycount = argc - 3;
-        if (ycount < 1) {
-            fprintf(stderr,
-                    "Must specify at least one y column when giving xcol.\n");
-            return 1;
+/* Called for every complete row; y holds one value per series. */
+typedef void (*RowFn)(void *ctx, double x, const double *y);
+
+/* Summaries of consecutive rows. Bucket k covers rows [k*span, (k+1)*span). */
+typedef struct {
+    int ycount;
+    size_t cap;                   /* maximum number of buckets (even) */
+    size_t nb;                    /* buckets in use */
+    size_t span;                  /* rows per bucket, a power of two */
+    size_t fill;                  /* rows in the last bucket */
+    size_t rows;
+    double *xmin, *xmax, *xsum;   /* [cap] */
+    double *ymin, *ymax, *ysum;   /* [cap * ycount] */
+    double first_x, last_x;
+    double *first_y, *last_y;     /* [ycount] */
+    double gxmin, gxmax, gymin, gymax;
+    int x_rising, x_falling;
+} Binner;
+
+/* Plot grid and the data range it shows. */
+typedef struct {
+    char **grid;
+    int *owner;   /* series drawn in each cell: later series stay on top */
+    int w, h;
+    double xmin, xmax, ymin, ymax;
+} Plot;
+
+static void *xmalloc(size_t size) {
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        fprintf(stderr, "Memory allocation failure\n");
+        exit(1);
+    }
+    return p;
+}
+
+/* Opens the fresh binary sidecar when it describes the text exactly: every
+ * line regular, no blank lines or empty fields, and all requested columns
+ * numeric. Returns NULL when it is missing or not usable. */
+static BcolFile *open_bcol(const char *filename, int xcol, const int *ycols, int ycount) {
+    BcolFile *bc = bcol_open(filename);
+    if (!bc)
+        return NULL;
+    int usable = bcol_skipped_lines(bc) == 0 && bcol_blank_lines(bc) == 0 &&
+                 !bcol_has_empty_fields(bc) && xcol >= 0 &&
+                 bcol_column_numeric(bc, (size_t)xcol);
+    for (int j = 0; usable && j < ycount; j++)
+        usable = ycols[j] >= 0 && bcol_column_numeric(bc, (size_t)ycols[j]);
+    if (!usable) {
+        bcol_close(bc);
+        return NULL;
+    }
+    return bc;
+}
+
+/* Picks the requested columns out of one text line. Returns 1 when the
+ * row has all of them (non-empty fields). */
+static int parse_row(const char *line, const Source *src, double *x, double *y,
+                     unsigned char *have_y) {
+    int have_x = 0;
+    memset(have_y, 0, (size_t)src->ycount);
+    const char *p = line;
+    for (int col = 0; ; col++) {
+        const char *end = p;
+        while (*end && *end != ',' && *end != '\n' && *end != '\r')
+            end++;
+        if (end > p) {
+            if (col == src->xcol) {
+                *x = strtod(p, NULL);
+                have_x = 1;
+            }
+            for (int j = 0; j < src->ycount; j++) {
+                if (col == src->ycols[j]) {
+                    y[j] = strtod(p, NULL);
+                    have_y[j] = 1;
+                }
+            }
         }
-        ycols = malloc(ycount * sizeof *ycols);
-        for (int j = 0; j < ycount; j++) {
-            ycols[j] = atoi(argv[3 + j]);
+        if (*end != ',')
+            break;
+        p = end + 1;
+    }
+    int ok = have_x;
+    for (int j = 0; j < src->ycount; j++)
+        ok = ok && have_y[j];
+    return ok;
+}
+
+/* Streams every complete row of the source to fn, skipping the header line. */
+static void scan_rows(const Source *src, RowFn fn, void *ctx) {
+    double *y = xmalloc(src->ycount * sizeof *y);
+
+    if (src->bc) {
+        /* The first line is always skipped as the header. */
+        size_t first = bcol_has_header(src->bc) ? 0 : 1;
+        size_t rows = bcol_rows(src->bc);
+        const double *xs = bcol_column(src->bc, (size_t)src->xcol);
+        const double **ys = xmalloc(src->ycount * sizeof *ys);
+        for (int j = 0; j < src->ycount; j++)
+            ys[j] = bcol_column(src->bc, (size_t)src->ycols[j]);
+        for (size_t i = first; i < rows; i++) {
+            for (int j = 0; j < src->ycount; j++)
+                y[j] = ys[j][i];
+            fn(ctx, xs[i], y);
         }
+        free(ys);
+        free(y);
+        return;
     }
 
-    /* Open file */
-    FILE *f = fopen(filename, "r");
+    FILE *f = fopen(src->filename, "r");
     if (!f) {
         perror("fopen");
-        return 1;
+        exit(1);
     }
-
-    /* Skip header */
     char *line = NULL;
     size_t len = 0;
     if (getline(&line, &len, f) == -1) {
         fprintf(stderr, "Empty file or read error.\n");
-        return 1;
+        exit(1);
+    }
+    unsigned char *have_y = xmalloc((size_t)src->ycount);
+    double x = 0.0;
+    while (getline(&line, &len, f) != -1) {
+        if (parse_row(line, src, &x, y, have_y))
+            fn(ctx, x, y);
     }
+    free(have_y);
+    free(line);
+    free(y);
+    fclose(f);
+}
 
-    /* Read and store data */
-    double *xs = NULL;
-    double **ys = NULL;
-    size_t n = 0, cap = 0;
+static void bin_init(Binner *b, size_t cap, int ycount) {
+    memset(b, 0, sizeof *b);
+    b->ycount = ycount;
+    b->cap = cap < 2 ? 2 : cap + (cap & 1);
+    b->span = 1;
+    b->xmin = xmalloc(b->cap * sizeof *b->xmin);
+    b->xmax = xmalloc(b->cap * sizeof *b->xmax);
+    b->xsum = xmalloc(b->cap * sizeof *b->xsum);
+    b->ymin = xmalloc(b->cap * ycount * sizeof *b->ymin);
+    b->ymax = xmalloc(b->cap * ycount * sizeof *b->ymax);
+    b->ysum = xmalloc(b->cap * ycount * sizeof *b->ysum);
+    b->first_y = xmalloc(ycount * sizeof *b->first_y);
+    b->last_y = xmalloc(ycount * sizeof *b->last_y);
+    b->x_rising = b->x_falling = 1;
+}
 
-    while (getline(&line, &len, f) != -1) {
-        int col = 0;
-        char *tok = strtok(line, ",");
-        double xv = 0.0;
-        int have_x = 0;
-        double *yv = malloc(ycount * sizeof *yv);
-        int *have_y = malloc(ycount * sizeof *have_y);
-
-        for (int j = 0; j < ycount; j++)
-            have_y[j] = 0;
-
-        while (tok) {
-            if (col == xcol) {
-                xv = atof(tok);
-                have_x = 1;
-            }
-            for (int j = 0; j < ycount; j++) {
-                if (col == ycols[j]) {
-                    yv[j] = atof(tok);
-                    have_y[j] = 1;
-                }
-            }
-            tok = strtok(NULL, ",");
-            col++;
+static void bin_free(Binner *b) {
+    free(b->xmin); free(b->xmax); free(b->xsum);
+    free(b->ymin); free(b->ymax); free(b->ysum);
+    free(b->first_y); free(b->last_y);
+}
+
+/* Merges neighbouring buckets pairwise; all buckets are full when called. */
+static void bin_halve(Binner *b) {
+    int yc = b->ycount;
+    for (size_t i = 0; i < b->cap / 2; i++) {
+        size_t a = 2 * i, c = 2 * i + 1;
+        b->xmin[i] = b->xmin[a] < b->xmin[c] ? b->xmin[a] : b->xmin[c];
+        b->xmax[i] = b->xmax[a] > b->xmax[c] ? b->xmax[a] : b->xmax[c];
+        b->xsum[i] = b->xsum[a] + b->xsum[c];
+        for (int j = 0; j < yc; j++) {
+            double lo1 = b->ymin[a * yc + j], lo2 = b->ymin[c * yc + j];
+            double hi1 = b->ymax[a * yc + j], hi2 = b->ymax[c * yc + j];
+            b->ymin[i * yc + j] = lo1 < lo2 ? lo1 : lo2;
+            b->ymax[i * yc + j] = hi1 > hi2 ? hi1 : hi2;
+            b->ysum[i * yc + j] = b->ysum[a * yc + j] + b->ysum[c * yc + j];
         }
+    }
+    b->nb = b->cap / 2;
+    b->span *= 2;
+    b->fill = b->span;
+}
 
-        /* only store rows with all requested values */
-        int ok = have_x;
-        for (int j = 0; j < ycount; j++)
-            ok = ok && have_y[j];
-
-        if (ok) {
-            if (n == cap) {
-                cap = cap ? cap * 2 : 128;
-                xs = realloc(xs, cap * sizeof *xs);
-                ys = realloc(ys, ycount * sizeof *ys);
-                if (!xs || !ys) {
-                    fprintf(stderr, "Memory allocation failure\n");
-                    return 1;
-                }
-                for (int j = 0; j < ycount; j++) {
-                    ys[j] = realloc(ys[j], cap * sizeof *ys[j]);
-                    if (!ys[j]) {
-                        fprintf(stderr, "Memory allocation failure\n");
-                        return 1;
-                    }
-                }
-            }
-            xs[n] = xv;
-            for (int j = 0; j < ycount; j++) {
-                ys[j][n] = yv[j];
-            }
-            n++;
+static void bin_row(void *ctx, double x, const double *y) {
+    Binner *b = ctx;
+    int yc = b->ycount;
+    if (b->rows == 0) {
+        b->first_x = b->gxmin = b->gxmax = x;
+        b->gymin = b->gymax = y[0];
+        memcpy(b->first_y, y, yc * sizeof *y);
+    } else {
+        if (x < b->last_x) b->x_rising = 0;
+        if (x > b->last_x) b->x_falling = 0;
+    }
+    if (x < b->gxmin) b->gxmin = x;
+    if (x > b->gxmax) b->gxmax = x;
+    for (int j = 0; j < yc; j++) {
+        if (y[j] < b->gymin) b->gymin = y[j];
+        if (y[j] > b->gymax) b->gymax = y[j];
+    }
+
+    if (b->nb == 0 || b->fill == b->span) {
+        if (b->nb == b->cap)
+            bin_halve(b);
+        size_t k = b->nb++;
+        b->xmin[k] = b->xmax[k] = x;
+        b->xsum[k] = 0.0;
+        for (int j = 0; j < yc; j++) {
+            b->ymin[k * yc + j] = b->ymax[k * yc + j] = y[j];
+            b->ysum[k * yc + j] = 0.0;
         }
+        b->fill = 0;
+    }
+    size_t k = b->nb - 1;
+    if (x < b->xmin[k]) b->xmin[k] = x;
+    if (x > b->xmax[k]) b->xmax[k] = x;
+    b->xsum[k] += x;
+    for (int j = 0; j < yc; j++) {
+        double v = y[j];
+        if (v < b->ymin[k * yc + j]) b->ymin[k * yc + j] = v;
+        if (v > b->ymax[k * yc + j]) b->ymax[k * yc + j] = v;
+        b->ysum[k * yc + j] += v;
+    }
+    b->fill++;
+    b->rows++;
+    b->last_x = x;
+    memcpy(b->last_y, y, yc * sizeof *y);
+}
+
+/* Rows in bucket k */
+static size_t bin_count(const Binner *b, size_t k) {
+    return k + 1 < b->nb ? b->span : b->fill;
+}
+
+static int plot_col(const Plot *p, double x) {
+    return (int)((x - p->xmin) / (p->xmax - p->xmin) * (p->w - 1));
+}
 
-        free(yv);
-        free(have_y);
+static int plot_row(const Plot *p, double y) {
+    return p->h - 1 - (int)((y - p->ymin) / (p->ymax - p->ymin) * (p->h - 1));
+}
+
+/* Marks series j in every cell of the x range [x0, x1] and the y range [y0, y1]. */
+static void plot_span(Plot *p, double x0, double x1, double y0, double y1, int j) {
+    int c0 = plot_col(p, x0), c1 = plot_col(p, x1);
+    int r0 = plot_row(p, y1), r1 = plot_row(p, y0);
+    for (int row = r0; row <= r1; row++) {
+        if (row < 0 || row >= p->h) continue;
+        for (int col = c0; col <= c1; col++) {
+            if (col < 0 || col >= p->w || p->owner[row * p->w + col] > j) continue;
+            p->owner[row * p->w + col] = j;
+            p->grid[row][col] = markers[j % NMARK];
+        }
     }
-    free(line);
-    fclose(f);
+}
 
-    if (n == 0) {
-        fprintf(stderr, "No complete data rows found for given columns.\n");
+static void plot_point(Plot *p, double x, double y, int j) {
+    plot_span(p, x, x, y, y, j);
+}
+
+/* Second pass of the exact scatter: marks every row. */
+typedef struct {
+    Plot *plot;
+    int ycount;
+} PointsPass;
+
+static void points_row(void *ctx, double x, const double *y) {
+    PointsPass *pp = ctx;
+    for (int j = 0; j < pp->ycount; j++)
+        plot_point(pp->plot, x, y[j], j);
+}
+
+/* Second pass of LTTB. For every bucket and series it keeps the row forming
+ * the largest triangle with the previously selected point and the mean of
+ * the next bucket (known from the first pass). */
+typedef struct {
+    const Binner *b;
+    Plot *plot;
+    size_t row, bucket;
+    double *prev_x, *prev_y;   /* selected point of the previous bucket */
+    double *best_x, *best_y, *best_area;
+} LttbPass;
+
+static void lttb_commit(LttbPass *lp) {
+    for (int j = 0; j < lp->b->ycount; j++) {
+        plot_point(lp->plot, lp->best_x[j], lp->best_y[j], j);
+        lp->prev_x[j] = lp->best_x[j];
+        lp->prev_y[j] = lp->best_y[j];
+        lp->best_area[j] = -1.0;
+    }
+}
+
+static void lttb_row(void *ctx, double x, const double *y) {
+    LttbPass *lp = ctx;
+    const Binner *b = lp->b;
+    int yc = b->ycount;
+    size_t k = lp->row++ / b->span;
+    if (k != lp->bucket) {
+        lttb_commit(lp);
+        lp->bucket = k;
+    }
+    for (int j = 0; j < yc; j++) {
+        double cx, cy;
+        if (k + 1 < b->nb) {
+            double cnt = (double)bin_count(b, k + 1);
+            cx = b->xsum[k + 1] / cnt;
+            cy = b->ysum[(k + 1) * yc + j] / cnt;
+        } else {
+            cx = b->last_x;
+            cy = b->last_y[j];
+        }
+        double ax = lp->prev_x[j], ay = lp->prev_y[j];
+        double area = (ax - cx) * (y[j] - ay) - (ax - x) * (cy - ay);
+        if (area < 0) area = -area;
+        if (area > lp->best_area[j]) {
+            lp->best_area[j] = area;
+            lp->best_x[j] = x;
+            lp->best_y[j] = y[j];
+        }
+    }
+}
+
+static void plot_lttb(const Source *src, const Binner *b, Plot *p) {
+    int yc = b->ycount;
+    LttbPass lp = { b, p, 0, 0, NULL, NULL, NULL, NULL, NULL };
+    lp.prev_x = xmalloc(yc * sizeof(double));
+    lp.prev_y = xmalloc(yc * sizeof(double));
+    lp.best_x = xmalloc(yc * sizeof(double));
+    lp.best_y = xmalloc(yc * sizeof(double));
+    lp.best_area = xmalloc(yc * sizeof(double));
+    for (int j = 0; j < yc; j++) {
+        lp.prev_x[j] = b->first_x;
+        lp.prev_y[j] = b->first_y[j];
+        lp.best_area[j] = -1.0;
+        plot_point(p, b->first_x, b->first_y[j], j);
+        plot_point(p, b->last_x, b->last_y[j], j);
+    }
+    scan_rows(src, lttb_row, &lp);
+    lttb_commit(&lp);
+    free(lp.prev_x); free(lp.prev_y);
+    free(lp.best_x); free(lp.best_y); free(lp.best_area);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-m minmax|mean|lttb|points] <file.csv> [xcol ycol1 [ycol2 ...]]\n",
+            prog);
+}
+
+int main(int argc, char *argv[]) {
+    int mode = MODE_MINMAX;
+    int argi = 1;
+    if (argc >= 3 && strcmp(argv[1], "-m") == 0) {
+        const char *m = argv[2];
+        if (strcmp(m, "minmax") == 0) mode = MODE_MINMAX;
+        else if (strcmp(m, "mean") == 0) mode = MODE_MEAN;
+        else if (strcmp(m, "lttb") == 0) mode = MODE_LTTB;
+        else if (strcmp(m, "points") == 0) mode = MODE_POINTS;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+        argi = 3;
+    }
+    if (argc - argi < 1) {
+        usage(argv[0]);
         return 1;
     }
 
-    /* Find ranges */
-    double xmin = xs[0], xmax = xs[0];
-    double ymin = ys[0][0], ymax = ys[0][0];
-    for (size_t i = 0; i < n; i++) {
-        if (xs[i] < xmin) xmin = xs[i];
-        if (xs[i] > xmax) xmax = xs[i];
+    const char *filename = argv[argi];
+
+    /* Determine x column and y columns */
+    int xcol;
+    int ycount;
+    int *ycols;
+
+    if (argc - argi == 1) {
+        /* defaults: x = 0, single y = 1 */
+        xcol  = 0;
+        ycount = 1;
+        ycols = xmalloc(sizeof *ycols);
+        ycols[0] = 1;
+    } else {
+        /* at least: xcol, then the ycols */
+        xcol = atoi(argv[argi + 1]);
+        ycount = argc - argi - 2;
+        if (ycount < 1) {
+            fprintf(stderr,
+                    "Must specify at least one y column when giving xcol.\n");
+            return 1;
+        }
+        ycols = xmalloc(ycount * sizeof *ycols);
         for (int j = 0; j < ycount; j++) {
-            double v = ys[j][i];
-            if (v < ymin) ymin = v;
-            if (v > ymax) ymax = v;
+            ycols[j] = atoi(argv[argi + 2 + j]);
         }
     }
-    if (xmax == xmin) { xmax = xmin + 1; xmin -= 1; }
-    if (ymax == ymin) { ymax = ymin + 1; ymin -= 1; }
 
     /* Terminal size */
     struct winsize w;
@@ -170,42 +466,70 @@ int main(int argc, char *argv[]) {
     }
     int plot_h = term_h - 4;  /* reserve rows for labels/legend */
     int plot_w = term_w - 5;  /* reserve cols for Y-axis and margin */
+    if (plot_h < 1) plot_h = 1;
+    if (plot_w < 1) plot_w = 1;
+
+    /* First pass: ranges and bucket summaries */
+    Source src = { filename, xcol, ycols, ycount,
+                   open_bcol(filename, xcol, ycols, ycount) };
+    Binner b;
+    bin_init(&b, 2 * (size_t)plot_w, ycount);
+    scan_rows(&src, bin_row, &b);
+
+    if (b.rows == 0) {
+        fprintf(stderr, "No complete data rows found for given columns.\n");
+        return 1;
+    }
+
+    /* Find ranges */
+    Plot p = { NULL, NULL, plot_w, plot_h, b.gxmin, b.gxmax, b.gymin, b.gymax };
+    if (p.xmax == p.xmin) { p.xmax = p.xmin + 1; p.xmin -= 1; }
+    if (p.ymax == p.ymin) { p.ymax = p.ymin + 1; p.ymin -= 1; }
 
     /* Allocate plot grid */
-    char **grid = malloc(plot_h * sizeof *grid);
+    p.grid = xmalloc(plot_h * sizeof *p.grid);
     for (int i = 0; i < plot_h; i++) {
-        grid[i] = malloc(plot_w);
-        memset(grid[i], ' ', plot_w);
+        p.grid[i] = xmalloc(plot_w);
+        memset(p.grid[i], ' ', plot_w);
     }
+    p.owner = xmalloc((size_t)plot_w * plot_h * sizeof *p.owner);
+    for (int i = 0; i < plot_w * plot_h; i++)
+        p.owner[i] = -1;
 
-    /* Marker characters for multiple series */
-    char markers[] = { '*', 'o', '+', 'x', 's', 'd', '#' };
-    int nmark = sizeof markers / sizeof *markers;
-
-    /* Plot each point */
-    for (int j = 0; j < ycount; j++) {
-        for (size_t i = 0; i < n; i++) {
-            int px = (int)((xs[i] - xmin) / (xmax - xmin) * (plot_w - 1));
-            int py = (int)((ys[j][i] - ymin) / (ymax - ymin) * (plot_h - 1));
-            int row = plot_h - 1 - py;
-            int col = px;
-            if (row >= 0 && row < plot_h && col >= 0 && col < plot_w) {
-                grid[row][col] = markers[j % nmark];
+    /* With one row per bucket every mode is the exact scatter. */
+    if (b.span > 1 && (mode == MODE_POINTS ||
+                       (mode != MODE_LTTB && !b.x_rising && !b.x_falling))) {
+        PointsPass pp = { &p, ycount };
+        scan_rows(&src, points_row, &pp);
+    } else if (b.span > 1 && mode == MODE_LTTB) {
+        plot_lttb(&src, &b, &p);
+    } else {
+        for (size_t k = 0; k < b.nb; k++) {
+            double cnt = (double)bin_count(&b, k);
+            for (int j = 0; j < ycount; j++) {
+                if (mode == MODE_MEAN)
+                    plot_point(&p, b.xsum[k] / cnt, b.ysum[k * ycount + j] / cnt, j);
+                else
+                    plot_span(&p, b.xmin[k], b.xmax[k],
+                              b.ymin[k * ycount + j], b.ymax[k * ycount + j], j);
             }
         }
     }
+    if (src.bc)
+        bcol_close(src.bc);
 
     /* Print Y range */
-    printf("Y range: [%g .. %g]\n", ymin, ymax);
+    printf("Y range: [%g .. %g]\n", p.ymin, p.ymax);
 
     /* Render grid */
     for (int i = 0; i < plot_h; i++) {
         printf("| ");               /* Y-axis */
-        fwrite(grid[i], 1, plot_w, stdout);
+        fwrite(p.grid[i], 1, plot_w, stdout);
         printf("\n");
-        free(grid[i]);
+        free(p.grid[i]);
     }
-    free(grid);
+    free(p.grid);
+    free(p.owner);
 
     /* X-axis */
     printf("+-");
@@ -214,8 +538,8 @@ int main(int argc, char *argv[]) {
 
     /* X labels */
     char buf1[32], buf2[32];
-    snprintf(buf1, sizeof buf1, "%g", xmin);
-    snprintf(buf2, sizeof buf2, "%g", xmax);
+    snprintf(buf1, sizeof buf1, "%g", p.xmin);
+    snprintf(buf2, sizeof buf2, "%g", p.xmax);
     printf("  %s", buf1);
     int pad = plot_w - (int)strlen(buf1) - (int)strlen(buf2);
     for (int i = 0; i < pad; i++) putchar(' ');
@@ -224,16 +548,12 @@ int main(int argc, char *argv[]) {
     /* Legend */
     printf("Legend: ");
     for (int j = 0; j < ycount; j++) {
-        printf("%c=col%d ", markers[j % nmark], ycols[j]);
+        printf("%c=col%d ", markers[j % NMARK], ycols[j]);
     }
     printf("\n");
 
     /* Clean up */
-    free(xs);
-    for (int j = 0; j < ycount; j++) {
-        free(ys[j]);
-    }
-    free(ys);
+    bin_free(&b);
     free(ycols);
 
     return 0;
@@ -13,6 +13,11 @@
 #include <string.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /*
  * Design principles and notes:
@@ -74,12 +79,24 @@ enum EditorKey {
     PGDN_KEY        // 1008
 };
 
+/* Display column of a byte offset within a line (see editorRowUpdateWidth) */
+typedef struct {
+    int byte;
+    int col;
+} ColMark;
+
+/* Bytes between two column checkpoints of a long line */
+#define COLMARK_STEP 256
+
 /* Data structure for a text line */
 typedef struct {
     int size;
     char *chars;
-    int modified;
+    int modified;       // 1 = changed, SAVE_PENDING = changed but in a running save
     int hl_in_comment;  // new field to store multi-line comment state for syntax highlighting
+    int width;          // cached display width, -1 when the line has changed
+    ColMark *marks;     // column checkpoints, one per COLMARK_STEP bytes
+    int nmarks;
 } EditorLine;
 
 /* Global clipboard for cut/copy/paste functionality */
@@ -94,9 +111,11 @@ struct EditorConfig {
     int rowoff;           // vertical scroll offset
     int coloff;           // horizontal scroll offset
     int numrows;          // number of rows in the file
+    int rowcap;           // allocated rows (grows geometrically)
     EditorLine *row;      // array of rows
     char *filename;
-    int dirty;            // unsaved changes flag
+    int dirty;            // unsaved changes flag (SAVE_PENDING while they are being saved)
+    int save_errno;       // error of the last save, 0 if it succeeded
     struct termios orig_termios; // original terminal settings
 
     char status_message[80];
@@ -123,6 +142,26 @@ typedef struct {
     int *modified;
 } UndoState;
 
+/* Background save: the document is snapshotted in editorSave() and written
+   to a temporary file next to the target, fsync'ed and renamed over it by a
+   worker thread, so a slow disk never stalls typing. The snapshot marks the
+   dirty flag and modified rows SAVE_PENDING; an edit during the save sets them
+   back to 1, and only flags still pending are cleared once the save succeeded. */
+#define SAVE_PENDING 2
+
+typedef struct {
+    pthread_t thread;
+    int running;          // started and not yet joined
+    atomic_int done;      // set by the worker when it has finished
+    char *buf;            // snapshot of the document
+    size_t len;
+    char *target;         // file to replace
+    mode_t mode;
+    int err;              // errno of a failed save
+} SaveJob;
+
+static SaveJob save_job;
+
 UndoState *undo_history[100];
 int undo_history_len = 0;
 
@@ -207,6 +246,9 @@ int getWindowSize(int *rows, int *cols);
 void editorRefreshScreen(void);
 int getRowNumWidth(void);
 int editorDisplayWidth(const char *s);
+int editorRowWidth(EditorLine *row);
+void editorRowChanged(EditorLine *row);
+void editorFreeRow(EditorLine *row);
 int editorRowCxToByteIndex(EditorLine *row, int cx);
 void editorRenderRow(EditorLine *row, int avail, struct abuf *ab);
 void editorRenderRowWithSelection(EditorLine *row, int file_row, int avail, struct abuf *ab);
@@ -217,6 +259,9 @@ void editorProcessKeypress(void);
 void editorOpen(const char *filename);
 void editorSave(void);
 void editorAppendLine(char *s, size_t len);
+void editorReserveRows(int n);
+int editorPollSave(void);
+void editorWaitSave(void);
 void editorInsertChar(int c);
 void editorInsertUTF8(const char *s, int len);
 void editorInsertNewline(void);
@@ -295,10 +340,78 @@ int editorDisplayWidth(const char *s) {
     return width;
 }
 
+/* Mark a line as edited so its width and checkpoints are rebuilt on demand. */
+void editorRowChanged(EditorLine *row) {
+    row->width = -1;
+}
+
+/* Release a line's text and its column checkpoints. */
+void editorFreeRow(EditorLine *row) {
+    free(row->chars);
+    free(row->marks);
+    row->chars = NULL;
+    row->marks = NULL;
+    row->nmarks = 0;
+}
+
+/* Decode a line once to cache its display width. Lines longer than
+   COLMARK_STEP also get a checkpoint every COLMARK_STEP bytes, so cursor
+   lookups on huge lines only decode from the nearest checkpoint. */
+static void editorRowUpdateWidth(EditorLine *row) {
+    int want = row->size > COLMARK_STEP ? row->size / COLMARK_STEP + 1 : 0;
+    if (want > row->nmarks || want == 0) {
+        free(row->marks);
+        row->marks = want ? malloc(sizeof(ColMark) * want) : NULL;
+        if (want && !row->marks)
+            die("malloc");
+    }
+    int n = 0, width = 0, index = 0;
+    size_t bytes;
+    wchar_t wc;
+    while (index < row->size) {
+        if (row->marks && index >= n * COLMARK_STEP && n < want) {
+            row->marks[n].byte = index;
+            row->marks[n].col = width;
+            n++;
+        }
+        bytes = mbrtowc(&wc, row->chars + index, MB_CUR_MAX, NULL);
+        if (bytes == (size_t)-1 || bytes == (size_t)-2) { bytes = 1; wc = row->chars[index]; }
+        if (bytes == 0) bytes = 1;
+        int w = wcwidth(wc);
+        if (w < 0) w = 0;
+        width += w; index += bytes;
+    }
+    row->nmarks = n;
+    row->width = width;
+}
+
+/* Cached display width of a line */
+int editorRowWidth(EditorLine *row) {
+    if (row->width < 0)
+        editorRowUpdateWidth(row);
+    return row->width;
+}
+
 int editorRowCxToByteIndex(EditorLine *row, int cx) {
     int cur_width = 0, index = 0;
     size_t bytes;
     wchar_t wc;
+    editorRowWidth(row);
+    if (row->nmarks > 0) {
+        /* start from the last checkpoint at or before column cx */
+        int lo = 0, hi = row->nmarks - 1;
+        while (lo < hi) {
+            int mid = (lo + hi + 1) / 2;
+            if (row->marks[mid].col <= cx)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        if (row->marks[lo].col <= cx) {
+            cur_width = row->marks[lo].col;
+            index = row->marks[lo].byte;
+        }
+    }
     while (index < row->size) {
         bytes = mbrtowc(&wc, row->chars + index, MB_CUR_MAX, NULL);
         if (bytes == (size_t)-1 || bytes == (size_t)-2) { bytes = 1; wc = row->chars[index]; }
@@ -352,7 +465,7 @@ void editorRenderRowWithSelection(EditorLine *row, int file_row, int avail, stru
             } else if (file_row == start_line) {
                 if (E.sel_anchor_y < E.cy) {
                     sel_local_start = E.sel_anchor_x;
-                    sel_local_end = editorDisplayWidth(row->chars);
+                    sel_local_end = editorRowWidth(row);
                 } else {
                     sel_local_start = 0;
                     sel_local_end = E.sel_anchor_x;
@@ -363,11 +476,11 @@ void editorRenderRowWithSelection(EditorLine *row, int file_row, int avail, stru
                     sel_local_end = E.cx;
                 } else {
                     sel_local_start = E.cx;
-                    sel_local_end = editorDisplayWidth(row->chars);
+                    sel_local_end = editorRowWidth(row);
                 }
             } else {
                 sel_local_start = 0;
-                sel_local_end = editorDisplayWidth(row->chars);
+                sel_local_end = editorRowWidth(row);
             }
         }
     }
@@ -428,7 +541,7 @@ void editorDrawRows(struct abuf *ab, int rn_width) {
                 }
             }
             
-            int printed_width = editorDisplayWidth(E.row[file_row].chars) - E.coloff;
+            int printed_width = editorRowWidth(&E.row[file_row]) - E.coloff;
             if (printed_width < 0) printed_width = 0;
             if (printed_width > text_width) printed_width = text_width;
             for (int i = printed_width; i < text_width; i++)
@@ -451,9 +564,14 @@ void editorDrawRows(struct abuf *ab, int rn_width) {
 void editorDrawStatusBar(struct abuf *ab) {
     char status[80];
     char rstatus[32];
-    int len = snprintf(status, sizeof(status), "%.20s%s",
+    char save_state[48] = "";
+    if (save_job.running)
+        snprintf(save_state, sizeof(save_state), " (saving)");
+    else if (E.save_errno)
+        snprintf(save_state, sizeof(save_state), " (save failed: %.25s)", strerror(E.save_errno));
+    int len = snprintf(status, sizeof(status), "%.20s%s%s",
                        E.filename ? E.filename : "[No Name]",
-                       E.dirty ? " (modified)" : "");
+                       E.dirty ? " (modified)" : "", save_state);
     int rlen = snprintf(rstatus, sizeof(rstatus), "Ln %d, Col %d",
                         E.cy + 1, E.cx + 1);
     if (len > E.screencols)
@@ -521,8 +639,11 @@ void editorRefreshScreen(void) {
 */
 int editorReadKey(void) {
     char c; int nread;
-    while ((nread = read(STDIN_FILENO, &c, 1)) == 0)
-        ;
+    while ((nread = read(STDIN_FILENO, &c, 1)) == 0) {
+        // Show the outcome of a background save without waiting for a key.
+        if (editorPollSave())
+            editorRefreshScreen();
+    }
     if (nread == -1 && errno != EAGAIN)
         die("read");
 
@@ -633,10 +754,11 @@ void pop_undo_state(void) {
     UndoState *state = undo_history[undo_history_len - 1];
     undo_history_len--;
     for (int i = 0; i < E.numrows; i++)
-        free(E.row[i].chars);
+        editorFreeRow(&E.row[i]);
     free(E.row);
     E.numrows = state->numrows;
-    E.row = malloc(sizeof(EditorLine) * E.numrows);
+    E.rowcap = E.numrows;
+    E.row = malloc(sizeof(EditorLine) * (E.numrows > 0 ? E.numrows : 1));
     if (!E.row) die("malloc restore rows");
     for (int i = 0; i < E.numrows; i++) {
         E.row[i].size = state->row[i].size;
@@ -644,7 +766,10 @@ void pop_undo_state(void) {
         if (!E.row[i].chars) die("malloc restore row char");
         memcpy(E.row[i].chars, state->row[i].chars, E.row[i].size);
         E.row[i].chars[E.row[i].size] = '\0';
-        E.row[i].modified = state->modified[i];
+        E.row[i].modified = state->modified[i] ? 1 : 0;
+        E.row[i].width = -1;
+        E.row[i].marks = NULL;
+        E.row[i].nmarks = 0;
     }
     E.cx = state->cx; E.cy = state->cy;
     free_undo_state(state);
@@ -706,7 +831,7 @@ void editorProcessKeypress(void) {
             E.sel_anchor_x = 0;
             E.sel_anchor_y = 0;
             E.cy = E.numrows - 1;
-            E.cx = editorDisplayWidth(E.row[E.cy].chars);
+            E.cx = editorRowWidth(&E.row[E.cy]);
             snprintf(E.status_message, sizeof(E.status_message), "Selected all text");
         }
         last_key_was_vertical = 0;
@@ -726,6 +851,7 @@ void editorProcessKeypress(void) {
     }
     switch (c) {
         case CTRL_KEY('q'):
+            editorWaitSave();
             write(STDOUT_FILENO, "\x1b[2J", 4);
             write(STDOUT_FILENO, "\x1b[H", 3);
             exit(0);
@@ -765,7 +891,7 @@ void editorProcessKeypress(void) {
             last_key_was_vertical = 0;
             break;
         case END_KEY:
-            E.cx = editorDisplayWidth(E.row[E.cy].chars);
+            E.cx = editorRowWidth(&E.row[E.cy]);
             E.preferred_cx = E.cx;
             last_key_was_vertical = 0;
             break;
@@ -809,7 +935,7 @@ void editorProcessKeypress(void) {
             last_key_was_vertical = 1;
             if (E.cy > 0) {
                 E.cy--;
-                int row_width = editorDisplayWidth(E.row[E.cy].chars);
+                int row_width = editorRowWidth(&E.row[E.cy]);
                 if (E.preferred_cx > row_width)
                     E.cx = row_width;
                 else
@@ -822,7 +948,7 @@ void editorProcessKeypress(void) {
             last_key_was_vertical = 1;
             if (E.cy < E.numrows - 1) {
                 E.cy++;
-                int row_width = editorDisplayWidth(E.row[E.cy].chars);
+                int row_width = editorRowWidth(&E.row[E.cy]);
                 if (E.preferred_cx > row_width)
                     E.cx = row_width;
                 else
@@ -834,13 +960,13 @@ void editorProcessKeypress(void) {
                 E.cx--;
             else if (E.cy > 0) {
                 E.cy--;
-                E.cx = editorDisplayWidth(E.row[E.cy].chars);
+                E.cx = editorRowWidth(&E.row[E.cy]);
             }
             E.preferred_cx = E.cx;
             last_key_was_vertical = 0;
             break;
         case ARROW_RIGHT: {
-            int roww = editorDisplayWidth(E.row[E.cy].chars);
+            int roww = editorRowWidth(&E.row[E.cy]);
             if (E.cx < roww)
                 E.cx++;
             else if (E.cy < E.numrows - 1) {
@@ -893,7 +1019,7 @@ void editorDeleteSelection(void) {
     int anchor_x = (E.sel_anchor_y <= E.cy ? E.sel_anchor_x : E.cx);
     int current_x = (E.sel_anchor_y <= E.cy ? E.cx : E.sel_anchor_x);
     for (int i = start_line; i <= end_line; i++) {
-        int line_width = editorDisplayWidth(E.row[i].chars);
+        int line_width = editorRowWidth(&E.row[i]);
         int sel_start, sel_end;
         if (start_line == end_line) {
             sel_start = (anchor_x < current_x ? anchor_x : current_x);
@@ -929,6 +1055,7 @@ void editorDeleteSelection(void) {
             free(E.row[i].chars);
             E.row[i].chars = strdup("");
         }
+        editorRowChanged(&E.row[i]);
     }
     if (start_line != end_line) {
         EditorLine *first_line = &E.row[start_line];
@@ -937,8 +1064,9 @@ void editorDeleteSelection(void) {
         first_line->chars = realloc(first_line->chars, new_size + 1);
         memcpy(first_line->chars + first_line->size, last_line->chars, last_line->size + 1);
         first_line->size = new_size;
+        editorRowChanged(first_line);
         for (int i = end_line; i > start_line; i--) {
-            free(E.row[i].chars);
+            editorFreeRow(&E.row[i]);
             for (int j = i; j < E.numrows - 1; j++)
                 E.row[j] = E.row[j + 1];
             E.numrows--;
@@ -955,13 +1083,14 @@ void editorDelCharAtCursor(void) {
     if (E.cy == E.numrows)
         return;
     EditorLine *line = &E.row[E.cy];
-    int row_display_width = editorDisplayWidth(line->chars);
+    int row_display_width = editorRowWidth(line);
     if (E.cx < row_display_width) {
        int index = editorRowCxToByteIndex(line, E.cx);
        int next_index = editorRowCxToByteIndex(line, E.cx + 1);
        memmove(&line->chars[index], &line->chars[next_index], line->size - next_index + 1);
        line->size -= (next_index - index);
        line->modified = 1;
+       editorRowChanged(line);
        E.dirty = 1;
     } else if (E.cx == row_display_width && E.cy < E.numrows - 1) {
        EditorLine *next_line = &E.row[E.cy+1];
@@ -971,7 +1100,8 @@ void editorDelCharAtCursor(void) {
        line->size += next_line->size;
        line->chars[line->size] = '\0';
        line->modified = 1;
-       free(next_line->chars);
+       editorRowChanged(line);
+       editorFreeRow(next_line);
        for (int j = E.cy+1; j < E.numrows - 1; j++)
            E.row[j] = E.row[j+1];
        E.numrows--;
@@ -991,7 +1121,7 @@ void editorSearch(void) {
         int pos = 0;
         for (int i = start_line; i <= end_line && pos < (int)sizeof(query) - 1; i++) {
             EditorLine *row = &E.row[i];
-            int line_width = editorDisplayWidth(row->chars);
+            int line_width = editorRowWidth(row);
             int sel_start, sel_end;
             if (start_line == end_line) {
                 sel_start = (anchor_x < current_x ? anchor_x : current_x);
@@ -1145,7 +1275,7 @@ void editorCopySelection(void) {
     buf[0] = '\0';
     size_t len = 0;
     for (int i = start_line; i <= end_line; i++) {
-        int line_width = editorDisplayWidth(E.row[i].chars);
+        int line_width = editorRowWidth(&E.row[i]);
         int sel_start, sel_end;
         if (start_line == end_line) {
             sel_start = (anchor_x < current_x ? anchor_x : current_x);
@@ -1199,6 +1329,7 @@ void editorCutSelection(void) {
                 E.row[start_line].chars + end_byte,
                 E.row[start_line].size - end_byte + 1);
         E.row[start_line].size = new_size;
+        editorRowChanged(&E.row[start_line]);
     } else {
         int first_sel_start = (E.sel_anchor_y < E.cy ? E.sel_anchor_x : 0);
         int last_sel_end = (E.sel_anchor_y < E.cy ? E.cx : E.sel_anchor_x);
@@ -1216,8 +1347,9 @@ void editorCutSelection(void) {
                E.row[end_line].chars,
                E.row[end_line].size + 1);
         E.row[start_line].size = new_size;
+        editorRowChanged(&E.row[start_line]);
         for (int i = end_line; i > start_line; i--) {
-            free(E.row[i].chars);
+            editorFreeRow(&E.row[i]);
             for (int j = i; j < E.numrows - 1; j++)
                 E.row[j] = E.row[j + 1];
             E.numrows--;
@@ -1272,6 +1404,7 @@ void editorInsertNewline(void) {
     remainder[line->size - index] = '\0';
     line->size = index;
     line->chars[index] = '\0';
+    editorRowChanged(line);
     char *new_content;
     if (auto_indent_enabled && !in_paste_mode) {
         size_t indent_len = strlen(indent);
@@ -1287,9 +1420,7 @@ void editorInsertNewline(void) {
         E.cx = 0;
     }
     free(remainder);
-    EditorLine *new_row = realloc(E.row, sizeof(EditorLine) * (E.numrows + 1));
-    if (!new_row) die("realloc");
-    E.row = new_row;
+    editorReserveRows(E.numrows + 1);
     for (int j = E.numrows; j > E.cy; j--)
         E.row[j] = E.row[j - 1];
     E.numrows++;
@@ -1297,6 +1428,9 @@ void editorInsertNewline(void) {
     E.row[E.cy + 1].size = strlen(new_content);
     E.row[E.cy + 1].modified = 1;
     E.row[E.cy + 1].hl_in_comment = 0;
+    E.row[E.cy + 1].width = -1;
+    E.row[E.cy + 1].marks = NULL;
+    E.row[E.cy + 1].nmarks = 0;
     E.cy++;
     E.preferred_cx = E.cx;
     E.dirty = 1;
@@ -1317,17 +1451,19 @@ void editorDelChar(void) {
         memcpy(prev_line->chars + prev_size, line->chars, line->size);
         prev_line->chars[prev_size + line->size] = '\0';
         prev_line->size = prev_size + line->size; prev_line->modified = 1;
-        free(line->chars);
+        editorRowChanged(prev_line);
+        editorFreeRow(line);
         for (int j = E.cy; j < E.numrows - 1; j++)
             E.row[j] = E.row[j + 1];
         E.numrows--; E.cy--;
-        E.cx = editorDisplayWidth(prev_line->chars);
+        E.cx = editorRowWidth(prev_line);
         E.preferred_cx = E.cx;
     } else {
         int index = editorRowCxToByteIndex(line, E.cx);
         int prev_index = editorRowCxToByteIndex(line, E.cx - 1);
         memmove(&line->chars[prev_index], &line->chars[index], line->size - index + 1);
         line->size -= (index - prev_index);
+        editorRowChanged(line);
         E.cx -= 1;
         E.preferred_cx = E.cx;
         line->modified = 1;
@@ -1341,43 +1477,172 @@ void editorOpen(const char *filename) {
     E.filename = strdup(filename);
     if (E.filename == NULL)
         die("strdup");
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
         if (errno == ENOENT) {
             editorAppendLine("", 0);
             E.dirty = 0;
             return;
         } else {
-            die("fopen");
+            die("open");
         }
     }
-    char *line = NULL; size_t linecap = 0; ssize_t linelen;
-    while ((linelen = getline(&line, &linecap, fp)) != -1) {
-        while (linelen > 0 && (line[linelen - 1] == '\n' || line[linelen - 1] == '\r')) {
-            line[linelen - 1] = '\0';
-            linelen--;
-        }
-        char *expanded = expand_tabs(line);
-        if (expanded) {
-            editorAppendLine(expanded, strlen(expanded));
-            free(expanded);
-        } else {
-            editorAppendLine(line, linelen);
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+        die("fstat");
+    size_t size = (size_t)st.st_size;
+    char *data = NULL;
+    if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+            die("mmap");
+    }
+    close(fd);
+
+    // Index the lines first so that the row array is allocated once.
+    char *end = data + size;
+    int lines = 0;
+    for (char *p = data; p < end; lines++) {
+        char *nl = memchr(p, '\n', end - p);
+        p = nl ? nl + 1 : end;
+    }
+    editorReserveRows(E.numrows + lines + 1);
+    for (char *p = data; p < end;) {
+        char *nl = memchr(p, '\n', end - p);
+        char *e = nl ? nl : end;
+        char *next = nl ? nl + 1 : end;
+        while (e > p && e[-1] == '\r')
+            e--;
+        char *nul = memchr(p, '\0', e - p);
+        if (nul)
+            e = nul;
+        editorAppendLine(p, e - p);
+        if (memchr(p, '\t', e - p)) {
+            EditorLine *row = &E.row[E.numrows - 1];
+            char *expanded = expand_tabs(row->chars);
+            if (expanded) {
+                free(row->chars);
+                row->chars = expanded;
+                row->size = strlen(expanded);
+            }
         }
+        p = next;
     }
-    free(line); fclose(fp);
+    if (data)
+        munmap(data, size);
     E.dirty = 0;
     if (E.numrows == 0)
         editorAppendLine("", 0);
 }
 
+/* Writes buf to a temporary file next to target, syncs it and renames it over
+   target. Returns 0 or an errno value. */
+static int save_file_atomic(const char *target, const char *buf, size_t len, mode_t mode) {
+    size_t tlen = strlen(target);
+    char *tmp = malloc(tlen + 8);
+    if (!tmp)
+        return ENOMEM;
+    memcpy(tmp, target, tlen);
+    memcpy(tmp + tlen, ".XXXXXX", 8);
+    int fd = mkstemp(tmp);
+    if (fd == -1) {
+        int err = errno;
+        free(tmp);
+        return err;
+    }
+    int err = 0;
+    if (fchmod(fd, mode) == -1)
+        err = errno;
+    while (!err && len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n == -1) {
+            if (errno != EINTR)
+                err = errno;
+            continue;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    if (!err && fsync(fd) == -1)
+        err = errno;
+    if (close(fd) == -1 && !err)
+        err = errno;
+    if (!err && rename(tmp, target) == -1)
+        err = errno;
+    if (err) {
+        unlink(tmp);
+    } else {
+        // Make the rename itself durable.
+        char *slash = strrchr(tmp, '/');
+        if (slash)
+            slash[1] = '\0';
+        int dfd = open(slash ? tmp : ".", O_RDONLY);
+        if (dfd != -1) {
+            fsync(dfd);
+            close(dfd);
+        }
+    }
+    free(tmp);
+    return err;
+}
+
+static void *save_worker(void *arg) {
+    (void)arg;
+    save_job.err = save_file_atomic(save_job.target, save_job.buf, save_job.len, save_job.mode);
+    atomic_store(&save_job.done, 1);
+    return NULL;
+}
+
+/* Settles the flags the snapshot marked SAVE_PENDING: saved, or modified again. */
+static void editorSettleSave(int err) {
+    int flag = err ? 1 : 0;
+    for (int i = 0; i < E.numrows; i++)
+        if (E.row[i].modified == SAVE_PENDING)
+            E.row[i].modified = flag;
+    if (err || E.dirty == SAVE_PENDING)
+        E.dirty = flag;   // after a failure the file no longer matches the document
+    E.save_errno = err;
+}
+
+/* Joins the save worker and records its outcome. */
+static void editorFinishSave(void) {
+    pthread_join(save_job.thread, NULL);
+    save_job.running = 0;
+    free(save_job.buf);
+    free(save_job.target);
+    save_job.buf = NULL;
+    save_job.target = NULL;
+    editorSettleSave(save_job.err);
+    if (save_job.err) {
+        snprintf(E.status_message, sizeof(E.status_message), "Save failed: %s",
+                 strerror(save_job.err));
+    } else {
+        snprintf(E.status_message, sizeof(E.status_message), "Saved %zu bytes", save_job.len);
+    }
+}
+
+/* Collects a finished background save; returns 1 when one was collected. */
+int editorPollSave(void) {
+    if (!save_job.running || !atomic_load(&save_job.done))
+        return 0;
+    editorFinishSave();
+    return 1;
+}
+
+/* Blocks until a running background save has finished. */
+void editorWaitSave(void) {
+    if (save_job.running)
+        editorFinishSave();
+}
+
 void editorSave(void) {
     if (E.filename == NULL)
         return;
-    int total_len = 0;
+    editorWaitSave();  // one save at a time
+    size_t total_len = 0;
     for (int j = 0; j < E.numrows; j++)
         total_len += E.row[j].size + 1;
-    char *buf = malloc(total_len);
+    char *buf = malloc(total_len > 0 ? total_len : 1);
     if (buf == NULL)
         die("malloc");
     char *p = buf;
@@ -1387,26 +1652,61 @@ void editorSave(void) {
         *p = '\n';
         p++;
     }
-    int fd = open(E.filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
-    if (fd != -1) {
-        if (write(fd, buf, total_len) == total_len) {
-            close(fd); free(buf);
-            E.dirty = 0;
-            for (int i = 0; i < E.numrows; i++)
-                E.row[i].modified = 0;
-            return;
-        }
-        close(fd);
+
+    // Replace the file a symlink points to, keeping the file's permissions.
+    char resolved[PATH_MAX];
+    const char *target = realpath(E.filename, resolved) ? resolved : E.filename;
+    struct stat st;
+    mode_t mode;
+    if (stat(target, &st) == 0) {
+        mode = st.st_mode & 07777;
+    } else {
+        mode_t mask = umask(0);
+        umask(mask);
+        mode = 0644 & ~mask;
+    }
+    save_job.target = strdup(target);
+    if (save_job.target == NULL)
+        die("strdup");
+    save_job.buf = buf;
+    save_job.len = total_len;
+    save_job.mode = mode;
+    save_job.err = 0;
+    atomic_store(&save_job.done, 0);
+    save_job.running = 1;
+    if (E.dirty)
+        E.dirty = SAVE_PENDING;
+    for (int i = 0; i < E.numrows; i++)
+        if (E.row[i].modified)
+            E.row[i].modified = SAVE_PENDING;
+    if (pthread_create(&save_job.thread, NULL, save_worker, NULL) != 0) {
+        // No thread available: save in the foreground.
+        save_job.running = 0;
+        save_job.err = save_file_atomic(save_job.target, buf, total_len, mode);
+        free(save_job.buf);
+        free(save_job.target);
+        save_job.buf = NULL;
+        save_job.target = NULL;
+        editorSettleSave(save_job.err);
     }
-    free(buf);
-    die("write");
 }
 
-void editorAppendLine(char *s, size_t len) {
-    EditorLine *new_row = realloc(E.row, sizeof(EditorLine) * (E.numrows + 1));
+/* Make room for at least n rows; the capacity grows geometrically. */
+void editorReserveRows(int n) {
+    if (n <= E.rowcap)
+        return;
+    int cap = E.rowcap > 0 ? E.rowcap : 16;
+    while (cap < n)
+        cap *= 2;
+    EditorLine *new_row = realloc(E.row, sizeof(EditorLine) * cap);
     if (new_row == NULL)
         die("realloc");
     E.row = new_row;
+    E.rowcap = cap;
+}
+
+void editorAppendLine(char *s, size_t len) {
+    editorReserveRows(E.numrows + 1);
     E.row[E.numrows].chars = malloc(len + 1);
     if (E.row[E.numrows].chars == NULL)
         die("malloc");
@@ -1415,6 +1715,9 @@ void editorAppendLine(char *s, size_t len) {
     E.row[E.numrows].size = (int)len;
     E.row[E.numrows].modified = 0;
     E.row[E.numrows].hl_in_comment = 0;
+    E.row[E.numrows].width = -1;
+    E.row[E.numrows].marks = NULL;
+    E.row[E.numrows].nmarks = 0;
     E.numrows++;
 }
 
@@ -1422,8 +1725,8 @@ void editorInsertChar(int c) {
     if (E.cy == E.numrows)
         editorAppendLine("", 0);
     EditorLine *line = &E.row[E.cy];
-    if (E.cx > editorDisplayWidth(line->chars))
-        E.cx = editorDisplayWidth(line->chars);
+    if (E.cx > editorRowWidth(line))
+        E.cx = editorRowWidth(line);
     int index = editorRowCxToByteIndex(line, E.cx);
     char *new_chars = realloc(line->chars, line->size + 2);
     if (new_chars == NULL)
@@ -1432,6 +1735,7 @@ void editorInsertChar(int c) {
     memmove(&line->chars[index + 1], &line->chars[index], line->size - index + 1);
     line->chars[index] = c;
     line->size++;
+    editorRowChanged(line);
     E.cx++;
     E.preferred_cx = E.cx;
     line->modified = 1; E.dirty = 1;
@@ -1441,8 +1745,8 @@ void editorInsertUTF8(const char *s, int len) {
     if (E.cy == E.numrows)
         editorAppendLine("", 0);
     EditorLine *line = &E.row[E.cy];
-    if (E.cx > editorDisplayWidth(line->chars))
-        E.cx = editorDisplayWidth(line->chars);
+    if (E.cx > editorRowWidth(line))
+        E.cx = editorRowWidth(line);
     int index = editorRowCxToByteIndex(line, E.cx);
     char *new_chars = realloc(line->chars, line->size + len + 1);
     if (new_chars == NULL)
@@ -1451,6 +1755,7 @@ void editorInsertUTF8(const char *s, int len) {
     memmove(&line->chars[index + len], &line->chars[index], line->size - index + 1);
     memcpy(&line->chars[index], s, len);
     line->size += len;
+    editorRowChanged(line);
     wchar_t wc;
     size_t bytes = mbrtowc(&wc, s, len, NULL);
     int width = (bytes == (size_t)-1 || bytes == (size_t)-2) ? 1 : wcwidth(wc);
@@ -1465,8 +1770,8 @@ int main(int argc, char *argv[]) {
     setlocale(LC_CTYPE, "");
     E.cx = 0; E.cy = 0;
     E.rowoff = 0; E.coloff = 0;
-    E.numrows = 0; E.row = NULL;
-    E.filename = NULL; E.dirty = 0;
+    E.numrows = 0; E.rowcap = 0; E.row = NULL;
+    E.filename = NULL; E.dirty = 0; E.save_errno = 0;
     E.status_message[0] = '\0';
     E.selecting = 0; E.sel_anchor_x = 0; E.sel_anchor_y = 0;
     E.preferred_cx = 0;
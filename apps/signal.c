@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include <unistd.h>    // for isatty, STDOUT_FILENO
 #include <errno.h>     // for errno
+#include <alsa/asoundlib.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -15,6 +16,127 @@
 
 #define SAMPLE_RATE 44100.0
 
+/*
+ * Samples are generated a block at a time from a 32-bit phase accumulator
+ * (2^32 = one period). Sine reads a wavetable with linear interpolation, the
+ * other waveforms are computed straight from the phase, and noise uses an
+ * xorshift64* generator instead of rand(). Each block is converted in one
+ * pass and written with a single fwrite() or snd_pcm_writei().
+ */
+#define BLOCK_SAMPLES 4096
+#define TABLE_BITS 12
+#define TABLE_SIZE (1u << TABLE_BITS)
+#define PHASE_FRAC_BITS (32 - TABLE_BITS)
+
+enum { W_SINE, W_SQUARE, W_TRIANGLE, W_SAWTOOTH, W_NOISE };
+
+static float sine_table[TABLE_SIZE + 1];   // one guard entry for interpolation
+
+typedef struct {
+    int wave;
+    uint32_t phase;
+    uint32_t phase_inc;
+    uint64_t rng;
+} Oscillator;
+
+static void init_sine_table(void) {
+    for (unsigned int i = 0; i <= TABLE_SIZE; i++)
+        sine_table[i] = (float)sin(2.0 * M_PI * i / TABLE_SIZE);
+}
+
+// xorshift64*: a few cycles per sample and far better spectrum than rand().
+static inline uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static void fill_block(Oscillator *osc, float *buf, size_t n) {
+    uint32_t phase = osc->phase;
+    const uint32_t inc = osc->phase_inc;
+    const float frac_scale = 1.0f / (float)(1u << PHASE_FRAC_BITS);
+    const float int_scale = 1.0f / 2147483648.0f;
+
+    switch (osc->wave) {
+      case W_SINE:
+        for (size_t i = 0; i < n; i++) {
+            uint32_t idx = phase >> PHASE_FRAC_BITS;
+            float frac = (float)(phase & ((1u << PHASE_FRAC_BITS) - 1)) * frac_scale;
+            buf[i] = sine_table[idx] + frac * (sine_table[idx + 1] - sine_table[idx]);
+            phase += inc;
+        }
+        break;
+      case W_SQUARE:
+        for (size_t i = 0; i < n; i++) {
+            buf[i] = (phase < 0x80000000u) ? 1.0f : -1.0f;
+            phase += inc;
+        }
+        break;
+      case W_SAWTOOTH:
+        // Read as signed, the phase is already a sawtooth from -2^31 to 2^31.
+        for (size_t i = 0; i < n; i++) {
+            buf[i] = (float)(int32_t)phase * int_scale;
+            phase += inc;
+        }
+        break;
+      case W_TRIANGLE:
+        for (size_t i = 0; i < n; i++) {
+            float saw = (float)(int32_t)phase * int_scale;
+            buf[i] = 2.0f * fabsf(saw) - 1.0f;
+            phase += inc;
+        }
+        break;
+      case W_NOISE:
+        for (size_t i = 0; i < n; i++)
+            buf[i] = (float)(int32_t)(next_random(&osc->rng) >> 32) * int_scale;
+        break;
+    }
+    osc->phase = phase;
+}
+
+static void float_to_s16(const float *in, int16_t *out, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        out[i] = (int16_t)(in[i] * 32767.0f);
+}
+
+static snd_pcm_t *open_playback(void) {
+    snd_pcm_t *pcm = NULL;
+    int err = snd_pcm_open(&pcm, "default", SND_PCM_STREAM_PLAYBACK, 0);
+    if (err < 0) {
+        fprintf(stderr, "Cannot open ALSA playback device: %s\n", snd_strerror(err));
+        return NULL;
+    }
+    // 16-bit little-endian mono 44.1 kHz with 100 ms of latency.
+    err = snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED,
+                             1, (unsigned int)SAMPLE_RATE, 1, 100000);
+    if (err < 0) {
+        fprintf(stderr, "Cannot configure ALSA playback: %s\n", snd_strerror(err));
+        snd_pcm_close(pcm);
+        return NULL;
+    }
+    return pcm;
+}
+
+static int play_block(snd_pcm_t *pcm, const int16_t *samples, size_t n) {
+    while (n > 0) {
+        snd_pcm_sframes_t written = snd_pcm_writei(pcm, samples, n);
+        if (written < 0) {
+            written = snd_pcm_recover(pcm, (int)written, 0);
+            if (written < 0) {
+                fprintf(stderr, "ALSA playback failed: %s\n", snd_strerror((int)written));
+                return -1;
+            }
+            continue;
+        }
+        samples += written;
+        n -= (size_t)written;
+    }
+    return 0;
+}
+
 static void usage(const char *prog) {
     fprintf(stderr,
         "Usage: %s -<waveform> <freq_Hz> <duration_s|inf> [format]\n"
@@ -68,7 +190,7 @@ int main(int argc, char *argv[]) {
 
     // Parse waveform
     const char *w = argv[1][0]=='-' ? argv[1]+1 : argv[1];
-    enum { W_SINE, W_SQUARE, W_TRIANGLE, W_SAWTOOTH, W_NOISE } wave;
+    int wave;
     if      (!strcmp(w,"sine"))     wave = W_SINE;
     else if (!strcmp(w,"square"))   wave = W_SQUARE;
     else if (!strcmp(w,"triangle")) wave = W_TRIANGLE;
@@ -124,21 +246,20 @@ int main(int argc, char *argv[]) {
         ? 0
         : (uint64_t)(duration * SAMPLE_RATE);
 
-    // Seed RNG for noise
-    srand((unsigned)time(NULL));
-
-    // Set up phase increment
-    const double two_pi = 2.0 * M_PI;
-    const double phase_inc = two_pi * freq / SAMPLE_RATE;
-    double phase = 0.0;
+    // Set up the oscillator: phase increment in 1/2^32 of a period per sample.
+    Oscillator osc;
+    osc.wave = wave;
+    osc.phase = 0;
+    osc.phase_inc = (uint32_t)(fmod(freq / SAMPLE_RATE, 1.0) * 4294967296.0);
+    osc.rng = (uint64_t)time(NULL) * 0x9E3779B97F4A7C15ULL | 1;  // never zero
+    init_sine_table();
 
     // Open output stream
     FILE *out = stdout;
+    snd_pcm_t *pcm = NULL;
     if (mode == F_PLAY) {
-        // play via aplay: 16-bit little-endian mono 44.1 kHz
-        out = popen("aplay -q -f S16_LE -c1 -r44100", "w");
-        if (!out) {
-            fprintf(stderr, "Failed to launch aplay: %s\n", strerror(errno));
+        pcm = open_playback();
+        if (!pcm) {
             return EXIT_FAILURE;
         }
     }
@@ -156,50 +277,40 @@ int main(int argc, char *argv[]) {
             argv[0], argv[1], argv[2], argv[3]);
     }
 
-    // Generate and output samples
-    for (uint64_t n = 0; infinite || n < total_samples; ++n) {
-        float fval;
-        switch (wave) {
-          case W_SINE:
-            fval = (float)sin(phase);
-            break;
-          case W_SQUARE:
-            fval = (phase < M_PI ? 1.0f : -1.0f);
-            break;
-          case W_SAWTOOTH: {
-            double t = phase / two_pi;
-            fval = (float)(2.0 * (t - floor(t + 0.5)));
-            break;
-          }
-          case W_TRIANGLE: {
-            double t = phase / two_pi;
-            double saw = 2.0 * (t - floor(t + 0.5));
-            fval = (float)(2.0 * fabs(saw) - 1.0);
-            break;
-          }
-          case W_NOISE:
-            fval = (float)((rand() / (double)RAND_MAX) * 2.0 - 1.0);
-            break;
-        }
+    // Generate and output samples block by block
+    static float fbuf[BLOCK_SAMPLES];
+    static int16_t sbuf[BLOCK_SAMPLES];
+    static char tbuf[BLOCK_SAMPLES * 16];
+    for (uint64_t n = 0; infinite || n < total_samples; ) {
+        size_t count = BLOCK_SAMPLES;
+        if (!infinite && total_samples - n < count)
+            count = (size_t)(total_samples - n);
+        fill_block(&osc, fbuf, count);
+        n += count;
 
         if (mode == F_RAW) {
-            if (fwrite(&fval, sizeof(fval), 1, out) != 1) break;
+            if (fwrite(fbuf, sizeof(float), count, out) != count) break;
         }
         else if (mode == F_TEXT) {
-            if (fprintf(out, "%f\n", fval) < 0) break;
+            size_t len = 0;
+            for (size_t i = 0; i < count; i++)
+                len += (size_t)snprintf(tbuf + len, sizeof(tbuf) - len, "%f\n", fbuf[i]);
+            if (fwrite(tbuf, 1, len, out) != len) break;
         }
         else {
             // F_WAV or F_PLAY both want 16-bit PCM
-            int16_t s16 = (int16_t)(fval * 32767);
-            if (fwrite(&s16, sizeof(s16), 1, out) != 1) break;
+            float_to_s16(fbuf, sbuf, count);
+            if (mode == F_PLAY) {
+                if (play_block(pcm, sbuf, count) < 0) break;
+            } else if (fwrite(sbuf, sizeof(int16_t), count, out) != count) {
+                break;
+            }
         }
-
-        phase += phase_inc;
-        if (phase >= two_pi) phase -= two_pi;
     }
 
     if (mode == F_PLAY) {
-        pclose(out);
+        snd_pcm_drain(pcm);
+        snd_pcm_close(pcm);
     }
 
     return 0;
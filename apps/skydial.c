@@ -7,8 +7,8 @@ illuminated percentage.
 The default observer location is Jyväskylä, Finland (latitude 62.2426° N, longitude 25.7473° E), 
 but a user may provide alternate coordinates via command-line parameters.
 
-Compile with:
-    cc -std=c11 -D_POSIX_C_SOURCE=200112L -lm -o skydial skydial.c
+Compile with (the positions come from the shared ephemeris in lib/libephem.c):
+    cc -std=c11 -D_POSIX_C_SOURCE=200112L -o skydial skydial.c ../lib/libephem.c -lm
 
 Usage:
     ./skydial
@@ -60,40 +60,34 @@ static const struct BrightObject brightObjects[] = {
 static const int numBrightObjects = sizeof(brightObjects) / sizeof(brightObjects[0]);
 
 /*
-Structure for a planet with crude orbital parameters.
-All values are approximate for the epoch J2000.
- - L0: mean longitude at J2000 (degrees)
- - n: daily motion in degrees per day
- - A: ad-hoc correction amplitude (degrees)
+Structure for a planet; its orbit model lives in the shared ephemeris,
+looked up by name.
 */
 struct Planet {
     const char *name;
-    double L0;
-    double n;
-    double A;
     char symbol;
 };
 
 // Static catalog for five naked-eye planets.
 static const struct Planet planets[] = {
-    {"Mercury", 252.25084, 4.09233445, 7.0, '1'},
-    {"Venus",   181.97973, 1.60213034, 3.0, '2'},
-    {"Mars",    355.45332, 0.52402068, 1.8, '3'},
-    {"Jupiter", 34.40438,  0.083086,   1.3, '4'},
-    {"Saturn",  49.94432,  0.033459,   0.8, '5'}
+    {"Mercury", '1'},
+    {"Venus",   '2'},
+    {"Mars",    '3'},
+    {"Jupiter", '4'},
+    {"Saturn",  '5'}
 };
 static const int numPlanets = sizeof(planets) / sizeof(planets[0]);
 
+// Shared ephemeris (lib/libephem.c).
+extern int ephem_body(const char *name);
+extern double ephem_jd(int year, int month, int day, double hours);
+extern void ephem_equatorial(int body, double jd, double *ra, double *dec);
+extern void ephem_horizontal(double ra, double dec, double lat, double lon, double jd,
+                             double *az, double *alt);
+extern double ephem_moon_illumination(double jd);
+
 // Function prototypes.
 double deg2rad(double deg);
-double rad2deg(double rad);
-double normalize_angle(double angle);
-double julian_date(struct tm *t);
-void calc_sun(double jd, double *ra, double *dec);
-void calc_moon(double jd, double *ra, double *dec);
-double calc_moon_phase(double jd);
-void calc_planet(double jd, double L0, double n, double A, double *ra, double *dec);
-void equatorial_to_horizontal(double ra, double dec, double lat, double lon, double jd, double *az, double *alt);
 static void plot_object_on_canvas(char canvas[HEIGHT][WIDTH+1], int center_x, int center_y,
                                   int radius_x, int radius_y, double az, double alt, char symbol);
 void draw_skydial(double sun_az, double sun_alt, double moon_az, double moon_alt,
@@ -104,164 +98,6 @@ double deg2rad(double deg) {
     return deg * PI / 180.0;
 }
 
-// Convert radians to degrees.
-double rad2deg(double rad) {
-    return rad * 180.0 / PI;
-}
-
-// Normalize angle to [0, 360).
-double normalize_angle(double angle) {
-    double result = fmod(angle, 360.0);
-    if (result < 0)
-        result += 360.0;
-    return result;
-}
-
-// Compute Julian Date from a UTC time structure.
-double julian_date(struct tm *t) {
-    int year = t->tm_year + 1900;
-    int month = t->tm_mon + 1;
-    int day = t->tm_mday;
-    int hour = t->tm_hour;
-    int minute = t->tm_min;
-    int second = t->tm_sec;
-
-    if (month <= 2) {
-        year -= 1;
-        month += 12;
-    }
-    int A = year / 100;
-    int B = 2 - A + (A / 4);
-    double day_fraction = (hour + minute / 60.0 + second / 3600.0) / 24.0;
-    double JD = floor(365.25 * (year + 4716)) +
-                floor(30.6001 * (month + 1)) +
-                day + day_fraction + B - 1524.5;
-    return JD;
-}
-
-/*
-Approximate apparent right ascension (ra) and declination (dec) of the Sun in degrees.
-Uses simplified formulas.
-*/
-void calc_sun(double jd, double *ra, double *dec) {
-    double d = jd - 2451545.0;  // days since J2000
-
-    double M = normalize_angle(357.529 + 0.98560028 * d); // mean anomaly in degrees
-    double L = normalize_angle(280.459 + 0.98564736 * d);  // mean longitude
-    double lambda = L + 1.915 * sin(deg2rad(M)) + 0.020 * sin(deg2rad(2 * M));
-
-    double epsilon = 23.439 - 0.00000036 * d; // obliquity of the ecliptic
-    double lambda_rad = deg2rad(lambda);
-    double epsilon_rad = deg2rad(epsilon);
-
-    double ra_rad = atan2(cos(epsilon_rad) * sin(lambda_rad), cos(lambda_rad));
-    double dec_rad = asin(sin(epsilon_rad) * sin(lambda_rad));
-
-    *ra = normalize_angle(rad2deg(ra_rad));
-    *dec = rad2deg(dec_rad);
-}
-
-/*
-Approximate apparent right ascension (ra) and declination (dec) of the Moon in degrees.
-Uses a simplified and low-accuracy algorithm.
-*/
-void calc_moon(double jd, double *ra, double *dec) {
-    double d = jd - 2451545.0;
-
-    double L0 = normalize_angle(218.316 + 13.176396 * d); // Moon's mean longitude
-    double M_moon = normalize_angle(134.963 + 13.064993 * d); // Moon's mean anomaly
-    double L = L0 + 6.289 * sin(deg2rad(M_moon));
-    
-    double epsilon = 23.439 - 0.00000036 * d; 
-    double L_rad = deg2rad(L);
-    double epsilon_rad = deg2rad(epsilon);
-
-    double ra_rad = atan2(cos(epsilon_rad) * sin(L_rad), cos(L_rad));
-    double dec_rad = asin(sin(epsilon_rad) * sin(L_rad));
-
-    *ra = normalize_angle(rad2deg(ra_rad));
-    *dec = rad2deg(dec_rad);
-}
-
-/*
-Compute the fraction of the Moon's disc that is illuminated based on the difference 
-between the Moon's and Sun's ecliptic longitudes.
-This simplified algorithm calculates the phase angle and then computes the fraction 
-as: (1 - cos(phase_angle))/2.
-*/
-double calc_moon_phase(double jd) {
-    double d = jd - 2451545.0;
-    double M = normalize_angle(357.529 + 0.98560028 * d);
-    double L = normalize_angle(280.459 + 0.98564736 * d);
-    double lambda_sun = L + 1.915 * sin(deg2rad(M)) + 0.020 * sin(deg2rad(2 * M));
-    
-    double L0 = normalize_angle(218.316 + 13.176396 * d);
-    double M_moon = normalize_angle(134.963 + 13.064993 * d);
-    double lambda_moon = L0 + 6.289 * sin(deg2rad(M_moon));
-    
-    double diff = fabs(normalize_angle(lambda_moon - lambda_sun));
-    if (diff > 180.0)
-        diff = 360.0 - diff;
-    
-    double phase = (1 - cos(deg2rad(diff))) / 2.0;
-    return phase;
-}
-
-/*
-Calculate approximate equatorial coordinates (RA/Dec) for a planet using a very crude model.
-The algorithm computes a mean longitude adjusted by a small correction term.
-*/
-void calc_planet(double jd, double L0, double n, double A, double *ra, double *dec) {
-    double d = jd - 2451545.0;
-    double L = normalize_angle(L0 + n * d); 
-    // Apply a crude correction; note: for a true calculation, the mean anomaly and eccentricity should be used.
-    double lambda = normalize_angle(L + A * sin(deg2rad(L)));
-    
-    double epsilon = 23.439 - 0.00000036 * d;  // approximate obliquity of the ecliptic
-    double lambda_rad = deg2rad(lambda);
-    double epsilon_rad = deg2rad(epsilon);
-    
-    double ra_rad = atan2(cos(epsilon_rad) * sin(lambda_rad), cos(lambda_rad));
-    double dec_rad = asin(sin(epsilon_rad) * sin(lambda_rad));
-    
-    *ra = normalize_angle(rad2deg(ra_rad));
-    *dec = rad2deg(dec_rad);
-}
-
-/*
-Convert equatorial coordinates (RA and Dec in degrees) to horizontal coordinates 
-(azimuth and altitude in degrees) for a given observer's location and time.
-*/
-void equatorial_to_horizontal(double ra, double dec, double lat, double lon, double jd, double *az, double *alt) {
-    double ra_rad = deg2rad(ra);
-    double dec_rad = deg2rad(dec);
-    double lat_rad = deg2rad(lat);
-
-    double d = jd - 2451545.0;
-    double GMST = normalize_angle(280.46061837 + 360.98564736629 * d);
-    double LST = normalize_angle(GMST + lon);
-    double LST_rad = deg2rad(LST);
-
-    double HA = LST_rad - ra_rad;
-    if (HA < -PI)
-        HA += 2 * PI;
-    if (HA > PI)
-        HA -= 2 * PI;
-
-    double sin_alt = sin(dec_rad) * sin(lat_rad) + cos(dec_rad) * cos(lat_rad) * cos(HA);
-    double altitude_rad = asin(sin_alt);
-
-    double cos_az = (sin(dec_rad) - sin(altitude_rad) * sin(lat_rad)) / (cos(altitude_rad) * cos(lat_rad));
-    if (cos_az > 1.0) cos_az = 1.0;
-    if (cos_az < -1.0) cos_az = -1.0;
-    double azimuth_rad = acos(cos_az);
-    if (sin(HA) > 0)
-        azimuth_rad = 2 * PI - azimuth_rad;
-
-    *az = normalize_angle(rad2deg(azimuth_rad));
-    *alt = rad2deg(altitude_rad);
-}
-
 /*
 Plot a celestial object (if above the horizon) onto the ASCII canvas.
 The marker is positioned by converting its azimuth and altitude to a location on the dial.
@@ -341,17 +177,17 @@ void draw_skydial(double sun_az, double sun_alt, double moon_az, double moon_alt
     // Plot bright naked-eye stars.
     for (int i = 0; i < numBrightObjects; i++) {
         double obj_az, obj_alt;
-        equatorial_to_horizontal(brightObjects[i].ra, brightObjects[i].dec,
-                                  lat, lon, jd, &obj_az, &obj_alt);
+        ephem_horizontal(brightObjects[i].ra, brightObjects[i].dec,
+                         lat, lon, jd, &obj_az, &obj_alt);
         plot_object_on_canvas(canvas, center_x, center_y, radius_x, radius_y, obj_az, obj_alt, brightObjects[i].symbol);
     }
 
     // Plot naked-eye planets.
     for (int i = 0; i < numPlanets; i++) {
         double planet_ra, planet_dec;
-        calc_planet(jd, planets[i].L0, planets[i].n, planets[i].A, &planet_ra, &planet_dec);
+        ephem_equatorial(ephem_body(planets[i].name), jd, &planet_ra, &planet_dec);
         double p_az, p_alt;
-        equatorial_to_horizontal(planet_ra, planet_dec, lat, lon, jd, &p_az, &p_alt);
+        ephem_horizontal(planet_ra, planet_dec, lat, lon, jd, &p_az, &p_alt);
         plot_object_on_canvas(canvas, center_x, center_y, radius_x, radius_y, p_az, p_alt, planets[i].symbol);
     }
 
@@ -380,21 +216,22 @@ int main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
-    double jd = julian_date(utc);
+    double jd = ephem_jd(utc->tm_year + 1900, utc->tm_mon + 1, utc->tm_mday,
+                         utc->tm_hour + utc->tm_min / 60.0 + utc->tm_sec / 3600.0);
 
     double sun_ra, sun_dec;
-    calc_sun(jd, &sun_ra, &sun_dec);
+    ephem_equatorial(ephem_body("Sun"), jd, &sun_ra, &sun_dec);
 
     double moon_ra, moon_dec;
-    calc_moon(jd, &moon_ra, &moon_dec);
+    ephem_equatorial(ephem_body("Moon"), jd, &moon_ra, &moon_dec);
 
     double sun_az, sun_alt;
-    equatorial_to_horizontal(sun_ra, sun_dec, lat, lon, jd, &sun_az, &sun_alt);
+    ephem_horizontal(sun_ra, sun_dec, lat, lon, jd, &sun_az, &sun_alt);
 
     double moon_az, moon_alt;
-    equatorial_to_horizontal(moon_ra, moon_dec, lat, lon, jd, &moon_az, &moon_alt);
+    ephem_horizontal(moon_ra, moon_dec, lat, lon, jd, &moon_az, &moon_alt);
 
-    double moon_phase = calc_moon_phase(jd);
+    double moon_phase = ephem_moon_illumination(jd);
 
     // Clear the terminal screen.
     printf("\033[2J\033[H");
@@ -48,20 +48,9 @@ Planet planets[NUM_PLANETS] = {
     { 'N',   30.070, 0.0086,60190.0,  4.471  }   // Neptune
 };
 
-// Function to solve Kepler's equation M = E - e*sin(E) using Newton-Raphson iteration.
+// Kepler's equation M = E - e*sin(E) is solved by the shared ephemeris (lib/libephem.c).
 // Returns the eccentric anomaly E given the mean anomaly M and eccentricity e.
-double solveKepler(double M, double e) {
-    double E = M; // initial guess
-    for (int i = 0; i < 10; i++) {
-        double f = E - e * sin(E) - M;
-        double fprime = 1 - e * cos(E);
-        double delta = f / fprime;
-        E -= delta;
-        if (fabs(delta) < 1e-6)
-            break;
-    }
-    return E;
-}
+extern double ephem_kepler(double M, double e);
 
 int main(int argc, char *argv[]) {
     // Parse command-line argument for number of orbits to visualize.
@@ -143,7 +132,7 @@ int main(int argc, char *argv[]) {
             M += 2 * M_PI;
         
         // Solve Kepler's equation for the eccentric anomaly.
-        double E = solveKepler(M, planets[p].e);
+        double E = ephem_kepler(M, planets[p].e);
         
         // Compute the true anomaly.
         double f_angle = 2 * atan2(sqrt(1 + planets[p].e) * sin(E / 2),
@@ -187,7 +176,7 @@ int main(int argc, char *argv[]) {
         if (M < 0)
             M += 2 * M_PI;
         // Solve for the eccentric anomaly.
-        double E = solveKepler(M, planets[p].e);
+        double E = ephem_kepler(M, planets[p].e);
         // Compute the true anomaly.
         double f_angle = 2 * atan2(sqrt(1 + planets[p].e) * sin(E / 2),
                                    sqrt(1 - planets[p].e) * cos(E / 2));
@@ -13,17 +13,27 @@
  *  - Displays external row numbers and column letters (Excel–like).
  *  - Copy–paste now automatically adjusts relative cell references. To prevent adjustment,
  *    the user may use the '$' character (e.g. "$A$1").
+ *  - Only the part of the sheet that fits the terminal is drawn; the viewport scrolls with
+ *    the selection. Each screen line is composed in memory and only lines that changed
+ *    since the previous keypress are rewritten, in a single write. Formula values come
+ *    from the library's value cache, so moving the cursor costs the same on any sheet size.
  *
  * To compile: cc -std=c11 -Wall -Wextra -pedantic -o table_app table.c libtable.c
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
 
 #define CTRL_KEY(k) ((k) & 0x1F)
 #define MAX_INPUT 256
+#define CELL_WIDTH 15      // width of the row label and of each cell slot
+#define MAX_LINE 4096      // composed screen line incl. escape sequences
 
 // Extern declarations from libtable.c
 typedef struct Table Table;
@@ -36,9 +46,9 @@ extern int table_save_csv(const Table *table, const char *filename);
 extern Table *table_load_csv(const char *filename);
 extern int table_get_rows(const Table *table);
 extern int table_get_cols(const Table *table);
-extern void table_print_highlight(const Table *table, int highlight_row, int highlight_col);
-extern void table_print_highlight_ex(const Table *table, int highlight_row, int highlight_col, int show_formulas);
 extern const char *table_get_cell(const Table *table, int row, int col);
+extern const char *table_get_display(const Table *table, int row, int col, int show_formulas);
+extern void table_get_column_label(int col, char *buf, size_t buf_size);
 extern int table_delete_column(Table *table, int col);
 extern int table_delete_row(Table *table, int row);
 // Declaration of the new adjustment function.
@@ -61,6 +71,15 @@ int show_formulas = 0;
 // New global flag to control display of the help/shortcut bar.
 static int show_help = 0;
 
+// Viewport: first table row and first data column shown.
+static int top_row = 0;
+static int left_col = 1;
+
+// Lines currently on the terminal, used to redraw only what changed.
+static char **screen_lines = NULL;
+static int screen_rows = 0;
+static int screen_cols = 0;
+
 /*
  * Terminal control functions using system("stty ...")
  */
@@ -93,27 +112,179 @@ void move_cursor(int row, int col) {
     fflush(stdout);
 }
 
+static void get_terminal_size(int *rows, int *cols) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        *rows = ws.ws_row;
+        *cols = ws.ws_col;
+    } else {
+        *rows = 24;
+        *cols = 80;
+    }
+}
+
+// Forgets the terminal contents so that the next render redraws every line.
+static void invalidate_screen(void) {
+    for (int i = 0; i < screen_rows; i++)
+        free(screen_lines[i]);
+    free(screen_lines);
+    screen_lines = NULL;
+    screen_rows = 0;
+}
+
+// Writes text into a line buffer starting at column x, clipped to the width.
+static void put_text(char *text, unsigned char *inverse, int width, int *used,
+                     int x, const char *s, int pad_to, int inv) {
+    int len = (int)strlen(s);
+    int n = len > pad_to ? len : pad_to;
+    for (int k = 0; k < n && x + k < width; k++) {
+        text[x + k] = (k < len) ? s[k] : ' ';
+        inverse[x + k] = (unsigned char)inv;
+    }
+    int end = (x + n > width) ? width : x + n;
+    if (end > *used)
+        *used = end;
+}
+
+// Serializes a line buffer into out, toggling inverse video where needed.
+static void compose_line(char *out, const char *text, const unsigned char *inverse, int used) {
+    size_t len = 0;
+    int inv = 0;
+    for (int i = 0; i < used && len + 8 < MAX_LINE; i++) {
+        if (inverse[i] != inv) {
+            len += (size_t)sprintf(out + len, inverse[i] ? "\033[7m" : "\033[0m");
+            inv = inverse[i];
+        }
+        out[len++] = text[i];
+    }
+    if (inv)
+        len += (size_t)sprintf(out + len, "\033[0m");
+    out[len] = '\0';
+}
+
 /*
- * New function: Print an improved help/shortcut bar below the spreadsheet.
- * Using a carriage return (\r) at the beginning of each line and the clear-to-end-of-line
- * sequence (\033[K) forces a consistent alignment even when lines vary in length.
+ * Draws the visible part of the table and the help bar. The viewport scrolls so
+ * that the selected cell is visible. Cells are laid out in fixed slots of
+ * CELL_WIDTH characters; non-selected cells overflow into the following slots
+ * and the selected cell's slot is shown in inverse video. Only lines that differ
+ * from what is on the terminal are written.
  */
-void print_help_bar(void) {
-    int table_rows = table_get_rows(g_table);
-    int help_start = table_rows + 3;
-    // Move the cursor to the first line of the help section.
-    printf("\033[%d;1H", help_start);
-    if (show_help) {
-        printf("\rDetailed Shortcuts:\033[K\n");
-        printf("\rNavigation:      HOME: ←5 cols   END: →5 cols   PGUP: ↑10 rows   PGDN: ↓10 rows\033[K\n");
-        printf("\r                 Arrow keys: move (live editing: type to modify cell, backspace to delete)\033[K\n");
-        printf("\rEditing:         CTRL+R: add row   CTRL+N: add column   CTRL+S: save   CTRL+Q: quit   CTRL+F: toggle formula view\033[K\n");
-        printf("\rCell Operations: DEL: clear cell   CTRL+D: delete col   CTRL+E: delete row   CTRL+C: copy   CTRL+X: cut   CTRL+V: paste\033[K\n");
-        printf("\r                 ...Press CTRL+T to hide help.\033[K\n");
-    } else {
-        printf("\rPress CTRL+T for help.\033[K\n");
+void render_screen(void) {
+    int term_rows, term_cols;
+    get_terminal_size(&term_rows, &term_cols);
+    if (term_rows != screen_rows || term_cols != screen_cols) {
+        invalidate_screen();
+        clear_screen();
+        screen_lines = calloc(term_rows, sizeof(char *));
+        if (!screen_lines)
+            return;
+        screen_rows = term_rows;
+        screen_cols = term_cols;
     }
-    fflush(stdout);
+
+    int help_lines = show_help ? 6 : 1;
+    int view_rows = term_rows - 2 - help_lines;  // header line and a blank line before help
+    if (view_rows < 1)
+        view_rows = 1;
+    int view_cols = (term_cols - CELL_WIDTH) / CELL_WIDTH;
+    if (view_cols < 1)
+        view_cols = 1;
+
+    // Scroll the viewport to keep the selection visible.
+    if (cur_row < top_row)
+        top_row = cur_row;
+    if (cur_row >= top_row + view_rows)
+        top_row = cur_row - view_rows + 1;
+    if (cur_col < left_col)
+        left_col = cur_col;
+    if (cur_col >= left_col + view_cols)
+        left_col = cur_col - view_cols + 1;
+    if (left_col < 1)
+        left_col = 1;
+
+    int rows = table_get_rows(g_table);
+    int cols = table_get_cols(g_table);
+    char *text = malloc(term_cols);
+    unsigned char *inverse = malloc(term_cols);
+    char *line = malloc(MAX_LINE);
+    char *out = malloc((size_t)term_rows * (MAX_LINE + 32));
+    if (!text || !inverse || !line || !out) {
+        free(text);
+        free(inverse);
+        free(line);
+        free(out);
+        return;
+    }
+    size_t out_len = 0;
+
+    for (int y = 0; y < term_rows; y++) {
+        int used = 0;
+        memset(text, ' ', term_cols);
+        memset(inverse, 0, term_cols);
+        line[0] = '\0';
+
+        if (y == 0) {
+            // Column letters; the top-left corner is left blank.
+            for (int j = left_col; j < cols; j++) {
+                int x = CELL_WIDTH + (j - left_col) * CELL_WIDTH;
+                if (x >= term_cols)
+                    break;
+                char col_label[16];
+                table_get_column_label(j, col_label, sizeof(col_label));
+                put_text(text, inverse, term_cols, &used, x, col_label, 0, 0);
+            }
+            compose_line(line, text, inverse, used);
+        } else if (y <= view_rows) {
+            int i = top_row + y - 1;
+            if (i < rows) {
+                char row_label[16];
+                snprintf(row_label, sizeof(row_label), "%d", i + 1);
+                put_text(text, inverse, term_cols, &used, 0, row_label, 0, 0);
+                for (int j = left_col; j < cols; j++) {
+                    int x = CELL_WIDTH + (j - left_col) * CELL_WIDTH;
+                    if (x >= term_cols)
+                        break;
+                    const char *value = table_get_display(g_table, i, j, show_formulas);
+                    if (i == cur_row && j == cur_col) {
+                        char cell_fixed[CELL_WIDTH + 1];
+                        snprintf(cell_fixed, sizeof(cell_fixed), "%s", value);
+                        put_text(text, inverse, term_cols, &used, x, cell_fixed, CELL_WIDTH, 1);
+                        if (strlen(value) > CELL_WIDTH)
+                            put_text(text, inverse, term_cols, &used, x + CELL_WIDTH, value + CELL_WIDTH, 0, 0);
+                    } else {
+                        put_text(text, inverse, term_cols, &used, x, value, 0, 0);
+                    }
+                }
+                compose_line(line, text, inverse, used);
+            }
+        } else if (y >= view_rows + 2 && y < view_rows + 2 + help_lines) {
+            static const char *help[] = {
+                "Detailed Shortcuts:",
+                "Navigation:      HOME: ←5 cols   END: →5 cols   PGUP: ↑10 rows   PGDN: ↓10 rows",
+                "                 Arrow keys: move (live editing: type to modify cell, backspace to delete)",
+                "Editing:         CTRL+R: add row   CTRL+N: add column   CTRL+S: save   CTRL+Q: quit   CTRL+F: toggle formula view",
+                "Cell Operations: DEL: clear cell   CTRL+D: delete col   CTRL+E: delete row   CTRL+C: copy   CTRL+X: cut   CTRL+V: paste",
+                "                 ...Press CTRL+T to hide help."
+            };
+            int k = y - view_rows - 2;
+            snprintf(line, MAX_LINE, "%s", show_help ? help[k] : "Press CTRL+T for help.");
+        }
+
+        if (screen_lines[y] && strcmp(screen_lines[y], line) == 0)
+            continue;
+        free(screen_lines[y]);
+        screen_lines[y] = strdup(line);
+        out_len += (size_t)sprintf(out + out_len, "\033[%d;1H%s\033[K", y + 1, line);
+    }
+
+    if (out_len > 0) {
+        fwrite(out, 1, out_len, stdout);
+        fflush(stdout);
+    }
+    free(text);
+    free(inverse);
+    free(line);
+    free(out);
 }
 
 /*
@@ -121,8 +292,8 @@ void print_help_bar(void) {
  */
 void save_table(void) {
     char filename[MAX_INPUT];
-    move_cursor(24, 1);
-    printf("\rEnter filename to save: ");
+    move_cursor(screen_rows > 0 ? screen_rows : 24, 1);
+    printf("\r\033[KEnter filename to save: ");
     fflush(stdout);
     disable_raw_mode();
     fgets(filename, MAX_INPUT, stdin);
@@ -137,6 +308,8 @@ void save_table(void) {
     printf("\rPress any key to continue...");
     fflush(stdout);
     getchar();
+    // The prompt overwrote parts of the screen.
+    invalidate_screen();
 }
 
 int main(int argc, char *argv[]) {
@@ -169,11 +342,8 @@ int main(int argc, char *argv[]) {
 
     int running = 1;
     while (running) {
-        clear_screen();
-        // Print the table (this function clears the screen and prints the table grid)
-        table_print_highlight_ex(g_table, cur_row, cur_col, show_formulas);
-        // Print the improved help/shortcut bar below the table.
-        print_help_bar();
+        // Redraw the visible part of the table and the help bar.
+        render_screen();
 
         int c = getchar();
         if (c == 27) {  // ESC sequence for arrows/extended keys
@@ -315,6 +485,7 @@ int main(int argc, char *argv[]) {
     show_cursor();
     disable_raw_mode();
     clear_screen();
+    invalidate_screen();
     table_free(g_table);
     return EXIT_SUCCESS;
 }
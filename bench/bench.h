@@ -0,0 +1,137 @@
+/*
+ * bench.h
+ *
+ * Timing harness shared by the benchmark programs in bench/.
+ *
+ * Design principles:
+ *  - One program per kernel. A program either includes the source file of the
+ *    kernel it measures with main() renamed (for static functions in commands and
+ *    nodes) or declares the lib functions it calls, like any other consumer.
+ *  - Inputs are synthetic and generated with a fixed seed, so runs are comparable.
+ *  - bench_run() grows the batch size until one batch takes BENCH_MS milliseconds
+ *    (default 100), times BENCH_REPEATS batches and keeps the fastest one, which
+ *    is the one least disturbed by other load.
+ *  - Output is one line per case, whitespace separated, for bench/run.sh:
+ *        <name> <ns/op> <throughput> <unit>
+ *    Lines starting with '#' are comments.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BENCH_REPEATS 5
+#define BENCH_DEFAULT_MS 100.0
+
+typedef void (*BenchFn)(void *ctx);
+
+// Set to send the kernel's own stdout to /dev/null while it is timed.
+static int bench_mute_stdout = 0;
+
+static inline double bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// The call goes through a volatile pointer so that an optimizing build cannot
+// inline the kernel and drop work whose result is never read.
+static inline double bench_batch_ns(BenchFn fn, void *ctx, long iters) {
+    BenchFn volatile call = fn;
+    double t0 = bench_now_ns();
+    for (long i = 0; i < iters; i++)
+        call(ctx);
+    return bench_now_ns() - t0;
+}
+
+// Deterministic pseudo-random numbers for synthetic inputs (xorshift64).
+static inline uint64_t bench_rand(void) {
+    static uint64_t state = 0x9E3779B97F4A7C15ull;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static inline double bench_rand_unit(void) {
+    return (double)(bench_rand() >> 11) / 9007199254740992.0;
+}
+
+/*
+ * Write a synthetic numeric CSV without header to a new temporary file: column 1
+ * holds one of 'groups' integer keys, the others values in [0, 1000). Stores the
+ * path (to unlink when done) and returns the file size, or 0 on error.
+ */
+static inline size_t bench_temp_csv(char path[256], int rows, int cols, int groups) {
+    const char *dir = getenv("TMPDIR");
+    snprintf(path, 256, "%s/bench-%ld.csv", dir && *dir ? dir : "/tmp", (long)getpid());
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror("bench: temporary file");
+        return 0;
+    }
+    for (int r = 0; r < rows; r++) {
+        fprintf(f, "%d", (int)(bench_rand() % (uint64_t)groups));
+        for (int c = 1; c < cols; c++)
+            fprintf(f, ",%.3f", bench_rand_unit() * 1000.0);
+        fputc('\n', f);
+    }
+    long size = ftell(f);
+    if (fclose(f) != 0 || size <= 0) {
+        unlink(path);
+        return 0;
+    }
+    return (size_t)size;
+}
+
+/*
+ * Time fn(ctx) and print one result line. One call is one operation of 'work'
+ * units, reported as work per second in 'unit' (e.g. work = bytes / 1e6 for MB/s).
+ */
+static inline void bench_run(const char *name, BenchFn fn, void *ctx, double work, const char *unit) {
+    const char *env = getenv("BENCH_MS");
+    double target = (env && atof(env) > 0 ? atof(env) : BENCH_DEFAULT_MS) * 1e6;
+
+    int saved = -1;
+    if (bench_mute_stdout) {
+        fflush(stdout);
+        saved = dup(STDOUT_FILENO);
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) {
+            dup2(null, STDOUT_FILENO);
+            close(null);
+        }
+    }
+
+    // Calibrate: grow the batch until it takes a quarter of the target time.
+    long iters = 1;
+    double t = bench_batch_ns(fn, ctx, iters);
+    while (t < target / 4 && iters < (1L << 40)) {
+        iters *= t > 0 && target / 4 / t < 10 ? 2 : 10;
+        t = bench_batch_ns(fn, ctx, iters);
+    }
+    iters = (long)(iters * (target / (t > 1 ? t : 1))) + 1;
+
+    double best = 0;
+    for (int r = 0; r < BENCH_REPEATS; r++) {
+        double ns = bench_batch_ns(fn, ctx, iters) / (double)iters;
+        if (r == 0 || ns < best)
+            best = ns;
+    }
+
+    if (saved >= 0) {
+        fflush(stdout);
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+    printf("%-32s %14.1f %14.3f %s\n", name, best, work * 1e9 / best, unit);
+    fflush(stdout);
+}
+
+#endif
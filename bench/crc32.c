@@ -0,0 +1,41 @@
+/*
+ * crc32.c - benchmark of update_crc32() from commands/crc32.c.
+ */
+
+#define main crc32_main
+#include "../commands/crc32.c"
+#undef main
+
+#include "bench.h"
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    uint32_t crc;
+} CrcCase;
+
+static void run_crc(void *ctx) {
+    CrcCase *c = ctx;
+    c->crc = update_crc32(c->crc, c->buf, c->len);
+}
+
+int main(void) {
+    static const size_t sizes[] = { 64, 4096, 1 << 20 };
+    uint8_t *buf = malloc(1 << 20);
+    if (!buf) {
+        perror("malloc");
+        return 1;
+    }
+    for (size_t i = 0; i < (1 << 20); i++)
+        buf[i] = (uint8_t)bench_rand();
+    init_crc32();
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        CrcCase c = { buf, sizes[i], 0 };
+        char name[64];
+        snprintf(name, sizeof(name), "crc32/update/%zu", sizes[i]);
+        bench_run(name, run_crc, &c, sizes[i] / 1e6, "MB/s");
+    }
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * csvstat.c - benchmark of CSV parsing in commands/csvstat.c.
+ *
+ * Runs the whole command on a synthetic file without a binary sidecar, so the
+ * text is parsed every time: per-column statistics and a single-threaded
+ * group-by.
+ */
+
+#define main csvstat_main
+#include "../commands/csvstat.c"
+#undef main
+
+#include "bench.h"
+
+typedef struct {
+    int argc;
+    char **argv;
+} CsvCase;
+
+static void run_csvstat(void *ctx) {
+    CsvCase *c = ctx;
+    csvstat_main(c->argc, c->argv);
+}
+
+int main(void) {
+    char path[256];
+    size_t size = bench_temp_csv(path, 50000, 5, 100);
+    if (!size)
+        return 1;
+    bench_mute_stdout = 1;
+
+    char *stats_argv[] = { "csvstat", path, NULL };
+    CsvCase stats = { 2, stats_argv };
+    bench_run("csvstat/stats", run_csvstat, &stats, size / 1e6, "MB/s");
+
+    char *group_argv[] = { "csvstat", "-by", "1", "-t", "1", path, "3", NULL };
+    CsvCase group = { 7, group_argv };
+    bench_run("csvstat/groupby", run_csvstat, &group, size / 1e6, "MB/s");
+
+    unlink(path);
+    return 0;
+}
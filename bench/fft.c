@@ -0,0 +1,46 @@
+/*
+ * fft.c - benchmark of fft() from node/input_audio.c.
+ *
+ * fft() works in place, so every operation first restores the input signal;
+ * the copy is a small part of the time.
+ */
+
+#define main input_audio_main
+#include "../node/input_audio.c"
+#undef main
+
+#include "bench.h"
+
+typedef struct {
+    complex double *signal, *work;
+    int n;
+} FftCase;
+
+static void run_fft(void *ctx) {
+    FftCase *c = ctx;
+    memcpy(c->work, c->signal, (size_t)c->n * sizeof(complex double));
+    fft(c->work, c->n);
+}
+
+int main(void) {
+    static const int sizes[] = { 256, 1024, 4096 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        int n = sizes[i];
+        FftCase c = { malloc((size_t)n * sizeof(complex double)),
+                      malloc((size_t)n * sizeof(complex double)), n };
+        if (!c.signal || !c.work) {
+            perror("malloc");
+            return 1;
+        }
+        // A 1 kHz tone at 48 kHz with some noise, as from a microphone.
+        for (int k = 0; k < n; k++)
+            c.signal[k] = sin(2 * M_PI * 1000.0 * k / 48000.0) + 0.1 * (bench_rand_unit() - 0.5);
+
+        char name[64];
+        snprintf(name, sizeof(name), "fft/%d", n);
+        bench_run(name, run_fft, &c, n / 1e6, "Msamples/s");
+        free(c.signal);
+        free(c.work);
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#define _POSIX_C_SOURCE 200809L
+/*
+ * formula.c - benchmark of evaluate_formula() from lib/libtable.c.
+ *
+ * A 200 x 10 table of numbers; the formulas are evaluated directly, without the
+ * per-cell cache, as happens whenever a cell is (re)computed.
+ */
+
+#include <string.h>
+
+#include "bench.h"
+
+typedef struct Table Table;
+extern Table *table_create(void);
+extern void table_free(Table *table);
+extern int table_set_cell(Table *table, int row, int col, const char *value);
+extern int table_add_row(Table *table);
+extern int table_add_col(Table *table, const char *header);
+extern char *evaluate_formula(const Table *t, const char *formula);
+
+#define ROWS 200
+#define COLS 10
+
+typedef struct {
+    const Table *table;
+    const char *formula;
+} FormulaCase;
+
+static void run_formula(void *ctx) {
+    FormulaCase *c = ctx;
+    free(evaluate_formula(c->table, c->formula));
+}
+
+int main(void) {
+    Table *t = table_create();
+    if (!t) {
+        perror("table_create");
+        return 1;
+    }
+    for (int col = 1; col <= COLS; col++) {
+        char header[8];
+        snprintf(header, sizeof(header), "%c", 'A' + col - 1);
+        table_add_col(t, header);
+    }
+    for (int row = 1; row <= ROWS; row++) {
+        table_add_row(t);
+        for (int col = 1; col <= COLS; col++) {
+            char value[32];
+            snprintf(value, sizeof(value), "%.3f", bench_rand_unit() * 1000.0);
+            table_set_cell(t, row, col, value);
+        }
+    }
+
+    static const struct {
+        const char *name, *formula;
+        double cells;
+    } cases[] = {
+        { "formula/arith",   "=A1*2+(B3-C4)/2.5-D10*(E20+1)", 5 },
+        { "formula/sum",     "=SUM(A1:J200)",                 ROWS * COLS },
+        { "formula/average", "=AVERAGE(B1:B200)+SUM(C1:C50)", ROWS + 50 }
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        FormulaCase c = { t, cases[i].formula };
+        bench_run(cases[i].name, run_formula, &c, cases[i].cells / 1e6, "Mcells/s");
+    }
+    table_free(t);
+    return 0;
+}
@@ -0,0 +1,66 @@
+#define _POSIX_C_SOURCE 200809L
+/*
+ * frame.c - benchmark of process_frame() from lib/libregocnition.c.
+ *
+ * The input is a 320x240 YUYV sequence of a bright square moving over a noisy
+ * background. process_frame() draws its overlay into the frame, so every
+ * operation first copies the next pristine frame.
+ */
+
+#include <string.h>
+
+#include "bench.h"
+
+typedef struct {
+    int x;
+    int y;
+} Position;
+
+extern Position process_frame(unsigned char *frame, size_t frame_size, int frame_width, int frame_height);
+extern void process_frame_enable_timing(int enable);
+extern void process_frame_set_roi_tracking(int enable);
+
+#define WIDTH 320
+#define HEIGHT 240
+#define FRAME_SIZE (WIDTH * HEIGHT * 2)
+#define NUM_FRAMES 32
+
+typedef struct {
+    unsigned char *frames, *work;
+    int next;
+} FrameCase;
+
+static void run_frame(void *ctx) {
+    FrameCase *c = ctx;
+    memcpy(c->work, c->frames + (size_t)c->next * FRAME_SIZE, FRAME_SIZE);
+    process_frame(c->work, FRAME_SIZE, WIDTH, HEIGHT);
+    c->next = (c->next + 1) % NUM_FRAMES;
+}
+
+int main(void) {
+    FrameCase c = { malloc((size_t)NUM_FRAMES * FRAME_SIZE), malloc(FRAME_SIZE), 0 };
+    if (!c.frames || !c.work) {
+        perror("malloc");
+        return 1;
+    }
+    for (int f = 0; f < NUM_FRAMES; f++) {
+        unsigned char *p = c.frames + (size_t)f * FRAME_SIZE;
+        int sx = 40 + f * 6, sy = 60 + f * 3;   // square position in this frame
+        for (int y = 0; y < HEIGHT; y++) {
+            for (int x = 0; x < WIDTH; x++) {
+                int inside = x >= sx && x < sx + 32 && y >= sy && y < sy + 32;
+                p[(y * WIDTH + x) * 2] = (unsigned char)(inside ? 220 : 60 + bench_rand() % 8);
+                p[(y * WIDTH + x) * 2 + 1] = 128;
+            }
+        }
+    }
+
+    process_frame_enable_timing(1);   // also silences the per-frame diagnostics
+    bench_run("frame/full", run_frame, &c, 1, "frames/s");
+    process_frame_set_roi_tracking(1);
+    bench_run("frame/roi", run_frame, &c, 1, "frames/s");
+
+    free(c.frames);
+    free(c.work);
+    return 0;
+}
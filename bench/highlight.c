@@ -0,0 +1,41 @@
+#define _POSIX_C_SOURCE 200809L
+/*
+ * highlight.c - benchmark of highlight_c_line() from lib/libedit.c.
+ */
+
+#include <string.h>
+
+#include "bench.h"
+
+extern char *highlight_c_line(const char *line, int hl_in_comment);
+
+// A mix of the line kinds found in C sources.
+static const char *lines[] = {
+    "#include <stdio.h>",
+    "static int parse_header(const char *buf, size_t len, struct header *out) {",
+    "    for (size_t i = 0; i < len; i++) {",
+    "        if (buf[i] == '\\n' && state != STATE_BODY)   // end of the header",
+    "            return snprintf(out->name, sizeof(out->name), \"%s:%d\", name, 42);",
+    "    double ratio = 3.14159 * (double)count / 0x1F + 1e-6;",
+    "    /* Comments can span several lines and contain \"quotes\" and 'chars'. */",
+    "    switch (kind) { case TOKEN_IDENT: return while_loop(unsigned long long x); }",
+    "",
+    "}"
+};
+
+#define NUM_LINES (sizeof(lines) / sizeof(lines[0]))
+
+// One operation highlights one line, cycling through the mix.
+static void run_highlight(void *ctx) {
+    size_t *next = ctx;
+    free(highlight_c_line(lines[*next], 0));
+    *next = (*next + 1) % NUM_LINES;
+}
+
+int main(void) {
+    size_t bytes = 0, next = 0;
+    for (size_t i = 0; i < NUM_LINES; i++)
+        bytes += strlen(lines[i]) + 1;
+    bench_run("highlight/c_line", run_highlight, &next, (double)bytes / NUM_LINES / 1e6, "MB/s");
+    return 0;
+}
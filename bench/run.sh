@@ -0,0 +1,91 @@
+#!/bin/sh
+# =============================================================================
+# Script Name: run.sh
+# Description: Runs the benchmark programs of bench/ (built by 'make bench'),
+#              writes their results to bench/results.txt and compares every case
+#              with bench/baseline.txt.
+#
+# Design Principles:
+# - Machine-readable: results and baseline share the format printed by
+#   bench/bench.h, "<name> <ns/op> <throughput> <unit>", one case per line.
+# - The comparison is by ns/op; a case slower than the baseline by more than
+#   BENCH_TOLERANCE percent is a regression and makes the script exit with 1.
+# - Cases missing from either side are listed but never fail the run.
+#
+# Usage:
+#   bench/run.sh [-baseline] <benchmark program>...
+#     -baseline  store the results as the new bench/baseline.txt
+#
+# Environment:
+#   BENCH_MS         minimum duration of one timed batch in ms (default 100)
+#   BENCH_TOLERANCE  allowed slowdown in percent (default 10)
+# =============================================================================
+
+DIR=$(dirname "$0")
+RESULTS="$DIR/results.txt"
+BASELINE="$DIR/baseline.txt"
+TOLERANCE=${BENCH_TOLERANCE:-10}
+
+STORE=0
+if [ "$1" = "-baseline" ]; then
+    STORE=1
+    shift
+fi
+if [ $# -eq 0 ]; then
+    echo "Usage: $0 [-baseline] <benchmark program>..." >&2
+    exit 2
+fi
+
+# Run every program; a failing benchmark aborts so no partial baseline is stored.
+{
+    echo "# name ns/op throughput unit"
+    echo "# $(date -u '+%Y-%m-%dT%H:%M:%SZ') $(uname -srm)"
+} > "$RESULTS.tmp"
+for prog in "$@"; do
+    if ! "$prog" >> "$RESULTS.tmp"; then
+        echo "$0: $prog failed" >&2
+        rm -f "$RESULTS.tmp"
+        exit 2
+    fi
+done
+mv "$RESULTS.tmp" "$RESULTS"
+
+if [ $STORE -eq 1 ]; then
+    cp "$RESULTS" "$BASELINE"
+    cat "$RESULTS"
+    echo "Baseline stored in $BASELINE."
+    exit 0
+fi
+
+if [ ! -f "$BASELINE" ]; then
+    cat "$RESULTS"
+    echo "No baseline yet: run 'make bench-baseline' to store one."
+    exit 0
+fi
+
+awk -v tolerance="$TOLERANCE" '
+    BEGIN { printf "%-32s %14s %14s %8s\n", "# name", "ns/op", "baseline", "change" }
+    /^#/ { next }
+    NR == FNR { base[$1] = $2; next }
+    {
+        seen[$1] = 1
+        if (!($1 in base)) {
+            printf "%-32s %14.1f %14s %8s  new\n", $1, $2, "-", "-"
+            next
+        }
+        change = ($2 - base[$1]) / base[$1] * 100
+        verdict = change > tolerance ? "REGRESSION" : (change < -tolerance ? "faster" : "ok")
+        if (verdict == "REGRESSION")
+            regressions++
+        printf "%-32s %14.1f %14.1f %+7.1f%%  %s\n", $1, $2, base[$1], change, verdict
+    }
+    END {
+        for (name in base)
+            if (!(name in seen))
+                printf "%-32s %14s %14.1f %8s  missing\n", name, "-", base[name], "-"
+        if (regressions) {
+            printf "%d case(s) slower than the baseline by more than %s%%.\n", regressions, tolerance
+            exit 1
+        }
+    }
+' "$BASELINE" "$RESULTS"
@@ -0,0 +1,65 @@
+/*
+ * switchboard.c - benchmark of message routing in node/server.c.
+ *
+ * A full client table is set up in memory; the source and the routed-to
+ * destination are connected through socket pairs. One operation is one recv()
+ * batch of output lines from the source, parsed and forwarded by
+ * handle_client_input(), plus draining the destination socket.
+ */
+
+#define main server_main
+#include "../node/server.c"
+#undef main
+
+#include <fcntl.h>
+
+#include "bench.h"
+
+#define BATCH 8   // output lines per recv()
+
+typedef struct {
+    int src, dst;      // our ends of the source and destination socket pairs
+    char lines[512];
+    size_t len;
+} RouteCase;
+
+static void run_route(void *ctx) {
+    RouteCase *c = ctx;
+    char buf[8192];
+    if (write(c->src, c->lines, c->len) != (ssize_t)c->len)
+        exit(1);
+    handle_client_input(0);
+    while (read(c->dst, buf, sizeof(buf)) > 0)
+        ;
+}
+
+int main(void) {
+    int a[2], b[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, a) != 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, b) != 0) {
+        perror("socketpair");
+        return 1;
+    }
+    fcntl(b[0], F_SETFL, O_NONBLOCK);
+
+    memset(clients, 0, sizeof(clients));
+    memset(routing, -1, sizeof(routing));
+    memset(client_data, 0, sizeof(client_data));
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        clients[i].sockfd = -1;
+        clients[i].client_id = i + 1;
+        clients[i].active = 1;
+        snprintf(clients[i].name, sizeof(clients[i].name), "Client%d", i + 1);
+    }
+    // Route out0 of the first client to in3 of the last, the worst case for lookups.
+    clients[0].sockfd = a[1];
+    clients[MAX_CLIENTS - 1].sockfd = b[1];
+    routing[1][0].in_client_id = MAX_CLIENTS;
+    routing[1][0].in_channel = 3;
+
+    RouteCase c = { a[0], b[0], "", 0 };
+    for (int i = 0; i < BATCH; i++)
+        c.len += (size_t)snprintf(c.lines + c.len, sizeof(c.lines) - c.len, "out0: %.4f\n",
+                                  bench_rand_unit() * 100.0);
+    bench_run("switchboard/route", run_route, &c, BATCH, "msg/s");
+    return 0;
+}
@@ -11,6 +11,7 @@
 #include <errno.h>     /* For errno */
 #include <glob.h>      /* For glob() */
 #include <signal.h>    /* For signal() */
+#include <dlfcn.h>     /* For dlopen, dlsym */
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
@@ -40,6 +41,99 @@ void set_base_path(const char *path) {
     }
 }
 
+/*
+ * Shared-object commands. The makefile builds the commands listed in
+ * COMMAND_PLUGIN_SRCS a second time as commands/<name>.so with main() renamed
+ * to command_main(). Each one is dlopen()ed the first time it is used and kept
+ * loaded, so later runs are a plain function call instead of fork + exec.
+ * Lookups that fail are cached too; those commands keep running as processes.
+ */
+#define MAX_COMMAND_PLUGINS 64
+typedef int (*CommandMain)(int argc, char **argv);
+
+typedef struct {
+    char name[64];
+    CommandMain entry;   /* NULL when there is no usable shared object */
+} CommandPlugin;
+
+static CommandPlugin command_plugins[MAX_COMMAND_PLUGINS];
+static int command_plugin_count = 0;
+
+/* Return the in-process entry point of a command, loading it on first use */
+static CommandMain find_command_plugin(const char *command) {
+    for (int i = 0; i < command_plugin_count; i++) {
+        if (strcmp(command_plugins[i].name, command) == 0)
+            return command_plugins[i].entry;
+    }
+    if (strchr(command, '/') || strlen(command) >= sizeof(command_plugins[0].name))
+        return NULL;
+
+    char so_path[PATH_MAX];
+    snprintf(so_path, sizeof(so_path), "%s/commands/%s.so",
+             base_path[0] != '\0' ? base_path : ".", command);
+    CommandMain entry = NULL;
+    if (access(so_path, R_OK) == 0) {
+        void *handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            fprintf(stderr, "dlopen %s: %s\n", so_path, dlerror());
+        } else {
+            void *sym = dlsym(handle, "command_main");
+            if (sym) {
+                /* ISO C has no object-to-function pointer cast; POSIX allows the copy */
+                memcpy(&entry, &sym, sizeof(entry));
+            } else {
+                fprintf(stderr, "%s: no command_main symbol\n", so_path);
+                dlclose(handle);
+            }
+        }
+    }
+
+    if (command_plugin_count < MAX_COMMAND_PLUGINS) {
+        CommandPlugin *p = &command_plugins[command_plugin_count++];
+        strcpy(p->name, command);
+        p->entry = entry;
+    }
+    return entry;
+}
+
+int command_runs_inprocess(const char *command) {
+    return find_command_plugin(command) != NULL;
+}
+
+int run_command_inprocess(const CommandStruct *cmd, FILE *out, int *status) {
+    CommandMain entry = find_command_plugin(cmd->command);
+    if (!entry)
+        return 0;
+
+    /* Same argv layout as execute_command(): flags+values, then parameters */
+    char name[INPUT_SIZE];
+    strcpy(name, cmd->command);
+    int argc = 1 + cmd->opt_count + cmd->param_count;
+    char *args[argc + 1];
+    args[0] = name;
+    int idx = 1;
+    for (int i = 0; i < cmd->opt_count; i++)
+        args[idx++] = cmd->options[i];
+    for (int i = 0; i < cmd->param_count; i++)
+        args[idx++] = cmd->parameters[i];
+    args[idx] = NULL;
+
+    /* glibc's stdout/stderr are assignable; the command's stdio follows them */
+    FILE *saved_out = stdout, *saved_err = stderr;
+    fflush(stdout);
+    fflush(stderr);
+    if (out) {
+        stdout = out;
+        stderr = out;
+    }
+    *status = entry(argc, args);
+    fflush(stdout);
+    fflush(stderr);
+    stdout = saved_out;
+    stderr = saved_err;
+    return 1;
+}
+
 /* Commands that should bypass wildcard expansion */
 static const char *bypass_expansion_commands[] = {
     "list",
@@ -155,8 +249,10 @@ void parse_input(const char *input, CommandStruct *cmd) {
 /*
  * Locate the executable under base_path, then execv() it,
  * passing all flags (and their values) first, then positional parameters.
+ * Returns the command's exit status: 127 when it is not found and
+ * 128 + signal number when it was killed by a signal.
  */
-void execute_command(const CommandStruct *cmd) {
+int execute_command(const CommandStruct *cmd) {
     char command_path[PATH_MAX];
     int found = 0;
 
@@ -167,6 +263,11 @@ void execute_command(const CommandStruct *cmd) {
     };
     int num_dirs = sizeof(relative_commands_dirs) / sizeof(relative_commands_dirs[0]);
 
+    /* Shared-object commands run in-process; everything else is exec'd */
+    int status;
+    if (run_command_inprocess(cmd, NULL, &status))
+        return status;
+
     /* Search for the executable */
     for (int i = 0; i < num_dirs; i++) {
         if (base_path[0] != '\0') {
@@ -186,14 +287,14 @@ void execute_command(const CommandStruct *cmd) {
 
     if (!found) {
         fprintf(stderr, "Command not found or not executable: %s\n", cmd->command);
-        return;
+        return 127;
     }
 
     /* Resolve to absolute path */
     char abs_path[PATH_MAX];
     if (!realpath(command_path, abs_path)) {
         perror("realpath failed");
-        return;
+        return EXIT_FAILURE;
     }
 
     /* Build argv: flags+values first, then parameters */
@@ -211,18 +312,21 @@ void execute_command(const CommandStruct *cmd) {
     pid_t pid = fork();
     if (pid < 0) {
         perror("fork failed");
-        return;
+        return EXIT_FAILURE;
     }
     if (pid == 0) {
         signal(SIGINT, SIG_DFL);
         execv(abs_path, args);
         perror("execv failed");
         exit(EXIT_FAILURE);
-    } else {
-        int status;
-        if (waitpid(pid, &status, 0) < 0)
-            perror("waitpid failed");
     }
+    if (waitpid(pid, &status, 0) < 0) {
+        perror("waitpid failed");
+        return EXIT_FAILURE;
+    }
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
 }
 
 /* Free all strdup’d memory in a CommandStruct */
@@ -13,6 +13,8 @@
 #ifndef COMMANDPARSER_H
 #define COMMANDPARSER_H
 
+#include <stdio.h>
+
 #define INPUT_SIZE 256
 #define MAX_PARAMETERS 10
 #define MAX_OPTIONS 10
@@ -26,9 +28,21 @@ typedef struct {
 } CommandStruct;
 
 void parse_input(const char *input, CommandStruct *cmd);
-void execute_command(const CommandStruct *cmd);
+int execute_command(const CommandStruct *cmd);
 void free_command_struct(CommandStruct *cmd);
 
+/*
+ * In-process execution of shared-object commands (commands/<name>.so, built by
+ * "make plugins"). command_runs_inprocess() loads the shared object on first use
+ * and reports whether the command can run without fork/exec.
+ * run_command_inprocess() runs it with stdout and stderr redirected to out
+ * (or left alone when out is NULL), stores its exit status in *status and
+ * returns 1; it returns 0 when the command has no shared object and must be
+ * executed as a process.
+ */
+int command_runs_inprocess(const char *command);
+int run_command_inprocess(const CommandStruct *cmd, FILE *out, int *status);
+
 /* 
  * Sets the base directory for command lookup.
  * The base directory is typically the directory where the executable is located.
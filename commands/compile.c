@@ -1,25 +1,93 @@
-#define _POSIX_C_SOURCE 200112L
+#define _GNU_SOURCE     /* pipe2() */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 /*
     compile.c
 
-    A simple wrapper around gcc that:
+    A wrapper around gcc for multi-file programs that:
       - Uses -std=c11 always
       - Accepts arbitrary gcc flags (e.g. -lm, -O2, -Wall, etc.)
       - Accepts one or more C source files (*.c)
-      - Derives the output executable name from the first source file
+      - Derives the output executable name from the first source file,
+        unless it is given with -o
+      - Compiles every source file separately, in parallel
+      - Keeps object files in a cache keyed by a hash of the preprocessed
+        source, the flags and the gcc version, so unchanged files (and files
+        whose headers did not change) are never compiled twice
+      - Links only when an object or the link flags changed since the last
+        link of the same executable
 
     Usage:
-      compile [gcc-flags] file1.c [file2.c ...]
+      compile [-j jobs] [-o output] [gcc-flags] file1.c [file2.c ...]
     Example:
       compile -lm -O2 main.c util.c
-    This invokes:
-      gcc -std=c11 main.c util.c -lm -O2 -o main
+    This invokes (once per file, all at the same time):
+      gcc -std=c11 -O2 -c main.c -o <cache>/<hash>.o
+    and then:
+      gcc -std=c11 <objects> -lm -O2 -o main
+
+    The cache lives in $XDG_CACHE_HOME/budostack/compile (default
+    ~/.cache/budostack/compile) and can be deleted at any time.
 */
 
+#define MAX_JOBS 64
+
+/* One translation unit */
+typedef struct {
+    const char *source;
+    char object[4096];
+    int cached;          /* 1: object came from the cache */
+    int failed;
+    char *log;           /* compiler diagnostics */
+    size_t log_len, log_cap;
+} Unit;
+
+typedef struct {
+    Unit *units;
+    int count;
+    int next;
+    char **cflags;
+    int cflag_count;
+    const char *cache_dir;
+    const char *version;
+    pthread_mutex_t lock;
+} Build;
+
+/* Two independent 64-bit hashes, used together as a 128-bit content key */
+typedef struct {
+    uint64_t a, b;
+} Hash;
+
+static void hash_init(Hash *h) {
+    h->a = 0xcbf29ce484222325ULL;     /* FNV-1a offset basis */
+    h->b = 0x9e3779b97f4a7c15ULL;
+}
+
+static void hash_update(Hash *h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t a = h->a, b = h->b;
+    for (size_t i = 0; i < len; i++) {
+        a = (a ^ p[i]) * 0x100000001b3ULL;
+        b = (b + p[i] + 1) * 0xff51afd7ed558ccdULL;
+        b ^= b >> 29;
+    }
+    h->a = a;
+    h->b = b;
+}
+
+static void hash_hex(const Hash *h, char out[33]) {
+    snprintf(out, 33, "%016llx%016llx", (unsigned long long)h->a, (unsigned long long)h->b);
+}
+
 /* Strip the ".c" extension from filename if present */
 static void strip_extension(const char *filename, char *output, size_t maxlen) {
     size_t len = strlen(filename);
@@ -41,10 +109,12 @@ static void strip_extension(const char *filename, char *output, size_t maxlen) {
 /* Print usage information */
 static void print_help(const char *progname) {
     printf("Usage:\n");
-    printf("  %s [gcc-flags] file1.c [file2.c ...]\n", progname);
+    printf("  %s [-j jobs] [-o output] [gcc-flags] file1.c [file2.c ...]\n", progname);
     printf("\nExample:\n");
     printf("  %s -lm -O2 main.c util.c\n", progname);
     printf("  # compiles main.c and util.c into executable 'main'\n");
+    printf("\nSource files are compiled in parallel (default: one job per CPU) and\n");
+    printf("object files are cached, so only changed files are compiled again.\n");
 }
 
 /* Check if a string ends with ".c" */
@@ -53,6 +123,214 @@ static int is_c_file(const char *arg) {
     return (len > 2 && strcmp(arg + len - 2, ".c") == 0);
 }
 
+/* Flags that only matter when linking (libraries, linker options, objects) */
+static int is_link_only(const char *arg) {
+    return arg[0] != '-' || strncmp(arg, "-l", 2) == 0 || strncmp(arg, "-L", 2) == 0 ||
+           strncmp(arg, "-Wl,", 4) == 0 || strcmp(arg, "-static") == 0 ||
+           strcmp(arg, "-rdynamic") == 0 || strcmp(arg, "-Xlinker") == 0 ||
+           strcmp(arg, "-T") == 0 || strcmp(arg, "-u") == 0;
+}
+
+/* Flags whose value is the next argument (e.g. "-I inc"); the value goes wherever the flag goes */
+static int takes_value(const char *arg) {
+    static const char *const with_value[] = {
+        "-I", "-D", "-U", "-include", "-imacros", "-isystem", "-iquote", "-idirafter",
+        "-x", "-MF", "-MT", "-MQ", "-Xpreprocessor", "-Xassembler",
+        "-l", "-L", "-Xlinker", "-T", "-u", NULL
+    };
+    for (int i = 0; with_value[i]; i++) {
+        if (strcmp(arg, with_value[i]) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* mkdir -p */
+static int make_dirs(char *path) {
+    for (char *p = path + 1; *p; p++) {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        int rc = mkdir(path, 0755);
+        *p = '/';
+        if (rc != 0 && errno != EEXIST)
+            return -1;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST)
+        return -1;
+    return 0;
+}
+
+/*
+ * Start gcc with the given arguments. Its stdout goes to out_fd and its
+ * stderr to err_fd (-1: /dev/null). Returns the pid or -1. Pipes are created
+ * with O_CLOEXEC so a gcc started by one worker thread does not inherit the
+ * write end of another worker's pipe and keep its reader waiting.
+ */
+static pid_t spawn_gcc(char *const args[], int out_fd, int err_fd) {
+    pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+    int devnull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    dup2(out_fd >= 0 ? out_fd : devnull, STDOUT_FILENO);
+    dup2(err_fd >= 0 ? err_fd : devnull, STDERR_FILENO);
+    execvp("gcc", args);
+    _exit(127);
+}
+
+static int wait_ok(pid_t pid) {
+    int status;
+    if (pid < 0)
+        return 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            return 0;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void log_append(Unit *u, const char *data, size_t len) {
+    if (u->log_len + len + 1 > u->log_cap) {
+        size_t cap = u->log_cap ? u->log_cap : 1024;
+        while (cap < u->log_len + len + 1)
+            cap *= 2;
+        char *tmp = realloc(u->log, cap);
+        if (!tmp)
+            return;
+        u->log = tmp;
+        u->log_cap = cap;
+    }
+    memcpy(u->log + u->log_len, data, len);
+    u->log_len += len;
+    u->log[u->log_len] = '\0';
+}
+
+/* Run gcc and collect everything it prints into the unit's log */
+static int run_logged(Unit *u, char *const args[]) {
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) != 0)
+        return 0;
+    pid_t pid = spawn_gcc(args, pipefd[1], pipefd[1]);
+    close(pipefd[1]);
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(pipefd[0], buf, sizeof(buf))) > 0 || (n < 0 && errno == EINTR)) {
+        if (n > 0)
+            log_append(u, buf, (size_t)n);
+    }
+    close(pipefd[0]);
+    return wait_ok(pid);
+}
+
+/* gcc -std=c11 <cflags> <mode...> <source> [-o out] as an argv array */
+static char **gcc_args(const Build *b, const char *mode, const char *source, const char *out) {
+    char **args = malloc((size_t)(b->cflag_count + 8) * sizeof(char *));
+    if (!args)
+        return NULL;
+    int n = 0;
+    args[n++] = "gcc";
+    args[n++] = "-std=c11";
+    for (int i = 0; i < b->cflag_count; i++)
+        args[n++] = b->cflags[i];
+    args[n++] = (char *)mode;
+    args[n++] = (char *)source;
+    if (out) {
+        args[n++] = "-o";
+        args[n++] = (char *)out;
+    }
+    args[n] = NULL;
+    return args;
+}
+
+/* Cache key of a unit: gcc version, compile flags and preprocessed source */
+static int unit_key(const Build *b, const Unit *u, char key[33]) {
+    char **args = gcc_args(b, "-E", u->source, NULL);
+    int pipefd[2];
+    if (!args || pipe2(pipefd, O_CLOEXEC) != 0) {
+        free(args);
+        return 0;
+    }
+    pid_t pid = spawn_gcc(args, pipefd[1], -1);
+    close(pipefd[1]);
+    free(args);
+
+    Hash h;
+    hash_init(&h);
+    hash_update(&h, b->version, strlen(b->version) + 1);
+    for (int i = 0; i < b->cflag_count; i++)
+        hash_update(&h, b->cflags[i], strlen(b->cflags[i]) + 1);
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(pipefd[0], buf, sizeof(buf))) > 0 || (n < 0 && errno == EINTR)) {
+        if (n > 0)
+            hash_update(&h, buf, (size_t)n);
+    }
+    close(pipefd[0]);
+    if (!wait_ok(pid))
+        return 0;
+    hash_hex(&h, key);
+    return 1;
+}
+
+static void build_unit(Build *b, Unit *u, int index) {
+    char key[33];
+    if (!unit_key(b, u, key)) {
+        /* Preprocessing failed: let gcc explain why */
+        char **args = gcc_args(b, "-fsyntax-only", u->source, NULL);
+        if (args)
+            run_logged(u, args);
+        free(args);
+        u->failed = 1;
+        return;
+    }
+    snprintf(u->object, sizeof(u->object), "%s/%s.o", b->cache_dir, key);
+    if (access(u->object, R_OK) == 0) {
+        u->cached = 1;
+        return;
+    }
+
+    /* Compile next to the cache entry, then publish it atomically */
+    char tmp[4200];
+    snprintf(tmp, sizeof(tmp), "%s.%d.%d.tmp", u->object, (int)getpid(), index);
+    char **args = gcc_args(b, "-c", u->source, tmp);
+    if (!args || !run_logged(u, args) || rename(tmp, u->object) != 0) {
+        unlink(tmp);
+        u->failed = 1;
+    }
+    free(args);
+}
+
+static void *build_worker(void *arg) {
+    Build *b = arg;
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        int i = b->next < b->count ? b->next++ : -1;
+        pthread_mutex_unlock(&b->lock);
+        if (i < 0)
+            break;
+        build_unit(b, &b->units[i], i);
+    }
+    return NULL;
+}
+
+/* First line printed by a command, or "" */
+static void command_line_output(char *const args[], char *out, size_t outlen) {
+    out[0] = '\0';
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) != 0)
+        return;
+    pid_t pid = spawn_gcc(args, pipefd[1], -1);
+    close(pipefd[1]);
+    size_t len = 0;
+    ssize_t n;
+    while (len + 1 < outlen && (n = read(pipefd[0], out + len, outlen - 1 - len)) > 0)
+        len += (size_t)n;
+    out[len] = '\0';
+    out[strcspn(out, "\n")] = '\0';
+    close(pipefd[0]);
+    wait_ok(pid);
+}
+
 int main(int argc, char *argv[]) {
     if (argc < 2) {
         fprintf(stderr, "Error: No arguments provided.\n");
@@ -69,17 +347,35 @@ int main(int argc, char *argv[]) {
     /* Collect flags and sources */
     char *flags[argc];
     int  flag_count = 0;
+    char *cflags[argc];
+    int  cflag_count = 0;
     char *sources[argc];
     int  src_count  = 0;
+    int  jobs = 0;
+    const char *output = NULL;
 
     for (int i = 1; i < argc; i++) {
-        if (is_c_file(argv[i])) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strncmp(argv[i], "-o", 2) == 0 && argv[i][2]) {
+            output = argv[i] + 2;
+        } else if (is_c_file(argv[i])) {
             sources[src_count++] = argv[i];
-        } else if (argv[i][0] == '-') {
-            flags[flag_count++] = argv[i];
         } else {
-            fprintf(stderr, "Warning: treating \"%s\" as gcc flag\n", argv[i]);
+            if (argv[i][0] != '-')
+                fprintf(stderr, "Warning: treating \"%s\" as gcc flag\n", argv[i]);
+            int link_only = is_link_only(argv[i]);
             flags[flag_count++] = argv[i];
+            if (!link_only)
+                cflags[cflag_count++] = argv[i];
+            /* keep "-I inc", "-D X", ... together in the same step */
+            if (takes_value(argv[i]) && i + 1 < argc) {
+                flags[flag_count++] = argv[++i];
+                if (!link_only)
+                    cflags[cflag_count++] = argv[i];
+            }
         }
     }
 
@@ -91,27 +387,143 @@ int main(int argc, char *argv[]) {
 
     /* Determine output name from first source */
     char output_name[256];
-    strip_extension(sources[0], output_name, sizeof(output_name));
+    if (output)
+        snprintf(output_name, sizeof(output_name), "%s", output);
+    else
+        strip_extension(sources[0], output_name, sizeof(output_name));
 
-    /* Build gcc command: sources first, then flags, then -o */
-    char cmd[4096];
-    int  pos = snprintf(cmd, sizeof(cmd), "gcc -std=c11 ");
+    /* Object cache directory */
+    char cache_dir[2048];
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if (xdg && xdg[0])
+        snprintf(cache_dir, sizeof(cache_dir), "%s/budostack/compile", xdg);
+    else if (home && home[0])
+        snprintf(cache_dir, sizeof(cache_dir), "%s/.cache/budostack/compile", home);
+    else
+        snprintf(cache_dir, sizeof(cache_dir), ".budostack-cache/compile");
+    if (make_dirs(cache_dir) != 0) {
+        fprintf(stderr, "Error: cannot create cache directory %s: %s\n", cache_dir, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    char version[128];
+    char *version_args[] = { "gcc", "-dumpfullversion", "-dumpversion", NULL };
+    command_line_output(version_args, version, sizeof(version));
 
+    /* Compile all translation units in parallel */
+    Unit units[src_count];
+    memset(units, 0, sizeof(units));
+    for (int i = 0; i < src_count; i++)
+        units[i].source = sources[i];
+    Build build = { units, src_count, 0, cflags, cflag_count, cache_dir, version,
+                    PTHREAD_MUTEX_INITIALIZER };
+
+    if (jobs <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cpus > 0 ? (int)cpus : 1;
+    }
+    if (jobs > MAX_JOBS)
+        jobs = MAX_JOBS;
+    if (jobs > src_count)
+        jobs = src_count;
+
+    pthread_t tid[MAX_JOBS];
+    int started[MAX_JOBS] = {0};
+    for (int t = 0; t < jobs - 1; t++)
+        started[t] = pthread_create(&tid[t], NULL, build_worker, &build) == 0;
+    build_worker(&build);
+    for (int t = 0; t < jobs - 1; t++) {
+        if (started[t])
+            pthread_join(tid[t], NULL);
+    }
+
+    int failed = 0, compiled = 0;
     for (int i = 0; i < src_count; i++) {
-        pos += snprintf(cmd + pos, sizeof(cmd) - pos, "%s ", sources[i]);
+        Unit *u = &units[i];
+        if (u->failed)
+            printf("Failed:   %s\n", u->source);
+        else if (u->cached)
+            printf("Cached:   %s\n", u->source);
+        else
+            printf("Compiled: %s\n", u->source);
+        if (u->log_len)
+            fputs(u->log, stdout);
+        failed += u->failed;
+        compiled += !u->failed && !u->cached;
+        free(u->log);
     }
-    for (int i = 0; i < flag_count; i++) {
-        pos += snprintf(cmd + pos, sizeof(cmd) - pos, "%s ", flags[i]);
+    if (failed) {
+        fprintf(stderr, "Compilation failed (%d of %d files).\n", failed, src_count);
+        return EXIT_FAILURE;
     }
-    pos += snprintf(cmd + pos, sizeof(cmd) - pos, "-o %s", output_name);
 
-    /* Execute */
-    printf("Running: %s\n", cmd);
-    int ret = system(cmd);
-    if (ret != 0) {
-        fprintf(stderr, "Compilation failed (exit %d).\n", ret);
+    /*
+     * Link only if the objects or link flags changed. The stamp remembers the
+     * link key and the size and time of the executable it produced.
+     */
+    Hash h;
+    hash_init(&h);
+    hash_update(&h, version, strlen(version) + 1);
+    for (int i = 0; i < src_count; i++)
+        hash_update(&h, units[i].object, strlen(units[i].object) + 1);
+    for (int i = 0; i < flag_count; i++)
+        hash_update(&h, flags[i], strlen(flags[i]) + 1);
+    char link_key[33];
+    hash_hex(&h, link_key);
+
+    char where[4096];
+    if (!getcwd(where, sizeof(where)))
+        where[0] = '\0';
+    hash_init(&h);
+    hash_update(&h, where, strlen(where) + 1);
+    hash_update(&h, output_name, strlen(output_name) + 1);
+    char stamp_key[33];
+    hash_hex(&h, stamp_key);
+    char stamp_path[2200];
+    snprintf(stamp_path, sizeof(stamp_path), "%s/link-%s.stamp", cache_dir, stamp_key);
+
+    struct stat st;
+    char expected[128], recorded[128] = "";
+    FILE *sf = fopen(stamp_path, "r");
+    if (sf) {
+        if (!fgets(recorded, sizeof(recorded), sf))
+            recorded[0] = '\0';
+        fclose(sf);
+    }
+    if (stat(output_name, &st) == 0) {
+        snprintf(expected, sizeof(expected), "%s %lld %lld.%09ld\n", link_key,
+                 (long long)st.st_size, (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec);
+        if (strcmp(expected, recorded) == 0) {
+            printf("Up to date: ./ %s\n", output_name);
+            return EXIT_SUCCESS;
+        }
+    }
+
+    char *link_args[src_count + flag_count + 5];
+    int n = 0;
+    link_args[n++] = "gcc";
+    link_args[n++] = "-std=c11";
+    for (int i = 0; i < src_count; i++)
+        link_args[n++] = units[i].object;
+    for (int i = 0; i < flag_count; i++)
+        link_args[n++] = flags[i];
+    link_args[n++] = "-o";
+    link_args[n++] = output_name;
+    link_args[n] = NULL;
+
+    printf("Linking %s (%d compiled, %d cached)\n", output_name, compiled, src_count - compiled);
+    fflush(stdout);
+    if (!wait_ok(spawn_gcc(link_args, STDOUT_FILENO, STDERR_FILENO))) {
+        fprintf(stderr, "Linking failed.\n");
+        unlink(stamp_path);
         return EXIT_FAILURE;
     }
+    if (stat(output_name, &st) == 0 && (sf = fopen(stamp_path, "w")) != NULL) {
+        fprintf(sf, "%s %lld %lld.%09ld\n", link_key, (long long)st.st_size,
+                (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec);
+        fclose(sf);
+    }
 
     printf("Success: ./ %s\n", output_name);
     return EXIT_SUCCESS;
@@ -0,0 +1,104 @@
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+/* Extern declarations from lib/libbcol.c */
+typedef struct BcolFile BcolFile;
+extern int bcol_build(const char *csv_path);
+extern BcolFile *bcol_open(const char *csv_path);
+extern void bcol_close(BcolFile *b);
+extern size_t bcol_rows(const BcolFile *b);
+extern size_t bcol_cols(const BcolFile *b);
+extern size_t bcol_skipped_lines(const BcolFile *b);
+extern int bcol_has_header(const BcolFile *b);
+extern int bcol_column_numeric(const BcolFile *b, size_t col);
+extern const char *bcol_column_name(const BcolFile *b, size_t col);
+
+/* Print usage summary */
+static void print_usage(void) {
+    fprintf(stderr, "Usage: csvbcol [-h | --help | -help] [-f] <file.csv> [file2.csv ...]\n");
+}
+
+/* Print detailed help */
+static void print_help(void) {
+    printf(
+        "csvbcol - build the binary columnar sidecar of CSV files\n\n"
+        "Usage:\n"
+        "  csvbcol [-h | --help | -help] [-f] <file.csv> [file2.csv ...]\n\n"
+        "Writes <file.csv>.bcol, a typed column image of the CSV file. csvstat,\n"
+        "csvfilter, csvclean and csvplot read the sidecar instead of parsing the\n"
+        "text while it is fresh (the CSV's size and modification time still match).\n"
+        "A fresh sidecar is left as is unless -f is given.\n\n"
+        "Examples:\n"
+        "  csvbcol capture.csv\n"
+        "  csvbcol -f node1.csv node2.csv\n"
+    );
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 2 &&
+        (strcmp(argv[1], "-h") == 0 ||
+         strcmp(argv[1], "--help") == 0 ||
+         strcmp(argv[1], "-help") == 0)) {
+        print_help();
+        return EXIT_SUCCESS;
+    }
+    int force = 0;
+    int first = 1;
+    if (argc >= 2 && strcmp(argv[1], "-f") == 0) {
+        force = 1;
+        first = 2;
+    }
+    if (first >= argc) {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    for (int i = first; i < argc; i++) {
+        const char *fn = argv[i];
+        BcolFile *b = force ? NULL : bcol_open(fn);
+        const char *state = "up to date";
+        double secs = 0.0;
+        if (!b) {
+            struct timespec t0, t1;
+            timespec_get(&t0, TIME_UTC);
+            if (bcol_build(fn) != 0) {
+                fprintf(stderr, "%s: %s\n", fn, strerror(errno));
+                status = EXIT_FAILURE;
+                continue;
+            }
+            timespec_get(&t1, TIME_UTC);
+            secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+            state = "built";
+            b = bcol_open(fn);
+            if (!b) {
+                fprintf(stderr, "%s: sidecar could not be opened after building\n", fn);
+                status = EXIT_FAILURE;
+                continue;
+            }
+        }
+
+        size_t cols = bcol_cols(b), numeric = 0;
+        for (size_t c = 0; c < cols; c++)
+            if (bcol_column_numeric(b, c)) numeric++;
+        printf("%s.bcol: %s", fn, state);
+        if (secs > 0.0)
+            printf(" in %.3f s", secs);
+        printf(", %zu rows, %zu columns (%zu numeric)%s",
+               bcol_rows(b), cols, numeric, bcol_has_header(b) ? ", header" : "");
+        if (bcol_skipped_lines(b) > 0)
+            printf(", %zu irregular lines not stored", bcol_skipped_lines(b));
+        printf("\n");
+        if (bcol_has_header(b)) {
+            for (size_t c = 0; c < cols; c++)
+                printf("  %-20s %s\n", bcol_column_name(b, c),
+                       bcol_column_numeric(b, c) ? "number" : "text");
+        }
+        bcol_close(b);
+    }
+    return status;
+}
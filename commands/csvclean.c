@@ -4,30 +4,254 @@
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
 
-/* Trim leading/trailing whitespace in place */
-static char *trim(char *s) {
-    char *end;
-    while (isspace((unsigned char)*s)) s++;
-    if (*s == '\0') return s;
-    end = s + strlen(s) - 1;
-    while (end > s && isspace((unsigned char)*end)) end--;
-    end[1] = '\0';
-    return s;
+/* Extern declarations from lib/libbcol.c (binary sidecar, see csvbcol) */
+typedef struct BcolFile BcolFile;
+extern BcolFile *bcol_open(const char *csv_path);
+extern void bcol_close(BcolFile *b);
+extern size_t bcol_rows(const BcolFile *b);
+extern int bcol_row_numeric(const BcolFile *b, size_t row);
+extern const char *bcol_row_text(const BcolFile *b, size_t row, size_t *len);
+extern const char *bcol_header_text(const BcolFile *b, size_t *len);
+
+#define CLEAN_BLOCK (8u << 20)        /* bytes read at a time */
+#define CLEAN_MIN_RANGE (256u << 10)   /* bytes of a block per thread at least */
+#define CLEAN_MAX_THREADS 64
+#define CLEAN_MAX_FIELD 256            /* longer fields are not numbers (as in the sidecar) */
+
+/* Buffered output; large pieces are written straight from the caller's memory */
+typedef struct {
+    int fd;
+    char *buf;
+    size_t len, cap;
+    int error;
+} Writer;
+
+static void write_all(Writer *w, const char *p, size_t n) {
+    while (n > 0 && !w->error) {
+        ssize_t k = write(w->fd, p, n);
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            w->error = errno;
+            return;
+        }
+        p += k;
+        n -= (size_t)k;
+    }
+}
+
+static void writer_flush(Writer *w) {
+    write_all(w, w->buf, w->len);
+    w->len = 0;
+}
+
+static void writer_put(Writer *w, const char *p, size_t n) {
+    if (w->len + n > w->cap) {
+        writer_flush(w);
+        if (n > w->cap / 2) {
+            write_all(w, p, n);
+            return;
+        }
+    }
+    memcpy(w->buf + w->len, p, n);
+    w->len += n;
+}
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/* Return 1 if [s, e) is a valid floating-point literal (no leftover chars),
+   with the same verdict as strtod. Plain decimal numbers are checked here;
+   hex, inf/nan and values that might overflow or underflow go to strtod. */
+static int is_numeric(const char *s, const char *e) {
+    size_t len = (size_t)(e - s);
+    if (len == 0 || len >= CLEAN_MAX_FIELD) return 0;
+    const char *p = s;
+    if (*p == '+' || *p == '-') p++;
+    const char *mant = p;
+    long digits = 0, lead = 0;
+    while (p < e && *p == '0') { p++; lead++; }
+    while (p < e && is_digit(*p)) { p++; digits++; }
+    long int_digits = digits;
+    if (p < e && *p == '.') {
+        p++;
+        if (digits == 0)
+            while (p < e && *p == '0') { p++; lead++; int_digits--; }
+        while (p < e && is_digit(*p)) { p++; digits++; }
+    }
+    if (digits + lead == 0) {
+        /* no digits: only inf/nan or hex could still be numbers */
+        if (p < e && (*p == 'i' || *p == 'I' || *p == 'n' || *p == 'N')) goto slow;
+        return 0;
+    }
+    if (p < e && (*p == 'x' || *p == 'X') && p - mant == 1 && *mant == '0') goto slow;
+    long exp = 0;
+    if (p < e && (*p == 'e' || *p == 'E')) {
+        p++;
+        int neg = 0;
+        if (p < e && (*p == '+' || *p == '-')) neg = *p++ == '-';
+        if (p == e || !is_digit(*p)) return 0;
+        while (p < e && is_digit(*p)) {
+            if (exp < 100000) exp = exp * 10 + (*p - '0');
+            p++;
+        }
+        if (neg) exp = -exp;
+    }
+    if (p != e) return 0;
+    /* zero never overflows; otherwise the decimal exponent must stay well in range */
+    if (digits == 0) return 1;
+    long mag = exp + int_digits;
+    if (mag > -290 && mag < 300) return 1;
+slow:
+    {
+        char buf[CLEAN_MAX_FIELD];
+        memcpy(buf, s, len);
+        buf[len] = '\0';
+        char *endptr;
+        errno = 0;
+        strtod(buf, &endptr);
+        return !errno && *endptr == '\0';
+    }
+}
+
+/* Trimmed field bounds within [*s, *e) */
+static void trim_span(const char **s, const char **e) {
+    while (*s < *e && isspace((unsigned char)**s)) (*s)++;
+    while (*e > *s && isspace((unsigned char)(*e)[-1])) (*e)--;
 }
 
-/* Return 1 if s is a valid floating‑point literal (no leftover chars) */
-static int is_numeric(const char *s) {
-    char *endptr;
-    errno = 0;
-    strtod(s, &endptr);
-    if (errno || *endptr != '\0') return 0;
-    return 1;
+/* Returns the end of the line at p (before CRs) and the start of the next one */
+static char *line_end(char *p, char *end, char **next) {
+    char *nl = memchr(p, '\n', (size_t)(end - p));
+    char *e = nl ? nl : end;
+    *next = nl ? nl + 1 : end;
+    while (e > p && e[-1] == '\r') e--;
+    return e;
+}
+
+/* Write the fields of one line (len bytes, not NUL terminated) trimmed and comma separated */
+static void emit_trimmed(const char *s, size_t len, Writer *w) {
+    const char *end = s + len, *f = s;
+    for (const char *p = s; ; p++) {
+        if (p == end || *p == ',') {
+            const char *a = f, *b = p;
+            trim_span(&a, &b);
+            if (f != s) writer_put(w, ",", 1);
+            writer_put(w, a, (size_t)(b - a));
+            if (p == end) break;
+            f = p + 1;
+        }
+    }
+    writer_put(w, "\n", 1);
+}
+
+/* Returns 1 when the line [p, e) is a header: some field is not a number */
+static int is_header(const char *p, const char *e, size_t *cols) {
+    int header = 0;
+    *cols = 1;
+    const char *f = p;
+    for (const char *q = p; ; q++) {
+        if (q == e || *q == ',') {
+            const char *a = f, *b = q;
+            trim_span(&a, &b);
+            if (!is_numeric(a, b)) header = 1;
+            if (q == e) break;
+            (*cols)++;
+            f = q + 1;
+        }
+    }
+    return header;
+}
+
+/*
+ * Cleans the complete lines of [begin, end) in place: kept rows are written
+ * trimmed from begin on (output never outgrows the input it replaces).
+ * Returns the number of bytes of cleaned output.
+ */
+static size_t clean_range(char *begin, char *end, size_t expected_cols) {
+    char *dst = begin;
+    char *next;
+    for (char *p = begin; p < end; p = next) {
+        char *e = line_end(p, end, &next);
+        if (e == p) continue;
+        char *row = dst;
+        size_t cols = 0;
+        int ok = 1;
+        for (char *f = p; ok; ) {
+            char *fe = memchr(f, ',', (size_t)(e - f));
+            if (!fe) fe = e;
+            const char *a = f, *b = fe;
+            trim_span(&a, &b);
+            if (++cols > expected_cols || !is_numeric(a, b)) {
+                ok = 0;
+                break;
+            }
+            if (cols > 1) *dst++ = ',';
+            memmove(dst, a, (size_t)(b - a));
+            dst += b - a;
+            if (fe == e) break;
+            f = fe + 1;
+        }
+        if (!ok || cols != expected_cols) {
+            dst = row;
+            continue;
+        }
+        *dst++ = '\n';
+    }
+    return (size_t)(dst - begin);
+}
+
+typedef struct {
+    char *begin, *end;
+    size_t expected_cols;
+    size_t out_len;
+} CleanJob;
+
+static void *clean_worker(void *arg) {
+    CleanJob *job = arg;
+    job->out_len = clean_range(job->begin, job->end, job->expected_cols);
+    return NULL;
+}
+
+/* Cleans [begin, end) with up to threads workers and writes the pieces in order */
+static void clean_block(char *begin, char *end, size_t expected_cols, int threads, Writer *w) {
+    CleanJob jobs[CLEAN_MAX_THREADS];
+    pthread_t tids[CLEAN_MAX_THREADS];
+    int started[CLEAN_MAX_THREADS];
+    size_t size = (size_t)(end - begin);
+    int n = (int)(size / CLEAN_MIN_RANGE + 1);
+    if (n > threads) n = threads;
+    /* split at line starts */
+    int k = 0;
+    char *from = begin;
+    for (int i = 1; i < n && from < end; i++) {
+        char *p = begin + size * (size_t)i / (size_t)n;
+        if (p < from) p = from;
+        char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (!nl) break;
+        jobs[k++] = (CleanJob){ from, nl + 1, expected_cols, 0 };
+        from = nl + 1;
+    }
+    jobs[k++] = (CleanJob){ from, end, expected_cols, 0 };
+    /* the calling thread takes the last piece */
+    for (int i = 0; i < k; i++) {
+        started[i] = i < k - 1 && pthread_create(&tids[i], NULL, clean_worker, &jobs[i]) == 0;
+        if (!started[i])
+            clean_worker(&jobs[i]);
+    }
+    for (int i = 0; i < k; i++) {
+        if (started[i]) pthread_join(tids[i], NULL);
+        writer_put(w, jobs[i].begin, jobs[i].out_len);
+    }
 }
 
 /* Print usage summary */
 static void print_usage(void) {
-    fprintf(stderr, "Usage: csvclean [-h | --help | -help] <input.csv> [output.csv]\n");
+    fprintf(stderr, "Usage: csvclean [-h | --help | -help] [-t threads] <input.csv> [output.csv]\n");
 }
 
 /* Print detailed help on how cleaning is done */
@@ -35,7 +259,7 @@ static void print_help(void) {
     printf(
         "csvclean - clean up a CSV file of numeric data\n\n"
         "Usage:\n"
-        "  csvclean [-h | --help | -help] <input.csv> [output.csv]\n\n"
+        "  csvclean [-h | --help | -help] [-t threads] <input.csv> [output.csv]\n\n"
         "Cleaning steps:\n"
         "  1. Strip CR/LF and skip empty lines.\n"
         "  2. On first non-empty row:\n"
@@ -43,8 +267,11 @@ static void print_help(void) {
         "       • Otherwise treat as data and set expected column count.\n"
         "  3. For subsequent rows:\n"
         "       • Skip rows with mismatched column counts.\n"
-        "       • Trim whitespace and verify all fields numeric.\n"
+        "       • Trim whitespace and verify all fields numeric\n"
+        "         (an empty field is not numeric).\n"
         "       • Output cleaned numeric rows.\n\n"
+        "The input is read in large blocks and cleaned in place; blocks are split\n"
+        "between threads (-t, default: all CPUs) and written in input order.\n\n"
         "Examples:\n"
         "  csvclean data.csv\n"
         "  csvclean data.csv cleaned.csv\n"
@@ -59,102 +286,107 @@ int main(int argc, char *argv[]) {
         print_help();
         return EXIT_SUCCESS;
     }
-    if (argc < 2 || argc > 3) {
+    int threads = 0;
+    int argi = 1;
+    if (argc >= 3 && strcmp(argv[1], "-t") == 0) {
+        threads = atoi(argv[2]);
+        argi = 3;
+    }
+    if (argc - argi < 1 || argc - argi > 2) {
         print_usage();
         return EXIT_FAILURE;
     }
+    if (threads <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = n > 0 ? (int)n : 1;
+    }
+    if (threads > CLEAN_MAX_THREADS) threads = CLEAN_MAX_THREADS;
+
+    const char *inname  = argv[argi];
+    const char *outname = (argc - argi == 2 ? argv[argi + 1] : NULL);
+    int fin = open(inname, O_RDONLY);
+    if (fin < 0) { perror("Failed to open input"); return EXIT_FAILURE; }
+    int fout = outname ? open(outname, O_WRONLY | O_CREAT | O_TRUNC, 0644) : STDOUT_FILENO;
+    if (fout < 0) { perror("Failed to open output"); close(fin); return EXIT_FAILURE; }
+
+    Writer w = { fout, malloc(1 << 20), 0, 1 << 20, 0 };
+    char *buf = malloc(CLEAN_BLOCK);
+    size_t cap = CLEAN_BLOCK;
+    if (!w.buf || !buf) { perror("malloc"); return EXIT_FAILURE; }
 
-    const char *inname  = argv[1];
-    const char *outname = (argc == 3 ? argv[2] : NULL);
-    FILE *fin = fopen(inname, "r");
-    if (!fin) { perror("Failed to open input"); return EXIT_FAILURE; }
-    FILE *fout = outname ? fopen(outname, "w") : stdout;
-    if (outname && !fout) { perror("Failed to open output"); fclose(fin); return EXIT_FAILURE; }
-
-    char line[16384];
-    size_t expected_cols = 0;
-    int header_done = 0;
-
-    while (fgets(line, sizeof(line), fin)) {
-        /* strip CR/LF and skip empty lines */
-        line[strcspn(line, "\r\n")] = '\0';
-        if (line[0] == '\0') continue;
-
-        /* count fields */
-        size_t cols = 1;
-        for (char *p = line; *p; p++)
-            if (*p == ',') cols++;
-
-        /* first data/header row */
-        if (!header_done) {
-            /* copy and test numeric */
-            char *copy = malloc(strlen(line) + 1);
-            if (!copy) { perror("malloc"); break; }
-            strcpy(copy, line);
-            int ok = 1;
-            char *saveptr = NULL, *tok = strtok_r(copy, ",", &saveptr);
-            while (tok) {
-                if (!is_numeric(trim(tok))) { ok = 0; break; }
-                tok = strtok_r(NULL, ",", &saveptr);
+    /* A fresh sidecar already knows which rows are regular and numeric;
+       only those rows are trimmed and copied. */
+    BcolFile *bc = bcol_open(inname);
+    if (bc) {
+        size_t len;
+        const char *text = bcol_header_text(bc, &len);
+        if (text)
+            emit_trimmed(text, len, &w);
+        for (size_t r = 0; r < bcol_rows(bc); r++) {
+            if (!bcol_row_numeric(bc, r)) continue;
+            text = bcol_row_text(bc, r, &len);
+            emit_trimmed(text, len, &w);
+        }
+        bcol_close(bc);
+    } else {
+        size_t have = 0, expected_cols = 0;
+        int header_done = 0, eof = 0;
+        while (!eof) {
+            ssize_t n = read(fin, buf + have, cap - have);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                perror("Failed to read input");
+                break;
             }
-            free(copy);
-
-            expected_cols = cols;
-            header_done = 1;
-
-            if (!ok) {
-                /* treat as header: output trimmed */
-                char *hdr = malloc(strlen(line) + 1);
-                if (!hdr) { perror("malloc"); break; }
-                strcpy(hdr, line);
-                saveptr = NULL; tok = strtok_r(hdr, ",", &saveptr);
-                int first = 1;
-                while (tok) {
-                    if (!first) fputc(',', fout);
-                    fputs(trim(tok), fout);
-                    first = 0;
-                    tok = strtok_r(NULL, ",", &saveptr);
+            eof = n == 0;
+            have += (size_t)n;
+
+            /* process complete lines only; the tail moves to the next block */
+            size_t end = have;
+            if (!eof) {
+                while (end > 0 && buf[end - 1] != '\n') end--;
+                if (end == 0) {
+                    if (have == cap) {
+                        char *b = realloc(buf, cap * 2);
+                        if (!b) { perror("realloc"); break; }
+                        buf = b;
+                        cap *= 2;
+                    }
+                    continue;
                 }
-                fputc('\n', fout);
-                free(hdr);
-                continue;
             }
-            /* if ok, fall through to numeric processing */
-        }
 
-        /* skip mismatched columns */
-        if (cols != expected_cols) continue;
+            char *p = buf, *stop = buf + end;
+            /* first non-empty line: header or the start of the data */
+            while (!header_done && p < stop) {
+                char *next, *e = line_end(p, stop, &next);
+                if (e == p) { p = next; continue; }
+                header_done = 1;
+                if (is_header(p, e, &expected_cols)) {
+                    /* treat as header: output trimmed */
+                    emit_trimmed(p, (size_t)(e - p), &w);
+                    p = next;
+                }
+            }
+            if (p < stop)
+                clean_block(p, stop, expected_cols, threads, &w);
 
-        /* numeric validation */
-        char *copy = malloc(strlen(line) + 1);
-        if (!copy) { perror("malloc"); break; }
-        strcpy(copy, line);
-        int ok = 1;
-        char *saveptr = NULL, *tok = strtok_r(copy, ",", &saveptr);
-        while (tok) {
-            if (!is_numeric(trim(tok))) { ok = 0; break; }
-            tok = strtok_r(NULL, ",", &saveptr);
-        }
-        free(copy);
-        if (!ok) continue;
-
-        /* emit cleaned row */
-        char *line2 = malloc(strlen(line) + 1);
-        if (!line2) { perror("malloc"); break; }
-        strcpy(line2, line);
-        saveptr = NULL; tok = strtok_r(line2, ",", &saveptr);
-        int first = 1;
-        while (tok) {
-            if (!first) fputc(',', fout);
-            fputs(trim(tok), fout);
-            first = 0;
-            tok = strtok_r(NULL, ",", &saveptr);
+            memmove(buf, buf + end, have - end);
+            have -= end;
         }
-        fputc('\n', fout);
-        free(line2);
     }
-
-    fclose(fin);
-    if (outname) fclose(fout);
-    return EXIT_SUCCESS;
+    writer_flush(&w);
+    int status = EXIT_SUCCESS;
+    if (w.error) {
+        fprintf(stderr, "Failed to write output: %s\n", strerror(w.error));
+        status = EXIT_FAILURE;
+    }
+    free(buf);
+    free(w.buf);
+    close(fin);
+    if (outname && close(fout) != 0) {
+        perror("Failed to write output");
+        status = EXIT_FAILURE;
+    }
+    return status;
 }
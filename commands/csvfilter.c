@@ -5,6 +5,21 @@
 #include <ctype.h>
 #include <errno.h>
 
+/* Extern declarations from lib/libbcol.c (binary sidecar, see csvbcol) */
+typedef struct BcolFile BcolFile;
+extern BcolFile *bcol_open(const char *csv_path);
+extern void bcol_close(BcolFile *b);
+extern size_t bcol_rows(const BcolFile *b);
+extern size_t bcol_cols(const BcolFile *b);
+extern size_t bcol_skipped_lines(const BcolFile *b);
+extern int bcol_has_header(const BcolFile *b);
+extern int bcol_has_empty_fields(const BcolFile *b);
+extern const char *bcol_column_name(const BcolFile *b, size_t col);
+extern const double *bcol_column(const BcolFile *b, size_t col);
+extern int bcol_row_numeric(const BcolFile *b, size_t row);
+extern const char *bcol_row_text(const BcolFile *b, size_t row, size_t *len);
+extern const char *bcol_header_text(const BcolFile *b, size_t *len);
+
 /* Provide strdup/strndup implementations for POSIX.1-2001 */
 static char *strdup(const char *s) {
     size_t len = strlen(s);
@@ -279,6 +294,39 @@ static void free_ast(AST *n) {
     free(n);
 }
 
+/* Filter using a fresh binary sidecar: rows are evaluated from the column
+   arrays and matching rows are copied from the original text. */
+static void filter_bcol(BcolFile *bc, AST *root, FILE *fout) {
+    size_t ncols = bcol_cols(bc), nrows = bcol_rows(bc);
+    char **headers = NULL;
+    size_t len;
+    const char *text = bcol_header_text(bc, &len);
+    if (text) {
+        headers = malloc(ncols * sizeof(char *));
+        for (size_t c = 0; c < ncols; c++)
+            headers[c] = (char *)bcol_column_name(bc, c);
+        fwrite(text, 1, len, fout);
+        fputc('\n', fout);
+    }
+    const double **cols = malloc(ncols * sizeof(double *));
+    double *row = malloc(ncols * sizeof(double));
+    for (size_t c = 0; c < ncols; c++)
+        cols[c] = bcol_column(bc, c);
+    for (size_t r = 0; r < nrows; r++) {
+        if (!bcol_row_numeric(bc, r)) continue;
+        for (size_t c = 0; c < ncols; c++)
+            row[c] = cols[c][r];
+        if (eval_ast(root, row, ncols, headers)) {
+            text = bcol_row_text(bc, r, &len);
+            fwrite(text, 1, len, fout);
+            fputc('\n', fout);
+        }
+    }
+    free(row);
+    free(cols);
+    free(headers);
+}
+
 /* Print usage */
 static void print_usage(void) {
     fprintf(stderr,
@@ -321,6 +369,19 @@ int main(int argc, char *argv[]) {
     FILE *fout = outfile ? fopen(outfile, "w") : stdout;
     if (outfile && !fout) { perror("fopen output"); fclose(fin); return EXIT_FAILURE; }
 
+    /* Skip text parsing when a fresh sidecar describes every line the same way. */
+    BcolFile *bc = bcol_open(infile);
+    if (bc && bcol_skipped_lines(bc) == 0 && !bcol_has_empty_fields(bc)) {
+        filter_bcol(bc, root, fout);
+        bcol_close(bc);
+        fclose(fin);
+        if (outfile) fclose(fout);
+        free_ast(root);
+        free(expr);
+        return EXIT_SUCCESS;
+    }
+    bcol_close(bc);
+
     char line[16384];
     char *header_line = NULL;
     char **headers = NULL;
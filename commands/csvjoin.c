@@ -0,0 +1,373 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* Extern declarations from lib/libextsort.c */
+typedef struct ExtSort ExtSort;
+extern ExtSort *extsort_create(int key_col, int reverse, int unique, size_t mem_limit,
+                               int threads, const char *tmpdir);
+extern int extsort_add(ExtSort *s, const char *line, size_t len);
+extern int extsort_finish(ExtSort *s);
+extern const char *extsort_next(ExtSort *s, size_t *len);
+extern const char *extsort_current_key(const ExtSort *s, size_t *len, int *is_num, double *num);
+extern int extsort_compare_keys(int a_num, double a_val, const char *a_key, size_t a_len,
+                                int b_num, double b_val, const char *b_key, size_t b_len);
+extern int extsort_error(const ExtSort *s);
+extern void extsort_free(ExtSort *s);
+extern int extsort_is_header_line(const char *line);
+extern int extsort_resolve_column(const char *spec, const char *header);
+
+/* Copy of a key taken from the sorter, kept while the sorter moves on */
+typedef struct {
+    char *text;
+    size_t len, cap;
+    int is_num;
+    double num;
+} Key;
+
+/* Right-hand rows sharing one key, stored without their key field */
+typedef struct {
+    char *data;
+    size_t used, cap;
+    size_t *offs;
+    size_t count, offs_cap;
+} Group;
+
+/* Number of comma-separated fields in a line */
+static size_t count_fields(const char *line, size_t len) {
+    size_t n = 1;
+    for (size_t i = 0; i < len; i++)
+        if (line[i] == ',') n++;
+    return n;
+}
+
+/*
+ * Write ",<fields>" for every field of line except field col. Writes nothing
+ * when the line has only the key field.
+ */
+static void write_without_field(FILE *out, const char *line, size_t len, int col) {
+    size_t start = 0;
+    int field = 0;
+    for (size_t i = 0; i <= len; i++) {
+        if (i == len || line[i] == ',') {
+            if (field != col) {
+                fputc(',', out);
+                fwrite(line + start, 1, i - start, out);
+            }
+            field++;
+            start = i + 1;
+        }
+    }
+}
+
+/* Read one input into a new sorter; the header line, if any, is returned in *header */
+static ExtSort *load_input(const char *fn, const char *key_spec, int no_header,
+                           size_t mem_limit, int threads, const char *tmpdir,
+                           char **header, int *key_col, size_t *ncols) {
+    FILE *fin = fopen(fn, "r");
+    if (!fin) {
+        fprintf(stderr, "%s: %s\n", fn, strerror(errno));
+        return NULL;
+    }
+    *header = NULL;
+    *ncols = 0;
+    *key_col = -1;
+    ExtSort *sorter = NULL;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    int first_line = 1, failed = 0;
+    while (!failed && (n = getline(&line, &cap, fin)) != -1) {
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r'))
+            line[--n] = '\0';
+        if (n == 0) continue;
+
+        if (first_line) {
+            first_line = 0;
+            *ncols = count_fields(line, (size_t)n);
+            if (!no_header && extsort_is_header_line(line))
+                *header = strdup(line);
+            *key_col = extsort_resolve_column(key_spec, *header);
+            if (*key_col < 0) {
+                fprintf(stderr, "%s: unknown key column: %s\n", fn, key_spec);
+                failed = 1;
+            }
+            if (*header) continue;
+        }
+        if (!failed && !sorter) {
+            sorter = extsort_create(*key_col, 0, 0, mem_limit, threads, tmpdir);
+            if (!sorter) {
+                perror("csvjoin");
+                failed = 1;
+            }
+        }
+        if (!failed && extsort_add(sorter, line, (size_t)n) != 0) {
+            fprintf(stderr, "%s: writing temporary run: %s\n", fn, strerror(errno));
+            failed = 1;
+        }
+    }
+    free(line);
+    fclose(fin);
+
+    /* an input without data rows still gets an (empty) sorter */
+    if (!failed && !sorter) {
+        if (*key_col < 0) *key_col = 0;
+        sorter = extsort_create(*key_col, 0, 0, mem_limit, threads, tmpdir);
+    }
+    if (!failed && (!sorter || extsort_finish(sorter) != 0)) {
+        perror("csvjoin: sorting input");
+        failed = 1;
+    }
+    if (failed) {
+        extsort_free(sorter);
+        free(*header);
+        *header = NULL;
+        return NULL;
+    }
+    return sorter;
+}
+
+/* Copy the key of the sorter's current line into k */
+static int key_take(Key *k, const ExtSort *s) {
+    size_t len;
+    const char *text = extsort_current_key(s, &len, &k->is_num, &k->num);
+    if (len + 1 > k->cap) {
+        size_t cap = k->cap ? k->cap : 64;
+        while (cap < len + 1) cap *= 2;
+        char *t = realloc(k->text, cap);
+        if (!t) return -1;
+        k->text = t;
+        k->cap = cap;
+    }
+    memcpy(k->text, text, len);
+    k->len = len;
+    return 0;
+}
+
+/* Compare the sorter's current key with a stored one */
+static int key_cmp(const ExtSort *s, const Key *k) {
+    size_t len;
+    int is_num;
+    double num;
+    const char *text = extsort_current_key(s, &len, &is_num, &num);
+    return extsort_compare_keys(is_num, num, text, len, k->is_num, k->num, k->text, k->len);
+}
+
+/* Append the right-hand line without its key field to the group */
+static int group_add(Group *g, const char *line, size_t len, int key_col) {
+    if (g->count == g->offs_cap) {
+        size_t cap = g->offs_cap ? g->offs_cap * 2 : 16;
+        size_t *o = realloc(g->offs, cap * sizeof(size_t));
+        if (!o) return -1;
+        g->offs = o;
+        g->offs_cap = cap;
+    }
+    /* the stored form is ",f1,f2..." which is at most len + 1 bytes, plus NUL */
+    if (g->used + len + 2 > g->cap) {
+        size_t cap = g->cap ? g->cap : 4096;
+        while (cap < g->used + len + 2) cap *= 2;
+        char *d = realloc(g->data, cap);
+        if (!d) return -1;
+        g->data = d;
+        g->cap = cap;
+    }
+    g->offs[g->count++] = g->used;
+    char *dst = g->data + g->used;
+    size_t start = 0;
+    int field = 0;
+    for (size_t i = 0; i <= len; i++) {
+        if (i == len || line[i] == ',') {
+            if (field != key_col) {
+                *dst++ = ',';
+                memcpy(dst, line + start, i - start);
+                dst += i - start;
+            }
+            field++;
+            start = i + 1;
+        }
+    }
+    *dst++ = '\0';
+    g->used = (size_t)(dst - g->data);
+    return 0;
+}
+
+/* Print usage summary */
+static void print_usage(void) {
+    fprintf(stderr,
+        "Usage: csvjoin [-h] [-k col] [-1 col] [-2 col] [-a] [-H] [-m MB] [-t threads]\n"
+        "               [-T tmpdir] [-o output.csv] <left.csv> <right.csv>\n");
+}
+
+/* Print detailed help */
+static void print_help(void) {
+    printf(
+        "csvjoin - join two CSV files of any size on a key column\n\n"
+        "Usage:\n"
+        "  csvjoin [-h] [-k col] [-1 col] [-2 col] [-a] [-H] [-m MB] [-t threads]\n"
+        "          [-T tmpdir] [-o output.csv] <left.csv> <right.csv>\n\n"
+        "Options:\n"
+        "  -k col      Key column of both files, number or header name (default 1).\n"
+        "  -1 col      Key column of the left file.\n"
+        "  -2 col      Key column of the right file.\n"
+        "  -a          Also output left rows without a match (right fields empty).\n"
+        "  -H          Inputs have no header line.\n"
+        "  -m MB       Memory for sorting each input (default 128).\n"
+        "  -t threads  Sorting threads (default: all CPUs).\n"
+        "  -T tmpdir   Directory for temporary runs (default: system temp dir).\n"
+        "  -o file     Write to file instead of standard output.\n\n"
+        "Both inputs are sorted on their key with csvsort's external merge sort and\n"
+        "joined in one streaming pass. Each output row is the left row followed by\n"
+        "the right row without its key field; rows are ordered by key. Keys match\n"
+        "when they are equal numbers or identical text.\n\n"
+        "Examples:\n"
+        "  csvjoin -k time accel.csv gyro.csv -o imu.csv\n"
+        "  csvjoin -a -1 id -2 sensor readings.csv sensors.csv\n"
+    );
+}
+
+int main(int argc, char *argv[]) {
+    const char *left_spec = "1", *right_spec = "1";
+    const char *outname = NULL;
+    const char *tmpdir = NULL;
+    const char *inputs[2] = { NULL, NULL };
+    int ninputs = 0;
+    int outer = 0, no_header = 0, threads = 0;
+    size_t mem_mb = 128;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0 || strcmp(a, "-help") == 0) {
+            print_help();
+            return EXIT_SUCCESS;
+        } else if (strcmp(a, "-a") == 0) {
+            outer = 1;
+        } else if (strcmp(a, "-H") == 0) {
+            no_header = 1;
+        } else if ((strcmp(a, "-k") == 0 || strcmp(a, "-1") == 0 || strcmp(a, "-2") == 0 ||
+                    strcmp(a, "-m") == 0 || strcmp(a, "-t") == 0 || strcmp(a, "-T") == 0 ||
+                    strcmp(a, "-o") == 0) && i + 1 < argc) {
+            const char *v = argv[++i];
+            switch (a[1]) {
+            case 'k': left_spec = right_spec = v; break;
+            case '1': left_spec = v; break;
+            case '2': right_spec = v; break;
+            case 'm': mem_mb = (size_t)strtoul(v, NULL, 10); break;
+            case 't': threads = atoi(v); break;
+            case 'T': tmpdir = v; break;
+            default: outname = v; break;
+            }
+        } else if (a[0] == '-' && a[1] != '\0') {
+            print_usage();
+            return EXIT_FAILURE;
+        } else if (ninputs < 2) {
+            inputs[ninputs++] = a;
+        } else {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (ninputs != 2 || mem_mb == 0) {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    char *lheader = NULL, *rheader = NULL;
+    int lkey, rkey;
+    size_t lcols, rcols;
+    ExtSort *left = load_input(inputs[0], left_spec, no_header, mem_mb << 20, threads,
+                               tmpdir, &lheader, &lkey, &lcols);
+    if (!left)
+        return EXIT_FAILURE;
+    ExtSort *right = load_input(inputs[1], right_spec, no_header, mem_mb << 20, threads,
+                                tmpdir, &rheader, &rkey, &rcols);
+    if (!right) {
+        extsort_free(left);
+        free(lheader);
+        return EXIT_FAILURE;
+    }
+
+    FILE *fout = outname ? fopen(outname, "w") : stdout;
+    if (!fout) {
+        perror("Failed to open output");
+        extsort_free(left);
+        extsort_free(right);
+        free(lheader);
+        free(rheader);
+        return EXIT_FAILURE;
+    }
+    if (lheader) {
+        fputs(lheader, fout);
+        if (rheader)
+            write_without_field(fout, rheader, strlen(rheader), rkey);
+        fputc('\n', fout);
+    }
+
+    /* Merge join: both sides arrive in key order. */
+    Key key = {0};
+    Group group = {0};
+    int status = EXIT_SUCCESS;
+    size_t llen, rlen, joined = 0;
+    const char *l = extsort_next(left, &llen);
+    const char *r = extsort_next(right, &rlen);
+    while (l) {
+        int c = -1;
+        if (r) {
+            /* compare via a copy of the right key: the group scan below moves past it */
+            if (key_take(&key, right) != 0) { status = EXIT_FAILURE; break; }
+            c = key_cmp(left, &key);
+        }
+        if (c < 0) {
+            if (outer) {
+                fwrite(l, 1, llen, fout);
+                for (size_t i = 1; i < rcols; i++)
+                    fputc(',', fout);
+                fputc('\n', fout);
+            }
+            l = extsort_next(left, &llen);
+        } else if (c > 0) {
+            r = extsort_next(right, &rlen);
+        } else {
+            /* collect every right row with this key, then pair each left row with them */
+            group.used = group.count = 0;
+            while (r && key_cmp(right, &key) == 0) {
+                if (group_add(&group, r, rlen, rkey) != 0) { status = EXIT_FAILURE; break; }
+                r = extsort_next(right, &rlen);
+            }
+            if (status != EXIT_SUCCESS) break;
+            while (l && key_cmp(left, &key) == 0) {
+                for (size_t g = 0; g < group.count; g++) {
+                    fwrite(l, 1, llen, fout);
+                    fputs(group.data + group.offs[g], fout);
+                    fputc('\n', fout);
+                    joined++;
+                }
+                l = extsort_next(left, &llen);
+            }
+        }
+    }
+    if (status != EXIT_SUCCESS)
+        fprintf(stderr, "csvjoin: out of memory\n");
+    if (extsort_error(left) || extsort_error(right)) {
+        perror("csvjoin: reading temporary run");
+        status = EXIT_FAILURE;
+    }
+    if (outname) {
+        if (fclose(fout) != 0) {
+            perror("Failed to write output");
+            status = EXIT_FAILURE;
+        } else {
+            fprintf(stderr, "csvjoin: %zu joined rows written to %s\n", joined, outname);
+        }
+    }
+
+    free(key.text);
+    free(group.data);
+    free(group.offs);
+    extsort_free(left);
+    extsort_free(right);
+    free(lheader);
+    free(rheader);
+    return status;
+}
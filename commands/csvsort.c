@@ -0,0 +1,194 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* Extern declarations from lib/libextsort.c */
+typedef struct ExtSort ExtSort;
+extern ExtSort *extsort_create(int key_col, int reverse, int unique, size_t mem_limit,
+                               int threads, const char *tmpdir);
+extern int extsort_add(ExtSort *s, const char *line, size_t len);
+extern int extsort_finish(ExtSort *s);
+extern const char *extsort_next(ExtSort *s, size_t *len);
+extern size_t extsort_runs(const ExtSort *s);
+extern int extsort_error(const ExtSort *s);
+extern void extsort_free(ExtSort *s);
+extern int extsort_is_header_line(const char *line);
+extern int extsort_resolve_column(const char *spec, const char *header);
+
+/* Print usage summary */
+static void print_usage(void) {
+    fprintf(stderr,
+        "Usage: csvsort [-h] [-k col] [-r] [-u] [-H] [-m MB] [-t threads] [-T tmpdir]\n"
+        "               [-o output.csv] <input.csv> [input2.csv ...]\n");
+}
+
+/* Print detailed help */
+static void print_help(void) {
+    printf(
+        "csvsort - sort, merge and dedupe CSV files of any size\n\n"
+        "Usage:\n"
+        "  csvsort [-h] [-k col] [-r] [-u] [-H] [-m MB] [-t threads] [-T tmpdir]\n"
+        "          [-o output.csv] <input.csv> [input2.csv ...]\n\n"
+        "Options:\n"
+        "  -k col      Key column, 1-based number or header name (default 1).\n"
+        "  -r          Sort in descending order.\n"
+        "  -u          Drop repeated lines.\n"
+        "  -H          Input has no header line (default: the first line is a\n"
+        "              header if any of its fields is not a number).\n"
+        "  -m MB       Memory for in-memory runs (default 256). Larger inputs are\n"
+        "              sorted in runs on disk and merged.\n"
+        "  -t threads  Sorting threads (default: all CPUs).\n"
+        "  -T tmpdir   Directory for temporary runs (default: system temp dir).\n"
+        "  -o file     Write to file instead of standard output.\n\n"
+        "Numeric keys are compared by value and sort before text keys; text keys\n"
+        "compare bytewise. Lines with equal keys keep their input order. Several\n"
+        "inputs are merged into one sorted output with a single header.\n\n"
+        "Examples:\n"
+        "  csvsort -k time capture.csv -o sorted.csv\n"
+        "  csvsort -k 1 -m 64 node1.csv node2.csv -o merged.csv\n"
+    );
+}
+
+int main(int argc, char *argv[]) {
+    const char *key_spec = "1";
+    const char *outname = NULL;
+    const char *tmpdir = NULL;
+    int reverse = 0, unique = 0, no_header = 0, threads = 0;
+    size_t mem_mb = 256;
+    int first_input = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0 || strcmp(a, "-help") == 0) {
+            print_help();
+            return EXIT_SUCCESS;
+        } else if (strcmp(a, "-r") == 0) {
+            reverse = 1;
+        } else if (strcmp(a, "-u") == 0) {
+            unique = 1;
+        } else if (strcmp(a, "-H") == 0) {
+            no_header = 1;
+        } else if ((strcmp(a, "-k") == 0 || strcmp(a, "-m") == 0 || strcmp(a, "-t") == 0 ||
+                    strcmp(a, "-T") == 0 || strcmp(a, "-o") == 0) && i + 1 < argc) {
+            const char *v = argv[++i];
+            if (a[1] == 'k') key_spec = v;
+            else if (a[1] == 'm') mem_mb = (size_t)strtoul(v, NULL, 10);
+            else if (a[1] == 't') threads = atoi(v);
+            else if (a[1] == 'T') tmpdir = v;
+            else outname = v;
+        } else if (a[0] == '-' && a[1] != '\0') {
+            print_usage();
+            return EXIT_FAILURE;
+        } else {
+            /* Inputs are collected in place at the front of argv. */
+            argv[++first_input] = argv[i];
+        }
+    }
+    int ninputs = first_input;
+    if (ninputs == 0 || mem_mb == 0) {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    char *header = NULL;
+    ExtSort *sorter = NULL;
+
+    for (int f = 1; f <= ninputs; f++) {
+        FILE *fin = fopen(argv[f], "r");
+        if (!fin) {
+            fprintf(stderr, "%s: %s\n", argv[f], strerror(errno));
+            extsort_free(sorter);
+            free(header);
+            free(line);
+            return EXIT_FAILURE;
+        }
+        int first_line = 1;
+        ssize_t n;
+        while ((n = getline(&line, &cap, fin)) != -1) {
+            /* strip CR/LF and skip empty lines */
+            while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r'))
+                line[--n] = '\0';
+            if (n == 0) continue;
+
+            if (first_line) {
+                first_line = 0;
+                if (!no_header && extsort_is_header_line(line)) {
+                    /* the header of the first input is kept, later ones are dropped */
+                    if (!header) header = strdup(line);
+                    continue;
+                }
+            }
+            if (!sorter) {
+                int key_col = extsort_resolve_column(key_spec, header);
+                if (key_col < 0) {
+                    fprintf(stderr, "Unknown key column: %s\n", key_spec);
+                    fclose(fin);
+                    free(header);
+                    free(line);
+                    return EXIT_FAILURE;
+                }
+                sorter = extsort_create(key_col, reverse, unique, mem_mb << 20, threads, tmpdir);
+                if (!sorter) {
+                    perror("csvsort");
+                    fclose(fin);
+                    free(header);
+                    free(line);
+                    return EXIT_FAILURE;
+                }
+            }
+            if (extsort_add(sorter, line, (size_t)n) != 0) {
+                perror("csvsort: writing temporary run");
+                fclose(fin);
+                extsort_free(sorter);
+                free(header);
+                free(line);
+                return EXIT_FAILURE;
+            }
+        }
+        fclose(fin);
+    }
+    free(line);
+
+    FILE *fout = outname ? fopen(outname, "w") : stdout;
+    if (!fout) {
+        perror("Failed to open output");
+        extsort_free(sorter);
+        free(header);
+        return EXIT_FAILURE;
+    }
+    if (header) {
+        fputs(header, fout);
+        fputc('\n', fout);
+    }
+    int status = EXIT_SUCCESS;
+    if (sorter) {
+        if (extsort_finish(sorter) != 0) {
+            perror("csvsort: merging runs");
+            status = EXIT_FAILURE;
+        } else {
+            size_t len;
+            const char *out;
+            while ((out = extsort_next(sorter, &len)) != NULL) {
+                fwrite(out, 1, len, fout);
+                fputc('\n', fout);
+            }
+            if (extsort_error(sorter)) {
+                perror("csvsort: reading temporary run");
+                status = EXIT_FAILURE;
+            }
+        }
+        if (outname && extsort_runs(sorter) > 0)
+            fprintf(stderr, "csvsort: merged %zu runs\n", extsort_runs(sorter));
+        extsort_free(sorter);
+    }
+    if (outname && fclose(fout) != 0) {
+        perror("Failed to write output");
+        status = EXIT_FAILURE;
+    }
+    free(header);
+    return status;
+}
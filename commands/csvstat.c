@@ -1,9 +1,30 @@
-#define _POSIX_C_SOURCE 200112L
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <math.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Extern declarations from lib/libbcol.c (binary sidecar, see csvbcol) */
+typedef struct BcolFile BcolFile;
+extern BcolFile *bcol_open(const char *csv_path);
+extern void bcol_close(BcolFile *b);
+extern size_t bcol_rows(const BcolFile *b);
+extern size_t bcol_cols(const BcolFile *b);
+extern size_t bcol_skipped_lines(const BcolFile *b);
+extern size_t bcol_blank_lines(const BcolFile *b);
+extern int bcol_has_header(const BcolFile *b);
+extern int bcol_has_padded_fields(const BcolFile *b);
+extern int bcol_column_numeric(const BcolFile *b, size_t col);
+extern const char *bcol_column_name(const BcolFile *b, size_t col);
+extern const double *bcol_column(const BcolFile *b, size_t col);
 
 /* compare two doubles for qsort */
 static int cmp_double(const void *a, const void *b) {
@@ -15,7 +36,7 @@ static int cmp_double(const void *a, const void *b) {
 }
 
 /* print statistics for a single column */
-static void print_stats(double *data, size_t n, size_t col_number) {
+static void print_stats(const double *data, size_t n, size_t col_number) {
     if (n == 0) {
         printf("Column %zu: no data\n\n", col_number);
         return;
@@ -98,10 +119,743 @@ static int parse_line(char *buf, size_t row, size_t num_cols, int target_col,
     return 0;
 }
 
+/*
+ * Group-by mode: csvstat -by <col> [-every <width>] [-t threads] <csv_file> [column]
+ *
+ * One scan computes count, mean, min, max, sample std and approximate
+ * quantiles of the value column(s) for every distinct key. The file is split
+ * into one range of lines per thread; each thread aggregates its range into
+ * its own open-addressing hash table and the tables are merged at the end.
+ * Means and variances are merged exactly (Welford / Chan). Quantiles come
+ * from a log-bucket sketch with about 1% relative error that merges by
+ * adding bucket counts. Keys that parse as numbers group by value (so "1"
+ * and "1.0" are one group); -every groups numeric keys into buckets
+ * [k*width, (k+1)*width), e.g. per minute of a time column in seconds.
+ * Fields are trimmed and the first line is a header if any of its fields is
+ * not a number, as in the other csv tools.
+ */
+
+#define GROUPBY_MAX_THREADS 64
+#define GROUPBY_MIN_RANGE (256 * 1024)   /* bytes of text per thread at least */
+#define SKETCH_GAMMA 1.02                /* bucket growth: about 1% relative error */
+#define SKETCH_MAX_BINS 2048             /* smaller magnitudes collapse beyond this */
+
+/* Counts of one sign: bin i counts values in (gamma^(offset+i-1), gamma^(offset+i)] */
+typedef struct {
+    int offset;
+    int nbins;
+    uint64_t *counts;
+} SketchStore;
+
+/* Statistics of one value column within one group */
+typedef struct {
+    size_t n;
+    double mean, m2, min, max;
+    SketchStore pos, neg;
+    uint64_t zeros;
+} Agg;
+
+typedef struct {
+    char *text;          /* text key (NULL for numeric keys) */
+    size_t len;
+    int is_num;
+    double num;
+    uint64_t hash;
+    Agg *aggs;           /* one per value column; NULL marks an empty slot */
+} Group;
+
+typedef struct {
+    Group *slots;
+    size_t cap, count;
+} GroupTable;
+
+typedef struct {
+    int key_col;         /* 0-based */
+    double every;        /* bucket width, 0 for exact keys */
+    size_t ncols;
+    size_t nvals;
+    int *slot_of;        /* [ncols]: value index of a column, -1 when unused */
+    int *val_cols;       /* [nvals]: column of each value */
+} GroupBySpec;
+
+typedef struct {
+    const GroupBySpec *spec;
+    const char *begin, *end;          /* text lines */
+    const double *key_data;           /* sidecar columns (key_data != NULL) */
+    const double **val_data;
+    size_t row_begin, row_end;
+    GroupTable table;
+    char err[160];
+} GroupByWorker;
+
+/* Reports an allocation failure; returns the exit status for groupby_main() */
+static int groupby_oom(void) {
+    fprintf(stderr, "Memory error\n");
+    return EXIT_FAILURE;
+}
+
+/* Returns -1 when out of memory */
+static int store_add(SketchStore *s, int key, uint64_t count) {
+    if (s->nbins == 0 || key < s->offset || key >= s->offset + s->nbins) {
+        int slack = s->nbins / 2 + 8;
+        int lo = s->nbins == 0 ? key - slack : (key < s->offset ? key - slack : s->offset);
+        int hi = s->nbins == 0 ? key + slack :
+                 (key >= s->offset + s->nbins ? key + slack : s->offset + s->nbins - 1);
+        if (hi - lo + 1 > SKETCH_MAX_BINS)
+            lo = hi - SKETCH_MAX_BINS + 1;
+        uint64_t *c = calloc((size_t)(hi - lo + 1), sizeof *c);
+        if (!c) return -1;
+        for (int i = 0; i < s->nbins; i++) {
+            int k = s->offset + i;
+            c[(k < lo ? lo : k) - lo] += s->counts[i];
+        }
+        free(s->counts);
+        s->counts = c;
+        s->offset = lo;
+        s->nbins = hi - lo + 1;
+    }
+    if (key < s->offset) key = s->offset;
+    s->counts[key - s->offset] += count;
+    return 0;
+}
+
+static int sketch_key(double magnitude) {
+    return (int)ceil(log(magnitude) / log(SKETCH_GAMMA));
+}
+
+/* Representative value of bin key: the point with equal relative error to both ends */
+static double sketch_value(int key) {
+    return 2.0 * pow(SKETCH_GAMMA, key) / (SKETCH_GAMMA + 1.0);
+}
+
+/* Returns -1 when out of memory */
+static int agg_add(Agg *a, double v) {
+    a->n++;
+    if (a->n == 1) {
+        a->min = a->max = v;
+    } else {
+        if (v < a->min) a->min = v;
+        if (v > a->max) a->max = v;
+    }
+    double d = v - a->mean;
+    a->mean += d / a->n;
+    a->m2 += d * (v - a->mean);
+    if (!isfinite(v) || v == 0.0) {
+        a->zeros += v == 0.0;
+        return 0;
+    }
+    return v > 0 ? store_add(&a->pos, sketch_key(v), 1) : store_add(&a->neg, sketch_key(-v), 1);
+}
+
+/* Returns -1 when out of memory */
+static int agg_merge(Agg *a, const Agg *b) {
+    if (b->n == 0) return 0;
+    if (a->n == 0) {
+        a->min = b->min;
+        a->max = b->max;
+    } else {
+        if (b->min < a->min) a->min = b->min;
+        if (b->max > a->max) a->max = b->max;
+    }
+    double n = (double)a->n + (double)b->n;
+    double d = b->mean - a->mean;
+    a->m2 += b->m2 + d * d * (double)a->n * (double)b->n / n;
+    a->mean += d * (double)b->n / n;
+    a->n += b->n;
+    a->zeros += b->zeros;
+    for (int i = 0; i < b->pos.nbins; i++)
+        if (b->pos.counts[i] && store_add(&a->pos, b->pos.offset + i, b->pos.counts[i]) != 0)
+            return -1;
+    for (int i = 0; i < b->neg.nbins; i++)
+        if (b->neg.counts[i] && store_add(&a->neg, b->neg.offset + i, b->neg.counts[i]) != 0)
+            return -1;
+    return 0;
+}
+
+static double agg_quantile(const Agg *a, double q) {
+    double rank = q * (double)(a->n - 1);
+    double v = a->max;
+    uint64_t seen = 0;
+    int found = 0;
+    for (int i = a->neg.nbins - 1; i >= 0 && !found; i--) {
+        seen += a->neg.counts[i];
+        if ((double)seen > rank) { v = -sketch_value(a->neg.offset + i); found = 1; }
+    }
+    if (!found) {
+        seen += a->zeros;
+        if ((double)seen > rank) { v = 0.0; found = 1; }
+    }
+    for (int i = 0; i < a->pos.nbins && !found; i++) {
+        seen += a->pos.counts[i];
+        if ((double)seen > rank) { v = sketch_value(a->pos.offset + i); found = 1; }
+    }
+    if (v < a->min) v = a->min;
+    if (v > a->max) v = a->max;
+    return v;
+}
+
+static void agg_free(Agg *a) {
+    free(a->pos.counts);
+    free(a->neg.counts);
+}
+
+static uint64_t hash_num(double num) {
+    if (num == 0.0) num = 0.0;   /* -0 and 0 are one key */
+    uint64_t x;
+    memcpy(&x, &num, sizeof x);
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t hash_text(const char *s, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static int table_grow(GroupTable *t) {
+    size_t cap = t->cap ? t->cap * 2 : 64;
+    Group *slots = calloc(cap, sizeof *slots);
+    if (!slots) return -1;
+    for (size_t i = 0; i < t->cap; i++) {
+        if (!t->slots[i].aggs) continue;
+        size_t j = t->slots[i].hash & (cap - 1);
+        while (slots[j].aggs) j = (j + 1) & (cap - 1);
+        slots[j] = t->slots[i];
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->cap = cap;
+    return 0;
+}
+
+/* Finds the group of a key, creating it when missing; NULL when out of memory */
+static Group *table_group(GroupTable *t, size_t nvals, int is_num, double num,
+                          const char *text, size_t len) {
+    if ((t->count + 1) * 10 > t->cap * 7 && table_grow(t) != 0)
+        return NULL;
+    uint64_t h = is_num ? hash_num(num) : hash_text(text, len);
+    size_t i = h & (t->cap - 1);
+    for (; t->slots[i].aggs; i = (i + 1) & (t->cap - 1)) {
+        Group *g = &t->slots[i];
+        if (g->hash != h || g->is_num != is_num) continue;
+        if (is_num ? g->num == num : (g->len == len && memcmp(g->text, text, len) == 0))
+            return g;
+    }
+    Group *g = &t->slots[i];
+    g->hash = h;
+    g->is_num = is_num;
+    g->num = num;
+    g->len = len;
+    g->text = NULL;
+    if (!is_num) {
+        g->text = malloc(len + 1);
+        if (!g->text) return NULL;
+        memcpy(g->text, text, len);
+        g->text[len] = '\0';
+    }
+    g->aggs = calloc(nvals, sizeof *g->aggs);
+    if (!g->aggs) {
+        /* the slot stays free */
+        free(g->text);
+        g->text = NULL;
+        return NULL;
+    }
+    t->count++;
+    return g;
+}
+
+static void table_free(GroupTable *t, size_t nvals) {
+    for (size_t i = 0; i < t->cap; i++) {
+        if (!t->slots[i].aggs) continue;
+        for (size_t v = 0; v < nvals; v++)
+            agg_free(&t->slots[i].aggs[v]);
+        free(t->slots[i].aggs);
+        free(t->slots[i].text);
+    }
+    free(t->slots);
+}
+
+/* Trims [*s, *e) in place */
+static void trim_span(const char **s, const char **e) {
+    while (*s < *e && isspace((unsigned char)**s)) (*s)++;
+    while (*e > *s && isspace((unsigned char)(*e)[-1])) (*e)--;
+}
+
+/* Parses the whole span as a number; returns 0 when it is not one */
+static int span_number(const char *s, const char *e, double *out) {
+    char buf[128];
+    if (s == e || e - s >= (long)sizeof buf) return 0;
+    memcpy(buf, s, (size_t)(e - s));
+    buf[e - s] = '\0';
+    char *endptr;
+    errno = 0;
+    *out = strtod(buf, &endptr);
+    return !errno && *endptr == '\0';
+}
+
+static Group *worker_group(GroupByWorker *w, int is_num, double num,
+                           const char *text, size_t len) {
+    if (is_num && w->spec->every > 0)
+        num = floor(num / w->spec->every) * w->spec->every;
+    return table_group(&w->table, w->spec->nvals, is_num, num, text, len);
+}
+
+/* Aggregates one text line; returns -1 (with w->err set) on an invalid number or
+ * when out of memory */
+static int groupby_line(GroupByWorker *w, const char *p, const char *e, double *vals,
+                        unsigned char *have) {
+    const GroupBySpec *spec = w->spec;
+    const char *ks = NULL, *ke = NULL;
+    memset(have, 0, spec->nvals);
+    size_t col = 0;
+    for (const char *f = p; ; col++) {
+        const char *fe = f;
+        while (fe < e && *fe != ',') fe++;
+        if (col < spec->ncols) {
+            if ((int)col == spec->key_col) {
+                ks = f;
+                ke = fe;
+            } else if (spec->slot_of[col] >= 0) {
+                const char *s = f, *t = fe;
+                trim_span(&s, &t);
+                if (s < t) {
+                    int slot = spec->slot_of[col];
+                    if (!span_number(s, t, &vals[slot])) {
+                        snprintf(w->err, sizeof w->err, "Invalid number '%.*s' in column %zu",
+                                 (int)(t - s > 60 ? 60 : t - s), s, col + 1);
+                        return -1;
+                    }
+                    have[slot] = 1;
+                }
+            }
+        }
+        if (fe >= e) break;
+        f = fe + 1;
+    }
+    if (!ks) return 0;
+    trim_span(&ks, &ke);
+    double num = 0.0;
+    int is_num = span_number(ks, ke, &num);
+    if (spec->every > 0 && !is_num) return 0;
+    Group *g = worker_group(w, is_num, num, ks, (size_t)(ke - ks));
+    for (size_t v = 0; g && v < spec->nvals; v++)
+        if (have[v] && agg_add(&g->aggs[v], vals[v]) != 0)
+            g = NULL;
+    if (!g) {
+        snprintf(w->err, sizeof w->err, "Memory error");
+        return -1;
+    }
+    return 0;
+}
+
+static void *groupby_worker(void *arg) {
+    GroupByWorker *w = arg;
+    const GroupBySpec *spec = w->spec;
+    if (w->key_data) {
+        for (size_t r = w->row_begin; r < w->row_end; r++) {
+            Group *g = worker_group(w, 1, w->key_data[r], NULL, 0);
+            for (size_t v = 0; g && v < spec->nvals; v++)
+                if (agg_add(&g->aggs[v], w->val_data[v][r]) != 0)
+                    g = NULL;
+            if (!g) {
+                snprintf(w->err, sizeof w->err, "Memory error");
+                break;
+            }
+        }
+        return NULL;
+    }
+    double *vals = malloc(spec->nvals * sizeof *vals + 1);
+    unsigned char *have = malloc(spec->nvals + 1);
+    if (!vals || !have) {
+        snprintf(w->err, sizeof w->err, "Memory error");
+        free(vals);
+        free(have);
+        return NULL;
+    }
+    for (const char *p = w->begin; p < w->end; ) {
+        const char *nl = memchr(p, '\n', (size_t)(w->end - p));
+        const char *e = nl ? nl : w->end;
+        const char *next = nl ? nl + 1 : w->end;
+        if (e > p && e[-1] == '\r') e--;
+        const char *s = p, *t = e;
+        trim_span(&s, &t);
+        if (s < t && groupby_line(w, p, e, vals, have) != 0)
+            break;
+        p = next;
+    }
+    free(vals);
+    free(have);
+    return NULL;
+}
+
+/* Splits [begin, end) at line starts into at most n ranges; returns the count */
+static int split_lines(const char *begin, const char *end, int n, const char **bounds) {
+    int k = 0;
+    bounds[k++] = begin;
+    for (int i = 1; i < n; i++) {
+        const char *p = begin + (size_t)(end - begin) * (size_t)i / (size_t)n;
+        if (p <= bounds[k - 1]) continue;
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (!nl || nl + 1 >= end) break;
+        if (nl + 1 > bounds[k - 1]) bounds[k++] = nl + 1;
+    }
+    bounds[k] = end;
+    return k;
+}
+
+static int cmp_group(const void *a, const void *b) {
+    const Group *ga = *(const Group *const *)a;
+    const Group *gb = *(const Group *const *)b;
+    if (ga->is_num != gb->is_num) return ga->is_num ? -1 : 1;
+    if (ga->is_num) return (ga->num > gb->num) - (ga->num < gb->num);
+    size_t n = ga->len < gb->len ? ga->len : gb->len;
+    int c = memcmp(ga->text, gb->text, n);
+    if (c) return c;
+    return (ga->len > gb->len) - (ga->len < gb->len);
+}
+
+/* 0-based column of a 1-based number or header name, -1 when unknown */
+static int resolve_column(const char *spec, char **names, size_t ncols) {
+    char *endptr;
+    long n = strtol(spec, &endptr, 10);
+    if (*spec && *endptr == '\0')
+        return n >= 1 && (size_t)n <= ncols ? (int)(n - 1) : -1;
+    for (size_t c = 0; names && c < ncols; c++)
+        if (strcmp(names[c], spec) == 0) return (int)c;
+    return -1;
+}
+
+/* Splits the first line into trimmed fields; returns 1 when it is a header, 0 when
+ * it is data and -1 when out of memory */
+static int split_first_line(const char *p, const char *e, char ***names_out, size_t *ncols_out) {
+    size_t n = 1;
+    for (const char *q = p; q < e; q++)
+        if (*q == ',') n++;
+    char **names = malloc(n * sizeof *names);
+    if (!names) return -1;
+    int header = 0;
+    size_t c = 0;
+    for (const char *f = p; ; ) {
+        const char *fe = f;
+        while (fe < e && *fe != ',') fe++;
+        const char *s = f, *t = fe;
+        trim_span(&s, &t);
+        double v;
+        if (!span_number(s, t, &v)) header = 1;
+        names[c] = malloc((size_t)(t - s) + 1);
+        if (!names[c]) {
+            while (c > 0)
+                free(names[--c]);
+            free(names);
+            return -1;
+        }
+        memcpy(names[c], s, (size_t)(t - s));
+        names[c][t - s] = '\0';
+        c++;
+        if (fe >= e) break;
+        f = fe + 1;
+    }
+    *names_out = names;
+    *ncols_out = n;
+    return header;
+}
+
+static void print_number(double v) {
+    if (v == floor(v) && fabs(v) < 1e15)
+        printf("%.0f", v);
+    else
+        printf("%.15g", v);
+}
+
+static int groupby_main(int argc, char *argv[]) {
+    const char *by = NULL, *value_spec = NULL, *fn = NULL;
+    double every = 0.0;
+    int threads = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-by") == 0 && i + 1 < argc) {
+            by = argv[++i];
+        } else if (strcmp(argv[i], "-every") == 0 && i + 1 < argc) {
+            every = strtod(argv[++i], NULL);
+            if (!(every > 0)) {
+                fprintf(stderr, "Invalid bucket width: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (!fn) {
+            fn = argv[i];
+        } else if (!value_spec) {
+            value_spec = argv[i];
+        } else {
+            fn = NULL;
+            break;
+        }
+    }
+    if (!by || !fn) {
+        fprintf(stderr, "Usage: %s -by <col> [-every <width>] [-t threads] <csv_file> [column]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (threads <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = n > 0 ? (int)n : 1;
+    }
+    if (threads > GROUPBY_MAX_THREADS) threads = GROUPBY_MAX_THREADS;
+
+    /* Column layout: from the sidecar when it can serve the scan, else the text */
+    char **names = NULL;
+    size_t ncols = 0;
+    int has_header = 0;
+    BcolFile *bc = bcol_open(fn);
+    const char *text = NULL, *data_begin = NULL;
+    size_t text_size = 0;
+    if (bc) {
+        ncols = bcol_cols(bc);
+        has_header = bcol_has_header(bc);
+        names = calloc(ncols ? ncols : 1, sizeof *names);
+        if (!names) return groupby_oom();
+        for (size_t c = 0; c < ncols; c++) {
+            names[c] = strdup(bcol_column_name(bc, c));
+            if (!names[c]) return groupby_oom();
+        }
+    } else {
+        int fd = open(fn, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            perror("Failed to open file");
+            if (fd >= 0) close(fd);
+            return EXIT_FAILURE;
+        }
+        text_size = (size_t)st.st_size;
+        if (text_size > 0) {
+            void *m = mmap(NULL, text_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            text = m == MAP_FAILED ? NULL : m;
+        }
+        close(fd);
+        if (!text) {
+            fprintf(stderr, "Empty file or read error\n");
+            return EXIT_FAILURE;
+        }
+        /* first non-blank line fixes the columns */
+        const char *p = text, *end = text + text_size;
+        while (p < end) {
+            const char *nl = memchr(p, '\n', (size_t)(end - p));
+            const char *e = nl ? nl : end;
+            const char *s = p, *t = e;
+            if (t > s && t[-1] == '\r') t--;
+            const char *ts = s, *te = t;
+            trim_span(&ts, &te);
+            if (ts < te) {
+                has_header = split_first_line(s, t, &names, &ncols);
+                if (has_header < 0) {
+                    munmap((void *)text, text_size);
+                    return groupby_oom();
+                }
+                data_begin = has_header ? (nl ? nl + 1 : end) : p;
+                break;
+            }
+            p = nl ? nl + 1 : end;
+        }
+        if (!names) {
+            fprintf(stderr, "Empty file or read error\n");
+            munmap((void *)text, text_size);
+            return EXIT_FAILURE;
+        }
+    }
+
+    GroupBySpec spec = { -1, every, ncols, 0, NULL, NULL };
+    spec.key_col = resolve_column(by, has_header ? names : NULL, ncols);
+    int value_col = value_spec ? resolve_column(value_spec, has_header ? names : NULL, ncols) : -1;
+    if (spec.key_col < 0 || (value_spec && value_col < 0)) {
+        fprintf(stderr, "Unknown column: %s\n", spec.key_col < 0 ? by : value_spec);
+        return EXIT_FAILURE;
+    }
+    spec.slot_of = malloc(ncols * sizeof *spec.slot_of);
+    spec.val_cols = malloc(ncols * sizeof *spec.val_cols);
+    if (!spec.slot_of || !spec.val_cols) return groupby_oom();
+    for (size_t c = 0; c < ncols; c++) {
+        spec.slot_of[c] = -1;
+        if ((int)c == spec.key_col || (value_col >= 0 && (int)c != value_col)) continue;
+        spec.slot_of[c] = (int)spec.nvals;
+        spec.val_cols[spec.nvals++] = (int)c;
+    }
+    if (spec.nvals == 0) {
+        fprintf(stderr, "No value columns besides the key column\n");
+        return EXIT_FAILURE;
+    }
+
+    /* The sidecar serves the scan when it stores every line and all used columns are numbers. */
+    const double **val_data = NULL;
+    if (bc) {
+        int usable = bcol_skipped_lines(bc) == 0 && bcol_column_numeric(bc, (size_t)spec.key_col);
+        for (size_t v = 0; usable && v < spec.nvals; v++)
+            usable = bcol_column_numeric(bc, (size_t)spec.val_cols[v]);
+        if (!usable) {
+            /* fall back to the text with the same column layout */
+            bcol_close(bc);
+            bc = NULL;
+            int fd = open(fn, O_RDONLY);
+            struct stat st;
+            if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+                perror("Failed to open file");
+                if (fd >= 0) close(fd);
+                return EXIT_FAILURE;
+            }
+            text_size = (size_t)st.st_size;
+            void *m = mmap(NULL, text_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (m == MAP_FAILED) {
+                perror("mmap");
+                return EXIT_FAILURE;
+            }
+            text = m;
+            const char *p = text, *end = text + text_size;
+            data_begin = p;
+            while (has_header && p < end) {
+                const char *nl = memchr(p, '\n', (size_t)(end - p));
+                const char *s = p, *t = nl ? nl : end;
+                trim_span(&s, &t);
+                p = nl ? nl + 1 : end;
+                if (s < t) {
+                    data_begin = p;   /* skip the header line */
+                    break;
+                }
+            }
+        } else {
+            val_data = malloc(spec.nvals * sizeof *val_data);
+            if (!val_data) return groupby_oom();
+            for (size_t v = 0; v < spec.nvals; v++)
+                val_data[v] = bcol_column(bc, (size_t)spec.val_cols[v]);
+        }
+    }
+
+    /* Scan in parallel, one hash table per thread */
+    GroupByWorker workers[GROUPBY_MAX_THREADS];
+    pthread_t tids[GROUPBY_MAX_THREADS];
+    int started[GROUPBY_MAX_THREADS];
+    int nworkers;
+    memset(workers, 0, sizeof workers);
+    if (bc) {
+        size_t rows = bcol_rows(bc);
+        nworkers = (int)(rows / (GROUPBY_MIN_RANGE / 16) + 1);
+        if (nworkers > threads) nworkers = threads;
+        for (int i = 0; i < nworkers; i++) {
+            workers[i].key_data = bcol_column(bc, (size_t)spec.key_col);
+            workers[i].val_data = val_data;
+            workers[i].row_begin = rows * (size_t)i / (size_t)nworkers;
+            workers[i].row_end = rows * (size_t)(i + 1) / (size_t)nworkers;
+        }
+    } else {
+        const char *bounds[GROUPBY_MAX_THREADS + 1];
+        const char *end = text + text_size;
+        int n = (int)((size_t)(end - data_begin) / GROUPBY_MIN_RANGE + 1);
+        if (n > threads) n = threads;
+        nworkers = split_lines(data_begin, end, n, bounds);
+        for (int i = 0; i < nworkers; i++) {
+            workers[i].begin = bounds[i];
+            workers[i].end = bounds[i + 1];
+        }
+    }
+    for (int i = 0; i < nworkers; i++) {
+        workers[i].spec = &spec;
+        /* the calling thread takes the last range */
+        started[i] = i < nworkers - 1 &&
+                     pthread_create(&tids[i], NULL, groupby_worker, &workers[i]) == 0;
+        if (!started[i])
+            groupby_worker(&workers[i]);
+    }
+    for (int i = 0; i < nworkers; i++)
+        if (started[i]) pthread_join(tids[i], NULL);
+
+    int status = EXIT_SUCCESS;
+    for (int i = 0; i < nworkers; i++) {
+        if (workers[i].err[0]) {
+            fprintf(stderr, "%s\n", workers[i].err);
+            status = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    /* Merge the partial tables into the first one */
+    GroupTable *all = &workers[0].table;
+    for (int i = 1; status == EXIT_SUCCESS && i < nworkers; i++) {
+        GroupTable *t = &workers[i].table;
+        for (size_t s = 0; s < t->cap; s++) {
+            Group *g = &t->slots[s];
+            if (!g->aggs) continue;
+            Group *d = table_group(all, spec.nvals, g->is_num, g->num, g->text, g->len);
+            for (size_t v = 0; d && v < spec.nvals; v++)
+                if (agg_merge(&d->aggs[v], &g->aggs[v]) != 0)
+                    d = NULL;
+            if (!d) {
+                status = groupby_oom();
+                break;
+            }
+        }
+    }
+
+    Group **order = NULL;
+    if (status == EXIT_SUCCESS) {
+        order = malloc((all->count ? all->count : 1) * sizeof *order);
+        if (!order)
+            status = groupby_oom();
+    }
+    if (status == EXIT_SUCCESS) {
+        size_t ng = 0;
+        for (size_t s = 0; s < all->cap; s++)
+            if (all->slots[s].aggs) order[ng++] = &all->slots[s];
+        qsort(order, ng, sizeof *order, cmp_group);
+
+        printf("%s,column,count,mean,min,max,std,p50,p90,p99\n",
+               has_header ? names[spec.key_col] : "group");
+        for (size_t i = 0; i < ng; i++) {
+            for (size_t v = 0; v < spec.nvals; v++) {
+                const Agg *a = &order[i]->aggs[v];
+                if (a->n == 0) continue;
+                if (order[i]->is_num)
+                    print_number(order[i]->num);
+                else
+                    fputs(order[i]->text, stdout);
+                if (has_header)
+                    printf(",%s", names[spec.val_cols[v]]);
+                else
+                    printf(",%d", spec.val_cols[v] + 1);
+                double sd = a->n > 1 ? sqrt(a->m2 / (double)(a->n - 1)) : 0.0;
+                printf(",%zu,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n", a->n, a->mean,
+                       a->min, a->max, sd, agg_quantile(a, 0.5), agg_quantile(a, 0.9),
+                       agg_quantile(a, 0.99));
+            }
+        }
+        free(order);
+    }
+
+    for (int i = 0; i < nworkers; i++)
+        table_free(&workers[i].table, spec.nvals);
+    if (bc) bcol_close(bc);
+    if (text) munmap((void *)text, text_size);
+    for (size_t c = 0; c < ncols; c++)
+        free(names[c]);
+    free(names);
+    free(val_data);
+    free(spec.slot_of);
+    free(spec.val_cols);
+    return status;
+}
+
 int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "-by") == 0)
+            return groupby_main(argc, argv);
     if (argc < 2 || argc > 3) {
         fprintf(stderr,
-                "Usage: %s <csv_file> [column_number]\n", argv[0]);
+                "Usage: %s <csv_file> [column_number]\n"
+                "       %s -by <col> [-every <width>] [-t threads] <csv_file> [column]\n",
+                argv[0], argv[0]);
         return EXIT_FAILURE;
     }
     const char *fn = argv[1];
@@ -113,6 +867,33 @@ int main(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
     }
+
+    /* A fresh sidecar gives the same result without parsing the text when the
+       file has no header, no blank or irregular lines, no whitespace around
+       fields and the columns are numeric. */
+    BcolFile *bc = bcol_open(fn);
+    if (bc) {
+        size_t ncols = bcol_cols(bc);
+        int usable = !bcol_has_header(bc) && bcol_rows(bc) > 0 &&
+                     bcol_blank_lines(bc) == 0 && bcol_skipped_lines(bc) == 0 &&
+                     !bcol_has_padded_fields(bc) &&
+                     (target_col <= 0 || (size_t)target_col <= ncols);
+        for (size_t c = 0; usable && c < ncols; c++)
+            if ((target_col <= 0 || c + 1 == (size_t)target_col) && !bcol_column_numeric(bc, c))
+                usable = 0;
+        if (usable) {
+            if (target_col > 0) {
+                print_stats(bcol_column(bc, target_col - 1), bcol_rows(bc), (size_t)target_col);
+            } else {
+                for (size_t c = 0; c < ncols; c++)
+                    print_stats(bcol_column(bc, c), bcol_rows(bc), c + 1);
+            }
+            bcol_close(bc);
+            return EXIT_SUCCESS;
+        }
+        bcol_close(bc);
+    }
+
     FILE *fp = fopen(fn, "r");
     if (!fp) {
         perror("Failed to open file");
@@ -0,0 +1,366 @@
+#define _POSIX_C_SOURCE 200809L
+/*
+ * ephem.c
+ *
+ * Export a year of sun/moon rise and set times, or of sky positions, for one or
+ * many locations as CSV.
+ *
+ * Design principles:
+ *  - All astronomy comes from the shared ephemeris (lib/libephem.c): the per-day
+ *    terms and the Moon grid of the year are computed once, then every location
+ *    is a cheap pass over those arrays.
+ *  - Times are UTC, written as ISO 8601 ("2026-10-18T05:12Z"); an empty field
+ *    means the event does not happen on that day (polar day or night, or the
+ *    Moon skipping a rise or set).
+ *  - Dates are local mean solar days of each location, so an event always lands
+ *    on the date a local observer would give it.
+ *  - The compute and write times go to stderr so the export stays clean CSV.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+// Shared ephemeris (lib/libephem.c).
+typedef struct EphemGrid EphemGrid;
+typedef struct EphemDays EphemDays;
+extern int ephem_body(const char *name);
+extern int ephem_body_count(void);
+extern const char *ephem_body_name(int body);
+extern double ephem_jd(int year, int month, int day, double hours);
+extern double ephem_unix_from_jd(double jd);
+extern EphemGrid *ephem_grid(int body, double jd0, double step, size_t n);
+extern void ephem_grid_free(EphemGrid *g);
+extern double ephem_grid_jd(const EphemGrid *g, size_t i);
+extern void ephem_grid_horizontal(const EphemGrid *g, double lat, double lon, double *az, double *alt);
+extern EphemDays *ephem_days(double jd0, size_t ndays);
+extern void ephem_days_free(EphemDays *days);
+extern void ephem_sun_events(const EphemDays *days, double lat, double lon, double *rise, double *set);
+extern int ephem_moon_events(const EphemDays *days, double lat, double lon, double *rise, double *set);
+
+typedef struct {
+    double lat, lon;
+} Location;
+
+typedef struct {
+    Location *items;
+    size_t count, cap;
+} LocationList;
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [-y year] [-f locations.csv] [-o out.csv] events [lat lon ...]\n", prog);
+    printf("       %s [-y year] [-f locations.csv] [-o out.csv] [-s minutes] [-b body] positions [lat lon ...]\n", prog);
+    printf("Exports a year of sunrise, sunset, moonrise and moonset times (events) or of\n");
+    printf("azimuth and altitude (positions) as CSV, for every location at once.\n");
+    printf("  -y year     Year to export (default: the current year).\n");
+    printf("  -f file     Read locations from a CSV file, one 'lat,lon' per line.\n");
+    printf("  -o file     Write to a file instead of standard output.\n");
+    printf("  -s minutes  Time step for positions (default: 60).\n");
+    printf("  -b body     Sun, Moon, Mercury, Venus, Mars, Jupiter, Saturn or all (default: Sun).\n");
+    printf("Without locations, LATITUDE and LONGITUDE from the environment are used.\n");
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int add_location(LocationList *list, double lat, double lon) {
+    if (lat < -90 || lat > 90 || lon < -180 || lon > 180) {
+        fprintf(stderr, "ephem: location %g %g out of range\n", lat, lon);
+        return -1;
+    }
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 16;
+        Location *items = realloc(list->items, cap * sizeof(*items));
+        if (!items) {
+            fprintf(stderr, "ephem: out of memory\n");
+            return -1;
+        }
+        list->items = items;
+        list->cap = cap;
+    }
+    list->items[list->count].lat = lat;
+    list->items[list->count].lon = lon;
+    list->count++;
+    return 0;
+}
+
+// Read 'lat,lon' lines; lines not starting with two numbers (e.g. a header) are skipped.
+static int read_locations(const char *path, LocationList *list) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "ephem: cannot open '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        char *end;
+        double lat = strtod(line, &end);
+        if (end == line)
+            continue;
+        while (*end == ' ' || *end == '\t' || *end == ',' || *end == ';')
+            end++;
+        char *start = end;
+        double lon = strtod(start, &end);
+        if (end == start)
+            continue;
+        if (add_location(list, lat, lon) < 0) {
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+// Gregorian date from days since 1970-01-01 (H. Hinnant's civil_from_days).
+static void civil_from_days(long z, int *y, int *m, int *d) {
+    z += 719468;
+    long era = (z >= 0 ? z : z - 146096) / 146097;
+    long doe = z - era * 146097;
+    long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long mp = (5 * doy + 2) / 153;
+    *d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *y = (int)(yoe + era * 400 + (*m <= 2));
+}
+
+// Format a Julian date as "YYYY-MM-DDTHH:MMZ" (empty for NAN); returns the end.
+// Rows are built by hand because printf and gmtime dominate a large export.
+static char *put_time(char *p, double jd) {
+    if (isnan(jd))
+        return p;
+    long minutes = lround(ephem_unix_from_jd(jd) / 60.0);
+    long days = minutes >= 0 ? minutes / 1440 : -((-minutes + 1439) / 1440);
+    long rem = minutes - days * 1440;
+    int y, m, d;
+    civil_from_days(days, &y, &m, &d);
+    return p + sprintf(p, "%04d-%02d-%02dT%02ld:%02ldZ", y, m, d, rem / 60, rem % 60);
+}
+
+// Format v with three decimals; returns the end.
+static char *put_fixed3(char *p, double v) {
+    long x = lround(v * 1000.0);
+    if (x < 0) {
+        *p++ = '-';
+        x = -x;
+    }
+    char digits[24];
+    int n = 0;
+    long whole = x / 1000;
+    do {
+        digits[n++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole);
+    while (n)
+        *p++ = digits[--n];
+    *p++ = '.';
+    *p++ = (char)('0' + x / 100 % 10);
+    *p++ = (char)('0' + x / 10 % 10);
+    *p++ = (char)('0' + x % 10);
+    return p;
+}
+
+static int export_events(FILE *out, const LocationList *locs, int year, double *compute_ms) {
+    double jd0 = ephem_jd(year, 1, 1, 0);
+    size_t ndays = (size_t)(ephem_jd(year + 1, 1, 1, 0) - jd0);
+    double t0 = now_ms();
+    EphemDays *days = ephem_days(jd0, ndays);
+    double *buf = malloc(4 * ndays * sizeof(double));
+    if (!days || !buf) {
+        ephem_days_free(days);
+        free(buf);
+        fprintf(stderr, "ephem: out of memory\n");
+        return -1;
+    }
+    double *sunrise = buf, *sunset = buf + ndays, *moonrise = buf + 2 * ndays, *moonset = buf + 3 * ndays;
+    *compute_ms = now_ms() - t0;
+
+    long epoch_day = lround(ephem_unix_from_jd(jd0) / 86400.0);
+    fprintf(out, "lat,lon,date,sunrise,sunset,moonrise,moonset\n");
+    for (size_t l = 0; l < locs->count; l++) {
+        const Location *loc = &locs->items[l];
+        t0 = now_ms();
+        ephem_sun_events(days, loc->lat, loc->lon, sunrise, sunset);
+        if (ephem_moon_events(days, loc->lat, loc->lon, moonrise, moonset) < 0) {
+            fprintf(stderr, "ephem: out of memory\n");
+            ephem_days_free(days);
+            free(buf);
+            return -1;
+        }
+        *compute_ms += now_ms() - t0;
+        for (size_t k = 0; k < ndays; k++) {
+            char row[160], *p = row;
+            int y, m, d;
+            civil_from_days(epoch_day + (long)k, &y, &m, &d);
+            p += sprintf(p, "%.4f,%.4f,%04d-%02d-%02d,", loc->lat, loc->lon, y, m, d);
+            p = put_time(p, sunrise[k]);
+            *p++ = ',';
+            p = put_time(p, sunset[k]);
+            *p++ = ',';
+            p = put_time(p, moonrise[k]);
+            *p++ = ',';
+            p = put_time(p, moonset[k]);
+            *p++ = '\n';
+            fwrite(row, 1, (size_t)(p - row), out);
+        }
+    }
+    ephem_days_free(days);
+    free(buf);
+    return 0;
+}
+
+static int export_positions(FILE *out, const LocationList *locs, int year, int step_minutes,
+                            int body, double *compute_ms) {
+    double jd0 = ephem_jd(year, 1, 1, 0);
+    size_t n = (size_t)(ephem_jd(year + 1, 1, 1, 0) - jd0) * 1440 / (size_t)step_minutes;
+    int first = body < 0 ? 0 : body;
+    int last = body < 0 ? ephem_body_count() - 1 : body;
+    double *buf = malloc(2 * n * sizeof(double));
+    char (*stamps)[24] = malloc(n * sizeof(*stamps));   // the same times for every location
+    int *stamp_len = malloc(n * sizeof(int));
+    if (!buf || !stamps || !stamp_len) {
+        fprintf(stderr, "ephem: out of memory\n");
+        free(buf);
+        free(stamps);
+        free(stamp_len);
+        return -1;
+    }
+    double *az = buf, *alt = buf + n;
+    *compute_ms = 0;
+
+    fprintf(out, "time,lat,lon,body,azimuth,altitude\n");
+    for (int b = first; b <= last; b++) {
+        double t0 = now_ms();
+        EphemGrid *g = ephem_grid(b, jd0, step_minutes / 1440.0, n);
+        if (!g) {
+            fprintf(stderr, "ephem: out of memory\n");
+            free(buf);
+            free(stamps);
+            free(stamp_len);
+            return -1;
+        }
+        *compute_ms += now_ms() - t0;
+        for (size_t i = 0; i < n; i++)
+            stamp_len[i] = (int)(put_time(stamps[i], ephem_grid_jd(g, i)) - stamps[i]);
+        for (size_t l = 0; l < locs->count; l++) {
+            const Location *loc = &locs->items[l];
+            t0 = now_ms();
+            ephem_grid_horizontal(g, loc->lat, loc->lon, az, alt);
+            *compute_ms += now_ms() - t0;
+            char fields[96];
+            int flen = snprintf(fields, sizeof(fields), ",%.4f,%.4f,%s,", loc->lat, loc->lon,
+                                ephem_body_name(b));
+            for (size_t i = 0; i < n; i++) {
+                char row[160], *p = row;
+                memcpy(p, stamps[i], (size_t)stamp_len[i]);
+                p += stamp_len[i];
+                memcpy(p, fields, (size_t)flen);
+                p = put_fixed3(p + flen, az[i]);
+                *p++ = ',';
+                p = put_fixed3(p, alt[i]);
+                *p++ = '\n';
+                fwrite(row, 1, (size_t)(p - row), out);
+            }
+        }
+        ephem_grid_free(g);
+    }
+    free(buf);
+    free(stamps);
+    free(stamp_len);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    time_t now = time(NULL);
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    int year = utc.tm_year + 1900, step = 60, body = ephem_body("Sun");
+    const char *outpath = NULL;
+    LocationList locs = { 0 };
+    int first = 1;
+
+    while (first < argc && argv[first][0] == '-' && argv[first][1] != '\0') {
+        if (strcmp(argv[first], "-y") == 0 && first + 1 < argc) {
+            year = atoi(argv[first + 1]);
+            first += 2;
+        } else if (strcmp(argv[first], "-f") == 0 && first + 1 < argc) {
+            if (read_locations(argv[first + 1], &locs) < 0)
+                return 1;
+            first += 2;
+        } else if (strcmp(argv[first], "-o") == 0 && first + 1 < argc) {
+            outpath = argv[first + 1];
+            first += 2;
+        } else if (strcmp(argv[first], "-s") == 0 && first + 1 < argc) {
+            step = atoi(argv[first + 1]);
+            first += 2;
+        } else if (strcmp(argv[first], "-b") == 0 && first + 1 < argc) {
+            body = strcmp(argv[first + 1], "all") == 0 ? -1 : ephem_body(argv[first + 1]);
+            if (body < 0 && strcmp(argv[first + 1], "all") != 0) {
+                fprintf(stderr, "ephem: unknown body '%s'\n", argv[first + 1]);
+                return 1;
+            }
+            first += 2;
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[first], "-help") == 0 ? 0 : 1;
+        }
+    }
+    if (first >= argc || (strcmp(argv[first], "events") != 0 && strcmp(argv[first], "positions") != 0) ||
+        (argc - first - 1) % 2 != 0 || year < 1000 || year > 3000 || step < 1) {
+        print_usage(argv[0]);
+        free(locs.items);
+        return 1;
+    }
+    int events = strcmp(argv[first], "events") == 0;
+    for (int i = first + 1; i + 1 < argc; i += 2) {
+        if (add_location(&locs, atof(argv[i]), atof(argv[i + 1])) < 0) {
+            free(locs.items);
+            return 1;
+        }
+    }
+    if (locs.count == 0) {
+        const char *lat = getenv("LATITUDE"), *lon = getenv("LONGITUDE");
+        if (!lat || !lon) {
+            fprintf(stderr, "ephem: no locations (give lat lon, -f file, or set LATITUDE and LONGITUDE)\n");
+            return 1;
+        }
+        if (add_location(&locs, atof(lat), atof(lon)) < 0)
+            return 1;
+    }
+
+    FILE *out = stdout;
+    if (outpath) {
+        out = fopen(outpath, "w");
+        if (!out) {
+            fprintf(stderr, "ephem: cannot create '%s': %s\n", outpath, strerror(errno));
+            free(locs.items);
+            return 1;
+        }
+    }
+    setvbuf(out, NULL, _IOFBF, 1 << 16);
+
+    double start = now_ms(), compute_ms = 0;
+    int rc = events ? export_events(out, &locs, year, &compute_ms)
+                    : export_positions(out, &locs, year, step, body, &compute_ms);
+    if (fflush(out) != 0 || ferror(out)) {
+        fprintf(stderr, "ephem: write error: %s\n", strerror(errno));
+        rc = -1;
+    }
+    if (out != stdout)
+        fclose(out);
+    if (rc == 0) {
+        double total = now_ms() - start;
+        fprintf(stderr, "ephem: %s for %zu location%s in %d: computed in %.1f ms, written in %.1f ms\n",
+                events ? "events" : "positions", locs.count, locs.count == 1 ? "" : "s", year,
+                compute_ms, total - compute_ms);
+    }
+    free(locs.items);
+    return rc == 0 ? 0 : 1;
+}
@@ -36,14 +36,19 @@ int main(int argc, char *argv[]) {
     printf("  drives   : Lists all found drives.\n");
     printf("  edit     : Opens a basic file editor: edit <filename>.\n");
     printf("             Supported languages: C/C++, Markup\n");
+    printf("  each     : Run a command for every matching file on all cores,\n");
+    printf("             e.g. 'each -j 4 *.csv crc32' or 'each *.csv csvstat {}'\n");
+    printf("  ephem    : Export a year of sun/moon rise and set times or sky positions\n");
+    printf("             for many locations as CSV, e.g. 'ephem -f places.csv events'\n");
     printf("  find     : Find anything.\n");
     printf("  git      : Git helper, type git -help.\n");
     printf("  inet     : Interactive internet connection manager.\n");
+    printf("  jobs     : List background jobs. End any command with '&' to start one.\n");
     printf("  list     : List contents of a directory (type 'list -help').\n");
     printf("  makedir  : Create a new directory.\n");
     printf("  move     : Moves anything. Can be used for renaming as well.\n");
 	printf("  mute     : Enable/Disable Voice Assistant.\n");
-    printf("  pack     : Pack anything, e.g. 'pack myfolder myfolder.zip'\n");
+    printf("  pack     : Pack anything on all cores, e.g. 'pack myfolder myfolder.bpk'\n");
     printf("  remove   : Remove anything, whether it is a file or folder.\n");
     printf("  restart  : A command to re-compile and restart BUDOSTACK. Use with caution!\n");
     printf("             Use 'restart -f' to clean before building.\n");
@@ -54,16 +59,21 @@ int main(int argc, char *argv[]) {
     printf("  stats    : Displays basic hardware stats.\n");
     printf("  time     : Display time now in different time-zones. 'time -s' for astro\n"); 
     printf("             events.\n");
-    printf("  unpack   : Unpack what has been packed, e.g. 'unpack myfolder.zip'\n");
+    printf("  unpack   : Unpack what has been packed, e.g. 'unpack myfolder.bpk'\n");
     printf("  update   : Create an empty file or update its modification time.\n");
+    printf("  wait     : Wait for background jobs to finish, e.g. 'wait' or 'wait 2'.\n");
     printf("  exit     : Exit BUDOSTACK.\n");
     printf("\n");    
     printf("/* Engineering and Science */\n");
     printf("\n");
     printf("  cmath    : Math interpreter that has interactive mode and macro execution.\n");
     printf("             To run existing macro, type 'cmath mymacro.m'.\n");
+    printf("             'cmath -b mymacro.m' compiles it first for loops and vectors.\n");
+	printf("  csvbcol  : Build a binary column cache of a .csv file for faster csv tools.\n");
 	printf("  csvclean : Basic .csv data cleaning method, type 'csvclean -help'.\n");
+	printf("  csvjoin  : Join two .csv files of any size on a key column.\n");
 	printf("  csvplot  : ASCII x-y plotter for .csv files.\n");
+	printf("  csvsort  : Sort, merge and dedupe .csv files larger than memory.\n");
 	printf("  csvstat  : Calculate statistics from .csv file columns.\n");
 	printf("  signal   : Signal generator. Type 'signal' for help.\n");
     printf("  skydial  : Simple sky-dial to identify and locate celestial objects.\n");
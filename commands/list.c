@@ -9,6 +9,7 @@
 #include <time.h>
 #include <errno.h>
 #include <fnmatch.h>
+#include <signal.h>
 
 // Global base path used in filter and comparator
 static const char *base_path;
@@ -30,6 +31,15 @@ static char **matches = NULL;
 static size_t matches_count = 0;
 static size_t matches_capacity = 0;
 
+// Set by CTRL+C during a recursive search; the shell may run this command
+// in-process with SIGINT ignored, so the search installs its own handler
+static volatile sig_atomic_t interrupted = 0;
+
+static void on_interrupt(int sig) {
+    (void)sig;
+    interrupted = 1;
+}
+
 // Convert file mode to a permission string (similar to ls -l output)
 void mode_to_string(mode_t mode, char *str) {
     str[0] = S_ISDIR(mode) ? 'd' : (S_ISLNK(mode) ? 'l' : '-');
@@ -121,30 +131,38 @@ void list_directory(const char *dir_path) {
     printf("\n");
 }
 
-// Add a matching path to the dynamic array
-void add_match(const char *path) {
+// Add a matching path to the dynamic array; returns -1 when out of memory
+int add_match(const char *path) {
     if (matches_count == matches_capacity) {
         size_t new_cap = matches_capacity ? matches_capacity * 2 : 64;
         char **tmp = realloc(matches, new_cap * sizeof(char*));
         if (!tmp) {
             perror("list: memory allocation failed");
-            exit(EXIT_FAILURE);
+            return -1;
         }
         matches = tmp;
         matches_capacity = new_cap;
     }
-    matches[matches_count++] = strdup(path);
+    char *copy = strdup(path);
+    if (!copy) {
+        perror("list: memory allocation failed");
+        return -1;
+    }
+    matches[matches_count++] = copy;
+    return 0;
 }
 
-// Recursively collect all entries matching the pattern
-void recursive_collect(const char *dir_path, const char *pattern) {
+// Recursively collect all entries matching the pattern; returns -1 when the
+// search has to stop (out of memory or interrupted)
+int recursive_collect(const char *dir_path, const char *pattern) {
     DIR *dp = opendir(dir_path);
     if (!dp) {
         fprintf(stderr, "list: cannot access directory '%s': %s\n", dir_path, strerror(errno));
-        return;
+        return 0;
     }
+    int ret = 0;
     struct dirent *entry;
-    while ((entry = readdir(dp)) != NULL) {
+    while (ret == 0 && !interrupted && (entry = readdir(dp)) != NULL) {
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
             continue;
         char fullpath[1024];
@@ -164,16 +182,17 @@ void recursive_collect(const char *dir_path, const char *pattern) {
                     }
                 }
                 if (!excluded)
-                    add_match(fullpath);
+                    ret = add_match(fullpath);
             } else {
-                add_match(fullpath);
+                ret = add_match(fullpath);
             }
         }
-        if (S_ISDIR(st.st_mode)) {
-            recursive_collect(fullpath, pattern);
+        if (ret == 0 && S_ISDIR(st.st_mode)) {
+            ret = recursive_collect(fullpath, pattern);
         }
     }
     closedir(dp);
+    return interrupted ? -1 : ret;
 }
 
 // Compare two strings for qsort
@@ -184,13 +203,31 @@ int cmp_str(const void *a, const void *b) {
 }
 
 // List files matching pattern recursively in alphabetical order
-void list_recursive_search(const char *pattern) {
+int list_recursive_search(const char *pattern) {
     free(matches);
     matches = NULL;
     matches_count = 0;
     matches_capacity = 0;
 
-    recursive_collect(".", pattern);
+    struct sigaction sa, old;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_interrupt;
+    sigemptyset(&sa.sa_mask);
+    interrupted = 0;
+    sigaction(SIGINT, &sa, &old);
+    int ret = recursive_collect(".", pattern);
+    sigaction(SIGINT, &old, NULL);
+
+    if (ret != 0) {
+        if (interrupted)
+            fprintf(stderr, "list: search interrupted\n");
+        for (size_t i = 0; i < matches_count; i++)
+            free(matches[i]);
+        free(matches);
+        matches = NULL;
+        matches_count = matches_capacity = 0;
+        return -1;
+    }
 
     qsort(matches, matches_count, sizeof(char*), cmp_str);
 
@@ -206,6 +243,7 @@ void list_recursive_search(const char *pattern) {
     matches = NULL;
     matches_count = matches_capacity = 0;
     printf("\n");
+    return 0;
 }
 
 // Help message
@@ -223,6 +261,8 @@ void print_help() {
 }
 
 int main(int argc, char *argv[]) {
+    // The shell may run this more than once in-process (see commandparser.c)
+    show_all = 0;
     if (argc == 1) {
         list_directory(".");
         return EXIT_SUCCESS;
@@ -294,6 +334,7 @@ int main(int argc, char *argv[]) {
     }
     free(dir_paths);
 
+    int status = EXIT_SUCCESS;
     for (int i = 0; i < search_count; i++) {
         char pattern[1024];
         if (!strchr(search_patterns[i], '*') && !strchr(search_patterns[i], '?') && !strchr(search_patterns[i], '[')) {
@@ -301,10 +342,11 @@ int main(int argc, char *argv[]) {
         } else {
             snprintf(pattern, sizeof(pattern), "%s", search_patterns[i]);
         }
-        list_recursive_search(pattern);
+        if (status == EXIT_SUCCESS && list_recursive_search(pattern) != 0)
+            status = EXIT_FAILURE;
         free(search_patterns[i]);
     }
     free(search_patterns);
 
-    return EXIT_SUCCESS;
+    return status;
 }
@@ -1,42 +1,157 @@
-/* 
- * pack.c - Packs a file or folder into a zip archive.
- * 
+/*
+ * pack.c - Packs files and folders into a BUDOSTACK archive.
+ *
  * Design:
- * - Uses the standard library only.
- * - Checks command-line arguments: if incorrect or "-help" is provided, prints usage info.
- * - Builds a command string to invoke "zip -r <destination> <source>".
- * - Calls system() to execute the command.
- * - Uses plain C (C11, no extra headers) and no additional libraries.
+ * - The archive engine lives in lib/libpack.c: files are cut into 1 MiB blocks
+ *   that worker threads compress in parallel, and an index at the end of the
+ *   archive makes it seekable (see unpack).
+ * - Progress is shown on a terminal; a throughput report is printed at the end.
+ * - A destination ending in ".zip" is still handed to the zip tool, without a
+ *   shell and without a fixed-size command buffer.
  *
- * Compile with: gcc -std=c11 -o pack pack.c
+ * Usage: pack [-t threads] [-q] <source> [source ...] <destination>
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* Extern declarations from lib/libpack.c */
+typedef void (*PackProgress)(uint64_t done, uint64_t total, void *ctx);
+extern int pack_create(const char *archive, char *const paths[], int npaths, int threads,
+                       PackProgress progress, void *ctx, uint64_t *files,
+                       uint64_t *raw_bytes, uint64_t *packed_bytes, char *err, size_t errlen);
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static const char *human_size(uint64_t bytes, char *buf, size_t len) {
+    static const char *units[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+    double v = (double)bytes;
+    int u = 0;
+    while (v >= 1024.0 && u < 4) {
+        v /= 1024.0;
+        u++;
+    }
+    snprintf(buf, len, u ? "%.1f %s" : "%.0f %s", v, units[u]);
+    return buf;
+}
+
+/* Progress line, redrawn at most five times a second */
+static void show_progress(uint64_t done, uint64_t total, void *ctx) {
+    double *last = ctx;
+    double t = now_seconds();
+    if (done < total && t - *last < 0.2)
+        return;
+    *last = t;
+    char a[32], b[32];
+    fprintf(stderr, "\rpack: %s / %s (%3.0f%%)  ", human_size(done, a, sizeof(a)),
+            human_size(total, b, sizeof(b)), total ? 100.0 * (double)done / (double)total : 100.0);
+    fflush(stderr);
+}
+
+/* zip archives keep using the zip tool */
+static int run_zip(int nsources, char *sources[], const char *dest) {
+    char **args = malloc((size_t)(nsources + 4) * sizeof(char *));
+    if (!args) {
+        perror("malloc");
+        return 1;
+    }
+    int n = 0;
+    args[n++] = "zip";
+    args[n++] = "-r";
+    args[n++] = (char *)dest;
+    for (int i = 0; i < nsources; i++)
+        args[n++] = sources[i];
+    args[n] = NULL;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp("zip", args);
+        perror("zip");
+        _exit(127);
+    }
+    free(args);
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0) {
+        perror("pack");
+        return 1;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Error: zip command failed\n");
+        return 1;
+    }
+    return 0;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [-t threads] [-q] <source> [source ...] <destination>\n", prog);
+    printf("Packs files and directories into a BUDOSTACK archive (e.g. data.bpk),\n");
+    printf("compressing 1 MiB blocks on all CPUs. Unpack it with 'unpack'.\n");
+    printf("  -t threads  Compression threads (default: all CPUs).\n");
+    printf("  -q          No progress or report.\n");
+    printf("A destination ending in .zip is created with the zip tool instead.\n");
+}
 
 int main(int argc, char *argv[]) {
-    // Check for help or invalid number of arguments
-    if (argc != 3 || strcmp(argv[1], "-help") == 0 || strcmp(argv[2], "-help") == 0) {
-        printf("Usage: %s <source_file_or_directory> <destination_zip>\n", argv[0]);
-        printf("Packs the specified file or directory into a zip archive.\n");
+    int threads = 0, quiet = 0, first = 1;
+    while (first < argc && argv[first][0] == '-' && argv[first][1] != '\0') {
+        if (strcmp(argv[first], "-t") == 0 && first + 1 < argc) {
+            threads = atoi(argv[first + 1]);
+            first += 2;
+        } else if (strcmp(argv[first], "-q") == 0) {
+            quiet = 1;
+            first++;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    int nsources = argc - first - 1;
+    if (nsources < 1) {
+        print_usage(argv[0]);
         return 1;
     }
-    
-    // Prepare the command string to pack using zip
-    char command[1024];
-    int n = snprintf(command, sizeof(command), "zip -r \"%s\" \"%s\"", argv[2], argv[1]);
-    if (n < 0 || (size_t)n >= sizeof(command)) {
-        fprintf(stderr, "Error: command buffer overflow\n");
+    char **sources = argv + first;
+    const char *dest = argv[argc - 1];
+
+    size_t dlen = strlen(dest);
+    if (dlen > 4 && strcmp(dest + dlen - 4, ".zip") == 0)
+        return run_zip(nsources, sources, dest);
+
+    double last = 0.0;
+    int show = !quiet && isatty(STDERR_FILENO);
+    double start = now_seconds();
+    uint64_t files = 0, raw = 0, packed = 0;
+    char err[512];
+    int rc = pack_create(dest, sources, nsources, threads, show ? show_progress : NULL, &last,
+                         &files, &raw, &packed, err, sizeof(err));
+    if (show)
+        fprintf(stderr, "\r\033[K");
+    if (rc != 0) {
+        fprintf(stderr, "pack: %s\n", err);
         return 1;
     }
-    
-    // Execute the command
-    int ret = system(command);
-    if (ret != 0) {
-        fprintf(stderr, "Error: zip command failed with code %d\n", ret);
-        return ret;
+
+    if (!quiet) {
+        double secs = now_seconds() - start;
+        if (threads <= 0) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            threads = cpus > 0 ? (int)cpus : 1;
+        }
+        char a[32], b[32], c[32];
+        printf("Packed %llu files into %s: %s -> %s (%.1f%%) in %.2f s, %s/s, %d threads\n",
+               (unsigned long long)files, dest, human_size(raw, a, sizeof(a)),
+               human_size(packed, b, sizeof(b)), raw ? 100.0 * (double)packed / (double)raw : 100.0,
+               secs, human_size((uint64_t)(secs > 0 ? (double)raw / secs : 0), c, sizeof(c)), threads);
     }
-    
     return 0;
 }
@@ -5,10 +5,6 @@
 #include <string.h>
 #include <math.h>
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846  /* Define M_PI if not defined */
-#endif
-
 // Determine if a given year is a leap year.
 int is_leap(int year) {
     // A year is a leap year if it is divisible by 400 or if it is divisible by 4 and not by 100.
@@ -24,102 +20,52 @@ struct Timezone {
 
 // ---------- Astronomical events functions ----------
 
-// Calculate the Julian Ephemeris Date (JDE) for a given event and year.
-// event: 0 = March Equinox, 1 = June Solstice, 2 = September Equinox, 3 = December Solstice.
-double calc_event_jde(int event, int year) {
-    double T = (year - 2000) / 1000.0;
-    double T2 = T * T;
-    double T3 = T2 * T;
-    double T4 = T3 * T;
-    double JDE;
-    switch (event) {
-        case 0: // March Equinox
-            JDE = 2451623.80984 + 365242.37404 * T + 0.05169 * T2 - 0.00411 * T3 - 0.00057 * T4;
-            break;
-        case 1: // June Solstice
-            JDE = 2451716.56767 + 365241.62603 * T + 0.00325 * T2 + 0.00888 * T3 - 0.00030 * T4;
-            break;
-        case 2: // September Equinox
-            JDE = 2451810.21715 + 365242.01767 * T - 0.11575 * T2 + 0.00337 * T3 + 0.00078 * T4;
-            break;
-        case 3: // December Solstice
-            JDE = 2451900.05952 + 365242.74049 * T - 0.06223 * T2 - 0.00823 * T3 + 0.00032 * T4;
-            break;
-        default:
-            JDE = 0;
-    }
-    return JDE;
-}
+// Shared ephemeris (lib/libephem.c).
+typedef struct EphemDays EphemDays;
+extern double ephem_season_jde(int event, int year);
+extern double ephem_jd_from_unix(double t);
+extern double ephem_unix_from_jd(double jd);
+extern EphemDays *ephem_days(double jd0, size_t ndays);
+extern void ephem_days_free(EphemDays *days);
+extern void ephem_sun_events(const EphemDays *days, double lat, double lon, double *rise, double *set);
 
 // Convert a Julian Ephemeris Date to Unix time (seconds since 1970-01-01 00:00:00 UTC).
 time_t event_time_from_jde(double jde) {
-    double seconds = (jde - 2440587.5) * 86400.0;
-    return (time_t)(seconds + 0.5);  // Round to nearest second.
+    return (time_t)(ephem_unix_from_jd(jde) + 0.5);  // Round to nearest second.
 }
 
 // For a given event and year, compute the Unix time of the event.
 // If the event time for the given year has passed (relative to now), compute it for next year.
 time_t get_astronomical_event(int event, int year, time_t now) {
-    time_t etime = event_time_from_jde(calc_event_jde(event, year));
+    time_t etime = event_time_from_jde(ephem_season_jde(event, year));
     if (difftime(etime, now) <= 0) {
-        etime = event_time_from_jde(calc_event_jde(event, year + 1));
+        etime = event_time_from_jde(ephem_season_jde(event, year + 1));
     }
     return etime;
 }
 
-// Compute the local time zone offset (in hours) from UTC.
-double get_tz_offset(time_t now) {
-    struct tm local_tm, gm_tm;
-    localtime_r(&now, &local_tm);
-    gmtime_r(&now, &gm_tm);
-    time_t local_sec = mktime(&local_tm);
-    time_t gm_sec = mktime(&gm_tm);
-    return difftime(local_sec, gm_sec) / 3600.0;
-}
-
-// Compute sunrise or sunset (is_sunrise nonzero for sunrise, zero for sunset)
-// using a simple solar calculation. This function uses the current date provided
-// in the 'base_date' struct and adjusts to the next occurrence if the event has passed.
-time_t compute_sun_event(struct tm base_date, double lat, double lon, double tz_offset, int is_sunrise) {
-    struct tm date = base_date;
-    time_t event_time;
-    while (1) {
-        int N = date.tm_yday + 1;  // Day of year (1 to 366)
-        // Calculate solar declination (in degrees) using an approximate formula.
-        double decl_deg = 23.45 * sin(2 * M_PI * (284 + N) / 365.0);
-        double decl = decl_deg * M_PI / 180.0;
-        double lat_rad = lat * M_PI / 180.0;
-        // Zenith angle for sunrise/sunset (includes atmospheric refraction)
-        double zenith = 90.833 * M_PI / 180.0;
-        // Use the standard sunrise/sunset formula.
-        double cos_ha = (cos(zenith) - sin(lat_rad) * sin(decl)) / (cos(lat_rad) * cos(decl));
-        if (cos_ha > 1 || cos_ha < -1) {
-            // No sunrise or sunset occurs on this day at this location.
-            event_time = (time_t)-1;
-            break;
-        }
-        double ha = acos(cos_ha);  // Hour angle in radians.
-        // Convert hour angle to time in hours.
-        double ha_hours = (ha * 180.0 / M_PI) / 15.0;
-        // Approximate solar noon (in local time, in hours). Assumes user is near the center of the time zone.
-        double solar_noon = 12.0 - (lon / 15.0) + tz_offset;
-        double event_hour;
-        if (is_sunrise)
-            event_hour = solar_noon - ha_hours;
-        else
-            event_hour = solar_noon + ha_hours;
-        // Set the calculated hour (and minutes) into the date structure.
-        date.tm_hour = (int)event_hour;
-        date.tm_min = (int)((event_hour - date.tm_hour) * 60);
-        date.tm_sec = 0;
-        event_time = mktime(&date);
-        if (event_time > time(NULL))
-            break;
-        // If the event has already passed, try the next day.
-        date.tm_mday += 1;
-        mktime(&date);  // Normalize the date.
+// Compute the next sunrise or sunset (is_sunrise nonzero for sunrise, zero for
+// sunset) after 'now'. Searches the local days from yesterday to two days ahead;
+// returns -1 when the sun neither rises nor sets in that window (polar day or night).
+time_t compute_sun_event(time_t now, double lat, double lon, int is_sunrise) {
+    enum { SEARCH_DAYS = 4 };
+    double jd0 = floor(ephem_jd_from_unix((double)now) - 0.5) + 0.5 - 1.0;  // 0h UT yesterday
+    EphemDays *days = ephem_days(jd0, SEARCH_DAYS);
+    if (!days)
+        return (time_t)-1;
+    double rise[SEARCH_DAYS], set[SEARCH_DAYS];
+    ephem_sun_events(days, lat, lon, rise, set);
+    ephem_days_free(days);
+
+    const double *events = is_sunrise ? rise : set;
+    for (int k = 0; k < SEARCH_DAYS; k++) {
+        if (isnan(events[k]))
+            continue;
+        time_t t = (time_t)(ephem_unix_from_jd(events[k]) + 0.5);
+        if (t > now)
+            return t;
     }
-    return event_time;
+    return (time_t)-1;
 }
 
 // Format a time difference (in seconds) into a string "X days, HH:MM:SS".
@@ -138,9 +84,6 @@ void display_astronomy(void) {
     localtime_r(&now, &local_tm);
     char time_str[100];
 
-    // Obtain the local time zone offset.
-    double tz_offset = get_tz_offset(now);
-
     printf("Astronomical Events:\n\n");
 
     // Compute and display equinoxes and solstices.
@@ -164,8 +107,8 @@ void display_astronomy(void) {
     if (lat_env && lon_env) {
         double lat = atof(lat_env);
         double lon = atof(lon_env);
-        time_t sunrise = compute_sun_event(local_tm, lat, lon, tz_offset, 1);
-        time_t sunset = compute_sun_event(local_tm, lat, lon, tz_offset, 0);
+        time_t sunrise = compute_sun_event(now, lat, lon, 1);
+        time_t sunset = compute_sun_event(now, lat, lon, 0);
         if (sunrise != (time_t)-1) {
             struct tm sr_local;
             localtime_r(&sunrise, &sr_local);
@@ -175,7 +118,7 @@ void display_astronomy(void) {
             format_time_diff(diff, diff_str, sizeof(diff_str));
             printf("%-20s at %s (in %s)\n", "Sunrise", time_str, diff_str);
         } else {
-            printf("Sunrise: no sunrise on this day at this location\n");
+            printf("Sunrise: no sunrise in the coming days at this location\n");
         }
         if (sunset != (time_t)-1) {
             struct tm ss_local;
@@ -186,7 +129,7 @@ void display_astronomy(void) {
             format_time_diff(diff, diff_str, sizeof(diff_str));
             printf("%-20s at %s (in %s)\n", "Sunset", time_str, diff_str);
         } else {
-            printf("Sunset: no sunset on this day at this location\n");
+            printf("Sunset: no sunset in the coming days at this location\n");
         }
     } else {
         printf("\nLocation not provided (set LATITUDE and LONGITUDE env variables)\n");
@@ -265,10 +208,10 @@ int main(int argc, char *argv[]) {
 
     // Iterate through each time zone and display its regional time.
     for (int i = 0; i < numZones; i++) {
-        // Set the TZ environment variable to the zone's TZ string.
-        setenv("TZ", zones[i].tzString, 1);
-        tzset();
-        localtime_r(&now, &tm_city);
+        // Standard time is a fixed offset from UTC, so shift and format as UTC.
+        // (TZ is left alone: the shell may run this command in-process.)
+        time_t zone_time = now + (time_t)zones[i].offset * 3600;
+        gmtime_r(&zone_time, &tm_city);
         strftime(time_str, sizeof(time_str), "%d-%m-%Y %H:%M:%S", &tm_city);
 
         // Build the label in the format: "UTC±offset - cities".
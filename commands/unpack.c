@@ -1,42 +1,176 @@
-/* 
- * unpack.c - Unpacks a zip archive to the current directory.
- * 
+/*
+ * unpack.c - Unpacks a BUDOSTACK archive (or a zip archive) to the current directory.
+ *
  * Design:
- * - Uses the standard library only.
- * - Validates command-line arguments and prints usage instructions if incorrect or "-help" is given.
- * - Constructs a command string to invoke "unzip <zip_file>".
- * - Uses system() to call the unzip command.
- * - Compiled as plain C (C11, no additional libraries).
+ * - The archive engine lives in lib/libpack.c: worker threads read, check and
+ *   decompress blocks in parallel and write them straight into place.
+ * - The archive index is read first, so single files or folders can be
+ *   extracted without touching the rest of the archive, and "-l" lists it.
+ * - Progress is shown on a terminal; a throughput report is printed at the end.
+ * - zip archives are still handed to the unzip tool, without a shell.
  *
- * Compile with: gcc -std=c11 -o unpack unpack.c
+ * Usage: unpack [-t threads] [-d dir] [-l] [-q] <archive> [path ...]
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* Extern declarations from lib/libpack.c */
+typedef void (*PackProgress)(uint64_t done, uint64_t total, void *ctx);
+extern int pack_is_archive(const char *path);
+extern int pack_list(const char *archive, FILE *out, char *err, size_t errlen);
+extern int pack_extract(const char *archive, const char *destdir, char *const select[], int nselect,
+                        int threads, PackProgress progress, void *ctx, uint64_t *files,
+                        uint64_t *raw_bytes, char *err, size_t errlen);
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static const char *human_size(uint64_t bytes, char *buf, size_t len) {
+    static const char *units[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+    double v = (double)bytes;
+    int u = 0;
+    while (v >= 1024.0 && u < 4) {
+        v /= 1024.0;
+        u++;
+    }
+    snprintf(buf, len, u ? "%.1f %s" : "%.0f %s", v, units[u]);
+    return buf;
+}
+
+/* Progress line, redrawn at most five times a second */
+static void show_progress(uint64_t done, uint64_t total, void *ctx) {
+    double *last = ctx;
+    double t = now_seconds();
+    if (done < total && t - *last < 0.2)
+        return;
+    *last = t;
+    char a[32], b[32];
+    fprintf(stderr, "\runpack: %s / %s (%3.0f%%)  ", human_size(done, a, sizeof(a)),
+            human_size(total, b, sizeof(b)), total ? 100.0 * (double)done / (double)total : 100.0);
+    fflush(stderr);
+}
+
+static int is_zip(const char *path) {
+    unsigned char magic[4];
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    int ok = read(fd, magic, sizeof(magic)) == (ssize_t)sizeof(magic) &&
+             memcmp(magic, "PK\003\004", sizeof(magic)) == 0;
+    close(fd);
+    return ok;
+}
+
+/* zip archives keep using the unzip tool */
+static int run_unzip(const char *archive, const char *destdir) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (destdir)
+            execlp("unzip", "unzip", archive, "-d", destdir, (char *)NULL);
+        else
+            execlp("unzip", "unzip", archive, (char *)NULL);
+        perror("unzip");
+        _exit(127);
+    }
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0) {
+        perror("unpack");
+        return 1;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Error: unzip command failed\n");
+        return 1;
+    }
+    return 0;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [-t threads] [-d dir] [-l] [-q] <archive> [path ...]\n", prog);
+    printf("Unpacks an archive made by 'pack' to the current directory, decompressing\n");
+    printf("on all CPUs. Given paths, only those files or folders are extracted.\n");
+    printf("  -t threads  Decompression threads (default: all CPUs).\n");
+    printf("  -d dir      Extract below dir instead.\n");
+    printf("  -l          List the archive instead of extracting it.\n");
+    printf("  -q          No progress or report.\n");
+    printf("zip archives are unpacked with the unzip tool.\n");
+}
 
 int main(int argc, char *argv[]) {
-    // Check for help or invalid number of arguments
-    if (argc != 2 || strcmp(argv[1], "-help") == 0) {
-        printf("Usage: %s <zip_file>\n", argv[0]);
-        printf("Unpacks the specified zip archive to the current directory.\n");
+    int threads = 0, quiet = 0, list = 0, first = 1;
+    const char *destdir = NULL;
+    while (first < argc && argv[first][0] == '-' && argv[first][1] != '\0') {
+        if ((strcmp(argv[first], "-t") == 0 || strcmp(argv[first], "-d") == 0) && first + 1 < argc) {
+            if (argv[first][1] == 't')
+                threads = atoi(argv[first + 1]);
+            else
+                destdir = argv[first + 1];
+            first += 2;
+        } else if (strcmp(argv[first], "-l") == 0) {
+            list = 1;
+            first++;
+        } else if (strcmp(argv[first], "-q") == 0) {
+            quiet = 1;
+            first++;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (first >= argc) {
+        print_usage(argv[0]);
         return 1;
     }
-    
-    // Prepare the command string to unpack using unzip
-    char command[1024];
-    int n = snprintf(command, sizeof(command), "unzip \"%s\"", argv[1]);
-    if (n < 0 || (size_t)n >= sizeof(command)) {
-        fprintf(stderr, "Error: command buffer overflow\n");
+    const char *archive = argv[first];
+    char err[512];
+
+    if (!pack_is_archive(archive)) {
+        if (is_zip(archive) && !list)
+            return run_unzip(archive, destdir);
+        fprintf(stderr, "unpack: %s: not a BUDOSTACK archive\n", archive);
         return 1;
     }
-    
-    // Execute the command
-    int ret = system(command);
-    if (ret != 0) {
-        fprintf(stderr, "Error: unzip command failed with code %d\n", ret);
-        return ret;
+    if (list) {
+        if (pack_list(archive, stdout, err, sizeof(err)) != 0) {
+            fprintf(stderr, "unpack: %s\n", err);
+            return 1;
+        }
+        return 0;
+    }
+
+    double last = 0.0;
+    int show = !quiet && isatty(STDERR_FILENO);
+    double start = now_seconds();
+    uint64_t files = 0, raw = 0;
+    int rc = pack_extract(archive, destdir, argv + first + 1, argc - first - 1, threads,
+                          show ? show_progress : NULL, &last, &files, &raw, err, sizeof(err));
+    if (show)
+        fprintf(stderr, "\r\033[K");
+    if (rc != 0) {
+        fprintf(stderr, "unpack: %s\n", err);
+        return 1;
+    }
+
+    if (!quiet) {
+        double secs = now_seconds() - start;
+        if (threads <= 0) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            threads = cpus > 0 ? (int)cpus : 1;
+        }
+        char a[32], c[32];
+        printf("Unpacked %llu files (%s) in %.2f s, %s/s, %d threads\n",
+               (unsigned long long)files, human_size(raw, a, sizeof(a)), secs,
+               human_size((uint64_t)(secs > 0 ? (double)raw / secs : 0), c, sizeof(c)), threads);
     }
-    
     return 0;
 }
@@ -0,0 +1,464 @@
+#define _POSIX_C_SOURCE 200809L
+/*
+ * libbcol.c
+ *
+ * Binary columnar sidecar ("data.csv.bcol") for the CSV tools.
+ *
+ * Design principles:
+ *  - bcol_build() parses a CSV file once and writes a typed, columnar image next to
+ *    it. bcol_open() maps the image read-only and only succeeds while it is fresh:
+ *    the size and modification time recorded at build time must match the CSV.
+ *  - The CSV model is the one shared by csvclean, csvfilter and csvstat: lines split
+ *    at '\n' with CR stripped, blank lines skipped, fields split at every ',' and
+ *    trimmed. The first line is a header if any of its fields is not a number; the
+ *    number of fields in the first line fixes the column count.
+ *  - Every line with that many fields is a stored row. Each column holds one double
+ *    per row (NaN where the field is not a number) and is flagged numeric when all
+ *    of its fields parsed. Rows keep their byte offset and length in the CSV so that
+ *    tools can still emit the original text without re-reading the file.
+ *  - Tools use the sidecar transparently when bcol_open() returns non-NULL and fall
+ *    back to their text parser otherwise. The counters of skipped and blank lines
+ *    and the empty/padded-field flags let each tool decide whether the sidecar
+ *    reproduces its own text semantics exactly.
+ *  - The image is built into "<name>.bcol.tmp" and renamed, so readers never see a
+ *    partial file.
+ *
+ * File layout (little-endian host order, all sections 8-byte aligned):
+ *   BcolHeader | names (NUL separated) | column numeric flags uint8[cols] |
+ *   line offsets uint64[rows] | line lengths uint32[rows] | row flags uint8[rows] |
+ *   column data double[cols][rows]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BCOL_MAGIC "BCOL1\n\0\0"
+#define BCOL_SUFFIX ".bcol"
+#define BCOL_MAX_FIELD 256
+
+// Header flags.
+#define BCOL_HAS_HEADER 1u
+#define BCOL_EMPTY_FIELDS 2u    // some field, header line included, is empty
+#define BCOL_PADDED_FIELDS 4u   // some field has leading or trailing whitespace
+
+// Row flags.
+#define BCOL_ROW_NUMERIC 1u
+
+typedef struct {
+    char magic[8];
+    uint64_t csv_size;
+    int64_t csv_mtime_sec;
+    int64_t csv_mtime_nsec;
+    uint64_t rows;          // stored data rows
+    uint64_t skipped;       // non-blank lines with a different field count
+    uint64_t blank;         // blank lines
+    uint32_t cols;
+    uint32_t flags;
+    uint64_t header_offset; // header line in the CSV (when BCOL_HAS_HEADER)
+    uint64_t header_length;
+    uint64_t names_off;
+    uint64_t offsets_off;
+    uint64_t lengths_off;
+    uint64_t rowflags_off;
+    uint64_t data_off;
+    uint64_t numeric_mask_off;  // uint8[cols]: 1 when every field of the column parsed
+    uint64_t file_size;
+} BcolHeader;
+
+typedef struct BcolFile {
+    const unsigned char *map;
+    size_t map_size;
+    const BcolHeader *hdr;
+    const char *csv;        // CSV mapping, for row text
+    size_t csv_size;
+    const char **names;
+} BcolFile;
+
+static uint64_t align8(uint64_t v) {
+    return (v + 7) & ~(uint64_t)7;
+}
+
+// Sidecar path for a CSV file; caller frees.
+static char *sidecar_path(const char *csv_path, const char *extra) {
+    size_t len = strlen(csv_path) + strlen(BCOL_SUFFIX) + strlen(extra) + 1;
+    char *p = malloc(len);
+    if (p)
+        snprintf(p, len, "%s%s%s", csv_path, BCOL_SUFFIX, extra);
+    return p;
+}
+
+// Maps a whole file read-only. Empty files map to a dummy non-NULL pointer.
+static const void *map_file(const char *path, size_t *size, struct stat *st_out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    if (st_out)
+        *st_out = st;
+    if (*size == 0) {
+        close(fd);
+        return "";
+    }
+    void *m = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED)
+        return NULL;
+    return m;
+}
+
+static void unmap_file(const void *m, size_t size) {
+    if (m && size > 0)
+        munmap((void *)m, size);
+}
+
+// Trimmed field bounds within [s, e).
+static void trim_span(const char **s, const char **e) {
+    while (*s < *e && isspace((unsigned char)**s)) (*s)++;
+    while (*e > *s && isspace((unsigned char)(*e)[-1])) (*e)--;
+}
+
+// Parses a trimmed field as a double; returns 1 when the whole field is a number.
+static int parse_field(const char *s, const char *e, double *out) {
+    trim_span(&s, &e);
+    size_t len = (size_t)(e - s);
+    if (len == 0 || len >= BCOL_MAX_FIELD) {
+        *out = NAN;
+        return 0;
+    }
+    char buf[BCOL_MAX_FIELD];
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+    char *endptr;
+    errno = 0;
+    double v = strtod(buf, &endptr);
+    if (errno || *endptr != '\0') {
+        *out = NAN;
+        return 0;
+    }
+    *out = v;
+    return 1;
+}
+
+// Returns the end of the line starting at p and its length without CR.
+static const char *line_end(const char *p, const char *end, size_t *len) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    const char *e = nl ? nl : end;
+    const char *t = e;
+    while (t > p && t[-1] == '\r') t--;
+    *len = (size_t)(t - p);
+    return nl ? nl + 1 : end;
+}
+
+static size_t count_fields(const char *p, size_t len) {
+    size_t n = 1;
+    for (size_t i = 0; i < len; i++)
+        if (p[i] == ',') n++;
+    return n;
+}
+
+/*
+ * Builds "<csv_path>.bcol". Returns 0 on success, -1 on error (errno set).
+ */
+int bcol_build(const char *csv_path) {
+    size_t csv_size;
+    struct stat st;
+    const char *csv = map_file(csv_path, &csv_size, &st);
+    if (!csv)
+        return -1;
+    const char *end = csv + csv_size;
+
+    // Pass 1: header, column count and row counts.
+    BcolHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BCOL_MAGIC, 8);
+    h.csv_size = (uint64_t)st.st_size;
+    h.csv_mtime_sec = (int64_t)st.st_mtim.tv_sec;
+    h.csv_mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+    size_t names_size = 0;
+    int first = 1;
+    for (const char *p = csv; p < end;) {
+        size_t len;
+        const char *next = line_end(p, end, &len);
+        if (len == 0) {
+            h.blank++;
+            p = next;
+            continue;
+        }
+        size_t nf = count_fields(p, len);
+        if (first) {
+            first = 0;
+            h.cols = (uint32_t)nf;
+            int numeric = 1;
+            const char *f = p;
+            for (size_t i = 0; i <= len; i++) {
+                if (i == len || p[i] == ',') {
+                    double v;
+                    if (!parse_field(f, p + i, &v))
+                        numeric = 0;
+                    const char *ns = f, *ne = p + i;
+                    trim_span(&ns, &ne);
+                    // Tools differ on whether an empty field makes a header, so
+                    // flag it and let those that care use their text parser.
+                    if (ns == ne)
+                        h.flags |= BCOL_EMPTY_FIELDS;
+                    names_size += (size_t)(ne - ns) + 1;
+                    f = p + i + 1;
+                }
+            }
+            if (!numeric) {
+                h.flags |= BCOL_HAS_HEADER;
+                h.header_offset = (uint64_t)(p - csv);
+                h.header_length = len;
+                p = next;
+                continue;
+            }
+            names_size = 0;
+        }
+        if (nf == h.cols)
+            h.rows++;
+        else
+            h.skipped++;
+        p = next;
+    }
+
+    // Layout.
+    uint64_t rows = h.rows, cols = h.cols;
+    h.names_off = align8(sizeof(BcolHeader));
+    h.numeric_mask_off = align8(h.names_off + names_size);
+    h.offsets_off = align8(h.numeric_mask_off + cols);
+    h.lengths_off = align8(h.offsets_off + rows * sizeof(uint64_t));
+    h.rowflags_off = align8(h.lengths_off + rows * sizeof(uint32_t));
+    h.data_off = align8(h.rowflags_off + rows);
+    h.file_size = h.data_off + rows * cols * sizeof(double);
+
+    char *tmp_path = sidecar_path(csv_path, ".tmp");
+    char *final_path = sidecar_path(csv_path, "");
+    if (!tmp_path || !final_path) {
+        free(tmp_path);
+        free(final_path);
+        unmap_file(csv, csv_size);
+        return -1;
+    }
+    int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)h.file_size) != 0) {
+        int err = errno;
+        if (fd >= 0) close(fd);
+        unlink(tmp_path);
+        free(tmp_path);
+        free(final_path);
+        unmap_file(csv, csv_size);
+        errno = err;
+        return -1;
+    }
+    unsigned char *out = mmap(NULL, h.file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (out == MAP_FAILED) {
+        unlink(tmp_path);
+        free(tmp_path);
+        free(final_path);
+        unmap_file(csv, csv_size);
+        return -1;
+    }
+
+    uint8_t *numeric_mask = out + h.numeric_mask_off;
+    uint64_t *offsets = (uint64_t *)(out + h.offsets_off);
+    uint32_t *lengths = (uint32_t *)(out + h.lengths_off);
+    uint8_t *rowflags = out + h.rowflags_off;
+    double *data = (double *)(out + h.data_off);
+    for (uint64_t c = 0; c < cols; c++)
+        numeric_mask[c] = 1;
+
+    // Header names.
+    if (h.flags & BCOL_HAS_HEADER) {
+        const char *p = csv + h.header_offset;
+        char *names = (char *)out + h.names_off;
+        const char *f = p;
+        for (size_t i = 0; i <= h.header_length; i++) {
+            if (i == h.header_length || p[i] == ',') {
+                const char *ns = f, *ne = p + i;
+                trim_span(&ns, &ne);
+                memcpy(names, ns, (size_t)(ne - ns));
+                names += ne - ns;
+                *names++ = '\0';
+                f = p + i + 1;
+            }
+        }
+    }
+
+    // Pass 2: rows.
+    uint64_t r = 0;
+    int header_pending = (h.flags & BCOL_HAS_HEADER) != 0;
+    for (const char *p = csv; p < end;) {
+        size_t len;
+        const char *next = line_end(p, end, &len);
+        if (len == 0) {
+            p = next;
+            continue;
+        }
+        if (header_pending) {
+            header_pending = 0;
+            p = next;
+            continue;
+        }
+        if (count_fields(p, len) != cols) {
+            p = next;
+            continue;
+        }
+        int row_numeric = 1;
+        const char *f = p;
+        uint64_t c = 0;
+        for (size_t i = 0; i <= len; i++) {
+            if (i == len || p[i] == ',') {
+                if (f == p + i)
+                    h.flags |= BCOL_EMPTY_FIELDS;
+                else if (isspace((unsigned char)f[0]) || isspace((unsigned char)p[i - 1]))
+                    h.flags |= BCOL_PADDED_FIELDS;
+                if (!parse_field(f, p + i, &data[c * rows + r])) {
+                    row_numeric = 0;
+                    numeric_mask[c] = 0;
+                }
+                c++;
+                f = p + i + 1;
+            }
+        }
+        offsets[r] = (uint64_t)(p - csv);
+        lengths[r] = (uint32_t)len;
+        rowflags[r] = row_numeric ? BCOL_ROW_NUMERIC : 0;
+        r++;
+        p = next;
+    }
+    memcpy(out, &h, sizeof(h));
+
+    int rc = msync(out, h.file_size, MS_SYNC);
+    munmap(out, h.file_size);
+    unmap_file(csv, csv_size);
+    if (rc == 0)
+        rc = rename(tmp_path, final_path);
+    if (rc != 0)
+        unlink(tmp_path);
+    free(tmp_path);
+    free(final_path);
+    return rc == 0 ? 0 : -1;
+}
+
+void bcol_close(BcolFile *b) {
+    if (!b) return;
+    unmap_file(b->map, b->map_size);
+    unmap_file(b->csv, b->csv_size);
+    free(b->names);
+    free(b);
+}
+
+/*
+ * Opens the sidecar of csv_path. Returns NULL when it is missing, invalid or
+ * stale (the CSV's size or modification time differs from the recorded ones).
+ */
+BcolFile *bcol_open(const char *csv_path) {
+    struct stat csv_st;
+    if (stat(csv_path, &csv_st) != 0)
+        return NULL;
+    char *path = sidecar_path(csv_path, "");
+    if (!path)
+        return NULL;
+    BcolFile *b = calloc(1, sizeof(BcolFile));
+    if (!b) {
+        free(path);
+        return NULL;
+    }
+    b->map = map_file(path, &b->map_size, NULL);
+    free(path);
+    if (!b->map || b->map_size < sizeof(BcolHeader)) {
+        bcol_close(b);
+        return NULL;
+    }
+    const BcolHeader *h = (const BcolHeader *)b->map;
+    b->hdr = h;
+    if (memcmp(h->magic, BCOL_MAGIC, 8) != 0 || h->file_size != b->map_size ||
+        h->csv_size != (uint64_t)csv_st.st_size ||
+        h->csv_mtime_sec != (int64_t)csv_st.st_mtim.tv_sec ||
+        h->csv_mtime_nsec != (int64_t)csv_st.st_mtim.tv_nsec ||
+        h->data_off + h->rows * h->cols * sizeof(double) > b->map_size) {
+        bcol_close(b);
+        return NULL;
+    }
+    b->csv = map_file(csv_path, &b->csv_size, NULL);
+    if (!b->csv || b->csv_size != h->csv_size) {
+        bcol_close(b);
+        return NULL;
+    }
+    b->names = calloc(h->cols ? h->cols : 1, sizeof(char *));
+    if (!b->names) {
+        bcol_close(b);
+        return NULL;
+    }
+    const char *n = (const char *)b->map + h->names_off;
+    for (uint32_t c = 0; c < h->cols; c++) {
+        if (h->flags & BCOL_HAS_HEADER) {
+            b->names[c] = n;
+            n += strlen(n) + 1;
+        } else {
+            b->names[c] = "";
+        }
+    }
+    return b;
+}
+
+size_t bcol_rows(const BcolFile *b) { return (size_t)b->hdr->rows; }
+size_t bcol_cols(const BcolFile *b) { return (size_t)b->hdr->cols; }
+size_t bcol_skipped_lines(const BcolFile *b) { return (size_t)b->hdr->skipped; }
+size_t bcol_blank_lines(const BcolFile *b) { return (size_t)b->hdr->blank; }
+int bcol_has_header(const BcolFile *b) { return (b->hdr->flags & BCOL_HAS_HEADER) != 0; }
+int bcol_has_empty_fields(const BcolFile *b) { return (b->hdr->flags & BCOL_EMPTY_FIELDS) != 0; }
+int bcol_has_padded_fields(const BcolFile *b) { return (b->hdr->flags & BCOL_PADDED_FIELDS) != 0; }
+
+// Trimmed header name of a column ("" without a header).
+const char *bcol_column_name(const BcolFile *b, size_t col) {
+    return col < b->hdr->cols ? b->names[col] : "";
+}
+
+// 1 when every field of the column is a number.
+int bcol_column_numeric(const BcolFile *b, size_t col) {
+    return col < b->hdr->cols && b->map[b->hdr->numeric_mask_off + col];
+}
+
+// Values of a column, one per stored row (NaN where the field is not a number).
+const double *bcol_column(const BcolFile *b, size_t col) {
+    if (col >= b->hdr->cols)
+        return NULL;
+    return (const double *)(b->map + b->hdr->data_off) + col * b->hdr->rows;
+}
+
+// 1 when every field of the row is a number.
+int bcol_row_numeric(const BcolFile *b, size_t row) {
+    return (b->map[b->hdr->rowflags_off + row] & BCOL_ROW_NUMERIC) != 0;
+}
+
+// Original text of a row (without line terminator); not NUL terminated.
+const char *bcol_row_text(const BcolFile *b, size_t row, size_t *len) {
+    const uint64_t *offsets = (const uint64_t *)(b->map + b->hdr->offsets_off);
+    const uint32_t *lengths = (const uint32_t *)(b->map + b->hdr->lengths_off);
+    *len = lengths[row];
+    return b->csv + offsets[row];
+}
+
+// Original text of the header line, or NULL without a header.
+const char *bcol_header_text(const BcolFile *b, size_t *len) {
+    if (!(b->hdr->flags & BCOL_HAS_HEADER))
+        return NULL;
+    *len = (size_t)b->hdr->header_length;
+    return b->csv + b->hdr->header_offset;
+}
@@ -0,0 +1,413 @@
+#define _POSIX_C_SOURCE 200809L
+/*
+ * libephem.c
+ *
+ * Shared ephemeris for the astronomy tools (time -s, skydial, solar, ephem).
+ *
+ * Design principles:
+ *  - One low-accuracy model for everything, the one skydial always used: the Sun
+ *    from its mean anomaly and longitude, the Moon from its mean longitude and one
+ *    anomaly term, the naked-eye planets from a mean longitude with an ad-hoc
+ *    correction. Good to a fraction of a degree for the Sun and about a degree
+ *    for the Moon, which is plenty for dials, schedules and rise/set times.
+ *  - Single evaluations (ephem_equatorial, ephem_horizontal) serve interactive
+ *    tools. Batch work goes through EphemGrid: a body evaluated once over an
+ *    evenly spaced time grid, stored as arrays (structure of arrays) together
+ *    with the observer-independent terms sin/cos(dec) and sin/cos(GMST - RA).
+ *    Converting a grid to any observer's altitude and azimuth is then a few
+ *    multiply-adds per point in plain loops the compiler can vectorize; no
+ *    trigonometry is repeated per observer except the final asin/atan2.
+ *  - EphemDays caches the per-day terms of a date range once: the Sun's
+ *    declination and equation of time at noon and a 10-minute Moon grid. Rise and
+ *    set times for each further observer cost one acos per day for the Sun and a
+ *    linear scan with interpolation for the Moon, so schedules for many
+ *    locations take milliseconds.
+ *  - Days are local mean solar days: day k runs from midnight to midnight of
+ *    the observer's longitude, so every event belongs to the date a local
+ *    observer would give it. Times are Julian dates (UT).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <strings.h>
+
+#define EPHEM_PI 3.14159265358979323846
+#define EPHEM_RAD (EPHEM_PI / 180.0)
+#define EPHEM_J2000 2451545.0
+#define EPHEM_UNIX_EPOCH 2440587.5
+#define EPHEM_MOON_STEPS 144          // Moon grid points per day (10 minutes)
+#define EPHEM_SUN_H0 (-0.833)         // rise/set altitude of the Sun's upper limb
+#define EPHEM_MOON_H0 0.125           // same for the Moon, parallax included
+
+enum {
+    EPHEM_SUN, EPHEM_MOON, EPHEM_MERCURY, EPHEM_VENUS, EPHEM_MARS, EPHEM_JUPITER,
+    EPHEM_SATURN, EPHEM_BODIES
+};
+
+/*
+ * Bodies. Planets use a crude model valid around J2000:
+ *  - L0: mean longitude at J2000 (degrees)
+ *  - n: daily motion in degrees per day
+ *  - A: ad-hoc correction amplitude (degrees)
+ */
+static const struct {
+    const char *name;
+    double L0, n, A;
+} bodies[EPHEM_BODIES] = {
+    { "Sun",     0, 0, 0 },
+    { "Moon",    0, 0, 0 },
+    { "Mercury", 252.25084, 4.09233445, 7.0 },
+    { "Venus",   181.97973, 1.60213034, 3.0 },
+    { "Mars",    355.45332, 0.52402068, 1.8 },
+    { "Jupiter", 34.40438,  0.083086,   1.3 },
+    { "Saturn",  49.94432,  0.033459,   0.8 }
+};
+
+typedef struct EphemGrid {
+    size_t n;
+    double jd0, step;
+    double *ra, *dec;                 // degrees
+    double *sin_dec, *cos_dec;
+    double *sin_x, *cos_x;            // x = GMST - RA, the hour angle at longitude 0
+} EphemGrid;
+
+typedef struct EphemDays {
+    size_t ndays;
+    double jd0;                       // 0h UT of the first day
+    double *sin_dec, *cos_dec;        // the Sun at noon UT of each day
+    double *eot;                      // equation of time at noon, degrees
+    EphemGrid *moon;                  // starts half a day early, ends half a day late
+} EphemDays;
+
+static double norm360(double a) {
+    double r = fmod(a, 360.0);
+    return r < 0 ? r + 360.0 : r;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Time                                                                      */
+
+// Julian date of a Gregorian calendar date and UT hour.
+double ephem_jd(int year, int month, int day, double hours) {
+    if (month <= 2) {
+        year -= 1;
+        month += 12;
+    }
+    int A = year / 100;
+    int B = 2 - A + (A / 4);
+    return floor(365.25 * (year + 4716)) + floor(30.6001 * (month + 1)) +
+           day + hours / 24.0 + B - 1524.5;
+}
+
+double ephem_jd_from_unix(double t) {
+    return t / 86400.0 + EPHEM_UNIX_EPOCH;
+}
+
+double ephem_unix_from_jd(double jd) {
+    return (jd - EPHEM_UNIX_EPOCH) * 86400.0;
+}
+
+// Julian Ephemeris Date of an equinox or solstice (Meeus, years 1000..3000).
+// event: 0 = March Equinox, 1 = June Solstice, 2 = September Equinox, 3 = December Solstice.
+double ephem_season_jde(int event, int year) {
+    double T = (year - 2000) / 1000.0;
+    double T2 = T * T;
+    double T3 = T2 * T;
+    double T4 = T3 * T;
+    switch (event) {
+        case 0:
+            return 2451623.80984 + 365242.37404 * T + 0.05169 * T2 - 0.00411 * T3 - 0.00057 * T4;
+        case 1:
+            return 2451716.56767 + 365241.62603 * T + 0.00325 * T2 + 0.00888 * T3 - 0.00030 * T4;
+        case 2:
+            return 2451810.21715 + 365242.01767 * T - 0.11575 * T2 + 0.00337 * T3 + 0.00078 * T4;
+        case 3:
+            return 2451900.05952 + 365242.74049 * T - 0.06223 * T2 - 0.00823 * T3 + 0.00032 * T4;
+        default:
+            return 0;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Bodies                                                                    */
+
+int ephem_body_count(void) {
+    return EPHEM_BODIES;
+}
+
+const char *ephem_body_name(int body) {
+    return body >= 0 && body < EPHEM_BODIES ? bodies[body].name : NULL;
+}
+
+// Body number for a (case-insensitive) name, or -1.
+int ephem_body(const char *name) {
+    for (int i = 0; i < EPHEM_BODIES; i++) {
+        if (strcasecmp(name, bodies[i].name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// Ecliptic longitude (degrees, unnormalized) for n times d[i] days after J2000.
+static void ecliptic_longitude(int body, const double *d, size_t n, double *lambda) {
+    if (body == EPHEM_SUN) {
+        for (size_t i = 0; i < n; i++) {
+            double M = (357.529 + 0.98560028 * d[i]) * EPHEM_RAD;
+            lambda[i] = 280.459 + 0.98564736 * d[i] + 1.915 * sin(M) + 0.020 * sin(2 * M);
+        }
+    } else if (body == EPHEM_MOON) {
+        for (size_t i = 0; i < n; i++) {
+            double M = (134.963 + 13.064993 * d[i]) * EPHEM_RAD;
+            lambda[i] = 218.316 + 13.176396 * d[i] + 6.289 * sin(M);
+        }
+    } else {
+        double L0 = bodies[body].L0, rate = bodies[body].n, A = bodies[body].A;
+        for (size_t i = 0; i < n; i++) {
+            double L = L0 + rate * d[i];
+            lambda[i] = L + A * sin(L * EPHEM_RAD);
+        }
+    }
+}
+
+// Equatorial coordinates from ecliptic longitude (latitude taken as zero).
+static void to_equatorial(const double *d, const double *lambda, size_t n,
+                          double *ra, double *dec) {
+    for (size_t i = 0; i < n; i++) {
+        double eps = (23.439 - 0.00000036 * d[i]) * EPHEM_RAD;
+        double l = lambda[i] * EPHEM_RAD;
+        double sl = sin(l);
+        ra[i] = atan2(cos(eps) * sl, cos(l)) / EPHEM_RAD;
+        dec[i] = asin(sin(eps) * sl) / EPHEM_RAD;
+    }
+    for (size_t i = 0; i < n; i++)
+        ra[i] = norm360(ra[i]);
+}
+
+// Right ascension and declination (degrees) of a body at a Julian date.
+void ephem_equatorial(int body, double jd, double *ra, double *dec) {
+    double d = jd - EPHEM_J2000, lambda;
+    ecliptic_longitude(body, &d, 1, &lambda);
+    to_equatorial(&d, &lambda, 1, ra, dec);
+}
+
+// Azimuth (from north through east) and altitude in degrees for an observer.
+void ephem_horizontal(double ra, double dec, double lat, double lon, double jd,
+                      double *az, double *alt) {
+    double gmst = 280.46061837 + 360.98564736629 * (jd - EPHEM_J2000);
+    double h = (gmst + lon - ra) * EPHEM_RAD;
+    double sd = sin(dec * EPHEM_RAD), cd = cos(dec * EPHEM_RAD);
+    double sl = sin(lat * EPHEM_RAD), cl = cos(lat * EPHEM_RAD);
+    double s = sd * sl + cd * cl * cos(h);
+    *alt = asin(s > 1 ? 1 : s < -1 ? -1 : s) / EPHEM_RAD;
+    *az = norm360(atan2(-cd * sin(h), sd * cl - cd * sl * cos(h)) / EPHEM_RAD);
+}
+
+// Illuminated fraction of the Moon's disc from the Sun-Moon elongation.
+double ephem_moon_illumination(double jd) {
+    double d = jd - EPHEM_J2000, sun, moon;
+    ecliptic_longitude(EPHEM_SUN, &d, 1, &sun);
+    ecliptic_longitude(EPHEM_MOON, &d, 1, &moon);
+    return (1 - cos((moon - sun) * EPHEM_RAD)) / 2.0;
+}
+
+// Eccentric anomaly E from mean anomaly M (radians): M = E - e*sin(E), Newton-Raphson.
+double ephem_kepler(double M, double e) {
+    double E = M;
+    for (int i = 0; i < 10; i++) {
+        double delta = (E - e * sin(E) - M) / (1 - e * cos(E));
+        E -= delta;
+        if (fabs(delta) < 1e-6)
+            break;
+    }
+    return E;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Time grids                                                                */
+
+// Evaluate a body at n times jd0, jd0 + step, ...; NULL on bad input or no memory.
+EphemGrid *ephem_grid(int body, double jd0, double step, size_t n) {
+    if (body < 0 || body >= EPHEM_BODIES || n == 0)
+        return NULL;
+    EphemGrid *g = calloc(1, sizeof(*g));
+    double *mem = malloc(6 * n * sizeof(double));
+    double *d = malloc(2 * n * sizeof(double));
+    if (!g || !mem || !d) {
+        free(g);
+        free(mem);
+        free(d);
+        return NULL;
+    }
+    g->n = n;
+    g->jd0 = jd0;
+    g->step = step;
+    g->ra = mem;
+    g->dec = mem + n;
+    g->sin_dec = mem + 2 * n;
+    g->cos_dec = mem + 3 * n;
+    g->sin_x = mem + 4 * n;
+    g->cos_x = mem + 5 * n;
+
+    double *lambda = d + n;
+    for (size_t i = 0; i < n; i++)
+        d[i] = jd0 + (double)i * step - EPHEM_J2000;
+    ecliptic_longitude(body, d, n, lambda);
+    to_equatorial(d, lambda, n, g->ra, g->dec);
+    for (size_t i = 0; i < n; i++) {
+        double x = (280.46061837 + 360.98564736629 * d[i] - g->ra[i]) * EPHEM_RAD;
+        g->sin_x[i] = sin(x);
+        g->cos_x[i] = cos(x);
+        g->sin_dec[i] = sin(g->dec[i] * EPHEM_RAD);
+        g->cos_dec[i] = cos(g->dec[i] * EPHEM_RAD);
+    }
+    free(d);
+    return g;
+}
+
+void ephem_grid_free(EphemGrid *g) {
+    if (!g)
+        return;
+    free(g->ra);
+    free(g);
+}
+
+size_t ephem_grid_size(const EphemGrid *g) { return g->n; }
+double ephem_grid_jd(const EphemGrid *g, size_t i) { return g->jd0 + (double)i * g->step; }
+const double *ephem_grid_ra(const EphemGrid *g) { return g->ra; }
+const double *ephem_grid_dec(const EphemGrid *g) { return g->dec; }
+
+// Sine of the altitude at every grid point for an observer.
+static void grid_sin_alt(const EphemGrid *g, double lat, double lon, double *out) {
+    double sl = sin(lat * EPHEM_RAD), cl = cos(lat * EPHEM_RAD);
+    double so = sin(lon * EPHEM_RAD), co = cos(lon * EPHEM_RAD);
+    const double *sd = g->sin_dec, *cd = g->cos_dec, *sx = g->sin_x, *cx = g->cos_x;
+    for (size_t i = 0; i < g->n; i++)
+        out[i] = sd[i] * sl + cd[i] * cl * (cx[i] * co - sx[i] * so);   // cos(x + lon)
+}
+
+// Altitude and (when az is not NULL) azimuth in degrees at every grid point.
+void ephem_grid_horizontal(const EphemGrid *g, double lat, double lon, double *az, double *alt) {
+    grid_sin_alt(g, lat, lon, alt);
+    for (size_t i = 0; i < g->n; i++) {
+        double s = alt[i];
+        alt[i] = asin(s > 1 ? 1 : s < -1 ? -1 : s) / EPHEM_RAD;
+    }
+    if (!az)
+        return;
+    double sl = sin(lat * EPHEM_RAD), cl = cos(lat * EPHEM_RAD);
+    double so = sin(lon * EPHEM_RAD), co = cos(lon * EPHEM_RAD);
+    for (size_t i = 0; i < g->n; i++) {
+        double sin_h = g->sin_x[i] * co + g->cos_x[i] * so;
+        double cos_h = g->cos_x[i] * co - g->sin_x[i] * so;
+        az[i] = atan2(-g->cos_dec[i] * sin_h, g->sin_dec[i] * cl - g->cos_dec[i] * sl * cos_h) / EPHEM_RAD;
+    }
+    for (size_t i = 0; i < g->n; i++)
+        az[i] = az[i] < 0 ? az[i] + 360.0 : az[i];
+}
+
+/* ------------------------------------------------------------------------- */
+/* Rise and set                                                              */
+
+// Cache the per-day terms for ndays days starting at 0h UT of jd0.
+EphemDays *ephem_days(double jd0, size_t ndays) {
+    if (ndays == 0)
+        return NULL;
+    EphemDays *days = calloc(1, sizeof(*days));
+    double *mem = malloc(3 * ndays * sizeof(double));
+    EphemGrid *sun = ephem_grid(EPHEM_SUN, jd0 + 0.5, 1.0, ndays);
+    EphemGrid *moon = ephem_grid(EPHEM_MOON, jd0 - 0.5, 1.0 / EPHEM_MOON_STEPS,
+                                 (ndays + 1) * EPHEM_MOON_STEPS + 1);
+    if (!days || !mem || !sun || !moon) {
+        free(days);
+        free(mem);
+        ephem_grid_free(sun);
+        ephem_grid_free(moon);
+        return NULL;
+    }
+    days->ndays = ndays;
+    days->jd0 = jd0;
+    days->sin_dec = mem;
+    days->cos_dec = mem + ndays;
+    days->eot = mem + 2 * ndays;
+    days->moon = moon;
+    for (size_t k = 0; k < ndays; k++) {
+        double d = jd0 + 0.5 + (double)k - EPHEM_J2000;
+        double e = fmod(280.459 + 0.98564736 * d - sun->ra[k], 360.0);   // mean longitude - RA
+        days->eot[k] = e > 180 ? e - 360 : e < -180 ? e + 360 : e;
+        days->sin_dec[k] = sun->sin_dec[k];
+        days->cos_dec[k] = sun->cos_dec[k];
+    }
+    ephem_grid_free(sun);
+    return days;
+}
+
+void ephem_days_free(EphemDays *days) {
+    if (!days)
+        return;
+    free(days->sin_dec);
+    ephem_grid_free(days->moon);
+    free(days);
+}
+
+size_t ephem_days_count(const EphemDays *days) { return days->ndays; }
+
+/*
+ * Sunrise and sunset (Julian dates, NAN when the Sun stays up or down) of every
+ * cached day for an observer.
+ */
+void ephem_sun_events(const EphemDays *days, double lat, double lon, double *rise, double *set) {
+    double sl = sin(lat * EPHEM_RAD), cl = cos(lat * EPHEM_RAD);
+    double sh = sin(EPHEM_SUN_H0 * EPHEM_RAD);
+    for (size_t k = 0; k < days->ndays; k++) {
+        double cos_ha = (sh - sl * days->sin_dec[k]) / (cl * days->cos_dec[k]);
+        double transit = days->jd0 + (double)k + 0.5 - (lon + days->eot[k]) / 360.0;
+        if (cos_ha >= -1 && cos_ha <= 1) {
+            double ha = acos(cos_ha) / (2 * EPHEM_PI);   // fraction of a day
+            rise[k] = transit - ha;
+            set[k] = transit + ha;
+        } else {
+            rise[k] = set[k] = NAN;
+        }
+    }
+}
+
+/*
+ * Moonrise and moonset of every cached day for an observer: the first upward and
+ * downward horizon crossing within the local day, linearly interpolated between
+ * grid points; NAN on days without one. Returns -1 when out of memory.
+ */
+int ephem_moon_events(const EphemDays *days, double lat, double lon, double *rise, double *set) {
+    const EphemGrid *g = days->moon;
+    double *f = malloc(g->n * sizeof(double));
+    if (!f)
+        return -1;
+    grid_sin_alt(g, lat, lon, f);
+    double sh = sin(EPHEM_MOON_H0 * EPHEM_RAD);
+    for (size_t i = 0; i < g->n; i++)
+        f[i] -= sh;
+
+    // Local midnight of day k sits at grid index (k + 0.5 - lon/360) * steps.
+    double offset = (0.5 - lon / 360.0) * EPHEM_MOON_STEPS;
+    for (size_t k = 0; k < days->ndays; k++) {
+        size_t first = (size_t)ceil(offset + (double)k * EPHEM_MOON_STEPS);
+        size_t last = (size_t)ceil(offset + (double)(k + 1) * EPHEM_MOON_STEPS);
+        if (first < 1)
+            first = 1;
+        if (last > g->n)
+            last = g->n;
+        rise[k] = set[k] = NAN;
+        for (size_t i = first; i < last; i++) {
+            double a = f[i - 1], b = f[i];
+            if ((a < 0) == (b < 0))
+                continue;
+            double t = ephem_grid_jd(g, i - 1) + g->step * a / (a - b);
+            if (b >= 0 && isnan(rise[k]))
+                rise[k] = t;
+            else if (b < 0 && isnan(set[k]))
+                set[k] = t;
+        }
+    }
+    free(f);
+    return 0;
+}
@@ -0,0 +1,739 @@
+#define _POSIX_C_SOURCE 200809L
+/*
+ * libextsort.c
+ *
+ * External-memory sort of text lines by one CSV key column, used by csvsort
+ * and csvjoin.
+ *
+ * Design principles:
+ *  - Lines are added one at a time. The key field (split at ',', trimmed) is
+ *    extracted once when a line is added: it is stored as a number when the whole
+ *    field parses, otherwise as bytes. Numbers order before text; text compares
+ *    bytewise. Run files carry the extracted key next to each line, so merging
+ *    never parses a line again.
+ *  - Lines are buffered until the memory limit is reached. The buffer is then
+ *    split into one slice per thread, the slices are merge-sorted in parallel and
+ *    merged into a sorted run in an unlinked temporary file.
+ *  - Runs (or, when everything fit into memory, the sorted slices themselves) are
+ *    combined with a k-way merge driven by a loser tree: one comparison per tree
+ *    level for every line output. Whenever EXTSORT_FAN_IN + 1 runs are open, the
+ *    oldest EXTSORT_FAN_IN are merged into one, so open files stay bounded.
+ *  - The sort is stable: equal keys keep their input order. With "unique", equal
+ *    keys are ordered by the whole line and repeated lines are dropped.
+ *  - The result is read with extsort_next(); the returned line stays valid until
+ *    the next call.
+ *  - extsort_is_header_line() and extsort_resolve_column() hold the header and
+ *    key-column parsing both commands share.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define EXTSORT_FAN_IN 64
+#define EXTSORT_MAX_THREADS 64
+#define EXTSORT_MAX_KEY 128   // longer numeric-looking keys are compared as text
+#define EXTSORT_CHUNK (1 << 20)   // line storage is allocated in chunks of this size
+
+// One line with its extracted key.
+typedef struct {
+    const char *line;      // not NUL terminated
+    uint32_t len;
+    uint32_t key_off;
+    uint32_t key_len;
+    uint32_t is_num;
+    double num;
+} SortRec;
+
+// Record header in run files; the line bytes follow.
+typedef struct {
+    uint32_t len;
+    uint32_t key_off;
+    uint32_t key_len;
+    uint32_t is_num;
+    double num;
+} RunRecord;
+
+// A merge input: a sorted in-memory slice or a run file.
+typedef struct {
+    SortRec *recs;
+    size_t n, pos;
+    FILE *fp;
+    char *buf;
+    size_t cap;
+    SortRec cur;
+    int done;
+} MergeSource;
+
+typedef struct ExtSort ExtSort;
+
+// Loser tree over k sources; tree[0] holds the current winner.
+typedef struct {
+    const ExtSort *s;
+    MergeSource *src;
+    int k;
+    int *tree;
+} LoserTree;
+
+typedef struct ExtSort {
+    int key_col;
+    int reverse;
+    int unique;
+    int threads;
+    size_t mem_limit;
+    char *tmpdir;
+
+    // Input buffer: lines live in chunks that are never moved, records point into them.
+    char **chunks;
+    size_t nchunks, chunks_cap;
+    size_t chunk_used, chunk_size;   // fill level and size of the last chunk
+    size_t buffered;                 // line bytes held in chunks
+    SortRec *recs;
+    size_t nrecs, recs_cap;
+
+    // Spilled runs; those before first_run have been merged into later ones.
+    FILE **runs;
+    size_t nruns, runs_cap;
+    size_t first_run;
+    size_t runs_written;
+
+    // Final merge.
+    MergeSource *sources;
+    int nsources;
+    LoserTree tree;
+    int merging;
+    char *last;            // previously returned line (unique mode)
+    size_t last_len, last_cap;
+    int have_last;
+    SortRec current;
+    int error;
+} ExtSort;
+
+/*
+ * Key extraction and comparison.
+ */
+
+static void extract_key(const ExtSort *s, SortRec *r) {
+    const char *p = r->line, *end = r->line + r->len;
+    for (int c = 0; c < s->key_col && p < end; c++) {
+        const char *comma = memchr(p, ',', (size_t)(end - p));
+        p = comma ? comma + 1 : end;
+    }
+    const char *e = memchr(p, ',', (size_t)(end - p));
+    if (!e) e = end;
+    while (p < e && isspace((unsigned char)*p)) p++;
+    while (e > p && isspace((unsigned char)e[-1])) e--;
+    r->key_off = (uint32_t)(p - r->line);
+    r->key_len = (uint32_t)(e - p);
+    r->is_num = 0;
+    r->num = 0.0;
+    if (r->key_len > 0 && r->key_len < EXTSORT_MAX_KEY) {
+        char buf[EXTSORT_MAX_KEY];
+        memcpy(buf, p, r->key_len);
+        buf[r->key_len] = '\0';
+        char *endptr;
+        errno = 0;
+        double v = strtod(buf, &endptr);
+        if (!errno && *endptr == '\0' && v == v) {
+            r->is_num = 1;
+            r->num = v;
+        }
+    }
+}
+
+// Compares two keys: numbers before text, numbers by value, text bytewise.
+static int key_compare(int a_num, double a_val, const char *a_key, size_t a_len,
+                       int b_num, double b_val, const char *b_key, size_t b_len) {
+    if (a_num && b_num)
+        return (a_val > b_val) - (a_val < b_val);
+    if (a_num != b_num)
+        return a_num ? -1 : 1;
+    size_t n = a_len < b_len ? a_len : b_len;
+    int c = memcmp(a_key, b_key, n);
+    if (c != 0)
+        return c < 0 ? -1 : 1;
+    return (a_len > b_len) - (a_len < b_len);
+}
+
+static int rec_compare(const ExtSort *s, const SortRec *a, const SortRec *b) {
+    int c = key_compare((int)a->is_num, a->num, a->line + a->key_off, a->key_len,
+                        (int)b->is_num, b->num, b->line + b->key_off, b->key_len);
+    if (s->reverse)
+        c = -c;
+    if (c == 0 && s->unique) {
+        size_t n = a->len < b->len ? a->len : b->len;
+        c = memcmp(a->line, b->line, n);
+        if (c == 0)
+            c = (a->len > b->len) - (a->len < b->len);
+    }
+    return c;
+}
+
+/*
+ * Stable bottom-up merge sort of a record slice (tmp has room for n records).
+ */
+static void merge_sort(const ExtSort *s, SortRec *a, SortRec *tmp, size_t n) {
+    SortRec *src = a, *dst = tmp;
+    for (size_t width = 1; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            size_t i = lo, j = mid, k = lo;
+            while (i < mid && j < hi)
+                dst[k++] = (rec_compare(s, &src[j], &src[i]) < 0) ? src[j++] : src[i++];
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi) dst[k++] = src[j++];
+        }
+        SortRec *t = src; src = dst; dst = t;
+    }
+    if (src != a)
+        memcpy(a, src, n * sizeof(SortRec));
+}
+
+typedef struct {
+    const ExtSort *s;
+    SortRec *recs;
+    SortRec *tmp;
+    size_t n;
+} SortJob;
+
+static void *sort_worker(void *arg) {
+    SortJob *job = arg;
+    merge_sort(job->s, job->recs, job->tmp, job->n);
+    return NULL;
+}
+
+// Sorts the buffered records as nslices slices in parallel; fills bounds[0..nslices].
+static int sort_slices(ExtSort *s, size_t *bounds, int *nslices_out) {
+    int nslices = s->threads;
+    if ((size_t)nslices > s->nrecs / 1024 + 1)
+        nslices = (int)(s->nrecs / 1024 + 1);
+    SortRec *tmp = malloc((s->nrecs ? s->nrecs : 1) * sizeof(SortRec));
+    if (!tmp)
+        return -1;
+    SortJob jobs[EXTSORT_MAX_THREADS];
+    pthread_t tids[EXTSORT_MAX_THREADS];
+    int started[EXTSORT_MAX_THREADS];
+    for (int i = 0; i <= nslices; i++)
+        bounds[i] = s->nrecs * (size_t)i / (size_t)nslices;
+    // The last slice is sorted by the calling thread.
+    for (int i = 0; i < nslices; i++) {
+        jobs[i] = (SortJob){ s, s->recs + bounds[i], tmp + bounds[i], bounds[i + 1] - bounds[i] };
+        started[i] = i < nslices - 1 && pthread_create(&tids[i], NULL, sort_worker, &jobs[i]) == 0;
+        if (!started[i])
+            sort_worker(&jobs[i]);
+    }
+    for (int i = 0; i < nslices; i++)
+        if (started[i]) pthread_join(tids[i], NULL);
+    free(tmp);
+    *nslices_out = nslices;
+    return 0;
+}
+
+/*
+ * Merge sources and the loser tree.
+ */
+
+static int source_advance(MergeSource *m) {
+    if (!m->fp) {
+        if (m->pos >= m->n) {
+            m->done = 1;
+            return 0;
+        }
+        m->cur = m->recs[m->pos++];
+        return 0;
+    }
+    RunRecord rr;
+    if (fread(&rr, sizeof(rr), 1, m->fp) != 1) {
+        m->done = 1;
+        return 0;
+    }
+    if (rr.len + 1 > m->cap) {
+        size_t cap = m->cap ? m->cap : 256;
+        while (cap < (size_t)rr.len + 1) cap *= 2;
+        char *b = realloc(m->buf, cap);
+        if (!b) return -1;
+        m->buf = b;
+        m->cap = cap;
+    }
+    if (rr.len > 0 && fread(m->buf, rr.len, 1, m->fp) != 1)
+        return -1;
+    m->cur = (SortRec){ m->buf, rr.len, rr.key_off, rr.key_len, rr.is_num, rr.num };
+    return 0;
+}
+
+// Index k stands for a virtual source smaller than all others (used while building).
+static int lt_less(const LoserTree *t, int i, int j) {
+    if (i == t->k) return 1;
+    if (j == t->k) return 0;
+    if (t->src[i].done) return 0;
+    if (t->src[j].done) return 1;
+    int c = rec_compare(t->s, &t->src[i].cur, &t->src[j].cur);
+    return c < 0 || (c == 0 && i < j);
+}
+
+static void lt_adjust(LoserTree *t, int leaf) {
+    int winner = leaf;
+    for (int node = (leaf + t->k) / 2; node > 0; node /= 2) {
+        if (lt_less(t, t->tree[node], winner)) {
+            int tmp = t->tree[node];
+            t->tree[node] = winner;
+            winner = tmp;
+        }
+    }
+    t->tree[0] = winner;
+}
+
+static int lt_init(LoserTree *t, const ExtSort *s, MergeSource *src, int k) {
+    t->s = s;
+    t->src = src;
+    t->k = k;
+    t->tree = malloc(sizeof(int) * (size_t)(k > 0 ? k : 1));
+    if (!t->tree)
+        return -1;
+    for (int i = 0; i < k; i++)
+        t->tree[i] = k;
+    for (int i = k - 1; i >= 0; i--)
+        lt_adjust(t, i);
+    return 0;
+}
+
+// Returns the source holding the smallest record, or -1 when all are exhausted.
+static int lt_winner(const LoserTree *t) {
+    if (t->k == 0) return -1;
+    int w = t->tree[0];
+    return t->src[w].done ? -1 : w;
+}
+
+/*
+ * Run files.
+ */
+
+static FILE *open_temp(const char *dir) {
+    if (!dir)
+        return tmpfile();
+    size_t len = strlen(dir) + 32;
+    char *path = malloc(len);
+    if (!path)
+        return NULL;
+    snprintf(path, len, "%s/extsortXXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        free(path);
+        return NULL;
+    }
+    unlink(path);
+    free(path);
+    FILE *fp = fdopen(fd, "w+b");
+    if (!fp)
+        close(fd);
+    return fp;
+}
+
+static int write_record(FILE *fp, const SortRec *r) {
+    RunRecord rr = { r->len, r->key_off, r->key_len, r->is_num, r->num };
+    if (fwrite(&rr, sizeof(rr), 1, fp) != 1)
+        return -1;
+    if (r->len > 0 && fwrite(r->line, r->len, 1, fp) != 1)
+        return -1;
+    return 0;
+}
+
+static int add_run(ExtSort *s, FILE *fp) {
+    if (s->nruns == s->runs_cap) {
+        size_t cap = s->runs_cap ? s->runs_cap * 2 : 16;
+        FILE **r = realloc(s->runs, cap * sizeof(FILE *));
+        if (!r) return -1;
+        s->runs = r;
+        s->runs_cap = cap;
+    }
+    s->runs[s->nruns++] = fp;
+    s->runs_written++;
+    return 0;
+}
+
+// Merges k sources into a new run file.
+static int merge_to_run(ExtSort *s, MergeSource *src, int k) {
+    FILE *out = open_temp(s->tmpdir);
+    if (!out)
+        return -1;
+    LoserTree t;
+    if (lt_init(&t, s, src, k) != 0) {
+        fclose(out);
+        return -1;
+    }
+    int rc = 0;
+    int w;
+    while (rc == 0 && (w = lt_winner(&t)) >= 0) {
+        rc = write_record(out, &src[w].cur);
+        if (rc == 0)
+            rc = source_advance(&src[w]);
+        lt_adjust(&t, w);
+    }
+    free(t.tree);
+    if (rc == 0 && (fflush(out) != 0 || fseek(out, 0, SEEK_SET) != 0))
+        rc = -1;
+    if (rc == 0)
+        rc = add_run(s, out);
+    if (rc != 0)
+        fclose(out);
+    return rc;
+}
+
+// Sets up in-memory sources over the sorted slices of the buffer.
+static MergeSource *slice_sources(ExtSort *s, const size_t *bounds, int nslices) {
+    MergeSource *src = calloc((size_t)nslices, sizeof(MergeSource));
+    if (!src)
+        return NULL;
+    for (int i = 0; i < nslices; i++) {
+        src[i].recs = s->recs + bounds[i];
+        src[i].n = bounds[i + 1] - bounds[i];
+        source_advance(&src[i]);
+    }
+    return src;
+}
+
+static void free_chunks(ExtSort *s) {
+    for (size_t i = 0; i < s->nchunks; i++)
+        free(s->chunks[i]);
+    s->nchunks = 0;
+    s->chunk_used = s->chunk_size = 0;
+    s->buffered = 0;
+}
+
+// Reserves len bytes of line storage.
+static char *chunk_alloc(ExtSort *s, size_t len) {
+    if (s->nchunks == 0 || s->chunk_used + len > s->chunk_size) {
+        if (s->nchunks == s->chunks_cap) {
+            size_t cap = s->chunks_cap ? s->chunks_cap * 2 : 16;
+            char **c = realloc(s->chunks, cap * sizeof(char *));
+            if (!c) return NULL;
+            s->chunks = c;
+            s->chunks_cap = cap;
+        }
+        size_t size = len > EXTSORT_CHUNK ? len : EXTSORT_CHUNK;
+        char *chunk = malloc(size);
+        if (!chunk) return NULL;
+        s->chunks[s->nchunks++] = chunk;
+        s->chunk_used = 0;
+        s->chunk_size = size;
+    }
+    char *p = s->chunks[s->nchunks - 1] + s->chunk_used;
+    s->chunk_used += len;
+    s->buffered += len;
+    return p;
+}
+
+static void free_sources(MergeSource *src, int n) {
+    if (!src) return;
+    for (int i = 0; i < n; i++) {
+        if (src[i].fp) fclose(src[i].fp);
+        free(src[i].buf);
+    }
+    free(src);
+}
+
+// Sources over run files [first, first + n).
+static MergeSource *run_sources(ExtSort *s, size_t first, int n) {
+    MergeSource *src = calloc((size_t)n, sizeof(MergeSource));
+    if (!src)
+        return NULL;
+    size_t bufsize = s->mem_limit / (size_t)(n + 1);
+    if (bufsize < 4096) bufsize = 4096;
+    if (bufsize > (1 << 20)) bufsize = 1 << 20;
+    for (int i = 0; i < n; i++) {
+        src[i].fp = s->runs[first + (size_t)i];
+        s->runs[first + (size_t)i] = NULL;
+        setvbuf(src[i].fp, NULL, _IOFBF, bufsize);
+        if (source_advance(&src[i]) != 0) {
+            free_sources(src, n);
+            return NULL;
+        }
+    }
+    return src;
+}
+
+// Merges the oldest open runs, EXTSORT_FAN_IN at a time, until at most limit are left.
+static int reduce_runs(ExtSort *s, size_t limit) {
+    while (s->nruns - s->first_run > limit) {
+        MergeSource *src = run_sources(s, s->first_run, EXTSORT_FAN_IN);
+        if (!src)
+            return -1;
+        int rc = merge_to_run(s, src, EXTSORT_FAN_IN);
+        free_sources(src, EXTSORT_FAN_IN);
+        if (rc != 0)
+            return -1;
+        // The merged run holds the oldest input: move it into the last freed slot
+        // so that equal keys still come out in input order.
+        s->first_run += EXTSORT_FAN_IN - 1;
+        s->runs[s->first_run] = s->runs[--s->nruns];
+    }
+    return 0;
+}
+
+// Sorts the buffer and writes it as one run.
+static int spill(ExtSort *s) {
+    if (s->nrecs == 0)
+        return 0;
+    size_t bounds[EXTSORT_MAX_THREADS + 1];
+    int nslices;
+    if (sort_slices(s, bounds, &nslices) != 0)
+        return -1;
+    MergeSource *src = slice_sources(s, bounds, nslices);
+    if (!src)
+        return -1;
+    int rc = merge_to_run(s, src, nslices);
+    free(src);
+    s->nrecs = 0;
+    free_chunks(s);
+    // Keep the number of open run files bounded while input is still arriving.
+    if (rc == 0)
+        rc = reduce_runs(s, EXTSORT_FAN_IN);
+    return rc;
+}
+
+/*
+ * Public API.
+ */
+
+/*
+ * Creates a sorter on the 0-based key column. mem_limit bounds the buffered input
+ * (bytes); threads <= 0 uses all online CPUs; tmpdir may be NULL for the default.
+ */
+ExtSort *extsort_create(int key_col, int reverse, int unique, size_t mem_limit,
+                        int threads, const char *tmpdir) {
+    ExtSort *s = calloc(1, sizeof(ExtSort));
+    if (!s)
+        return NULL;
+    if (threads <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = n > 0 ? (int)n : 1;
+    }
+    if (threads > EXTSORT_MAX_THREADS)
+        threads = EXTSORT_MAX_THREADS;
+    s->key_col = key_col < 0 ? 0 : key_col;
+    s->reverse = reverse;
+    s->unique = unique;
+    s->threads = threads;
+    s->mem_limit = mem_limit < (1 << 20) ? (1 << 20) : mem_limit;
+    s->tmpdir = tmpdir ? strdup(tmpdir) : NULL;
+    return s;
+}
+
+/*
+ * Adds one line (without line terminator). Returns 0, or -1 on error.
+ */
+int extsort_add(ExtSort *s, const char *line, size_t len) {
+    if (s->merging || s->error)
+        return -1;
+    // Each record also needs room in the record array and in the sort's scratch array.
+    size_t need = len + 3 * sizeof(SortRec);
+    if (s->nrecs > 0 && s->buffered + s->nrecs * 3 * sizeof(SortRec) + need > s->mem_limit) {
+        if (spill(s) != 0) {
+            s->error = 1;
+            return -1;
+        }
+    }
+    if (s->nrecs == s->recs_cap) {
+        size_t cap = s->recs_cap ? s->recs_cap * 2 : 4096;
+        SortRec *r = realloc(s->recs, cap * sizeof(SortRec));
+        if (!r) {
+            s->error = 1;
+            return -1;
+        }
+        s->recs = r;
+        s->recs_cap = cap;
+    }
+    char *copy = chunk_alloc(s, len);
+    if (!copy) {
+        s->error = 1;
+        return -1;
+    }
+    memcpy(copy, line, len);
+    SortRec *r = &s->recs[s->nrecs++];
+    r->line = copy;
+    r->len = (uint32_t)len;
+    extract_key(s, r);
+    return 0;
+}
+
+/*
+ * Ends the input and prepares the merged output. Returns 0, or -1 on error.
+ */
+int extsort_finish(ExtSort *s) {
+    if (s->error)
+        return -1;
+    if (s->merging)
+        return 0;
+    s->merging = 1;
+    if (s->nruns == 0) {
+        // Everything fit into memory: merge the sorted slices directly.
+        size_t bounds[EXTSORT_MAX_THREADS + 1];
+        int nslices;
+        if (sort_slices(s, bounds, &nslices) != 0)
+            return -1;
+        s->sources = slice_sources(s, bounds, nslices);
+        s->nsources = nslices;
+    } else {
+        if (spill(s) != 0)
+            return -1;
+        s->nsources = (int)(s->nruns - s->first_run);
+        s->sources = run_sources(s, s->first_run, s->nsources);
+    }
+    if (!s->sources && s->nsources > 0)
+        return -1;
+    return lt_init(&s->tree, s, s->sources, s->nsources);
+}
+
+/*
+ * Returns the next line in sorted order (not NUL terminated, valid until the
+ * next call) and its length, or NULL at the end.
+ */
+const char *extsort_next(ExtSort *s, size_t *len) {
+    if (!s->merging && extsort_finish(s) != 0) {
+        s->error = 1;
+        return NULL;
+    }
+    for (;;) {
+        int w = lt_winner(&s->tree);
+        if (w < 0)
+            return NULL;
+        SortRec r = s->sources[w].cur;
+        // Keep the line before the source's buffer is reused.
+        if (r.len + 1 > s->last_cap) {
+            size_t cap = s->last_cap ? s->last_cap : 256;
+            while (cap < (size_t)r.len + 1) cap *= 2;
+            char *b = realloc(s->last, cap);
+            if (!b) {
+                s->error = 1;
+                return NULL;
+            }
+            s->last = b;
+            s->last_cap = cap;
+        }
+        int duplicate = s->unique && s->have_last && r.len == s->last_len &&
+                        memcmp(r.line, s->last, r.len) == 0;
+        if (!duplicate) {
+            memcpy(s->last, r.line, r.len);
+            s->last_len = r.len;
+            s->have_last = 1;
+        }
+        if (source_advance(&s->sources[w]) != 0) {
+            s->error = 1;
+            return NULL;
+        }
+        lt_adjust(&s->tree, w);
+        if (duplicate)
+            continue;
+        s->current = r;
+        s->current.line = s->last;
+        *len = s->last_len;
+        return s->last;
+    }
+}
+
+/*
+ * Key of the line last returned by extsort_next(): the trimmed field text and,
+ * when it is a number, its value.
+ */
+const char *extsort_current_key(const ExtSort *s, size_t *len, int *is_num, double *num) {
+    *len = s->current.key_len;
+    *is_num = (int)s->current.is_num;
+    *num = s->current.num;
+    return s->current.line + s->current.key_off;
+}
+
+// Compares two keys in sort order (numbers before text).
+int extsort_compare_keys(int a_num, double a_val, const char *a_key, size_t a_len,
+                         int b_num, double b_val, const char *b_key, size_t b_len) {
+    return key_compare(a_num, a_val, a_key, a_len, b_num, b_val, b_key, b_len);
+}
+
+// Number of runs written to temporary files (0 when the input fit into memory).
+size_t extsort_runs(const ExtSort *s) {
+    return s->runs_written;
+}
+
+// Non-zero when an error occurred (I/O or memory).
+int extsort_error(const ExtSort *s) {
+    return s->error;
+}
+
+void extsort_free(ExtSort *s) {
+    if (!s) return;
+    free_sources(s->sources, s->nsources);
+    for (size_t i = 0; i < s->nruns; i++)
+        if (s->runs[i]) fclose(s->runs[i]);
+    free(s->runs);
+    free(s->tree.tree);
+    free_chunks(s);
+    free(s->chunks);
+    free(s->recs);
+    free(s->last);
+    free(s->tmpdir);
+    free(s);
+}
+
+/*
+ * CSV header helpers shared by csvsort and csvjoin.
+ */
+
+// Returns 1 if the trimmed field [s, e) is a valid floating-point literal.
+static int is_numeric_field(const char *s, const char *e) {
+    while (s < e && isspace((unsigned char)*s)) s++;
+    while (e > s && isspace((unsigned char)e[-1])) e--;
+    if (s == e || e - s >= EXTSORT_MAX_KEY) return 0;
+    char buf[EXTSORT_MAX_KEY];
+    memcpy(buf, s, (size_t)(e - s));
+    buf[e - s] = '\0';
+    char *endptr;
+    errno = 0;
+    strtod(buf, &endptr);
+    return !errno && *endptr == '\0';
+}
+
+// A line is a header if any of its fields is not numeric (as in csvclean).
+int extsort_is_header_line(const char *line) {
+    const char *f = line;
+    for (const char *p = line; ; p++) {
+        if (*p == ',' || *p == '\0') {
+            if (!is_numeric_field(f, p)) return 1;
+            if (*p == '\0') break;
+            f = p + 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Resolves a key column given as 1-based number or header name (header may be
+ * NULL). Returns the 0-based index, or -1 when it names no column.
+ */
+int extsort_resolve_column(const char *spec, const char *header) {
+    char *endptr;
+    long n = strtol(spec, &endptr, 10);
+    if (*spec && *endptr == '\0')
+        return n >= 1 ? (int)(n - 1) : -1;
+    if (!header) return -1;
+    int col = 0;
+    const char *f = header;
+    size_t speclen = strlen(spec);
+    for (const char *p = header; ; p++) {
+        if (*p == ',' || *p == '\0') {
+            const char *s = f, *e = p;
+            while (s < e && isspace((unsigned char)*s)) s++;
+            while (e > s && isspace((unsigned char)e[-1])) e--;
+            if ((size_t)(e - s) == speclen && strncmp(s, spec, speclen) == 0)
+                return col;
+            if (*p == '\0') break;
+            col++;
+            f = p + 1;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,1060 @@
+#define _POSIX_C_SOURCE 200809L
+/*
+ * libpack.c
+ *
+ * Native archive engine behind the pack and unpack commands.
+ *
+ * Design principles:
+ *  - Files are cut into blocks of PACK_BLOCK_SIZE bytes (a block never spans two
+ *    files). Every block is compressed on its own, so worker threads compress and
+ *    decompress blocks independently and in any order.
+ *  - The compressor is a byte-oriented LZ77 coder in the style of LZ4: sequences
+ *    of literals followed by a 16-bit back reference, found through a hash of the
+ *    next four bytes. It is fast enough to keep up with disks, needs no library
+ *    and its decoder bounds-checks everything it reads. Blocks that do not shrink
+ *    are stored as they are.
+ *  - Workers append finished blocks to the archive at an offset reserved under a
+ *    lock, so the archive is written sequentially no matter which worker finishes
+ *    first. The index at the end records where each block went; that makes the
+ *    archive seekable: one file can be extracted without reading the others.
+ *  - Extraction creates every file at its final size first, then workers read
+ *    blocks from the archive and pwrite() them into place. Blocks carry a CRC-32
+ *    of their raw bytes. Symlinks are created and permissions and modification
+ *    times restored only after all data is written.
+ *  - Paths are stored relative, as given on the command line; leading "/", "./"
+ *    and "../" are dropped when packing and paths with ".." are refused when
+ *    unpacking.
+ *
+ * File layout (little-endian host order):
+ *   "BPK1" | blocks ... | PackEntry[entries] | PackBlock[blocks] | strings |
+ *   PackTrailer
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define PACK_MAGIC "BPK1"
+#define PACK_TRAILER_MAGIC "BPKINDEX"
+#define PACK_BLOCK_SIZE (1u << 20)
+#define PACK_MAX_THREADS 64
+#define PACK_NO_LINK UINT32_MAX
+
+#define LZ_HASH_BITS 14
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_BOUND(n) ((n) + (n) / 255 + 16)
+
+typedef void (*PackProgress)(uint64_t done, uint64_t total, void *ctx);
+
+typedef struct {
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint32_t first_block;
+    uint32_t mode;           // st_mode, including the file type bits
+    uint32_t name_off;       // offsets into the string table
+    uint32_t link_off;       // symlink target, PACK_NO_LINK otherwise
+} PackEntry;
+
+typedef struct {
+    uint64_t offset;         // position in the archive
+    uint32_t packed_len;     // equal to raw_len when the block is stored
+    uint32_t raw_len;
+    uint32_t crc;            // CRC-32 of the raw bytes
+    uint32_t entry;
+} PackBlock;
+
+typedef struct {
+    uint64_t index_offset;
+    uint64_t entries;
+    uint64_t blocks;
+    uint64_t strings_len;
+    uint32_t block_size;
+    uint32_t index_crc;      // CRC-32 of entries, blocks and strings
+    char magic[8];
+} PackTrailer;
+
+// State shared by the workers of one pack or unpack run.
+typedef struct {
+    PackEntry *entries;
+    PackBlock *blocks;
+    char *strings;
+    char **paths;            // file system path of each entry
+    uint64_t nentries, nblocks;
+    int fd;                  // the archive
+    uint64_t out_pos;        // pack: next free byte in the archive
+    uint64_t next_block;
+    uint64_t done, total;    // raw bytes
+    PackProgress progress;
+    void *ctx;
+    int failed;
+    char *err;
+    size_t errlen;
+    pthread_mutex_t lock;
+} PackRun;
+
+/* ------------------------------------------------------------------------- */
+/* CRC-32 (IEEE 802.3), as in commands/crc32.c                               */
+
+static uint32_t crc_table[256];
+
+static void crc_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int j = 0; j < 8; j++)
+            c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t *buf, size_t len) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+        crc = (crc >> 8) ^ crc_table[(crc ^ buf[i]) & 0xFF];
+    return ~crc;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Block compressor                                                          */
+
+static uint32_t lz_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint32_t lz_hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static uint8_t *lz_put_len(uint8_t *op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+static uint8_t *lz_put_literals(uint8_t *op, uint8_t *token, const uint8_t *lit, size_t n) {
+    *token = (uint8_t)((n >= 15 ? 15 : n) << 4);
+    if (n >= 15)
+        op = lz_put_len(op, n - 15);
+    memcpy(op, lit, n);
+    return op + n;
+}
+
+// Compress src into dst (at least LZ_BOUND(n) bytes); returns the packed size.
+static size_t lz_compress(const uint8_t *src, size_t n, uint8_t *dst, uint32_t *table) {
+    const uint8_t *ip = src, *anchor = src, *end = src + n;
+    const uint8_t *match_limit = n > 12 ? end - 12 : src;  // no match starts after this
+    uint8_t *op = dst;
+    unsigned misses = 0;
+
+    memset(table, 0, sizeof(uint32_t) << LZ_HASH_BITS);
+    while (ip < match_limit) {
+        uint32_t seq = lz_read32(ip);
+        uint32_t h = lz_hash(seq);
+        const uint8_t *ref = src + table[h];
+        table[h] = (uint32_t)(ip - src);
+        if (ref >= ip || ip - ref > LZ_MAX_OFFSET || lz_read32(ref) != seq) {
+            // skip faster through data that does not compress
+            ip += 1 + (misses++ >> 6);
+            continue;
+        }
+        misses = 0;
+        while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+            ip--;
+            ref--;
+        }
+        size_t len = LZ_MIN_MATCH;
+        while (ip + len < end - 5 && ip[len] == ref[len])
+            len++;
+
+        uint8_t *token = op++;
+        op = lz_put_literals(op, token, anchor, (size_t)(ip - anchor));
+        size_t off = (size_t)(ip - ref);
+        *op++ = (uint8_t)(off & 0xFF);
+        *op++ = (uint8_t)(off >> 8);
+        size_t extra = len - LZ_MIN_MATCH;
+        *token |= (uint8_t)(extra >= 15 ? 15 : extra);
+        if (extra >= 15)
+            op = lz_put_len(op, extra - 15);
+        ip += len;
+        anchor = ip;
+    }
+    uint8_t *token = op++;
+    op = lz_put_literals(op, token, anchor, (size_t)(end - anchor));
+    return (size_t)(op - dst);
+}
+
+static int lz_get_len(const uint8_t **ip, const uint8_t *end, size_t *len) {
+    unsigned b;
+    do {
+        if (*ip >= end)
+            return -1;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+// Decompress exactly raw bytes into dst; returns 0, or -1 on corrupt input.
+static int lz_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t raw) {
+    const uint8_t *ip = src, *end = src + n;
+    uint8_t *op = dst, *oend = dst + raw;
+
+    while (ip < end) {
+        unsigned token = *ip++;
+        size_t lit = token >> 4;
+        if (lit == 15 && lz_get_len(&ip, end, &lit) != 0)
+            return -1;
+        if (lit > (size_t)(end - ip) || lit > (size_t)(oend - op))
+            return -1;
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip == end)
+            break;                       // the last sequence has no match
+
+        if (end - ip < 2)
+            return -1;
+        size_t off = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        size_t len = token & 15;
+        if (len == 15 && lz_get_len(&ip, end, &len) != 0)
+            return -1;
+        len += LZ_MIN_MATCH;
+        if (off == 0 || off > (size_t)(op - dst) || len > (size_t)(oend - op))
+            return -1;
+        const uint8_t *ref = op - off;
+        if (off >= len) {
+            memcpy(op, ref, len);
+        } else {
+            for (size_t i = 0; i < len; i++)   // overlapping copy repeats a pattern
+                op[i] = ref[i];
+        }
+        op += len;
+    }
+    return op == oend ? 0 : -1;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Shared helpers                                                            */
+
+static void run_fail(PackRun *r, const char *fmt, const char *what, int errnum) {
+    pthread_mutex_lock(&r->lock);
+    if (!r->failed) {
+        r->failed = 1;
+        if (r->err) {
+            snprintf(r->err, r->errlen, fmt, what);
+            if (errnum) {
+                size_t used = strlen(r->err);
+                snprintf(r->err + used, r->errlen - used, ": %s", strerror(errnum));
+            }
+        }
+    }
+    pthread_mutex_unlock(&r->lock);
+}
+
+// Reserve the next block and account the previous one; returns 0 when none is left.
+static int run_next(PackRun *r, uint64_t finished_bytes, uint64_t *block) {
+    pthread_mutex_lock(&r->lock);
+    r->done += finished_bytes;
+    if (finished_bytes && r->progress)
+        r->progress(r->done, r->total, r->ctx);
+    int more = !r->failed && r->next_block < r->nblocks;
+    if (more)
+        *block = r->next_block++;
+    pthread_mutex_unlock(&r->lock);
+    return more;
+}
+
+static int write_all(int fd, const void *buf, size_t len, uint64_t off) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, (off_t)off);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        off += (uint64_t)n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *buf, size_t len, uint64_t off) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, (off_t)off);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (n == 0) {
+            errno = 0;                   // short file
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        off += (uint64_t)n;
+    }
+    return 0;
+}
+
+static int choose_threads(int threads, uint64_t nblocks) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > PACK_MAX_THREADS)
+        threads = PACK_MAX_THREADS;
+    if ((uint64_t)threads > nblocks)
+        threads = nblocks > 0 ? (int)nblocks : 1;
+    return threads;
+}
+
+// Run worker() on 'threads' threads, the calling thread taking the last one.
+static void run_workers(PackRun *r, int threads, void *(*worker)(void *)) {
+    pthread_t tid[PACK_MAX_THREADS];
+    int started[PACK_MAX_THREADS] = {0};
+    for (int t = 0; t < threads - 1; t++)
+        started[t] = pthread_create(&tid[t], NULL, worker, r) == 0;
+    worker(r);
+    for (int t = 0; t < threads - 1; t++) {
+        if (started[t])
+            pthread_join(tid[t], NULL);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Packing                                                                   */
+
+typedef struct {
+    PackRun run;
+    size_t entries_cap, blocks_cap, strings_cap, strings_len;
+    dev_t archive_dev;
+    ino_t archive_ino;
+} PackBuilder;
+
+static int builder_string(PackBuilder *b, const char *s, uint32_t *off) {
+    size_t len = strlen(s) + 1;
+    if (b->strings_len + len > UINT32_MAX)
+        return -1;
+    if (b->strings_len + len > b->strings_cap) {
+        size_t cap = b->strings_cap ? b->strings_cap : 4096;
+        while (cap < b->strings_len + len)
+            cap *= 2;
+        char *tmp = realloc(b->run.strings, cap);
+        if (!tmp)
+            return -1;
+        b->run.strings = tmp;
+        b->strings_cap = cap;
+    }
+    memcpy(b->run.strings + b->strings_len, s, len);
+    *off = (uint32_t)b->strings_len;
+    b->strings_len += len;
+    return 0;
+}
+
+static int builder_add(PackBuilder *b, const char *fs_path, const char *arc_path,
+                       const struct stat *st) {
+    PackRun *r = &b->run;
+    if (r->nentries == b->entries_cap) {
+        size_t cap = b->entries_cap ? b->entries_cap * 2 : 256;
+        PackEntry *e = realloc(r->entries, cap * sizeof(*e));
+        if (!e)
+            return -1;
+        r->entries = e;
+        char **p = realloc(r->paths, cap * sizeof(*p));
+        if (!p)
+            return -1;
+        r->paths = p;
+        b->entries_cap = cap;
+    }
+    PackEntry *e = &r->entries[r->nentries];
+    memset(e, 0, sizeof(*e));
+    e->mode = (uint32_t)st->st_mode;
+    e->mtime_sec = (int64_t)st->st_mtim.tv_sec;
+    e->mtime_nsec = (int64_t)st->st_mtim.tv_nsec;
+    e->first_block = (uint32_t)r->nblocks;
+    e->link_off = PACK_NO_LINK;
+    if (builder_string(b, arc_path, &e->name_off) != 0)
+        return -1;
+    r->paths[r->nentries] = strdup(fs_path);
+    if (!r->paths[r->nentries])
+        return -1;
+
+    if (S_ISLNK(st->st_mode)) {
+        char target[4096];
+        ssize_t n = readlink(fs_path, target, sizeof(target) - 1);
+        if (n < 0)
+            return -1;
+        target[n] = '\0';
+        if (builder_string(b, target, &e->link_off) != 0)
+            return -1;
+    } else if (S_ISREG(st->st_mode)) {
+        e->size = (uint64_t)st->st_size;
+        uint64_t nblocks = (e->size + PACK_BLOCK_SIZE - 1) / PACK_BLOCK_SIZE;
+        if (r->nblocks + nblocks > UINT32_MAX)
+            return -1;
+        if (r->nblocks + nblocks > b->blocks_cap) {
+            size_t cap = b->blocks_cap ? b->blocks_cap : 1024;
+            while (cap < r->nblocks + nblocks)
+                cap *= 2;
+            PackBlock *bl = realloc(r->blocks, cap * sizeof(*bl));
+            if (!bl)
+                return -1;
+            r->blocks = bl;
+            b->blocks_cap = cap;
+        }
+        for (uint64_t i = 0; i < nblocks; i++) {
+            PackBlock *bl = &r->blocks[r->nblocks++];
+            memset(bl, 0, sizeof(*bl));
+            uint64_t left = e->size - i * PACK_BLOCK_SIZE;
+            bl->raw_len = (uint32_t)(left < PACK_BLOCK_SIZE ? left : PACK_BLOCK_SIZE);
+            bl->entry = (uint32_t)r->nentries;
+        }
+        r->total += e->size;
+    }
+    r->nentries++;
+    return 0;
+}
+
+// Add fs_path (recursively for directories) under the archive name arc_path.
+static int builder_walk(PackBuilder *b, const char *fs_path, const char *arc_path) {
+    struct stat st;
+    if (lstat(fs_path, &st) != 0) {
+        run_fail(&b->run, "%s", fs_path, errno);
+        return -1;
+    }
+    if (st.st_dev == b->archive_dev && st.st_ino == b->archive_ino)
+        return 0;                        // never pack the archive into itself
+    if (!S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode) && !S_ISLNK(st.st_mode))
+        return 0;                        // devices, sockets and fifos are skipped
+    if (builder_add(b, fs_path, arc_path, &st) != 0) {
+        run_fail(&b->run, "%s", fs_path, errno);
+        return -1;
+    }
+    if (!S_ISDIR(st.st_mode))
+        return 0;
+
+    DIR *dir = opendir(fs_path);
+    if (!dir) {
+        run_fail(&b->run, "%s", fs_path, errno);
+        return -1;
+    }
+    struct dirent *de;
+    int rc = 0;
+    while (rc == 0 && (de = readdir(dir)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        size_t fl = strlen(fs_path) + strlen(de->d_name) + 2;
+        size_t al = strlen(arc_path) + strlen(de->d_name) + 2;
+        char *child_fs = malloc(fl), *child_arc = malloc(al);
+        if (!child_fs || !child_arc) {
+            run_fail(&b->run, "%s", fs_path, ENOMEM);
+            rc = -1;
+        } else {
+            snprintf(child_fs, fl, "%s/%s", fs_path, de->d_name);
+            snprintf(child_arc, al, "%s/%s", arc_path, de->d_name);
+            rc = builder_walk(b, child_fs, child_arc);
+        }
+        free(child_fs);
+        free(child_arc);
+    }
+    closedir(dir);
+    return rc;
+}
+
+// Archive name of a command-line path: relative, without "." and ".." parts.
+static void archive_name(const char *path, char *out, size_t outlen) {
+    size_t o = 0;
+    const char *p = path;
+    while (*p) {
+        while (*p == '/')
+            p++;
+        const char *s = p;
+        while (*p && *p != '/')
+            p++;
+        size_t len = (size_t)(p - s);
+        if (len == 0 || (len == 1 && s[0] == '.') || (len == 2 && s[0] == '.' && s[1] == '.'))
+            continue;
+        if (o && o + 1 < outlen)
+            out[o++] = '/';
+        for (size_t i = 0; i < len && o + 1 < outlen; i++)
+            out[o++] = s[i];
+    }
+    out[o] = '\0';
+}
+
+static void *pack_worker(void *arg) {
+    PackRun *r = arg;
+    uint8_t *raw = malloc(PACK_BLOCK_SIZE);
+    uint8_t *packed = malloc(LZ_BOUND(PACK_BLOCK_SIZE));
+    uint32_t *table = malloc(sizeof(uint32_t) << LZ_HASH_BITS);
+    if (!raw || !packed || !table) {
+        run_fail(r, "%s", "out of memory", 0);
+        goto out;
+    }
+
+    uint64_t i, finished = 0;
+    int fd = -1;
+    uint32_t fd_entry = UINT32_MAX;
+    while (run_next(r, finished, &i)) {
+        PackBlock *bl = &r->blocks[i];
+        const PackEntry *e = &r->entries[bl->entry];
+        if (bl->entry != fd_entry) {
+            if (fd >= 0)
+                close(fd);
+            fd_entry = bl->entry;
+            fd = open(r->paths[bl->entry], O_RDONLY);
+            if (fd < 0) {
+                run_fail(r, "%s", r->paths[bl->entry], errno);
+                break;
+            }
+        }
+        uint64_t file_off = (uint64_t)(i - e->first_block) * PACK_BLOCK_SIZE;
+        if (read_all(fd, raw, bl->raw_len, file_off) != 0) {
+            if (errno)
+                run_fail(r, "%s", r->paths[bl->entry], errno);
+            else
+                run_fail(r, "%s: file shrank while packing", r->paths[bl->entry], 0);
+            break;
+        }
+        bl->crc = crc_update(0, raw, bl->raw_len);
+        size_t n = lz_compress(raw, bl->raw_len, packed, table);
+        const uint8_t *data = packed;
+        if (n >= bl->raw_len) {
+            n = bl->raw_len;
+            data = raw;
+        }
+        bl->packed_len = (uint32_t)n;
+
+        pthread_mutex_lock(&r->lock);
+        bl->offset = r->out_pos;
+        r->out_pos += n;
+        pthread_mutex_unlock(&r->lock);
+        if (write_all(r->fd, data, n, bl->offset) != 0) {
+            run_fail(r, "%s", "writing archive", errno);
+            break;
+        }
+        finished = bl->raw_len;
+    }
+    if (fd >= 0)
+        close(fd);
+out:
+    free(raw);
+    free(packed);
+    free(table);
+    return NULL;
+}
+
+static void run_free(PackRun *r) {
+    for (uint64_t i = 0; r->paths && i < r->nentries; i++)
+        free(r->paths[i]);
+    free(r->paths);
+    free(r->entries);
+    free(r->blocks);
+    free(r->strings);
+}
+
+/*
+ * Pack the given files and directories into a new archive using 'threads'
+ * workers (0: one per CPU). progress, when set, is called with the raw bytes done
+ * so far. Returns 0 and fills the counters, or -1 with a message in err.
+ */
+int pack_create(const char *archive, char *const paths[], int npaths, int threads,
+                PackProgress progress, void *ctx, uint64_t *files,
+                uint64_t *raw_bytes, uint64_t *packed_bytes, char *err, size_t errlen) {
+    PackBuilder b;
+    memset(&b, 0, sizeof(b));
+    PackRun *r = &b.run;
+    r->err = err;
+    r->errlen = errlen;
+    r->progress = progress;
+    r->ctx = ctx;
+    pthread_mutex_init(&r->lock, NULL);
+    crc_init();
+
+    r->fd = open(archive, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (r->fd < 0) {
+        run_fail(r, "%s", archive, errno);
+        pthread_mutex_destroy(&r->lock);
+        return -1;
+    }
+    struct stat ast;
+    if (fstat(r->fd, &ast) == 0) {
+        b.archive_dev = ast.st_dev;
+        b.archive_ino = ast.st_ino;
+    }
+
+    for (int i = 0; i < npaths && !r->failed; i++) {
+        char name[4096];
+        archive_name(paths[i], name, sizeof(name));
+        if (name[0] == '\0') {
+            // "." or "/" : pack the contents without a leading directory
+            DIR *dir = opendir(paths[i]);
+            if (!dir) {
+                run_fail(r, "%s", paths[i], errno);
+                break;
+            }
+            struct dirent *de;
+            while (!r->failed && (de = readdir(dir)) != NULL) {
+                if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+                    continue;
+                char fs[4096];
+                snprintf(fs, sizeof(fs), "%s/%s", paths[i], de->d_name);
+                builder_walk(&b, fs, de->d_name);
+            }
+            closedir(dir);
+        } else {
+            builder_walk(&b, paths[i], name);
+        }
+    }
+
+    r->out_pos = strlen(PACK_MAGIC);
+    if (!r->failed && write_all(r->fd, PACK_MAGIC, r->out_pos, 0) != 0)
+        run_fail(r, "%s", "writing archive", errno);
+    if (!r->failed && r->nblocks > 0)
+        run_workers(r, choose_threads(threads, r->nblocks), pack_worker);
+
+    if (!r->failed) {
+        PackTrailer t;
+        memset(&t, 0, sizeof(t));
+        t.index_offset = r->out_pos;
+        t.entries = r->nentries;
+        t.blocks = r->nblocks;
+        t.strings_len = b.strings_len;
+        t.block_size = PACK_BLOCK_SIZE;
+        size_t elen = r->nentries * sizeof(PackEntry);
+        size_t blen = r->nblocks * sizeof(PackBlock);
+        t.index_crc = crc_update(0, (const uint8_t *)r->entries, elen);
+        t.index_crc = crc_update(t.index_crc, (const uint8_t *)r->blocks, blen);
+        t.index_crc = crc_update(t.index_crc, (const uint8_t *)r->strings, b.strings_len);
+        memcpy(t.magic, PACK_TRAILER_MAGIC, sizeof(t.magic));
+        uint64_t pos = r->out_pos;
+        if (write_all(r->fd, r->entries, elen, pos) != 0 ||
+            write_all(r->fd, r->blocks, blen, pos + elen) != 0 ||
+            write_all(r->fd, r->strings, b.strings_len, pos + elen + blen) != 0 ||
+            write_all(r->fd, &t, sizeof(t), pos + elen + blen + b.strings_len) != 0)
+            run_fail(r, "%s", "writing archive", errno);
+        else
+            r->out_pos = pos + elen + blen + b.strings_len + sizeof(t);
+    }
+    if (close(r->fd) != 0 && !r->failed)
+        run_fail(r, "%s", "writing archive", errno);
+
+    int failed = r->failed;
+    if (failed) {
+        unlink(archive);
+    } else {
+        uint64_t nfiles = 0;
+        for (uint64_t i = 0; i < r->nentries; i++)
+            nfiles += S_ISREG(r->entries[i].mode) != 0;
+        if (files) *files = nfiles;
+        if (raw_bytes) *raw_bytes = r->total;
+        if (packed_bytes) *packed_bytes = r->out_pos;
+    }
+    run_free(r);
+    pthread_mutex_destroy(&r->lock);
+    return failed ? -1 : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Reading archives                                                          */
+
+// Open an archive and load its index into r; returns 0 or -1 with r->err set.
+static int archive_load(PackRun *r, const char *archive) {
+    r->fd = open(archive, O_RDONLY);
+    if (r->fd < 0) {
+        run_fail(r, "%s", archive, errno);
+        return -1;
+    }
+    struct stat st;
+    char magic[4];
+    PackTrailer t;
+    if (fstat(r->fd, &st) != 0 || (uint64_t)st.st_size < sizeof(magic) + sizeof(t) ||
+        read_all(r->fd, magic, sizeof(magic), 0) != 0 ||
+        memcmp(magic, PACK_MAGIC, sizeof(magic)) != 0 ||
+        read_all(r->fd, &t, sizeof(t), (uint64_t)st.st_size - sizeof(t)) != 0 ||
+        memcmp(t.magic, PACK_TRAILER_MAGIC, sizeof(t.magic)) != 0) {
+        run_fail(r, "%s: not a BUDOSTACK archive", archive, 0);
+        return -1;
+    }
+    uint64_t elen = t.entries * sizeof(PackEntry), blen = t.blocks * sizeof(PackBlock);
+    uint64_t index_end = (uint64_t)st.st_size - sizeof(t);
+    if (t.block_size != PACK_BLOCK_SIZE || t.entries > index_end || t.blocks > index_end ||
+        t.index_offset > index_end || elen + blen + t.strings_len != index_end - t.index_offset) {
+        run_fail(r, "%s: damaged archive index", archive, 0);
+        return -1;
+    }
+    r->nentries = t.entries;
+    r->nblocks = t.blocks;
+    r->entries = malloc(elen ? elen : 1);
+    r->blocks = malloc(blen ? blen : 1);
+    r->strings = malloc(t.strings_len + 1);
+    if (!r->entries || !r->blocks || !r->strings) {
+        run_fail(r, "%s", archive, ENOMEM);
+        return -1;
+    }
+    if (read_all(r->fd, r->entries, elen, t.index_offset) != 0 ||
+        read_all(r->fd, r->blocks, blen, t.index_offset + elen) != 0 ||
+        read_all(r->fd, r->strings, t.strings_len, t.index_offset + elen + blen) != 0) {
+        run_fail(r, "%s: damaged archive index", archive, 0);
+        return -1;
+    }
+    r->strings[t.strings_len] = '\0';
+    uint32_t crc = crc_update(0, (const uint8_t *)r->entries, elen);
+    crc = crc_update(crc, (const uint8_t *)r->blocks, blen);
+    crc = crc_update(crc, (const uint8_t *)r->strings, t.strings_len);
+    if (crc != t.index_crc) {
+        run_fail(r, "%s: damaged archive index", archive, 0);
+        return -1;
+    }
+
+    // Validate what the workers will trust.
+    for (uint64_t i = 0; i < r->nentries; i++) {
+        const PackEntry *e = &r->entries[i];
+        uint64_t nb = (e->size + PACK_BLOCK_SIZE - 1) / PACK_BLOCK_SIZE;
+        if (e->name_off >= t.strings_len ||
+            (e->link_off != PACK_NO_LINK && e->link_off >= t.strings_len) ||
+            (uint64_t)e->first_block + nb > r->nblocks) {
+            run_fail(r, "%s: damaged archive index", archive, 0);
+            return -1;
+        }
+    }
+    for (uint64_t i = 0; i < r->nblocks; i++) {
+        const PackBlock *bl = &r->blocks[i];
+        if (bl->entry >= r->nentries || bl->raw_len > PACK_BLOCK_SIZE ||
+            bl->packed_len > LZ_BOUND(PACK_BLOCK_SIZE) ||
+            bl->offset + bl->packed_len > t.index_offset ||
+            i < r->entries[bl->entry].first_block ||
+            (i - r->entries[bl->entry].first_block) * PACK_BLOCK_SIZE >= r->entries[bl->entry].size) {
+            run_fail(r, "%s: damaged archive index", archive, 0);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Return 1 if path starts with a BUDOSTACK archive header.
+int pack_is_archive(const char *path) {
+    char magic[4];
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    int ok = read_all(fd, magic, sizeof(magic), 0) == 0 &&
+             memcmp(magic, PACK_MAGIC, sizeof(magic)) == 0;
+    close(fd);
+    return ok;
+}
+
+// Print one line per entry: type, size, modification time, path.
+int pack_list(const char *archive, FILE *out, char *err, size_t errlen) {
+    PackRun r;
+    memset(&r, 0, sizeof(r));
+    r.err = err;
+    r.errlen = errlen;
+    r.fd = -1;
+    pthread_mutex_init(&r.lock, NULL);
+    crc_init();
+    int rc = archive_load(&r, archive);
+    for (uint64_t i = 0; rc == 0 && i < r.nentries; i++) {
+        const PackEntry *e = &r.entries[i];
+        char when[32];
+        time_t t = (time_t)e->mtime_sec;
+        struct tm tm;
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M", localtime_r(&t, &tm));
+        char type = S_ISDIR(e->mode) ? 'd' : S_ISLNK(e->mode) ? 'l' : '-';
+        fprintf(out, "%c %12llu  %s  %s", type, (unsigned long long)e->size, when,
+                r.strings + e->name_off);
+        if (e->link_off != PACK_NO_LINK)
+            fprintf(out, " -> %s", r.strings + e->link_off);
+        fputc('\n', out);
+    }
+    if (r.fd >= 0)
+        close(r.fd);
+    free(r.entries);
+    free(r.blocks);
+    free(r.strings);
+    pthread_mutex_destroy(&r.lock);
+    return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Unpacking                                                                 */
+
+// A stored name is safe when it is relative and has no ".." component.
+static int safe_name(const char *name) {
+    if (name[0] == '/' || name[0] == '\0')
+        return 0;
+    for (const char *p = name; *p; ) {
+        const char *s = p;
+        while (*p && *p != '/')
+            p++;
+        if (p - s == 2 && s[0] == '.' && s[1] == '.')
+            return 0;
+        while (*p == '/')
+            p++;
+    }
+    return 1;
+}
+
+// Is name equal to or below the selected path?
+static int select_matches(const char *name, const char *path) {
+    char want[4096];
+    archive_name(path, want, sizeof(want));
+    size_t len = strlen(want);
+    return len == 0 || (strncmp(name, want, len) == 0 && (name[len] == '\0' || name[len] == '/'));
+}
+
+// Is name selected by one of the paths (all entries when none)?
+static int selected(const char *name, char *const select[], int nselect) {
+    if (nselect == 0)
+        return 1;
+    for (int i = 0; i < nselect; i++) {
+        if (select_matches(name, select[i]))
+            return 1;
+    }
+    return 0;
+}
+
+static int make_dirs(char *path, mode_t mode) {
+    for (char *p = path + 1; *p; p++) {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        int rc = mkdir(path, 0755);
+        *p = '/';
+        if (rc != 0 && errno != EEXIST)
+            return -1;
+    }
+    if (mkdir(path, mode) != 0 && errno != EEXIST)
+        return -1;
+    return 0;
+}
+
+static void *unpack_worker(void *arg) {
+    PackRun *r = arg;
+    uint8_t *raw = malloc(PACK_BLOCK_SIZE);
+    uint8_t *packed = malloc(LZ_BOUND(PACK_BLOCK_SIZE));
+    if (!raw || !packed) {
+        run_fail(r, "%s", "out of memory", 0);
+        goto out;
+    }
+
+    uint64_t i, finished = 0;
+    int fd = -1;
+    uint32_t fd_entry = UINT32_MAX;
+    while (run_next(r, finished, &i)) {
+        const PackBlock *bl = &r->blocks[i];
+        finished = 0;
+        if (!r->paths[bl->entry])
+            continue;                    // not selected
+        const PackEntry *e = &r->entries[bl->entry];
+        if (read_all(r->fd, packed, bl->packed_len, bl->offset) != 0) {
+            run_fail(r, "%s: truncated archive", r->paths[bl->entry], 0);
+            break;
+        }
+        const uint8_t *data = packed;
+        if (bl->packed_len != bl->raw_len) {
+            if (lz_decompress(packed, bl->packed_len, raw, bl->raw_len) != 0) {
+                run_fail(r, "%s: damaged block", r->paths[bl->entry], 0);
+                break;
+            }
+            data = raw;
+        }
+        if (crc_update(0, data, bl->raw_len) != bl->crc) {
+            run_fail(r, "%s: checksum mismatch", r->paths[bl->entry], 0);
+            break;
+        }
+        if (bl->entry != fd_entry) {
+            if (fd >= 0)
+                close(fd);
+            fd_entry = bl->entry;
+            fd = open(r->paths[bl->entry], O_WRONLY | O_NOFOLLOW);
+            if (fd < 0) {
+                run_fail(r, "%s", r->paths[bl->entry], errno);
+                break;
+            }
+        }
+        uint64_t file_off = (uint64_t)(i - e->first_block) * PACK_BLOCK_SIZE;
+        if (write_all(fd, data, bl->raw_len, file_off) != 0) {
+            run_fail(r, "%s", r->paths[bl->entry], errno);
+            break;
+        }
+        finished = bl->raw_len;
+    }
+    if (fd >= 0)
+        close(fd);
+out:
+    free(raw);
+    free(packed);
+    return NULL;
+}
+
+static void set_times(const char *path, const PackEntry *e) {
+    struct timespec ts[2];
+    ts[0].tv_sec = ts[1].tv_sec = (time_t)e->mtime_sec;
+    ts[0].tv_nsec = ts[1].tv_nsec = (long)e->mtime_nsec;
+    utimensat(AT_FDCWD, path, ts, AT_SYMLINK_NOFOLLOW);
+}
+
+/*
+ * Extract an archive below destdir (NULL: the current directory). When select
+ * names paths, only those entries (and everything below them) are extracted; a
+ * path that matches nothing is an error. On failure the files created by this
+ * call are removed again. Returns 0 and fills the counters, or -1 with a message
+ * in err.
+ */
+int pack_extract(const char *archive, const char *destdir, char *const select[], int nselect,
+                 int threads, PackProgress progress, void *ctx, uint64_t *files,
+                 uint64_t *raw_bytes, char *err, size_t errlen) {
+    PackRun r;
+    memset(&r, 0, sizeof(r));
+    r.err = err;
+    r.errlen = errlen;
+    r.fd = -1;
+    r.progress = progress;
+    r.ctx = ctx;
+    pthread_mutex_init(&r.lock, NULL);
+    crc_init();
+    unsigned char *created = NULL;   // entries whose file or link this call made
+
+    if (archive_load(&r, archive) != 0)
+        goto done;
+    r.paths = calloc(r.nentries ? r.nentries : 1, sizeof(char *));
+    created = calloc(r.nentries ? r.nentries : 1, 1);
+    if (!r.paths || !created) {
+        run_fail(&r, "%s", archive, ENOMEM);
+        goto done;
+    }
+
+    // Every selected path must name something in the archive.
+    int unmatched = 0;
+    for (int s = 0; s < nselect; s++) {
+        uint64_t i = 0;
+        while (i < r.nentries && !select_matches(r.strings + r.entries[i].name_off, select[s]))
+            i++;
+        if (i == r.nentries && unmatched++ == 0)
+            run_fail(&r, "%s: not found in archive", select[s], 0);
+    }
+    if (unmatched > 1 && err) {
+        size_t used = strlen(err);
+        snprintf(err + used, errlen - used, " (and %d more)", unmatched - 1);
+    }
+    if (r.failed)
+        goto done;
+
+    // Directories and empty files first, so the workers only write data.
+    uint64_t nfiles = 0;
+    for (uint64_t i = 0; i < r.nentries && !r.failed; i++) {
+        const PackEntry *e = &r.entries[i];
+        const char *name = r.strings + e->name_off;
+        if (!selected(name, select, nselect))
+            continue;
+        if (!safe_name(name)) {
+            run_fail(&r, "%s: unsafe path in archive", name, 0);
+            break;
+        }
+        size_t len = (destdir ? strlen(destdir) + 1 : 0) + strlen(name) + 1;
+        char *path = malloc(len);
+        if (!path) {
+            run_fail(&r, "%s", name, ENOMEM);
+            break;
+        }
+        if (destdir)
+            snprintf(path, len, "%s/%s", destdir, name);
+        else
+            snprintf(path, len, "%s", name);
+        r.paths[i] = path;
+
+        char *slash = strrchr(path, '/');
+        if (slash) {
+            *slash = '\0';
+            int rc = make_dirs(path, 0755);
+            *slash = '/';
+            if (rc != 0) {
+                run_fail(&r, "%s", path, errno);
+                break;
+            }
+        }
+        if (S_ISDIR(e->mode)) {
+            if (make_dirs(path, 0700) != 0)
+                run_fail(&r, "%s", path, errno);
+        } else if (S_ISREG(e->mode)) {
+            unlink(path);                // never write through an existing link
+            int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, 0600);
+            if (fd >= 0)
+                created[i] = 1;
+            if (fd < 0 || ftruncate(fd, (off_t)e->size) != 0)
+                run_fail(&r, "%s", path, errno);
+            if (fd >= 0)
+                close(fd);
+            r.total += e->size;
+            nfiles++;
+        }
+    }
+
+    if (!r.failed && r.nblocks > 0)
+        run_workers(&r, choose_threads(threads, r.nblocks), unpack_worker);
+
+    if (!r.failed) {
+        // Links, then modes and times; directories last so their times stick.
+        for (uint64_t i = 0; i < r.nentries; i++) {
+            const PackEntry *e = &r.entries[i];
+            if (!r.paths[i] || !S_ISLNK(e->mode))
+                continue;
+            unlink(r.paths[i]);
+            if (symlink(r.strings + e->link_off, r.paths[i]) != 0) {
+                run_fail(&r, "%s", r.paths[i], errno);
+            } else {
+                created[i] = 1;
+                set_times(r.paths[i], e);
+            }
+        }
+        for (uint64_t i = 0; i < r.nentries; i++) {
+            const PackEntry *e = &r.entries[i];
+            if (r.paths[i] && S_ISREG(e->mode)) {
+                chmod(r.paths[i], (mode_t)(e->mode & 07777));
+                set_times(r.paths[i], e);
+            }
+        }
+        for (uint64_t i = r.nentries; i-- > 0; ) {
+            const PackEntry *e = &r.entries[i];
+            if (r.paths[i] && S_ISDIR(e->mode)) {
+                chmod(r.paths[i], (mode_t)(e->mode & 07777));
+                set_times(r.paths[i], e);
+            }
+        }
+    }
+    if (files) *files = nfiles;
+    if (raw_bytes) *raw_bytes = r.total;
+
+done:
+    // Do not leave half-written files behind (directories may have existed before).
+    for (uint64_t i = 0; r.failed && created && i < r.nentries; i++) {
+        if (created[i])
+            unlink(r.paths[i]);
+    }
+    free(created);
+    if (r.fd >= 0)
+        close(r.fd);
+    run_free(&r);
+    pthread_mutex_destroy(&r.lock);
+    return r.failed ? -1 : 0;
+}
@@ -27,12 +27,39 @@
  *   1. Resolution-specific constants.
  *   2. Static allocation of buffers to avoid repeated memory allocation.
  *   3. Tuned parameters (e.g., motion threshold, marker size) for this resolution.
+ *
+ * Region-of-interest tracking:
+ *   - process_frame_set_roi_tracking(1) enables a tracking mode. Once a full-frame scan
+ *     finds the target, the following frames only process a window around the position
+ *     predicted by a constant-velocity model (last measured center + smoothed velocity).
+ *     The window covers the last motion bounding box plus ROI_MARGIN cells and the
+ *     per-frame velocity.
+ *   - The tracker falls back to a full-frame scan when the window holds too little
+ *     motion (target lost) and every ROI_REFRESH_FRAMES frames for re-acquisition.
+ *   - The background model is still updated over the whole grid, so cells entering the
+ *     window compare against a current background; outside the window no motion is
+ *     marked and no overlay is drawn.
+ *
+ * Multi-threading:
+ *   - process_frame_set_threads(n) splits steps 2-4 into n horizontal tiles processed
+ *     on a persistent pool of n-1 worker threads plus the caller (POSIX threads). Each
+ *     stage reads one halo row above and below its tile from the neighbouring tiles,
+ *     so the stages are separated by barriers; the per-tile centroid sums are reduced
+ *     by the caller. Results are identical to the single-threaded path (n = 1, default).
+ *
+ * Profiling:
+ *   - process_frame_enable_timing(1) makes process_frame() accumulate the time spent
+ *     in its background/threshold, morphology and centroid stages (and suppresses the
+ *     per-frame diagnostics on stderr). process_frame_get_timing() reads the totals.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
+#include <stdint.h>
+#include <pthread.h>
 
 /* Camera resolution settings for a 320×240 camera */
 #define CAM_WIDTH    320
@@ -60,6 +87,15 @@
 // Low pass filter constant for stabilizing the marker position (0 < alpha <= 1)
 #define CROSSHAIR_LPF_ALPHA 0.5f
 
+// ROI tracking: window margin (grid cells) around the last motion bounding box, and
+// the number of tracked frames after which a full-frame scan is forced.
+#define ROI_MARGIN 12
+#define ROI_REFRESH_FRAMES 30
+#define ROI_VELOCITY_ALPHA 0.5f        // smoothing of the per-frame velocity estimate
+
+// Upper bound for process_frame_set_threads().
+#define MAX_TILE_THREADS 16
+
 // Marker size for the filled square (default is 3x3 pixels)
 #define MARKER_SIZE 6
 
@@ -97,6 +133,14 @@ static int *dilated_mask = NULL;           // Buffer for the dilation step
 static int last_center_x = CAM_WIDTH / 2;   // Last known x-coordinate of marker
 static int last_center_y = CAM_HEIGHT / 2;  // Last known y-coordinate of marker
 
+/* ROI tracking state (grid coordinates) */
+static int roi_enabled = 0;
+static int roi_tracking = 0;               // 1 while the previous frame found the target
+static int roi_frames_since_full = 0;
+static float track_x = 0.0f, track_y = 0.0f;    // last measured center
+static float track_vx = 0.0f, track_vy = 0.0f;  // smoothed velocity per frame
+static int track_w = 0, track_h = 0;            // last motion bounding box size
+
 /**********************************************************
  * Position structure
  *
@@ -107,6 +151,94 @@ typedef struct {
     int y;
 } Position;
 
+/**********************************************************
+ * StageTimings structure
+ *
+ * Accumulated per-stage processing time in milliseconds.
+ **********************************************************/
+typedef struct {
+    double background_ms;   // background update, threshold and overlay
+    double morphology_ms;   // erosion + dilation
+    double centroid_ms;     // center-of-motion sums and filtering
+    unsigned long frames;
+    unsigned long roi_frames;   // frames processed inside a tracking window
+} StageTimings;
+
+static int timing_enabled = 0;
+static StageTimings stage_timings;
+
+/**********************************************************
+ * Tile thread pool
+ *
+ * Workers sleep on pool_cond until pool_generation changes, then process
+ * their tile of tile_job. The stage barrier has one slot per tile.
+ **********************************************************/
+typedef struct {
+    long sum_x, sum_y;
+    int count;
+    int min_x, max_x, min_y, max_y;
+} CentroidSums;
+
+typedef struct {
+    unsigned char *frame;
+    int bx0, by0, bx1, by1;     // processing box in grid cells
+} TileJob;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int waiting;
+    int total;
+    unsigned long generation;
+} StageBarrier;
+
+static int pool_threads = 1;               // tiles per frame, including the caller
+static pthread_t pool_workers[MAX_TILE_THREADS];
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+static unsigned long pool_generation = 0;
+static unsigned long pool_start_generation = 0;
+static int pool_quit = 0;
+static StageBarrier stage_barrier = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 1, 0};
+static TileJob tile_job;
+static CentroidSums tile_sums[MAX_TILE_THREADS];
+
+static double timing_now_ms(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+void process_frame_enable_timing(int enable) {
+    timing_enabled = enable;
+    memset(&stage_timings, 0, sizeof(stage_timings));
+}
+
+StageTimings process_frame_get_timing(void) {
+    return stage_timings;
+}
+
+static void stage_barrier_wait(void) {
+    if (pool_threads == 1)
+        return;
+    pthread_mutex_lock(&stage_barrier.lock);
+    unsigned long gen = stage_barrier.generation;
+    if (++stage_barrier.waiting == stage_barrier.total) {
+        stage_barrier.waiting = 0;
+        stage_barrier.generation++;
+        pthread_cond_broadcast(&stage_barrier.cond);
+    } else {
+        while (gen == stage_barrier.generation)
+            pthread_cond_wait(&stage_barrier.cond, &stage_barrier.lock);
+    }
+    pthread_mutex_unlock(&stage_barrier.lock);
+}
+
+void process_frame_set_roi_tracking(int enable) {
+    roi_enabled = enable;
+    roi_tracking = 0;
+}
+
 /**********************************************************
  * set_pixel
  *
@@ -140,6 +272,230 @@ void draw_marker(unsigned char *frame, int frame_width, int frame_height,
     }
 }
 
+/**********************************************************
+ * Tile stages
+ *
+ * The background stage processes grid rows [row0, row1) of the whole grid, so
+ * the model stays current outside the tracking window; the remaining stages
+ * process rows [y0, y1) of the box in tile_job. Erosion and dilation read one
+ * halo row on either side, written by the neighbouring tile in the previous
+ * stage.
+ **********************************************************/
+/* Steps 1 & 2: update the background, mark motion and overlay the red gradient
+   (motion marking and the overlay only inside the box). */
+static void stage_background(int row0, int row1) {
+    const TileJob *job = &tile_job;
+    unsigned char *frame = job->frame;
+    int bx0 = job->bx0, by0 = job->by0, bx1 = job->bx1, by1 = job->by1;
+    int i;
+
+    // Grid rows map to whole frame rows, so only the rows of the tile are copied.
+    size_t row_bytes = GRID_WIDTH * 4;
+    memcpy(orig_frame + row0 * row_bytes, frame + row0 * row_bytes, (size_t)(row1 - row0) * row_bytes);
+
+    for (int gy = row0; gy < row1; gy++) {
+        int row_in_box = gy >= by0 && gy < by1;
+        for (int gx = 0; gx < GRID_WIDTH; gx++) {
+            i = gy * GRID_WIDTH + gx;
+            int base = i * 4;
+            float y1 = (float)orig_frame[base];
+            float y2 = (float)orig_frame[base + 2];
+            float currentY = (y1 + y2) / 2.0f;
+            float diff = fabsf(currentY - backgroundY[i]);
+            float alpha = BG_ALPHA_NO_MOTION;
+            if (diff > BG_MOTION_DIFF_THRESHOLD)
+                alpha = BG_ALPHA_MOTION;
+            backgroundY[i] = alpha * backgroundY[i] + (1.0f - alpha) * currentY;
+            if (!row_in_box || gx < bx0 || gx >= bx1)
+                continue;
+        
+            float dynamic_thresh = MOTION_THRESHOLD;
+#if ENABLE_ADAPTIVE_THRESHOLD
+            float adaptive_component = ADAPTIVE_FACTOR * (backgroundY[i] + 1.0f);
+            if (adaptive_component > dynamic_thresh)
+                dynamic_thresh = adaptive_component;
+#endif
+            if (diff > dynamic_thresh) {
+                float ratio = (diff - DARK_RED_MOVEMENT_LEVEL) / (BRIGHT_RED_MOVEMENT_LEVEL - DARK_RED_MOVEMENT_LEVEL);
+                if (ratio < 0.0f) ratio = 0.0f;
+                if (ratio > 1.0f) ratio = 1.0f;
+                unsigned char newY = DARK_RED_Y_VALUE + (unsigned char)(ratio * (BRIGHT_RED_Y_VALUE - DARK_RED_Y_VALUE));
+                frame[base]   = newY;
+                frame[base+1] = RED_U;
+                frame[base+2] = newY;
+                frame[base+3] = RED_V;
+                motion_mask[i] = 1;
+            } else {
+                frame[base]   = orig_frame[base];
+                frame[base+1] = orig_frame[base+1];
+                frame[base+2] = orig_frame[base+2];
+                frame[base+3] = orig_frame[base+3];
+                motion_mask[i] = 0;
+            }
+        }
+        if (row_in_box) {
+            memset(eroded_mask + gy * GRID_WIDTH + bx0, 0, (size_t)(bx1 - bx0) * sizeof(int));
+            memset(dilated_mask + gy * GRID_WIDTH + bx0, 0, (size_t)(bx1 - bx0) * sizeof(int));
+        }
+    }
+}
+
+/* Step 3a: a cell remains marked only if all its 3×3 neighbors are marked. */
+static void stage_erode(int y0, int y1) {
+    const TileJob *job = &tile_job;
+    int x, y;
+    int ys = (y0 > job->by0 + 1) ? y0 : job->by0 + 1;
+    int ye = (y1 < job->by1 - 1) ? y1 : job->by1 - 1;
+    for (y = ys; y < ye; y++) {
+        for (x = job->bx0 + 1; x < job->bx1 - 1; x++) {
+            int idx = y * GRID_WIDTH + x;
+            int all_one = 1;
+            for (int ny = y - 1; ny <= y + 1; ny++) {
+                for (int nx = x - 1; nx <= x + 1; nx++) {
+                    int nidx = ny * GRID_WIDTH + nx;
+                    if (motion_mask[nidx] == 0) { all_one = 0; break; }
+                }
+                if (!all_one) break;
+            }
+            eroded_mask[idx] = all_one;
+        }
+    }
+}
+
+/* Step 3b: expand motion regions by checking adjacent cells. */
+static void stage_dilate(int y0, int y1) {
+    const TileJob *job = &tile_job;
+    int x, y;
+    int ys = (y0 > job->by0 + 1) ? y0 : job->by0 + 1;
+    int ye = (y1 < job->by1 - 1) ? y1 : job->by1 - 1;
+    for (y = ys; y < ye; y++) {
+        for (x = job->bx0 + 1; x < job->bx1 - 1; x++) {
+            int idx = y * GRID_WIDTH + x;
+            if (eroded_mask[idx] == 1) {
+                dilated_mask[idx] = 1;
+            } else {
+                int found = 0;
+                for (int ny = y - 1; ny <= y + 1 && !found; ny++) {
+                    for (int nx = x - 1; nx <= x + 1; nx++) {
+                        int nidx = ny * GRID_WIDTH + nx;
+                        if (eroded_mask[nidx] == 1) { found = 1; break; }
+                    }
+                }
+                dilated_mask[idx] = found;
+            }
+        }
+    }
+}
+
+/* Step 4: partial sums for the geometric center and the motion bounding box. */
+static void stage_centroid(int y0, int y1, CentroidSums *out) {
+    const TileJob *job = &tile_job;
+    int x, y;
+    long sum_x = 0, sum_y = 0;
+    int count = 0;
+    int min_x = GRID_WIDTH, max_x = -1, min_y = GRID_HEIGHT, max_y = -1;
+    for (y = y0; y < y1; y++) {
+        for (x = job->bx0; x < job->bx1; x++) {
+            int idx = y * GRID_WIDTH + x;
+            if (dilated_mask[idx] == 1) {
+                sum_x += x;
+                sum_y += y;
+                count++;
+                if (x < min_x) min_x = x;
+                if (x > max_x) max_x = x;
+                if (y < min_y) min_y = y;
+                if (y > max_y) max_y = y;
+            }
+        }
+    }
+    *out = (CentroidSums){sum_x, sum_y, count, min_x, max_x, min_y, max_y};
+}
+
+/*
+ * Run all stages for one tile. Tile 0 runs on the calling thread and records
+ * the stage timings (wall time of each stage including the barrier wait).
+ */
+static void run_tile(int tile, double *t_stage) {
+    int rows = tile_job.by1 - tile_job.by0;
+    int y0 = tile_job.by0 + rows * tile / pool_threads;
+    int y1 = tile_job.by0 + rows * (tile + 1) / pool_threads;
+
+    stage_background(GRID_HEIGHT * tile / pool_threads, GRID_HEIGHT * (tile + 1) / pool_threads);
+    stage_barrier_wait();
+    if (t_stage && timing_enabled) {
+        double t = timing_now_ms();
+        stage_timings.background_ms += t - *t_stage;
+        *t_stage = t;
+    }
+    stage_erode(y0, y1);
+    stage_barrier_wait();
+    stage_dilate(y0, y1);
+    stage_barrier_wait();
+    if (t_stage && timing_enabled) {
+        double t = timing_now_ms();
+        stage_timings.morphology_ms += t - *t_stage;
+        *t_stage = t;
+    }
+    stage_centroid(y0, y1, &tile_sums[tile]);
+    stage_barrier_wait();
+}
+
+static void *pool_worker(void *arg) {
+    int tile = (int)(intptr_t)arg;
+    unsigned long seen = pool_start_generation;
+    for (;;) {
+        pthread_mutex_lock(&pool_lock);
+        while (pool_generation == seen && !pool_quit)
+            pthread_cond_wait(&pool_cond, &pool_lock);
+        if (pool_quit) {
+            pthread_mutex_unlock(&pool_lock);
+            return NULL;
+        }
+        seen = pool_generation;
+        pthread_mutex_unlock(&pool_lock);
+        run_tile(tile, NULL);
+    }
+}
+
+/**********************************************************
+ * process_frame_set_threads
+ *
+ * Sets the number of tiles (threads, including the caller) used by
+ * process_frame(). Must not be called while process_frame() is running.
+ **********************************************************/
+void process_frame_set_threads(int threads) {
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_TILE_THREADS)
+        threads = MAX_TILE_THREADS;
+    if (threads == pool_threads)
+        return;
+
+    // Stop the current workers.
+    if (pool_threads > 1) {
+        pthread_mutex_lock(&pool_lock);
+        pool_quit = 1;
+        pthread_cond_broadcast(&pool_cond);
+        pthread_mutex_unlock(&pool_lock);
+        for (int t = 1; t < pool_threads; t++)
+            pthread_join(pool_workers[t], NULL);
+        pool_quit = 0;
+    }
+
+    int started = 1;
+    pool_start_generation = pool_generation;
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&pool_workers[t], NULL, pool_worker, (void *)(intptr_t)t) != 0) {
+            fprintf(stderr, "process_frame: started only %d of %d threads.\n", started, threads);
+            break;
+        }
+        started++;
+    }
+    pool_threads = started;
+    stage_barrier.total = started;
+    stage_barrier.waiting = 0;
+}
+
 /**********************************************************
  * process_frame
  *
@@ -156,10 +512,15 @@ void draw_marker(unsigned char *frame, int frame_width, int frame_height,
  *   5. Convert grid coordinates to frame coordinates and low pass filter the center.
  *   6. Draw the marker at the computed center and return its position.
  *
+ * The background model is updated over the whole grid every frame; thresholding
+ * and steps 3-4 run over a bounding box: the whole grid, or in ROI tracking mode
+ * the window around the predicted position. Each stage is split into one tile
+ * per pool thread (see process_frame_set_threads).
+ *
  * Assumes the frame is in YUYV format.
  **********************************************************/
 Position process_frame(unsigned char *frame, size_t frame_size, int frame_width, int frame_height) {
-    int i, x, y;
+    int i;
     
     // Allocate buffers on first call.
     if (orig_frame == NULL) {
@@ -182,101 +543,75 @@ Position process_frame(unsigned char *frame, size_t frame_size, int frame_width,
         return (Position){CAM_WIDTH / 2, CAM_HEIGHT / 2};
     }
     
-    memcpy(orig_frame, frame, frame_size);
-    
-    /* --- Step 1 & 2: Update background and mark motion ---
-       For each grid cell, compute the average brightness and update the background.
-       If the difference (diff) exceeds the threshold, mark the cell as motion.
-       Also overlay a red gradient based on the diff value.
-    */
-    for (i = 0; i < GRID_SIZE; i++) {
-        int base = i * 4;
-        float y1 = (float)orig_frame[base];
-        float y2 = (float)orig_frame[base + 2];
-        float currentY = (y1 + y2) / 2.0f;
-        float diff = fabsf(currentY - backgroundY[i]);
-        float alpha = BG_ALPHA_NO_MOTION;
-        if (diff > BG_MOTION_DIFF_THRESHOLD)
-            alpha = BG_ALPHA_MOTION;
-        backgroundY[i] = alpha * backgroundY[i] + (1.0f - alpha) * currentY;
-        
-        float dynamic_thresh = MOTION_THRESHOLD;
-#if ENABLE_ADAPTIVE_THRESHOLD
-        float adaptive_component = ADAPTIVE_FACTOR * (backgroundY[i] + 1.0f);
-        if (adaptive_component > dynamic_thresh)
-            dynamic_thresh = adaptive_component;
-#endif
-        if (diff > dynamic_thresh) {
-            float ratio = (diff - DARK_RED_MOVEMENT_LEVEL) / (BRIGHT_RED_MOVEMENT_LEVEL - DARK_RED_MOVEMENT_LEVEL);
-            if (ratio < 0.0f) ratio = 0.0f;
-            if (ratio > 1.0f) ratio = 1.0f;
-            unsigned char newY = DARK_RED_Y_VALUE + (unsigned char)(ratio * (BRIGHT_RED_Y_VALUE - DARK_RED_Y_VALUE));
-            frame[base]   = newY;
-            frame[base+1] = RED_U;
-            frame[base+2] = newY;
-            frame[base+3] = RED_V;
-            motion_mask[i] = 1;
-        } else {
-            frame[base]   = orig_frame[base];
-            frame[base+1] = orig_frame[base+1];
-            frame[base+2] = orig_frame[base+2];
-            frame[base+3] = orig_frame[base+3];
-            motion_mask[i] = 0;
-        }
+    double t_stage = timing_enabled ? timing_now_ms() : 0.0;
+
+    /* Choose the processing box: the full grid, or the tracking window. */
+    int bx0 = 0, by0 = 0, bx1 = GRID_WIDTH, by1 = GRID_HEIGHT;
+    int use_roi = roi_enabled && roi_tracking && roi_frames_since_full < ROI_REFRESH_FRAMES;
+    if (use_roi) {
+        float px = track_x + track_vx;
+        float py = track_y + track_vy;
+        int half_w = track_w / 2 + ROI_MARGIN + (int)fabsf(track_vx);
+        int half_h = track_h / 2 + ROI_MARGIN + (int)fabsf(track_vy);
+        bx0 = (int)px - half_w;
+        bx1 = (int)px + half_w + 1;
+        by0 = (int)py - half_h;
+        by1 = (int)py + half_h + 1;
+        if (bx0 < 0) bx0 = 0;
+        if (by0 < 0) by0 = 0;
+        if (bx1 > GRID_WIDTH) bx1 = GRID_WIDTH;
+        if (by1 > GRID_HEIGHT) by1 = GRID_HEIGHT;
+        roi_frames_since_full++;
+        stage_timings.roi_frames += timing_enabled;
+    } else {
+        roi_frames_since_full = 0;
     }
-    
-    /* --- Step 3: Noise reduction via 3×3 erosion and dilation ---
-       Erosion: A cell remains marked only if all its 3×3 neighbors are marked.
-       Dilation: Expand motion regions by checking adjacent cells.
+
+    /* --- Steps 1-4: background, threshold, morphology and partial centroid sums ---
+       Each stage is split into horizontal tiles, one per pool thread; tile 0 runs here.
     */
-    memset(eroded_mask, 0, GRID_SIZE * sizeof(int));
-    for (y = 1; y < GRID_HEIGHT - 1; y++) {
-        for (x = 1; x < GRID_WIDTH - 1; x++) {
-            int idx = y * GRID_WIDTH + x;
-            int all_one = 1;
-            for (int ny = y - 1; ny <= y + 1; ny++) {
-                for (int nx = x - 1; nx <= x + 1; nx++) {
-                    int nidx = ny * GRID_WIDTH + nx;
-                    if (motion_mask[nidx] == 0) { all_one = 0; break; }
-                }
-                if (!all_one) break;
-            }
-            eroded_mask[idx] = all_one;
-        }
+    tile_job = (TileJob){frame, bx0, by0, bx1, by1};
+    if (pool_threads > 1) {
+        pthread_mutex_lock(&pool_lock);
+        pool_generation++;
+        pthread_cond_broadcast(&pool_cond);
+        pthread_mutex_unlock(&pool_lock);
     }
-    memset(dilated_mask, 0, GRID_SIZE * sizeof(int));
-    for (y = 1; y < GRID_HEIGHT - 1; y++) {
-        for (x = 1; x < GRID_WIDTH - 1; x++) {
-            int idx = y * GRID_WIDTH + x;
-            if (eroded_mask[idx] == 1) {
-                dilated_mask[idx] = 1;
-            } else {
-                int found = 0;
-                for (int ny = y - 1; ny <= y + 1 && !found; ny++) {
-                    for (int nx = x - 1; nx <= x + 1; nx++) {
-                        int nidx = ny * GRID_WIDTH + nx;
-                        if (eroded_mask[nidx] == 1) { found = 1; break; }
-                    }
-                }
-                dilated_mask[idx] = found;
-            }
-        }
-    }
-    
-    /* --- Step 4: Compute geometric center ---
-         Simply average the grid coordinates of all cells marked as motion.
-         This yields the center-of-motion based on the detected movement.
-    */
+    run_tile(0, &t_stage);
+
+    // Reduce the per-tile centroid sums.
     long sum_x = 0, sum_y = 0;
     int count = 0;
-    for (y = 0; y < GRID_HEIGHT; y++) {
-        for (x = 0; x < GRID_WIDTH; x++) {
-            int idx = y * GRID_WIDTH + x;
-            if (dilated_mask[idx] == 1) {
-                sum_x += x;
-                sum_y += y;
-                count++;
+    int min_x = GRID_WIDTH, max_x = -1, min_y = GRID_HEIGHT, max_y = -1;
+    for (int t = 0; t < pool_threads; t++) {
+        const CentroidSums *ts = &tile_sums[t];
+        sum_x += ts->sum_x;
+        sum_y += ts->sum_y;
+        count += ts->count;
+        if (ts->min_x < min_x) min_x = ts->min_x;
+        if (ts->max_x > max_x) max_x = ts->max_x;
+        if (ts->min_y < min_y) min_y = ts->min_y;
+        if (ts->max_y > max_y) max_y = ts->max_y;
+    }
+    if (roi_enabled) {
+        /* Update the constant-velocity predictor; losing the target (or a full scan
+           without motion) drops back to full-frame scanning. */
+        if (count >= MIN_MOVEMENT_PIXELS) {
+            float cx = sum_x / (float)count;
+            float cy = sum_y / (float)count;
+            if (roi_tracking) {
+                track_vx = ROI_VELOCITY_ALPHA * (cx - track_x) + (1.0f - ROI_VELOCITY_ALPHA) * track_vx;
+                track_vy = ROI_VELOCITY_ALPHA * (cy - track_y) + (1.0f - ROI_VELOCITY_ALPHA) * track_vy;
+            } else {
+                track_vx = track_vy = 0.0f;
             }
+            track_x = cx;
+            track_y = cy;
+            track_w = max_x - min_x + 1;
+            track_h = max_y - min_y + 1;
+            roi_tracking = 1;
+        } else {
+            roi_tracking = 0;
         }
     }
     if (count >= MIN_MOVEMENT_PIXELS) {
@@ -286,10 +621,15 @@ Position process_frame(unsigned char *frame, size_t frame_size, int frame_width,
                               (1.0f - CROSSHAIR_LPF_ALPHA) * last_center_x);
         last_center_y = (int)(CROSSHAIR_LPF_ALPHA * measured_center_y +
                               (1.0f - CROSSHAIR_LPF_ALPHA) * last_center_y);
-        fprintf(stderr, "Center-of-motion at (%d, %d) with %d pixels.\n", measured_center_x, measured_center_y, count);
-    } else {
+        if (!timing_enabled)
+            fprintf(stderr, "Center-of-motion at (%d, %d) with %d pixels.\n", measured_center_x, measured_center_y, count);
+    } else if (!timing_enabled) {
         fprintf(stderr, "Insufficient motion detected (only %d pixels).\n", count);
     }
+    if (timing_enabled) {
+        stage_timings.centroid_ms += timing_now_ms() - t_stage;
+        stage_timings.frames++;
+    }
     
     /* --- Step 5: Draw the marker and return the center position --- */
     draw_marker(frame, frame_width, frame_height, last_center_x, last_center_y, marker_color);
@@ -17,6 +17,12 @@
  *  - A new printing function (table_print_highlight_ex) now displays Excel–like row numbers and
  *    column letters outside the table grid.
  *  - A new function adjust_cell_references() adjusts cell references in a formula when cells are copy-pasted.
+ *  - Evaluated formula values are cached per cell together with the ranges the formula
+ *    references. Each referenced cell also lists the formulas that reference it, so editing
+ *    a cell walks only the formulas that depend on it (directly or through other formulas)
+ *    instead of scanning the table; adding or deleting rows/columns drops the whole cache.
+ *    table_get_display() returns the cached value, so redraws never re-parse formulas.
+ *    Circular references evaluate to "#ERR".
  *
  * To compile: cc -std=c11 -Wall -Wextra -pedantic -o table_app table.c libtable.c
  */
@@ -31,15 +37,179 @@
 #define INITIAL_COLS 1
 #define MAX_CELL_LENGTH 256
 
+// Cache states of a formula cell.
+#define CACHE_STALE 0
+#define CACHE_EVALUATING 1
+#define CACHE_VALID 2
+
+// Cached evaluation of one formula cell and the cell ranges it references.
+typedef struct {
+    char *value;        // evaluated display string when state == CACHE_VALID
+    int state;
+    int (*deps)[4];     // referenced ranges as {row0, col0, row1, col1} (table indices)
+    int dep_count;
+    int dep_capacity;
+    int (*dependents)[2];   // reverse index: formula cells {row, col} whose deps cover this cell
+    int dependent_count;
+    int dependent_capacity;
+} CellCache;
+
 // Define the Table structure and alias.
 typedef struct Table {
     int rows;
     int cols;
     char ***cells;  // cells[row][col] is a dynamically allocated string.
+    CellCache **cache;   // cache[row][col], sized cache_rows x cache_cols
+    int cache_rows;
+    int cache_cols;
 } Table;
 
 // Forward declaration for the formula evaluation function.
 char *evaluate_formula(const Table *t, const char *formula);
+const char *table_get_display(const Table *t, int row, int col, int show_formulas);
+
+/*
+ * Formula value cache.
+ */
+
+static void cache_free(Table *t) {
+    if (!t->cache) return;
+    for (int i = 0; i < t->cache_rows; i++) {
+        for (int j = 0; j < t->cache_cols; j++) {
+            free(t->cache[i][j].value);
+            free(t->cache[i][j].deps);
+            free(t->cache[i][j].dependents);
+        }
+        free(t->cache[i]);
+    }
+    free(t->cache);
+    t->cache = NULL;
+    t->cache_rows = t->cache_cols = 0;
+}
+
+// Drops all cached values and sizes the cache to the current table (after structural changes).
+static void cache_reset(Table *t) {
+    cache_free(t);
+    t->cache = calloc(t->rows, sizeof(CellCache *));
+    if (!t->cache) return;
+    for (int i = 0; i < t->rows; i++) {
+        t->cache[i] = calloc(t->cols, sizeof(CellCache));
+        if (!t->cache[i]) {
+            t->cache_rows = i;
+            t->cache_cols = t->cols;
+            cache_free(t);
+            return;
+        }
+    }
+    t->cache_rows = t->rows;
+    t->cache_cols = t->cols;
+}
+
+// Set when a reverse index entry could not be stored; the next edit then drops the cache.
+static int index_incomplete = 0;
+
+// Clamps a dependency range to the cached cells; returns 0 when nothing is left.
+static int cache_clamp(const Table *t, const int *d, int *r0, int *c0, int *r1, int *c1) {
+    *r0 = d[0] < 0 ? 0 : d[0];
+    *c0 = d[1] < 0 ? 0 : d[1];
+    *r1 = d[2] < t->cache_rows ? d[2] : t->cache_rows - 1;
+    *c1 = d[3] < t->cache_cols ? d[3] : t->cache_cols - 1;
+    return *r0 <= *r1 && *c0 <= *c1;
+}
+
+// Adds formula cell (row, col) to the reverse index of every cell in range d.
+static void cache_link(const Table *t, const int *d, int row, int col) {
+    int r0, c0, r1, c1;
+    if (!cache_clamp(t, d, &r0, &c0, &r1, &c1)) return;
+    for (int i = r0; i <= r1; i++) {
+        for (int j = c0; j <= c1; j++) {
+            CellCache *cc = &t->cache[i][j];
+            int n = cc->dependent_count;
+            if (n > 0 && cc->dependents[n - 1][0] == row && cc->dependents[n - 1][1] == col)
+                continue;   // same cell referenced twice by one formula
+            if (n == cc->dependent_capacity) {
+                int capacity = n ? n * 2 : 4;
+                int (*temp)[2] = realloc(cc->dependents, sizeof(*temp) * capacity);
+                if (!temp) {
+                    index_incomplete = 1;
+                    continue;
+                }
+                cc->dependents = temp;
+                cc->dependent_capacity = capacity;
+            }
+            cc->dependents[n][0] = row;
+            cc->dependents[n][1] = col;
+            cc->dependent_count++;
+        }
+    }
+}
+
+// Removes formula cell (row, col) from the reverse index of every cell it referenced.
+static void cache_unlink(const Table *t, const CellCache *formula, int row, int col) {
+    for (int k = 0; k < formula->dep_count; k++) {
+        int r0, c0, r1, c1;
+        if (!cache_clamp(t, formula->deps[k], &r0, &c0, &r1, &c1)) continue;
+        for (int i = r0; i <= r1; i++) {
+            for (int j = c0; j <= c1; j++) {
+                CellCache *cc = &t->cache[i][j];
+                for (int n = 0; n < cc->dependent_count; ) {
+                    if (cc->dependents[n][0] == row && cc->dependents[n][1] == col) {
+                        cc->dependent_count--;
+                        cc->dependents[n][0] = cc->dependents[cc->dependent_count][0];
+                        cc->dependents[n][1] = cc->dependents[cc->dependent_count][1];
+                    } else {
+                        n++;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Marks the cell and every formula that depends on it (transitively) as stale.
+static void cache_invalidate(Table *t, int row, int col) {
+    if (!t->cache || row >= t->cache_rows || col >= t->cache_cols) return;
+    if (index_incomplete) {
+        index_incomplete = 0;
+        cache_reset(t);
+        return;
+    }
+    int capacity = 16, count = 0;
+    int (*queue)[2] = malloc(sizeof(*queue) * capacity);
+    if (!queue) {
+        cache_reset(t);
+        return;
+    }
+    t->cache[row][col].state = CACHE_STALE;
+    queue[count][0] = row;
+    queue[count][1] = col;
+    count++;
+    while (count > 0) {
+        count--;
+        const CellCache *src = &t->cache[queue[count][0]][queue[count][1]];
+        for (int k = 0; k < src->dependent_count; k++) {
+            int i = src->dependents[k][0], j = src->dependents[k][1];
+            CellCache *cc = &t->cache[i][j];
+            if (cc->state != CACHE_VALID)
+                continue;
+            cc->state = CACHE_STALE;
+            if (count == capacity) {
+                capacity *= 2;
+                int (*temp)[2] = realloc(queue, sizeof(*queue) * capacity);
+                if (!temp) {
+                    free(queue);
+                    cache_reset(t);
+                    return;
+                }
+                queue = temp;
+            }
+            queue[count][0] = i;
+            queue[count][1] = j;
+            count++;
+        }
+    }
+    free(queue);
+}
 
 /*
  * Basic table functions: create, free, print, access, add row/column,
@@ -65,11 +235,14 @@ Table *table_create(void) {
     }
     // Set the index column header.
     t->cells[0][0] = strdup("Index");
+    t->cache = NULL;
+    cache_reset(t);
     return t;
 }
 
 void table_free(Table *t) {
     if (!t) return;
+    cache_free(t);
     for (int i = 0; i < t->rows; i++) {
         for (int j = 0; j < t->cols; j++) {
             if (t->cells[i][j])
@@ -104,6 +277,11 @@ static void get_column_label(int col, char *buf, size_t buf_size) {
     buf[((size_t)len < buf_size ? (size_t)len : buf_size - 1)] = '\0';
 }
 
+// Public wrapper: Excel–like label of a table column (1 = A).
+void table_get_column_label(int col, char *buf, size_t buf_size) {
+    get_column_label(col, buf, buf_size);
+}
+
 /*
  * Updated printing function:
  *
@@ -161,14 +339,7 @@ void table_print_highlight_ex(const Table *t, int highlight_row, int highlight_c
 
             // Prepare the cell content.
             char buffer[1024];
-            const char *cell_content = t->cells[i][j] ? t->cells[i][j] : "";
-            if (!show_formulas && cell_content[0] == '=') {
-                char *eval_result = evaluate_formula(t, cell_content);
-                snprintf(buffer, sizeof(buffer), "%s", eval_result);
-                free(eval_result);
-            } else {
-                snprintf(buffer, sizeof(buffer), "%s", cell_content);
-            }
+            snprintf(buffer, sizeof(buffer), "%s", table_get_display(t, i, j, show_formulas));
 
             if (i == highlight_row && j == highlight_col) {
                 // For the selected cell, print its allocated cell region (15 characters)
@@ -216,12 +387,115 @@ static int in_bounds(const Table *t, int row, int col) {
     return t && row >= 0 && row < t->rows && col >= 0 && col < t->cols;
 }
 
+// Parser state; saved and restored around the evaluation of referenced formula cells.
+static int formula_error = 0;
+static CellCache *recording = NULL;   // cell whose dependencies are being recorded
+static const Table *recording_table = NULL;
+static int recording_row, recording_col;
+static int cycle_hit = 0;             // a circular reference was found below this evaluation
+
+/*
+ * Returns the value of a cell as displayed in evaluated view: the raw content,
+ * or for formulas the cached result (evaluated on demand).
+ */
+static const char *cell_value(const Table *t, int row, int col) {
+    if (!in_bounds(t, row, col))
+        return "";
+    const char *raw = t->cells[row][col] ? t->cells[row][col] : "";
+    if (raw[0] != '=')
+        return raw;
+    if (!t->cache || row >= t->cache_rows || col >= t->cache_cols) {
+        // No cache (allocation failed): evaluate into a static buffer.
+        static char uncached[64];
+        int saved_error = formula_error;
+        char *v = evaluate_formula(t, raw);
+        formula_error = saved_error;
+        snprintf(uncached, sizeof(uncached), "%s", v ? v : "#ERR");
+        free(v);
+        return uncached;
+    }
+    CellCache *cc = &t->cache[row][col];
+    if (cc->state == CACHE_VALID)
+        return cc->value;
+    if (cc->state == CACHE_EVALUATING) {
+        cycle_hit = 1;
+        return "#ERR";
+    }
+
+    int saved_error = formula_error;
+    CellCache *saved_recording = recording;
+    const Table *saved_table = recording_table;
+    int saved_row = recording_row, saved_col = recording_col;
+    int saved_cycle = cycle_hit;
+    cc->state = CACHE_EVALUATING;
+    cache_unlink(t, cc, row, col);
+    cc->dep_count = 0;
+    recording = cc;
+    recording_table = t;
+    recording_row = row;
+    recording_col = col;
+    cycle_hit = 0;
+    char *v = evaluate_formula(t, raw);
+    if (cycle_hit) {
+        free(v);
+        v = strdup("#ERR");
+    }
+    int inner_cycle = cycle_hit;
+    formula_error = saved_error;
+    recording = saved_recording;
+    recording_table = saved_table;
+    recording_row = saved_row;
+    recording_col = saved_col;
+    cycle_hit = saved_cycle || inner_cycle;
+
+    free(cc->value);
+    cc->value = v;
+    cc->state = CACHE_VALID;
+    return v ? v : "#ERR";
+}
+
+// Records a referenced range (table indices) for the formula being evaluated and
+// adds the formula to the reverse index of the referenced cells.
+static void record_dependency(int row0, int col0, int row1, int col1) {
+    if (!recording) return;
+    if (recording->dep_count == recording->dep_capacity) {
+        int capacity = recording->dep_capacity ? recording->dep_capacity * 2 : 4;
+        int (*temp)[4] = realloc(recording->deps, sizeof(*temp) * capacity);
+        if (!temp) {
+            index_incomplete = 1;
+            return;
+        }
+        recording->deps = temp;
+        recording->dep_capacity = capacity;
+    }
+    int *d = recording->deps[recording->dep_count++];
+    d[0] = row0;
+    d[1] = col0;
+    d[2] = row1;
+    d[3] = col1;
+    cache_link(recording_table, d, recording_row, recording_col);
+}
+
+/*
+ * Returns the text shown for a cell: the raw content when show_formulas is set,
+ * otherwise the (cached) evaluated value. The pointer is valid until the table
+ * is next modified.
+ */
+const char *table_get_display(const Table *t, int row, int col, int show_formulas) {
+    if (!in_bounds(t, row, col))
+        return "";
+    if (show_formulas)
+        return t->cells[row][col] ? t->cells[row][col] : "";
+    return cell_value(t, row, col);
+}
+
 // Set cell at (row, col) to given value.
 int table_set_cell(Table *t, int row, int col, const char *value) {
     if (!t || !in_bounds(t, row, col)) return -1;
     if (col == 0) return -1; // do not edit index column
     free(t->cells[row][col]);
     t->cells[row][col] = strdup(value);
+    cache_invalidate(t, row, col);
     return 0;
 }
 
@@ -240,6 +514,7 @@ int table_add_row(Table *t) {
         t->cells[new_row][j] = strdup("");
     }
     t->rows++;
+    cache_reset(t);
     return 0;
 }
 
@@ -256,6 +531,7 @@ int table_add_col(Table *t, const char *header) {
             t->cells[i][new_col] = strdup("");
     }
     t->cols++;
+    cache_reset(t);
     return 0;
 }
 
@@ -396,6 +672,8 @@ Table *table_load_csv(const char *filename) {
     t->rows = rows;
     t->cols = cols;
     t->cells = cells;
+    t->cache = NULL;
+    cache_reset(t);
     return t;
 }
 
@@ -414,9 +692,6 @@ Table *table_load_csv(const char *filename) {
  * the evaluated result is "#ERR".
  */
 
-// Global variable used by the parser to indicate an error.
-static int formula_error = 0;
-
 // Helper: Skip whitespace characters.
 static void skip_whitespace(const char **s) {
     while (**s == ' ' || **s == '\t')
@@ -521,22 +796,12 @@ static double parse_factor(const Table *t, const char **s) {
             int tc2 = end_col;
             if (tr1 > tr2) { int temp = tr1; tr1 = tr2; tr2 = temp; }
             if (tc1 > tc2) { int temp = tc1; tc1 = tc2; tc2 = temp; }
+            record_dependency(tr1, tc1, tr2, tc2);
             double sum = 0;
             int count = 0;
             for (int r = tr1; r <= tr2; r++) {
                 for (int c = tc1; c <= tc2; c++) {
-                    const char *cell_val = table_get_cell(t, r, c);
-                    double num_val = 0;
-                    if (cell_val && cell_val[0] == '=') {
-                        char *eval_str = evaluate_formula(t, cell_val);
-                        if (eval_str) {
-                            num_val = atof(eval_str);
-                            free(eval_str);
-                        }
-                    } else {
-                        num_val = atof(cell_val);
-                    }
-                    sum += num_val;
+                    sum += atof(cell_value(t, r, c));
                     count++;
                 }
             }
@@ -558,18 +823,8 @@ static double parse_factor(const Table *t, const char **s) {
             }
             int table_row = row - 1;
             int table_col = col;
-            const char *cell_val = table_get_cell(t, table_row, table_col);
-            double cell_num = 0;
-            if (cell_val && cell_val[0] == '=') {
-                char *eval_str = evaluate_formula(t, cell_val);
-                if (eval_str) {
-                    cell_num = atof(eval_str);
-                    free(eval_str);
-                }
-            } else {
-                cell_num = atof(cell_val);
-            }
-            return cell_num;
+            record_dependency(table_row, table_col, table_row, table_col);
+            return atof(cell_value(t, table_row, table_col));
         }
     } else {
         // Expect a number.
@@ -770,6 +1025,7 @@ int table_delete_column(Table *t, int col) {
         t->cells[i] = realloc(t->cells[i], sizeof(char *) * (t->cols - 1));
     }
     t->cols--;
+    cache_reset(t);
     return 0;
 }
 
@@ -791,6 +1047,7 @@ int table_delete_row(Table *t, int row) {
     }
     t->rows--;
     t->cells = realloc(t->cells, sizeof(char **) * t->rows);
+    cache_reset(t);
     return 0;
 }
 
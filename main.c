@@ -16,6 +16,7 @@
 #include <sys/select.h> // For select()
 #include <dirent.h>     // For directory handling
 #include <sys/stat.h>   // For stat()
+#include <glob.h>       // For glob() in "each"
 
 #include "commandparser.h"
 #include "input.h"      // Include the input handling header
@@ -288,9 +289,12 @@ int is_realtime_command(const char *command) {
     return 0;
 }
 
+static void page_output(char *output, size_t total_size);
+
 /*
  * Updated execute_command_with_paging():
  * - For realtime commands (or when the "-nopaging" flag is provided), execute directly.
+ * - Shared-object commands run in-process with their output captured in memory.
  * - Otherwise, fork a child process to execute the command and capture its output.
  */
 void execute_command_with_paging(CommandStruct *cmd) {
@@ -317,6 +321,23 @@ void execute_command_with_paging(CommandStruct *cmd) {
         return;
     }
     
+    if (command_runs_inprocess(cmd->command)) {
+        char *output = NULL;
+        size_t total_size = 0;
+        int status;
+        FILE *mem = open_memstream(&output, &total_size);
+        if (mem) {
+            run_command_inprocess(cmd, mem, &status);
+            if (fclose(mem) == 0) {
+                /* open_memstream() keeps a terminator past the data */
+                page_output(output, total_size);
+                return;
+            }
+            free(output);
+            return;
+        }
+    }
+    
     int pipefd[2];
     if (pipe(pipefd) == -1) {
         perror("pipe");
@@ -407,6 +428,15 @@ void execute_command_with_paging(CommandStruct *cmd) {
     }
     close(pipefd[0]);
     
+    page_output(output, total_size);
+}
+
+/*
+ * page_output(): print captured command output, through the pager when it does
+ * not fit on one screen. output must have room for a terminator at
+ * output[total_size]; it is freed here.
+ */
+static void page_output(char *output, size_t total_size) {
     if (total_size == 0) {
         free(output);
         return;
@@ -464,6 +494,340 @@ void execute_command_with_paging(CommandStruct *cmd) {
     free(output);
 }
 
+/*
+ * Background jobs.
+ * A command line ending in '&' is run in a forked child while the prompt comes
+ * back at once. Its output goes straight to the terminal (no paging). Finished
+ * jobs are reported before the next prompt; "jobs" lists the running ones and
+ * "wait [id]" blocks until one or all of them have finished.
+ */
+#define MAX_JOBS 32
+
+typedef struct {
+    int id;                  /* 0: free slot */
+    pid_t pid;
+    char line[INPUT_SIZE];
+} Job;
+
+static Job jobs[MAX_JOBS];
+
+static int run_each(const char *args);
+
+/* Run a command line in the current process and return an exit status */
+static int run_line(const char *line) {
+    if (strncmp(line, "each", 4) == 0 && (line[4] == ' ' || line[4] == '\0'))
+        return run_each(line + 4);
+
+    CommandStruct c;
+    memset(&c, 0, sizeof(c));
+    parse_input(line, &c);
+    int status = execute_command(&c);
+    free_command_struct(&c);
+    return status;
+}
+
+/* Print how a job ended and free its slot */
+static void finish_job(Job *job, int status) {
+    if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+        printf("[%d] Exit %d    %s\n", job->id, WEXITSTATUS(status), job->line);
+    else if (WIFSIGNALED(status))
+        printf("[%d] Killed (signal %d)    %s\n", job->id, WTERMSIG(status), job->line);
+    else
+        printf("[%d] Done    %s\n", job->id, job->line);
+    job->id = 0;
+}
+
+/* Collect finished jobs without blocking */
+static void reap_jobs(void) {
+    for (int i = 0; i < MAX_JOBS; i++) {
+        int status;
+        if (jobs[i].id && waitpid(jobs[i].pid, &status, WNOHANG) == jobs[i].pid)
+            finish_job(&jobs[i], status);
+    }
+}
+
+static void start_job(const char *line) {
+    int slot = -1, id = 1;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (!jobs[i].id) {
+            if (slot < 0)
+                slot = i;
+        } else if (jobs[i].id >= id) {
+            id = jobs[i].id + 1;
+        }
+    }
+    if (slot < 0) {
+        fprintf(stderr, "Too many background jobs (max %d).\n", MAX_JOBS);
+        return;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        return;
+    }
+    if (pid == 0) {
+        /*
+         * The job gets its own process group so CTRL+C at the prompt reaches
+         * neither it nor the commands it execs (which reset SIGINT to the
+         * default), and stdin is detached so they cannot steal keystrokes.
+         */
+        setpgid(0, 0);
+        int devnull = open("/dev/null", O_RDONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDIN_FILENO);
+            close(devnull);
+        }
+        int status = run_line(line);
+        fflush(stdout);
+        exit(status);
+    }
+    setpgid(pid, pid);   /* also here, so the group exists before we return */
+    jobs[slot].id = id;
+    jobs[slot].pid = pid;
+    strncpy(jobs[slot].line, line, sizeof(jobs[slot].line) - 1);
+    jobs[slot].line[sizeof(jobs[slot].line) - 1] = '\0';
+    printf("[%d] %d\n", id, (int)pid);
+}
+
+static void list_jobs(void) {
+    reap_jobs();
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].id)
+            printf("[%d] Running %d    %s\n", jobs[i].id, (int)jobs[i].pid, jobs[i].line);
+    }
+}
+
+/* wait: block until job <arg> (or every job when arg is empty) has finished */
+static void wait_jobs(const char *arg) {
+    while (*arg == ' ')
+        arg++;
+    if (*arg == '%')
+        arg++;
+    int id = *arg ? atoi(arg) : 0;
+    int found = 0;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (!jobs[i].id || (id && jobs[i].id != id))
+            continue;
+        found = 1;
+        int status;
+        if (waitpid(jobs[i].pid, &status, 0) == jobs[i].pid)
+            finish_job(&jobs[i], status);
+        else
+            jobs[i].id = 0;
+    }
+    if (id && !found)
+        fprintf(stderr, "wait: no such job: %d\n", id);
+}
+
+/*
+ * each [-j workers] <pattern> <command> [args...]
+ * Runs the command once per file matching the glob pattern, with at most
+ * 'workers' runs at a time (default: all CPUs). A "{}" argument is replaced by
+ * the file name, otherwise the name is appended. Output is shown in file order:
+ * the oldest unfinished run streams to the terminal while later ones are
+ * buffered until their turn.
+ */
+#define MAX_EACH_WORKERS 64
+
+typedef struct {
+    pid_t pid;
+    int fd;                  /* read end of the output pipe, -1 when closed */
+    int done;
+    int status;
+    char *buf;               /* output held back until this run is printed */
+    size_t len, cap;
+} EachRun;
+
+static int each_start(EachRun *run, const char *line) {
+    int pipefd[2];
+    if (pipe(pipefd) == -1) {
+        perror("pipe");
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        signal(SIGINT, SIG_DFL);
+        dup2(pipefd[1], STDOUT_FILENO);
+        dup2(pipefd[1], STDERR_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        int status = run_line(line);
+        fflush(stdout);
+        exit(status);
+    }
+    close(pipefd[1]);
+    run->pid = pid;
+    run->fd = pipefd[0];
+    return 0;
+}
+
+static void each_hold(EachRun *run, const char *data, size_t n) {
+    if (run->len + n > run->cap) {
+        size_t cap = run->cap ? run->cap : 4096;
+        while (cap < run->len + n)
+            cap *= 2;
+        char *tmp = realloc(run->buf, cap);
+        if (!tmp) {
+            perror("realloc");
+            return;
+        }
+        run->buf = tmp;
+        run->cap = cap;
+    }
+    memcpy(run->buf + run->len, data, n);
+    run->len += n;
+}
+
+static int run_each(const char *args) {
+    char buffer[INPUT_SIZE];
+    strncpy(buffer, args, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+
+    char *argv[INPUT_SIZE / 2];
+    int argc = 0;
+    char *saveptr;
+    for (char *tok = strtok_r(buffer, " ", &saveptr); tok; tok = strtok_r(NULL, " ", &saveptr))
+        argv[argc++] = tok;
+
+    int workers = 0, first = 0;
+    if (argc >= 2 && strcmp(argv[0], "-j") == 0) {
+        workers = atoi(argv[1]);
+        first = 2;
+    }
+    if (argc - first < 2) {
+        fprintf(stderr, "Usage: each [-j workers] <pattern> <command> [args...]\n");
+        return EXIT_FAILURE;
+    }
+    const char *pattern = argv[first];
+
+    glob_t files;
+    int ret = glob(pattern, 0, NULL, &files);
+    if (ret != 0) {
+        if (ret == GLOB_NOMATCH)
+            fprintf(stderr, "each: no files match '%s'\n", pattern);
+        else
+            fprintf(stderr, "each: cannot expand '%s'\n", pattern);
+        globfree(&files);
+        return EXIT_FAILURE;
+    }
+    size_t n = files.gl_pathc;
+
+    if (workers <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (int)cpus : 1;
+    }
+    if (workers > MAX_EACH_WORKERS)
+        workers = MAX_EACH_WORKERS;
+
+    EachRun *runs = calloc(n, sizeof(EachRun));
+    if (!runs) {
+        perror("calloc");
+        globfree(&files);
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < n; i++)
+        runs[i].fd = -1;
+
+    size_t next_start = 0, next_print = 0;
+    int running = 0, failed = 0;
+    char chunk[4096];
+
+    while (next_print < n) {
+        /* Keep the workers busy */
+        while (running < workers && next_start < n) {
+            char line[INPUT_SIZE];
+            size_t len = 0;
+            int placed = 0;
+            for (int a = first + 1; a < argc && len < sizeof(line); a++) {
+                const char *word = argv[a];
+                if (strcmp(word, "{}") == 0) {
+                    word = files.gl_pathv[next_start];
+                    placed = 1;
+                }
+                len += (size_t)snprintf(line + len, sizeof(line) - len, "%s%s",
+                                        len ? " " : "", word);
+            }
+            if (!placed && len < sizeof(line))
+                len += (size_t)snprintf(line + len, sizeof(line) - len, " %s",
+                                        files.gl_pathv[next_start]);
+            EachRun *run = &runs[next_start++];
+            if (len >= sizeof(line)) {
+                fprintf(stderr, "each: command line too long for %s\n", files.gl_pathv[next_start - 1]);
+                run->done = 1;
+                failed++;
+            } else if (each_start(run, line) != 0) {
+                run->done = 1;
+                failed++;
+            } else {
+                running++;
+            }
+        }
+
+        /* Print finished runs in order; the oldest live run streams directly */
+        while (next_print < n && runs[next_print].done) {
+            fwrite(runs[next_print].buf ? runs[next_print].buf : "", 1, runs[next_print].len, stdout);
+            free(runs[next_print].buf);
+            runs[next_print].buf = NULL;
+            next_print++;
+        }
+        if (next_print < n && runs[next_print].len) {
+            fwrite(runs[next_print].buf, 1, runs[next_print].len, stdout);
+            runs[next_print].len = 0;
+        }
+        fflush(stdout);
+        if (next_print >= n || running == 0)
+            continue;
+
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        int maxfd = -1;
+        for (size_t i = next_print; i < next_start; i++) {
+            if (runs[i].fd >= 0) {
+                FD_SET(runs[i].fd, &readfds);
+                if (runs[i].fd > maxfd)
+                    maxfd = runs[i].fd;
+            }
+        }
+        if (select(maxfd + 1, &readfds, NULL, NULL, NULL) < 0)
+            continue;
+        for (size_t i = next_print; i < next_start; i++) {
+            EachRun *run = &runs[i];
+            if (run->fd < 0 || !FD_ISSET(run->fd, &readfds))
+                continue;
+            ssize_t got = read(run->fd, chunk, sizeof(chunk));
+            if (got > 0) {
+                if (i == next_print)
+                    fwrite(chunk, 1, (size_t)got, stdout);
+                else
+                    each_hold(run, chunk, (size_t)got);
+                continue;
+            }
+            close(run->fd);
+            run->fd = -1;
+            waitpid(run->pid, &run->status, 0);
+            if (!WIFEXITED(run->status) || WEXITSTATUS(run->status) != 0)
+                failed++;
+            run->done = 1;
+            running--;
+        }
+    }
+
+    if (failed)
+        fprintf(stderr, "each: %d of %zu runs failed\n", failed, n);
+    free(runs);
+    globfree(&files);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 int main(int argc, char *argv[]) {
     char *input;
     CommandStruct cmd;
@@ -534,6 +898,7 @@ int main(int argc, char *argv[]) {
 
     /* Main loop */
     while (1) {
+        reap_jobs();
         display_prompt();
         input = read_input();
         if (input == NULL) {
@@ -649,6 +1014,38 @@ int main(int argc, char *argv[]) {
             free(input);
             continue;
         }
+        /* Job control built-ins: "jobs" and "wait [id]" */
+        if (strcmp(input, "jobs") == 0) {
+            list_jobs();
+            free(input);
+            continue;
+        }
+        if (strncmp(input, "wait", 4) == 0 && (input[4] == ' ' || input[4] == '\0')) {
+            wait_jobs(input + 4);
+            free(input);
+            continue;
+        }
+        /* A trailing '&' runs the line as a background job */
+        size_t input_len = strlen(input);
+        while (input_len > 0 && input[input_len - 1] == ' ')
+            input[--input_len] = '\0';
+        if (input_len > 0 && input[input_len - 1] == '&') {
+            input[--input_len] = '\0';
+            while (input_len > 0 && input[input_len - 1] == ' ')
+                input[--input_len] = '\0';
+            if (input_len > 0)
+                start_job(input);
+            else
+                fprintf(stderr, "&: missing command\n");
+            free(input);
+            continue;
+        }
+        /* Built-in "each": run a command over a glob on all cores */
+        if (strncmp(input, "each", 4) == 0 && (input[4] == ' ' || input[4] == '\0')) {
+            run_each(input + 4);
+            free(input);
+            continue;
+        }
         /* Default processing for other commands */
         parse_input(input, &cmd);
         execute_command_with_paging(&cmd);
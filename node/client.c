@@ -25,11 +25,22 @@
  *   - Uses select() to multiplex I/O between the network socket and console.
  *   - Respects a simple line-based protocol for client-server messages.
  *
+ * Plugin ABI:
+ *   The same source can also be built as a shared object (-DNODE_PLUGIN -fPIC -shared)
+ *   and loaded by node/nodehost, which runs many nodes in one process and one epoll loop.
+ *   A plugin exports a single symbol "node_plugin" of type NodePlugin (see below). The host
+ *   hands the plugin a NodeHost with callbacks to emit on an output channel and to watch
+ *   file descriptors; input channel messages arrive through on_input(). The two structs are
+ *   copied verbatim into every node that supports the ABI (no header files), so bump
+ *   NODE_PLUGIN_ABI_VERSION whenever either layout changes.
+ *
  * Compilation Example:
  *   gcc -std=c11 -Wall -Wextra -pedantic -o client_template client_template.c
+ *   gcc -std=c11 -Wall -Wextra -pedantic -DNODE_PLUGIN -fPIC -shared -o client.so client.c
  *
  * Run Example:
  *   ./client_template [server_ip] [port]
+ *   ./nodehost node/client.so
  *
  * Future Usage:
  *   - If you create a new client program, simply copy/rename this file (e.g. "my_client.c"),
@@ -45,7 +56,6 @@
 #include <unistd.h>       // close(), read(), etc.
 #include <arpa/inet.h>    // socket, connect(), etc.
 #include <sys/select.h>   // select()
-#include <ctype.h>        // isdigit()
 
 // ---------------------------------------------------------
 // Constants
@@ -54,6 +64,30 @@
 #define DEFAULT_IP   "127.0.0.1"
 #define BUFFER_SIZE  512
 
+// ---------------------------------------------------------
+// Node plugin ABI (keep identical in every node and in nodehost.c)
+// ---------------------------------------------------------
+#define NODE_PLUGIN_ABI_VERSION 1
+
+typedef struct NodeHost {
+    int abi_version;
+    void *ctx;                                                  // opaque, pass back to callbacks
+    void (*emit)(void *ctx, int channel, const char *msg);      // publish on outN
+    int  (*watch_fd)(void *ctx, int fd);                        // call on_fd() when fd is readable
+    void (*unwatch_fd)(void *ctx, int fd);
+} NodeHost;
+
+typedef struct NodePlugin {
+    int abi_version;
+    const char *name;
+    int tick_ms;                                                // 0 = no periodic on_tick()
+    void *(*init)(const NodeHost *host, int argc, char **argv); // returns plugin state or NULL
+    void (*on_fd)(void *state, int fd);
+    void (*on_input)(void *state, int channel, const char *msg);
+    void (*on_tick)(void *state);
+    void (*shutdown)(void *state);
+} NodePlugin;
+
 // ---------------------------------------------------------
 // Helper function: remove newline chars from a string
 // ---------------------------------------------------------
@@ -64,6 +98,115 @@ static void trim_newline(char *s) {
     if (p) *p = '\0';
 }
 
+// ---------------------------------------------------------
+// Node logic: shared by the standalone executable and the plugin
+// ---------------------------------------------------------
+typedef struct {
+    const NodeHost *host;
+} ClientState;
+
+static void *client_init(const NodeHost *host, int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    ClientState *st = calloc(1, sizeof(*st));
+    if (!st)
+        return NULL;
+    st->host = host;
+    if (host->watch_fd(host->ctx, STDIN_FILENO) < 0) {
+        free(st);
+        return NULL;
+    }
+    return st;
+}
+
+// Read one console line and publish it if it is a valid "outN: message".
+static void client_on_fd(void *state, int fd) {
+    ClientState *st = state;
+    char buffer[BUFFER_SIZE];
+    (void)fd;
+
+    if (fgets(buffer, sizeof(buffer), stdin) == NULL) {
+        // End-of-file detected (Ctrl+D): stop listening to the console.
+        st->host->unwatch_fd(st->host->ctx, STDIN_FILENO);
+        return;
+    }
+    trim_newline(buffer);
+
+    if (strlen(buffer) == 0) {
+        return; // ignore empty lines
+    }
+
+    // Validate that the message begins with "out", one channel digit and a colon.
+    // Example: "out0: Hello"
+    if (strncmp(buffer, "out", 3) == 0 && buffer[3] >= '0' && buffer[3] <= '4' && buffer[4] == ':') {
+        const char *msg = buffer + 5;
+        while (*msg == ' ' || *msg == '\t') msg++;
+        st->host->emit(st->host->ctx, buffer[3] - '0', msg);
+    } else {
+        printf("Invalid format. Use 'outN: message' where N is 0-4.\n");
+    }
+}
+
+static void client_on_input(void *state, int channel, const char *msg) {
+    (void)state;
+    printf("in%d: %s\n", channel, msg);
+    fflush(stdout);
+}
+
+static void client_shutdown(void *state) {
+    free(state);
+}
+
+const NodePlugin node_plugin = {
+    NODE_PLUGIN_ABI_VERSION,
+    "client",
+    0,
+    client_init,
+    client_on_fd,
+    client_on_input,
+    NULL,
+    client_shutdown
+};
+
+#ifndef NODE_PLUGIN
+// ---------------------------------------------------------
+// Standalone host: one socket to the switchboard, select() loop
+// ---------------------------------------------------------
+typedef struct {
+    int sockfd;
+    int stdin_open;
+    int send_failed;   // the connection is gone: leave the loop
+} StandaloneHost;
+
+static void standalone_emit(void *ctx, int channel, const char *msg) {
+    StandaloneHost *sh = ctx;
+    char line[BUFFER_SIZE + 16];
+    // Append a newline for protocol compliance.
+    int len = snprintf(line, sizeof(line), "out%d: %s\n", channel, msg);
+    if (len >= (int)sizeof(line)) {
+        line[sizeof(line) - 2] = '\n';
+        len = (int)sizeof(line) - 1;
+    }
+    if (len > 0 && send(sh->sockfd, line, (size_t)len, 0) < 0) {
+        perror("send");
+        sh->send_failed = 1;
+    }
+}
+
+static int standalone_watch_fd(void *ctx, int fd) {
+    StandaloneHost *sh = ctx;
+    if (fd != STDIN_FILENO)
+        return -1;
+    sh->stdin_open = 1;
+    return 0;
+}
+
+static void standalone_unwatch_fd(void *ctx, int fd) {
+    StandaloneHost *sh = ctx;
+    if (fd == STDIN_FILENO)
+        sh->stdin_open = 0;
+}
+
 // ---------------------------------------------------------
 // Main: Template Client App Entry Point
 // ---------------------------------------------------------
@@ -111,12 +254,22 @@ int main(int argc, char *argv[]) {
     printf("Enter messages in the format 'outN: message' (N = 0..4).\n");
     printf("Press Ctrl+D to exit.\n");
 
+    StandaloneHost sh = { sockfd, 0, 0 };
+    NodeHost host = { NODE_PLUGIN_ABI_VERSION, &sh, standalone_emit,
+                      standalone_watch_fd, standalone_unwatch_fd };
+    void *state = node_plugin.init(&host, argc, argv);
+    if (!state) {
+        fprintf(stderr, "Failed to initialize client.\n");
+        close(sockfd);
+        return 1;
+    }
+
     // Set up the event loop to monitor both the server socket and standard input.
     fd_set readfds;
     int maxfd = (sockfd > STDIN_FILENO ? sockfd : STDIN_FILENO);
     char buffer[BUFFER_SIZE];
 
-    while (1) {
+    while (sh.stdin_open && !sh.send_failed) {
         FD_ZERO(&readfds);
         FD_SET(sockfd, &readfds);
         FD_SET(STDIN_FILENO, &readfds);
@@ -141,34 +294,14 @@ int main(int argc, char *argv[]) {
 
         // Check for user input from stdin.
         if (FD_ISSET(STDIN_FILENO, &readfds)) {
-            if (fgets(buffer, sizeof(buffer), stdin) == NULL) {
-                // End-of-file detected (Ctrl+D)
+            node_plugin.on_fd(state, STDIN_FILENO);
+            if (!sh.stdin_open)
                 printf("Exiting.\n");
-                break;
-            }
-            trim_newline(buffer);
-
-            if (strlen(buffer) == 0) {
-                continue; // ignore empty lines
-            }
-
-            // Validate that the message begins with "out" followed by a digit.
-            // Example: "out0: Hello"
-            if (strncmp(buffer, "out", 3) == 0 && isdigit((unsigned char)buffer[3])) {
-                size_t len = strlen(buffer);
-                // Append a newline for protocol compliance.
-                buffer[len]     = '\n';
-                buffer[len + 1] = '\0';
-                if (send(sockfd, buffer, strlen(buffer), 0) < 0) {
-                    perror("send");
-                    break;
-                }
-            } else {
-                printf("Invalid format. Use 'outN: message' where N is 0-4.\n");
-            }
         }
     }
 
+    node_plugin.shutdown(state);
     close(sockfd);
     return 0;
 }
+#endif
@@ -7,11 +7,13 @@
    1. Diffuse Lighting & Face Shading:
       - Each face is filled using a simple Lambertian lighting model.
       - A fixed light direction is used to compute brightness for visible faces.
-      - A scanline polygon fill algorithm fills visible faces with an intensity
-        corresponding to the computed light.
+      - Triangles are filled by a fixed-point edge-function rasterizer (28.4
+        sub-cell coordinates, top-left fill rule, incremental edge stepping).
    
-   2. Hidden Surface Removal (Back‑Face Culling):
+   2. Hidden Surface Removal (Back‑Face Culling + Z-Buffer):
       - Faces not oriented toward the viewer (based on their normals) are culled.
+      - A per-cell 16.16 fixed-point depth buffer resolves overlapping faces, so
+        arbitrary (non-convex) meshes render correctly.
    
    3. Anti‑Aliased Wireframe Edges:
       - Wireframe edges are drawn using an adaptation of Xiaolin Wu’s algorithm
@@ -31,18 +33,39 @@
       - The text "AALTO" is overlaid onto the cube using an auxiliary overlay buffer,
         so the characters are actually printed.
    
+   8. Mesh Loading:
+      - "gui_aalto model.obj" renders a Wavefront OBJ mesh ("v" and "f" records,
+        polygons are fan-triangulated) scaled to the size of the cube. Without an
+        argument the built-in cube is shown; -w draws the wireframe for OBJ meshes.
+   
+   9. Terminal Output:
+      - The display uses the whole terminal. Only cells whose character or color
+        changed since the previous frame are emitted, and the frame goes out in a
+        single write().
+      - The bottom line reports the triangle count and the average frame time
+        (transform + rasterization + output encoding).
+      - "--bench N" renders N frames without output and prints the timings.
+   
    Design Principles:
      - Single‑file plain C (‑std=c11) using only standard cross‑platform libraries.
      - No header files; all functionality is contained in one source file.
      - Comments explain design decisions and enhance clarity.
    
-   Compile with: cc -std=c11 -O2 -o cube cube.c -lm -pthread
+   Compile with: cc -std=c11 -O2 -o gui_aalto gui_aalto.c -lm -pthread
+   Usage:        gui_aalto [model.obj] [-w] [--bench N]
 */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <math.h>
 #include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
 #include <threads.h>  // C11 thread support for thrd_sleep
 
 #define SCREEN_WIDTH 80
@@ -51,6 +74,12 @@
 #define ASPECT_RATIO 0.5
 #define CUBE_SIZE 0.9
 #define FOCAL_LENGTH 55.0
+#define NEAR_PLANE 0.1
+
+// Rasterizer fixed-point formats: 28.4 screen coordinates and 16.16 depth.
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL (1 << SUBPIXEL_BITS)
+#define DEPTH_ONE 65536.0
 
 // Gradient for mapping intensity (0.0 to 1.0) to an ASCII character.
 // The characters progress from "dim" (space) to "bright" (@).
@@ -62,6 +91,16 @@ typedef struct { double x, y, z; } Point3D;
 typedef struct { double x, y; } Point2D;
 // Structure representing a face defined by 4 vertex indices.
 typedef struct { int v[4]; } Face;
+// Triangle of a mesh (vertex indices).
+typedef struct { int v[3]; } Triangle;
+
+// Mesh rendered each frame: the built-in cube or a loaded OBJ model.
+typedef struct {
+    Point3D *vertices;
+    int vertex_count;
+    Triangle *triangles;
+    int triangle_count;
+} Mesh;
 
 // Cube vertices (centered at origin); cube spans from -CUBE_SIZE to +CUBE_SIZE.
 Point3D cube_vertices[8] = {
@@ -93,6 +132,22 @@ Face cube_faces[6] = {
     { {0,1,5,4} }  // Bottom face (y = -CUBE_SIZE)
 };
 
+// Screen size (cells) and per-frame buffers, sized from the terminal at startup.
+static int screen_width = SCREEN_WIDTH;
+static int screen_height = SCREEN_HEIGHT;   // rendered rows (the status line is extra)
+static double projection_scale = 1.0;
+static double *frame;          // intensity per cell [0, 1]
+static int32_t *depth;         // 16.16 depth per cell
+static char *overlay;          // overlay text per cell, '\0' = none
+static int *shown_cells;       // char | color << 8 currently on the terminal, -1 = unknown
+
+static volatile sig_atomic_t stop = 0;
+
+void handle_sigint(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
 // Clears the terminal screen and resets cursor and attributes.
 void clear_screen() {
     printf("\033[2J\033[H\033[0m");
@@ -106,6 +161,12 @@ void wait_frame(double seconds) {
     thrd_sleep(&ts, NULL);
 }
 
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
 // Rotates a 3D point by given angles (in radians) about the X, Y, and Z axes.
 Point3D rotate_point(Point3D p, double ax, double ay, double az) {
     Point3D r = p;
@@ -134,9 +195,9 @@ Point3D rotate_point(Point3D p, double ax, double ay, double az) {
 // Projects a 3D point to 2D using perspective projection with a focal length.
 Point2D project_point(Point3D p, double distance) {
     Point2D proj;
-    double factor = FOCAL_LENGTH / (p.z + distance);
-    proj.x = p.x * factor + SCREEN_WIDTH / 2;
-    proj.y = -p.y * factor * ASPECT_RATIO + SCREEN_HEIGHT / 2;
+    double factor = FOCAL_LENGTH * projection_scale / (p.z + distance);
+    proj.x = p.x * factor + screen_width / 2;
+    proj.y = -p.y * factor * ASPECT_RATIO + screen_height / 2;
     return proj;
 }
 
@@ -181,64 +242,103 @@ int intensity_to_color_code(double intensity) {
 
 // Sets a pixel in the frame buffer (if within bounds) to the given intensity
 // if it is higher than the current value.
-void plot_pixel(double frame[SCREEN_HEIGHT][SCREEN_WIDTH], int x, int y, double intensity) {
-    if (x < 0 || x >= SCREEN_WIDTH || y < 0 || y >= SCREEN_HEIGHT)
+void plot_pixel(double *frame, int x, int y, double intensity) {
+    if (x < 0 || x >= screen_width || y < 0 || y >= screen_height)
         return;
-    if (intensity > frame[y][x])
-        frame[y][x] = intensity;
+    if (intensity > frame[y * screen_width + x])
+        frame[y * screen_width + x] = intensity;
 }
 
-// Fills a convex polygon (given as an array of projected 2D points) in the frame
-// buffer using a simple scanline fill algorithm.
-void fill_polygon(double frame[SCREEN_HEIGHT][SCREEN_WIDTH], Point2D pts[], int n, double intensity) {
-    int min_y = SCREEN_HEIGHT, max_y = 0;
-    for (int i = 0; i < n; i++) {
-        int y = (int)round(pts[i].y);
-        if (y < min_y) min_y = y;
-        if (y > max_y) max_y = y;
+/*
+ * Rasterizes one triangle with a fixed-point edge-function rasterizer.
+ * Vertices are projected cell coordinates; z is the view distance used for the
+ * depth test. Cells whose center is inside the triangle (top-left fill rule) and
+ * nearer than the depth buffer take the face intensity.
+ */
+void raster_triangle(Point2D p0, Point2D p1, Point2D p2,
+                     double z0, double z1, double z2, double intensity) {
+    // Snap to 28.4 fixed point.
+    int64_t x0 = llround(p0.x * SUBPIXEL), y0 = llround(p0.y * SUBPIXEL);
+    int64_t x1 = llround(p1.x * SUBPIXEL), y1 = llround(p1.y * SUBPIXEL);
+    int64_t x2 = llround(p2.x * SUBPIXEL), y2 = llround(p2.y * SUBPIXEL);
+
+    int64_t area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+    if (area == 0)
+        return;
+    if (area < 0) {
+        // Make the winding consistent so that inside means all edges >= 0.
+        int64_t t;
+        t = x1; x1 = x2; x2 = t;
+        t = y1; y1 = y2; y2 = t;
+        double tz = z1; z1 = z2; z2 = tz;
+        area = -area;
     }
-    if (min_y < 0) min_y = 0;
-    if (max_y >= SCREEN_HEIGHT) max_y = SCREEN_HEIGHT - 1;
-    
-    for (int y = min_y; y <= max_y; y++) {
-        double intersections[10];
-        int count = 0;
-        for (int i = 0; i < n; i++) {
-            Point2D p1 = pts[i];
-            Point2D p2 = pts[(i+1) % n];
-            if ((p1.y < y && p2.y >= y) || (p2.y < y && p1.y >= y)) {
-                double t = (y - p1.y) / (p2.y - p1.y);
-                double x = p1.x + t * (p2.x - p1.x);
-                intersections[count++] = x;
-            }
-        }
-        // Sort intersections.
-        for (int i = 0; i < count - 1; i++) {
-            for (int j = i + 1; j < count; j++) {
-                if (intersections[i] > intersections[j]) {
-                    double temp = intersections[i];
-                    intersections[i] = intersections[j];
-                    intersections[j] = temp;
-                }
-            }
-        }
-        for (int i = 0; i < count; i += 2) {
-            if (i+1 >= count) break;
-            int x_start = (int)round(intersections[i]);
-            int x_end = (int)round(intersections[i+1]);
-            if (x_start < 0) x_start = 0;
-            if (x_end >= SCREEN_WIDTH) x_end = SCREEN_WIDTH - 1;
-            for (int x = x_start; x <= x_end; x++) {
-                if (intensity > frame[y][x])
-                    frame[y][x] = intensity;
+
+    // Bounding box in cells, clipped to the screen.
+    int64_t minx = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+    int64_t maxx = x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2);
+    int64_t miny = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+    int64_t maxy = y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2);
+    int cx0 = (int)(minx >> SUBPIXEL_BITS), cx1 = (int)((maxx + SUBPIXEL - 1) >> SUBPIXEL_BITS);
+    int cy0 = (int)(miny >> SUBPIXEL_BITS), cy1 = (int)((maxy + SUBPIXEL - 1) >> SUBPIXEL_BITS);
+    if (cx0 < 0) cx0 = 0;
+    if (cy0 < 0) cy0 = 0;
+    if (cx1 > screen_width - 1) cx1 = screen_width - 1;
+    if (cy1 > screen_height - 1) cy1 = screen_height - 1;
+    if (cx0 > cx1 || cy0 > cy1)
+        return;
+
+    // Edge functions w_i(p) for the edges opposite each vertex, evaluated at the
+    // first cell center, and their per-cell increments.
+    int64_t px = ((int64_t)cx0 << SUBPIXEL_BITS) + SUBPIXEL / 2;
+    int64_t py = ((int64_t)cy0 << SUBPIXEL_BITS) + SUBPIXEL / 2;
+    int64_t a0 = y1 - y2, b0 = x2 - x1;   // edge v1 -> v2
+    int64_t a1 = y2 - y0, b1 = x0 - x2;   // edge v2 -> v0
+    int64_t a2 = y0 - y1, b2 = x1 - x0;   // edge v0 -> v1
+    int64_t w0_row = (x2 - x1) * (py - y1) - (y2 - y1) * (px - x1);
+    int64_t w1_row = (x0 - x2) * (py - y2) - (y0 - y2) * (px - x2);
+    int64_t w2_row = (x1 - x0) * (py - y0) - (y1 - y0) * (px - x0);
+    // Top-left rule: pixels exactly on a right or bottom edge belong to the neighbour.
+    if (!(a0 > 0 || (a0 == 0 && b0 > 0))) w0_row--;
+    if (!(a1 > 0 || (a1 == 0 && b1 > 0))) w1_row--;
+    if (!(a2 > 0 || (a2 == 0 && b2 > 0))) w2_row--;
+    int64_t step_x0 = a0 * SUBPIXEL, step_x1 = a1 * SUBPIXEL, step_x2 = a2 * SUBPIXEL;
+    int64_t step_y0 = b0 * SUBPIXEL, step_y1 = b1 * SUBPIXEL, step_y2 = b2 * SUBPIXEL;
+
+    // Depth plane in 16.16 fixed point: z = (w0*z0 + w1*z1 + w2*z2) / area.
+    double inv_area = 1.0 / (double)area;
+    double dzdx = (step_x0 * z0 + step_x1 * z1 + step_x2 * z2) * inv_area;
+    double dzdy = (step_y0 * z0 + step_y1 * z1 + step_y2 * z2) * inv_area;
+    double z_start = (w0_row * z0 + w1_row * z1 + w2_row * z2) * inv_area;
+    int32_t z_row = (int32_t)(z_start * DEPTH_ONE);
+    int32_t z_step_x = (int32_t)(dzdx * DEPTH_ONE);
+    int32_t z_step_y = (int32_t)(dzdy * DEPTH_ONE);
+
+    for (int y = cy0; y <= cy1; y++) {
+        int64_t w0 = w0_row, w1 = w1_row, w2 = w2_row;
+        int32_t z = z_row;
+        double *frow = frame + y * screen_width;
+        int32_t *zrow = depth + y * screen_width;
+        for (int x = cx0; x <= cx1; x++) {
+            if ((w0 | w1 | w2) >= 0 && z < zrow[x]) {
+                zrow[x] = z;
+                frow[x] = intensity;
             }
+            w0 += step_x0;
+            w1 += step_x1;
+            w2 += step_x2;
+            z += z_step_x;
         }
+        w0_row += step_y0;
+        w1_row += step_y1;
+        w2_row += step_y2;
+        z_row += z_step_y;
     }
 }
 
 // Draws an anti-aliased line using an adaptation of Xiaolin Wu's algorithm.
 // The line is drawn into the frame buffer by updating pixel intensities.
-void draw_line_aa(double frame[SCREEN_HEIGHT][SCREEN_WIDTH], Point2D p0, Point2D p1) {
+void draw_line_aa(double *frame, Point2D p0, Point2D p1) {
     int steep = fabs(p1.y - p0.y) > fabs(p1.x - p0.x);
     if (steep) {
         double temp = p0.x; p0.x = p0.y; p0.y = temp;
@@ -304,30 +404,243 @@ void draw_line_aa(double frame[SCREEN_HEIGHT][SCREEN_WIDTH], Point2D p0, Point2D
     }
 }
 
-int main(void) {
+// Builds the built-in cube mesh by splitting each quad face into two triangles.
+static void load_cube(Mesh *mesh) {
+    mesh->vertices = malloc(sizeof(cube_vertices));
+    mesh->triangles = malloc(12 * sizeof(Triangle));
+    if (!mesh->vertices || !mesh->triangles) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(mesh->vertices, cube_vertices, sizeof(cube_vertices));
+    mesh->vertex_count = 8;
+    mesh->triangle_count = 0;
+    for (int f = 0; f < 6; f++) {
+        const int *v = cube_faces[f].v;
+        mesh->triangles[mesh->triangle_count++] = (Triangle){ {v[0], v[1], v[2]} };
+        mesh->triangles[mesh->triangle_count++] = (Triangle){ {v[0], v[2], v[3]} };
+    }
+}
+
+/*
+ * Loads a Wavefront OBJ file ("v x y z" and "f a b c ..." records; texture and
+ * normal indices after '/' are ignored, negative indices are relative). Polygons
+ * are fan-triangulated. The mesh is centered and scaled to the cube's size.
+ * Returns 0 on success.
+ */
+static int load_obj(Mesh *mesh, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    int vcap = 1024, tcap = 1024;
+    mesh->vertices = malloc(vcap * sizeof(Point3D));
+    mesh->triangles = malloc(tcap * sizeof(Triangle));
+    mesh->vertex_count = mesh->triangle_count = 0;
+    if (!mesh->vertices || !mesh->triangles) {
+        fclose(f);
+        return -1;
+    }
+
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == 'v' && line[1] == ' ') {
+            Point3D p;
+            if (sscanf(line + 2, "%lf %lf %lf", &p.x, &p.y, &p.z) != 3)
+                continue;
+            if (mesh->vertex_count == vcap) {
+                vcap *= 2;
+                Point3D *nv = realloc(mesh->vertices, vcap * sizeof(Point3D));
+                if (!nv) { fclose(f); return -1; }
+                mesh->vertices = nv;
+            }
+            mesh->vertices[mesh->vertex_count++] = p;
+        } else if (line[0] == 'f' && line[1] == ' ') {
+            int idx[64];
+            int n = 0;
+            char *tok = strtok(line + 2, " \t\r\n");
+            while (tok && n < 64) {
+                int v = atoi(tok);   // stops at the first '/'
+                if (v < 0)
+                    v = mesh->vertex_count + v + 1;
+                if (v >= 1 && v <= mesh->vertex_count)
+                    idx[n++] = v - 1;
+                tok = strtok(NULL, " \t\r\n");
+            }
+            for (int i = 1; i + 1 < n; i++) {
+                if (mesh->triangle_count == tcap) {
+                    tcap *= 2;
+                    Triangle *nt = realloc(mesh->triangles, tcap * sizeof(Triangle));
+                    if (!nt) { fclose(f); return -1; }
+                    mesh->triangles = nt;
+                }
+                mesh->triangles[mesh->triangle_count++] = (Triangle){ {idx[0], idx[i], idx[i + 1]} };
+            }
+        }
+    }
+    fclose(f);
+    if (mesh->vertex_count == 0 || mesh->triangle_count == 0) {
+        fprintf(stderr, "%s: no triangles found.\n", path);
+        return -1;
+    }
+
+    // Center on the bounding box and scale to the cube's bounding radius.
+    Point3D lo = mesh->vertices[0], hi = mesh->vertices[0];
+    for (int i = 1; i < mesh->vertex_count; i++) {
+        Point3D p = mesh->vertices[i];
+        if (p.x < lo.x) lo.x = p.x;
+        if (p.y < lo.y) lo.y = p.y;
+        if (p.z < lo.z) lo.z = p.z;
+        if (p.x > hi.x) hi.x = p.x;
+        if (p.y > hi.y) hi.y = p.y;
+        if (p.z > hi.z) hi.z = p.z;
+    }
+    Point3D c = { (lo.x + hi.x) / 2, (lo.y + hi.y) / 2, (lo.z + hi.z) / 2 };
+    double radius = 0.0;
+    for (int i = 0; i < mesh->vertex_count; i++) {
+        Point3D *p = &mesh->vertices[i];
+        p->x -= c.x; p->y -= c.y; p->z -= c.z;
+        double r = sqrt(p->x * p->x + p->y * p->y + p->z * p->z);
+        if (r > radius) radius = r;
+    }
+    double scale = (radius > 0.0) ? CUBE_SIZE * sqrt(3.0) / radius : 1.0;
+    for (int i = 0; i < mesh->vertex_count; i++) {
+        mesh->vertices[i].x *= scale;
+        mesh->vertices[i].y *= scale;
+        mesh->vertices[i].z *= scale;
+    }
+    return 0;
+}
+
+/*
+ * Encodes the cells that changed since the last frame (cursor moves, color
+ * changes and characters) into out. Returns the number of bytes.
+ */
+static size_t encode_changes(char *out) {
+    size_t len = 0;
+    int cur_color = -1;
+    int cursor = -1;   // cell index the terminal cursor is at, -1 = unknown
+    for (int y = 0; y < screen_height; y++) {
+        for (int x = 0; x < screen_width; x++) {
+            int i = y * screen_width + x;
+            char ch;
+            int color;
+            if (overlay[i] != '\0') {
+                ch = overlay[i];
+                color = 15;   // bright white for overlay text
+            } else {
+                ch = intensity_to_char(frame[i]);
+                color = intensity_to_color_code(frame[i]);
+            }
+            int cell = (unsigned char)ch | (color << 8);
+            if (cell == shown_cells[i])
+                continue;
+            shown_cells[i] = cell;
+            if (cursor != i)
+                len += (size_t)sprintf(out + len, "\033[%d;%dH", y + 1, x + 1);
+            if (color != cur_color) {
+                len += (size_t)sprintf(out + len, "\033[38;5;%dm", color);
+                cur_color = color;
+            }
+            out[len++] = ch;
+            cursor = (x + 1 < screen_width) ? i + 1 : -1;
+        }
+    }
+    if (len > 0)
+        len += (size_t)sprintf(out + len, "\033[0m");
+    return len;
+}
+
+static void write_all(const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, buf, len);
+        if (n <= 0)
+            return;
+        buf += n;
+        len -= (size_t)n;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *model_path = NULL;
+    int wireframe = 0;
+    long bench_frames = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-w") == 0) {
+            wireframe = 1;
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            bench_frames = atol(argv[++i]);
+        } else if (argv[i][0] != '-' && !model_path) {
+            model_path = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [model.obj] [-w] [--bench N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Mesh mesh;
+    if (model_path) {
+        if (load_obj(&mesh, model_path) != 0)
+            return EXIT_FAILURE;
+    } else {
+        load_cube(&mesh);
+        wireframe = 1;   // the cube always shows its edges
+    }
+
+    // Use the whole terminal; the last row holds the status line.
+    struct winsize ws;
+    if (!bench_frames && ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 1) {
+        screen_width = ws.ws_col;
+        screen_height = ws.ws_row - 1;
+    }
+    projection_scale = fmin(screen_width / (double)SCREEN_WIDTH, screen_height / (double)SCREEN_HEIGHT);
+    size_t cells = (size_t)screen_width * screen_height;
+
     // Frame buffer: each pixel holds a brightness intensity in the range [0, 1].
-    double frame[SCREEN_HEIGHT][SCREEN_WIDTH];
+    frame = malloc(cells * sizeof(double));
+    depth = malloc(cells * sizeof(int32_t));
     // Overlay buffer for text; initialized with '\0'.
-    char overlay[SCREEN_HEIGHT][SCREEN_WIDTH+1];
+    overlay = malloc(cells);
+    shown_cells = malloc(cells * sizeof(int));
+    // Worst case per cell: cursor move + color escape + character.
+    char *out = malloc(cells * 32 + 256);
+    Point3D *rotated = malloc(mesh.vertex_count * sizeof(Point3D));
+    Point2D *projected = malloc(mesh.vertex_count * sizeof(Point2D));
+    if (!frame || !depth || !overlay || !shown_cells || !out || !rotated || !projected) {
+        fprintf(stderr, "Out of memory.\n");
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < cells; i++)
+        shown_cells[i] = -1;
+
+    signal(SIGINT, handle_sigint);
+    if (!bench_frames) {
+        clear_screen();
+        printf("\033[?25l");   // hide the cursor while animating
+        fflush(stdout);
+    }
     
     double angle_x = 0, angle_y = 0, angle_z = 0;
     double distance = 4.0;  // Distance from viewer to cube
+    double frame_ms_total = 0.0, frame_ms_avg = 0.0, window_ms = 0.0, window_start = now_ms();
+    long frames_in_window = 0, frames_done = 0;
+    size_t bytes_total = 0;
+    int drawn_triangles = 0;
     
-    while (1) {
-        // Initialize frame and overlay buffers.
-        for (int i = 0; i < SCREEN_HEIGHT; i++) {
-            for (int j = 0; j < SCREEN_WIDTH; j++) {
-                frame[i][j] = 0.0;
-                overlay[i][j] = '\0';
-            }
-            overlay[i][SCREEN_WIDTH] = '\0';
+    while (!stop && (!bench_frames || frames_done < bench_frames)) {
+        double t_start = now_ms();
+
+        // Initialize frame, depth and overlay buffers.
+        for (size_t i = 0; i < cells; i++) {
+            frame[i] = 0.0;
+            depth[i] = INT32_MAX;
         }
+        memset(overlay, 0, cells);
         
-        // Rotate and project all cube vertices.
-        Point3D rotated[8];
-        Point2D projected[8];
-        for (int i = 0; i < 8; i++) {
-            rotated[i] = rotate_point(cube_vertices[i], angle_x, angle_y, angle_z);
+        // Rotate and project all mesh vertices.
+        for (int i = 0; i < mesh.vertex_count; i++) {
+            rotated[i] = rotate_point(mesh.vertices[i], angle_x, angle_y, angle_z);
             projected[i] = project_point(rotated[i], distance);
         }
         
@@ -336,17 +649,16 @@ int main(void) {
         Point3D light_dir = {0.5, 0.5, -1.0};
         light_dir = normalize(light_dir);
         
-        for (int f = 0; f < 6; f++) {
-            Point3D v[4];
-            Point2D proj[4];
-            for (int i = 0; i < 4; i++) {
-                int idx = cube_faces[f].v[i];
-                v[i] = rotated[idx];
-                proj[i] = projected[idx];
-            }
+        drawn_triangles = 0;
+        for (int f = 0; f < mesh.triangle_count; f++) {
+            const int *idx = mesh.triangles[f].v;
+            Point3D v0 = rotated[idx[0]], v1 = rotated[idx[1]], v2 = rotated[idx[2]];
+            // Skip triangles reaching behind the viewer.
+            if (v0.z + distance < NEAR_PLANE || v1.z + distance < NEAR_PLANE || v2.z + distance < NEAR_PLANE)
+                continue;
             // Compute face normal using the cross product of two edges.
-            Point3D edge1 = { v[1].x - v[0].x, v[1].y - v[0].y, v[1].z - v[0].z };
-            Point3D edge2 = { v[2].x - v[0].x, v[2].y - v[0].y, v[2].z - v[0].z };
+            Point3D edge1 = { v1.x - v0.x, v1.y - v0.y, v1.z - v0.z };
+            Point3D edge2 = { v2.x - v0.x, v2.y - v0.y, v2.z - v0.z };
             Point3D normal = cross_product(edge1, edge2);
             normal = normalize(normal);
             
@@ -359,58 +671,90 @@ int main(void) {
             double intensity = dot_product(normal, light_dir);
             if (intensity < 0) intensity = 0;
             
-            // Fill the face polygon with the computed intensity.
-            fill_polygon(frame, proj, 4, intensity);
+            raster_triangle(projected[idx[0]], projected[idx[1]], projected[idx[2]],
+                            v0.z + distance, v1.z + distance, v2.z + distance, intensity);
+            drawn_triangles++;
         }
         
         // Draw anti-aliased wireframe edges on top of the face shading.
-        for (int i = 0; i < 12; i++) {
-            int v0 = cube_edges[i][0];
-            int v1 = cube_edges[i][1];
-            draw_line_aa(frame, projected[v0], projected[v1]);
+        if (wireframe && !model_path) {
+            for (int i = 0; i < 12; i++) {
+                int v0 = cube_edges[i][0];
+                int v1 = cube_edges[i][1];
+                draw_line_aa(frame, projected[v0], projected[v1]);
+            }
+        } else if (wireframe) {
+            for (int f = 0; f < mesh.triangle_count; f++) {
+                const int *idx = mesh.triangles[f].v;
+                for (int e = 0; e < 3; e++)
+                    draw_line_aa(frame, projected[idx[e]], projected[idx[(e + 1) % 3]]);
+            }
         }
         
         // Overlay "AALTO" text at the cube's center.
         // The variable "text" is now used to fill the overlay buffer.
         const char *text = "AALTO";
         int text_len = 5;  // Length of "AALTO"
-        int text_start = SCREEN_WIDTH / 2 - text_len / 2;
-        int text_row = SCREEN_HEIGHT / 2;
+        int text_start = screen_width / 2 - text_len / 2;
+        int text_row = screen_height / 2;
         for (int k = 0; k < text_len; k++) {
             int x = text_start + k;
-            if (x >= 0 && x < SCREEN_WIDTH && text_row >= 0 && text_row < SCREEN_HEIGHT)
-                overlay[text_row][x] = text[k];
+            if (x >= 0 && x < screen_width && text_row >= 0 && text_row < screen_height)
+                overlay[text_row * screen_width + x] = text[k];
         }
         
-        // Render the frame buffer to the terminal.
-        clear_screen();
-        for (int i = 0; i < SCREEN_HEIGHT; i++) {
-            for (int j = 0; j < SCREEN_WIDTH; j++) {
-                // If an overlay character is set, print it directly.
-                if (overlay[i][j] != '\0') {
-                    // Use bright white for overlay text.
-                    printf("\033[38;5;15m%c", overlay[i][j]);
-                } else {
-                    double intensity = frame[i][j];
-                    char ch = intensity_to_char(intensity);
-                    int color_code = intensity_to_color_code(intensity);
-                    // Print each pixel with its corresponding ANSI color.
-                    printf("\033[38;5;%dm%c", color_code, ch);
-                }
-            }
-            // Reset colors at the end of each line.
-            printf("\033[0m\n");
+        // Encode only the cells that changed, plus the status line.
+        size_t len = encode_changes(out);
+        len += (size_t)sprintf(out + len,
+                               "\033[%d;1H\033[0m\033[K Triangles: %d (%d drawn)  Frame: %.2f ms  Output: %zu bytes",
+                               screen_height + 1, mesh.triangle_count, drawn_triangles, frame_ms_avg, len);
+        double t_end = now_ms();
+        frame_ms_total += t_end - t_start;
+        window_ms += t_end - t_start;
+        bytes_total += len;
+        frames_done++;
+
+        // Average the frame time over one-second windows for the status line.
+        frames_in_window++;
+        if (t_end - window_start >= 1000.0) {
+            frame_ms_avg = window_ms / frames_in_window;
+            frames_in_window = 0;
+            window_ms = 0.0;
+            window_start = t_end;
         }
-        fflush(stdout);
         
         // Update rotation angles for animation.
         angle_x += 0.03;
         angle_y += 0.02;
         angle_z += 0.04;
+
+        if (bench_frames)
+            continue;
+
+        // Render the frame to the terminal in one write.
+        write_all(out, len);
         
         // Wait for the next frame.
         wait_frame(FRAME_DELAY);
     }
+
+    if (bench_frames) {
+        printf("%ld frames, %d triangles at %dx%d cells: %.3f ms/frame, %.0f bytes/frame\n",
+               frames_done, mesh.triangle_count, screen_width, screen_height,
+               frame_ms_total / (frames_done ? frames_done : 1),
+               (double)bytes_total / (frames_done ? frames_done : 1));
+    } else {
+        printf("\033[0m\033[?25h\033[%d;1H\n", screen_height + 1);
+    }
     
+    free(frame);
+    free(depth);
+    free(overlay);
+    free(shown_cells);
+    free(out);
+    free(rotated);
+    free(projected);
+    free(mesh.vertices);
+    free(mesh.triangles);
     return 0;
 }
@@ -22,6 +22,42 @@
           Channel 3: Frequency of 3rd largest FFT peak (view 2)
           Channel 4: Checksum of waterfall view (view 3)
       If a view is not active, a zero value is sent on its channel.
+
+    File Source:
+    - Instead of an ALSA device, samples can be read from a WAV file, a raw PCM file
+      or stdin ("-"), e.g. the output of apps/signal:
+          signal -sine 1000 10 raw | input_audio -i - -F f32 --bench -v 2
+      WAV headers (16-bit PCM or 32-bit float) are detected automatically; raw input
+      is S16_LE unless -F f32 is given, at the rate set with -r (default 44100 Hz).
+    - The file is paced to real time by default; --fast reads it as fast as possible.
+    - --bench implies --fast and runs headless (no server connection, no terminal
+      output) until end of file, then reports the analysis throughput in frames/sec.
+
+    Triggered Recording:
+    - "--record <dir>" keeps the last --pre seconds (default 5) of captured PCM in a
+      lock-free ring. On a trigger, a background writer thread saves the pre-trigger
+      audio plus --post seconds (default 5) to <dir>/rec_YYYYMMDD_HHMMSS.wav.
+    - Triggers come from "--rec-threshold <dB>" (the out0 dB level crossing upwards),
+      from a "rec"/"trigger" or non-zero number received on input channel
+      --rec-channel (default 0), or from the 'T' key.
+    - The capture loop only copies each period into the ring and never waits on the
+      writer or the disk, so recording cannot cause an xrun. If the disk falls more
+      than the ring slack behind, the lost frames are reported instead.
+
+    Capture Setup:
+    - ALSA capture uses mmap access by default (snd_pcm_mmap_begin/commit): each period
+      is converted to S16 straight out of the driver ring into one plane per channel,
+      the only copy the analysis and the recorder read from. Devices without mmap support,
+      or "--rw", fall back to snd_pcm_readi.
+    - "-r rate", "-c channels", "-F s16|s32|f32", "-p period" and "-b buffer" (frames)
+      set the hardware parameters, e.g. "-p 128 -b 512" for low latency.
+    - Multi-channel input is analysed per channel: the stats line shows the dB level of
+      every channel, and the waveform/FFT views and out0..out4 follow the channel
+      selected with "-a N" or cycled with 'C'.
+
+    Usage:
+        input_audio [device]
+        input_audio -i <file|-> [-F s16|f32] [-r rate] [-v view] [--fast] [--bench]
 */
 
 #define _POSIX_C_SOURCE 200809L  // Must be defined before any headers
@@ -40,6 +76,10 @@
 #include <limits.h>  // for ULONG_MAX
 #include <sys/socket.h>  // added for TCP connection
 #include <arpa/inet.h>   // added for TCP connection
+#include <time.h>        // clock_gettime() for file pacing and throughput
+#include <pthread.h>     // background WAV writer
+#include <stdatomic.h>   // lock-free pre-trigger ring
+#include <errno.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -110,82 +150,771 @@ static int use_window = 0;       // 'W' for Hann window
 static double last_thd_percent = 0.0; // for FFT mode
 static int log_scale = 0;        // 'M' for log vs. linear frequency mapping
 
-int main(int argc, char *argv[]) {
-    const char *device = "default";
-    if (argc > 1)
-        device = argv[1];
+// --- Audio Source (ALSA capture or file) ---
+typedef struct {
+    snd_pcm_t *pcm;              // ALSA capture handle, NULL for a file source
+    FILE *file;                  // WAV/raw input for a file source
+    int file_float;              // samples are 32-bit float instead of S16_LE
+    int paced;                   // deliver file samples in real time
+    unsigned int rate;
+    unsigned int channels;
+    struct timespec start;
+    unsigned long long frames_total;
+    unsigned char pending[12];   // bytes read while probing for a WAV header
+    size_t pending_len;
+    float *float_buffer;         // conversion buffer for float input
+    size_t float_buffer_len;
+} AudioSource;
 
-    // Audio setup
-    unsigned int rate = 44100;
-    unsigned int channels = 1;
-    snd_pcm_format_t format = SND_PCM_FORMAT_S16_LE;
+static double elapsed_seconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static uint32_t read_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_le16(const unsigned char *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/*
+ * Parse a RIFF/WAVE header and leave the stream at the start of the sample data.
+ * Returns 1 for a WAV file, 0 if the stream is not WAV (the probed bytes stay in
+ * src->pending so raw input still sees them), -1 on an unsupported WAV.
+ */
+static int parse_wav_header(AudioSource *src) {
+    src->pending_len = fread(src->pending, 1, sizeof(src->pending), src->file);
+    if (src->pending_len < 12 || memcmp(src->pending, "RIFF", 4) != 0 ||
+        memcmp(src->pending + 8, "WAVE", 4) != 0)
+        return 0;
+    src->pending_len = 0;
+
+    int have_fmt = 0;
+    unsigned char hdr[8];
+    while (fread(hdr, 1, 8, src->file) == 8) {
+        uint32_t size = read_le32(hdr + 4);
+        if (memcmp(hdr, "fmt ", 4) == 0) {
+            unsigned char fmt[40];
+            if (size < 16 || size > sizeof(fmt) || fread(fmt, 1, size, src->file) != size)
+                return -1;
+            uint16_t audio_format = read_le16(fmt);
+            uint16_t bits = read_le16(fmt + 14);
+            src->channels = read_le16(fmt + 2);
+            src->rate = read_le32(fmt + 4);
+            if (audio_format == 1 && bits == 16)
+                src->file_float = 0;
+            else if (audio_format == 3 && bits == 32)
+                src->file_float = 1;
+            else {
+                fprintf(stderr, "Error: unsupported WAV format %u with %u bits.\n", audio_format, bits);
+                return -1;
+            }
+            if (size & 1)
+                fgetc(src->file);
+            have_fmt = 1;
+        } else if (memcmp(hdr, "data", 4) == 0) {
+            return (have_fmt && src->channels > 0) ? 1 : -1;
+        } else {
+            // Skip unknown chunks (LIST, fact, ...), which are word aligned.
+            for (uint32_t i = 0; i < size + (size & 1); i++) {
+                if (fgetc(src->file) == EOF)
+                    return -1;
+            }
+        }
+    }
+    return -1;
+}
+
+static int open_file_source(AudioSource *src, const char *path) {
+    src->file = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (!src->file) {
+        fprintf(stderr, "Error: cannot open '%s'\n", path);
+        return -1;
+    }
+    if (parse_wav_header(src) < 0) {
+        fprintf(stderr, "Error: '%s' is not a supported WAV file.\n", path);
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &src->start);
+    return 0;
+}
+
+/*
+ * Open and configure an ALSA capture device. *use_mmap selects mmap access and is
+ * cleared when the device only supports read/write access. The period and buffer
+ * sizes are requests (a buffer size of 0 leaves it to the driver) and return the
+ * values the hardware actually chose.
+ */
+static snd_pcm_t *open_capture(const char *device, unsigned int *rate, unsigned int channels,
+                               snd_pcm_format_t format, snd_pcm_uframes_t *period_size,
+                               snd_pcm_uframes_t *buffer_size, int *use_mmap) {
     snd_pcm_t *pcm_handle = NULL;
     snd_pcm_hw_params_t *hw_params = NULL;
 
-    signal(SIGINT, handle_sigint);
-    atexit(cleanup_alternate_screen);
-    enable_raw_mode();
-
     int err = snd_pcm_open(&pcm_handle, device, SND_PCM_STREAM_CAPTURE, 0);
     if (err < 0) {
         fprintf(stderr, "Error: cannot open audio device '%s' (%s)\n", device, snd_strerror(err));
-        return 1;
+        return NULL;
     }
     err = snd_pcm_hw_params_malloc(&hw_params);
     if (err < 0) {
         fprintf(stderr, "Error: cannot allocate HW parameters (%s)\n", snd_strerror(err));
         snd_pcm_close(pcm_handle);
-        return 1;
+        return NULL;
     }
     if ((err = snd_pcm_hw_params_any(pcm_handle, hw_params)) < 0) {
         fprintf(stderr, "Error: cannot initialize HW parameters (%s)\n", snd_strerror(err));
         snd_pcm_hw_params_free(hw_params);
         snd_pcm_close(pcm_handle);
-        return 1;
+        return NULL;
+    }
+    if (*use_mmap &&
+        snd_pcm_hw_params_set_access(pcm_handle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0) {
+        fprintf(stderr, "Warning: '%s' does not support mmap access, using read/write.\n", device);
+        *use_mmap = 0;
     }
-    if ((err = snd_pcm_hw_params_set_access(pcm_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
+    if (!*use_mmap &&
+        (err = snd_pcm_hw_params_set_access(pcm_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
         fprintf(stderr, "Error: cannot set interleaved mode (%s)\n", snd_strerror(err));
         snd_pcm_hw_params_free(hw_params);
         snd_pcm_close(pcm_handle);
-        return 1;
+        return NULL;
     }
     if ((err = snd_pcm_hw_params_set_format(pcm_handle, hw_params, format)) < 0) {
         fprintf(stderr, "Error: cannot set audio format (%s)\n", snd_strerror(err));
         snd_pcm_hw_params_free(hw_params);
         snd_pcm_close(pcm_handle);
-        return 1;
+        return NULL;
     }
     if ((err = snd_pcm_hw_params_set_channels(pcm_handle, hw_params, channels)) < 0) {
         fprintf(stderr, "Error: cannot set channel count (%s)\n", snd_strerror(err));
         snd_pcm_hw_params_free(hw_params);
         snd_pcm_close(pcm_handle);
-        return 1;
+        return NULL;
     }
-    if ((err = snd_pcm_hw_params_set_rate_near(pcm_handle, hw_params, &rate, NULL)) < 0) {
-        fprintf(stderr, "Error: cannot set sample rate to %u Hz (%s)\n", rate, snd_strerror(err));
+    if ((err = snd_pcm_hw_params_set_rate_near(pcm_handle, hw_params, rate, NULL)) < 0) {
+        fprintf(stderr, "Error: cannot set sample rate to %u Hz (%s)\n", *rate, snd_strerror(err));
         snd_pcm_hw_params_free(hw_params);
         snd_pcm_close(pcm_handle);
-        return 1;
+        return NULL;
     }
 
-    // Request period of 1024 frames
-    snd_pcm_uframes_t period_size = 1024;
-    if ((err = snd_pcm_hw_params_set_period_size_near(pcm_handle, hw_params, &period_size, NULL)) < 0) {
+    // Request the period size (1024 frames by default)
+    if ((err = snd_pcm_hw_params_set_period_size_near(pcm_handle, hw_params, period_size, NULL)) < 0) {
         fprintf(stderr, "Warning: cannot set period size (%s). Using default.\n", snd_strerror(err));
     }
+    if (*buffer_size > 0 &&
+        (err = snd_pcm_hw_params_set_buffer_size_near(pcm_handle, hw_params, buffer_size)) < 0) {
+        fprintf(stderr, "Warning: cannot set buffer size (%s). Using default.\n", snd_strerror(err));
+    }
     if ((err = snd_pcm_hw_params(pcm_handle, hw_params)) < 0) {
         fprintf(stderr, "Error: cannot set HW parameters (%s)\n", snd_strerror(err));
         snd_pcm_hw_params_free(hw_params);
         snd_pcm_close(pcm_handle);
-        return 1;
+        return NULL;
     }
+    snd_pcm_hw_params_get_period_size(hw_params, period_size, NULL);
+    snd_pcm_hw_params_get_buffer_size(hw_params, buffer_size);
     snd_pcm_hw_params_free(hw_params);
     if ((err = snd_pcm_prepare(pcm_handle)) < 0) {
         fprintf(stderr, "Error: cannot prepare audio interface (%s)\n", snd_strerror(err));
         snd_pcm_close(pcm_handle);
+        return NULL;
+    }
+    return pcm_handle;
+}
+
+/*
+ * Read up to 'frames' frames of S16 samples from a file source.
+ * Returns the number of frames read, 0 at end of file.
+ */
+static snd_pcm_sframes_t file_source_read(AudioSource *src, int16_t *out, snd_pcm_uframes_t frames) {
+    size_t want = frames * src->channels;
+    size_t sample_bytes = src->file_float ? sizeof(float) : sizeof(int16_t);
+    unsigned char *dst = (unsigned char *)out;
+
+    if (src->file_float) {
+        if (src->float_buffer_len < want) {
+            float *nb = realloc(src->float_buffer, want * sizeof(float));
+            if (!nb)
+                return 0;
+            src->float_buffer = nb;
+            src->float_buffer_len = want;
+        }
+        dst = (unsigned char *)src->float_buffer;
+    }
+
+    // Bytes consumed by the WAV probe on raw input come first.
+    size_t got_bytes = src->pending_len;
+    if (got_bytes > 0) {
+        memcpy(dst, src->pending, got_bytes);
+        src->pending_len = 0;
+    }
+    got_bytes += fread(dst + got_bytes, 1, want * sample_bytes - got_bytes, src->file);
+    snd_pcm_sframes_t got_frames = (snd_pcm_sframes_t)(got_bytes / sample_bytes / src->channels);
+    if (got_frames == 0)
+        return 0;
+
+    if (src->file_float) {
+        const float *f = src->float_buffer;
+        for (size_t i = 0; i < (size_t)got_frames * src->channels; i++) {
+            float v = f[i];
+            if (v > 1.0f) v = 1.0f;
+            if (v < -1.0f) v = -1.0f;
+            out[i] = (int16_t)(v * 32767.0f);
+        }
+    }
+
+    src->frames_total += (unsigned long long)got_frames;
+    if (src->paced) {
+        // Sleep until the wall clock catches up with the sample clock.
+        double ahead = (double)src->frames_total / src->rate - elapsed_seconds(&src->start);
+        if (ahead > 0.0) {
+            struct timespec ts;
+            ts.tv_sec = (time_t)ahead;
+            ts.tv_nsec = (long)((ahead - (double)ts.tv_sec) * 1e9);
+            nanosleep(&ts, NULL);
+        }
+    }
+    return got_frames;
+}
+
+// --- Triggered Recorder ---
+//
+// Single-producer ring: the capture loop appends periods and publishes the total
+// frame count with a release store; the writer thread reads behind it. Neither side
+// takes a lock, and the capture loop never blocks on the writer.
+//
+// The slots of the oldest period may be overwritten by a push that is not published
+// yet, so the writer stays one period (margin) clear of written - capacity. It copies
+// slots into a bounce buffer, re-reads written and keeps only frames that were still
+// clear afterwards; frames lapped during the copy are dropped, never written torn.
+#define RECORDER_SLACK_SECONDS 2   // ring room for the writer to fall behind
+#define RECORDER_BOUNCE_FRAMES 4096
+
+typedef struct {
+    const char *dir;
+    unsigned int rate;
+    unsigned int channels;
+    unsigned long long pre_frames;
+    unsigned long long post_frames;
+    int16_t *ring;
+    unsigned long long capacity;           // ring size in frames
+    unsigned long long margin;             // largest push (one period) in frames
+    int16_t *bounce;                       // writer's copy of RECORDER_BOUNCE_FRAMES frames
+    atomic_ullong written;                 // total frames pushed by the capture loop
+    atomic_ullong trigger_at;              // frame index + 1 of a pending trigger, 0 = none
+    atomic_int recording;                  // writer has a file open
+    atomic_int stop;
+    atomic_ullong dropped;                 // frames overwritten before they were saved
+    atomic_uint files;
+    pthread_t thread;
+} Recorder;
+
+static void put_le32(unsigned char *p, uint32_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+static void put_le16(unsigned char *p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+// 44-byte header for 16-bit PCM; data_bytes is patched when the file is closed.
+static void write_wav_header(FILE *f, unsigned int rate, unsigned int channels, uint32_t data_bytes) {
+    unsigned char h[44];
+    memcpy(h, "RIFF", 4);
+    put_le32(h + 4, 36 + data_bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put_le32(h + 16, 16);
+    put_le16(h + 20, 1);                            // PCM
+    put_le16(h + 22, (uint16_t)channels);
+    put_le32(h + 24, rate);
+    put_le32(h + 28, rate * channels * 2);          // byte rate
+    put_le16(h + 32, (uint16_t)(channels * 2));     // block align
+    put_le16(h + 34, 16);
+    memcpy(h + 36, "data", 4);
+    put_le32(h + 40, data_bytes);
+    fwrite(h, 1, sizeof(h), f);
+}
+
+// Called from the capture loop: interleave one period from the channel planes
+// (plane c at planes + c * plane_stride) into the ring and publish it.
+static void recorder_push(Recorder *rec, const int16_t *planes, snd_pcm_uframes_t plane_stride,
+                          snd_pcm_uframes_t frames) {
+    unsigned long long w = atomic_load_explicit(&rec->written, memory_order_relaxed);
+    snd_pcm_uframes_t done = 0;
+    while (done < frames) {
+        unsigned long long pos = w % rec->capacity;
+        unsigned long long n = rec->capacity - pos;
+        if (n > frames - done) n = frames - done;
+        int16_t *dst = rec->ring + pos * rec->channels;
+        if (rec->channels == 1) {
+            memcpy(dst, planes + done, n * sizeof(int16_t));
+        } else {
+            for (unsigned int c = 0; c < rec->channels; c++) {
+                const int16_t *src = planes + c * plane_stride + done;
+                for (unsigned long long i = 0; i < n; i++)
+                    dst[i * rec->channels + c] = src[i];
+            }
+        }
+        done += n;
+        w += n;
+    }
+    atomic_store_explicit(&rec->written, w, memory_order_release);
+}
+
+static void recorder_trigger(Recorder *rec) {
+    if (atomic_load(&rec->recording))
+        return;  // the current file already covers this event
+    unsigned long long expected = 0;
+    unsigned long long now = atomic_load_explicit(&rec->written, memory_order_acquire);
+    atomic_compare_exchange_strong(&rec->trigger_at, &expected, now + 1);
+}
+
+static FILE *recorder_open_file(Recorder *rec) {
+    char path[PATH_MAX];
+    char stamp[32];
+    time_t t = time(NULL);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &tm);
+    snprintf(path, sizeof(path), "%s/rec_%s.wav", rec->dir, stamp);
+    // Several events within one second get a numeric suffix.
+    for (int i = 1; access(path, F_OK) == 0 && i < 100; i++)
+        snprintf(path, sizeof(path), "%s/rec_%s_%d.wav", rec->dir, stamp, i);
+    FILE *f = fopen(path, "wb");
+    if (f)
+        write_wav_header(f, rec->rate, rec->channels, 0);
+    return f;
+}
+
+// First frame the writer may read once 'written' frames were published.
+static unsigned long long recorder_oldest(const Recorder *rec, unsigned long long written) {
+    unsigned long long w = written + rec->margin;
+    return w > rec->capacity ? w - rec->capacity : 0;
+}
+
+// Moves *read_pos up to oldest and counts the frames of the recording (up to end_pos)
+// that were skipped as lost.
+static void recorder_skip_to(Recorder *rec, unsigned long long *read_pos,
+                             unsigned long long oldest, unsigned long long end_pos) {
+    if (*read_pos >= oldest)
+        return;
+    unsigned long long lost_end = oldest < end_pos ? oldest : end_pos;
+    if (lost_end > *read_pos)
+        atomic_fetch_add(&rec->dropped, lost_end - *read_pos);
+    *read_pos = oldest;
+}
+
+static void *recorder_thread(void *arg) {
+    Recorder *rec = arg;
+    FILE *f = NULL;
+    unsigned long long read_pos = 0, end_pos = 0, data_frames = 0;
+    struct timespec idle = {0, 20 * 1000000L};
+
+    for (;;) {
+        int stopping = atomic_load(&rec->stop);
+        unsigned long long w = atomic_load_explicit(&rec->written, memory_order_acquire);
+
+        if (!f) {
+            unsigned long long trig = atomic_load(&rec->trigger_at);
+            if (trig == 0) {
+                if (stopping)
+                    break;
+                nanosleep(&idle, NULL);
+                continue;
+            }
+            trig--;
+            // Start pre_frames before the trigger, limited to what the ring still holds.
+            read_pos = (trig > rec->pre_frames) ? trig - rec->pre_frames : 0;
+            end_pos = trig + rec->post_frames;
+            recorder_skip_to(rec, &read_pos, recorder_oldest(rec, w), end_pos);
+            if (read_pos >= end_pos) {
+                // The whole event was overwritten before we got to it: no empty file.
+                atomic_store(&rec->trigger_at, 0);
+                continue;
+            }
+            data_frames = 0;
+            f = recorder_open_file(rec);
+            if (!f) {
+                perror("input_audio: cannot create recording");
+                atomic_store(&rec->trigger_at, 0);
+                continue;
+            }
+            atomic_store(&rec->recording, 1);
+        }
+
+        unsigned long long avail = (w < end_pos ? w : end_pos);
+        // The capture loop lapped us: skip what was overwritten.
+        recorder_skip_to(rec, &read_pos, recorder_oldest(rec, w), end_pos);
+        while (read_pos < avail) {
+            unsigned long long pos = read_pos % rec->capacity;
+            unsigned long long n = rec->capacity - pos;
+            if (n > avail - read_pos) n = avail - read_pos;
+            if (n > RECORDER_BOUNCE_FRAMES) n = RECORDER_BOUNCE_FRAMES;
+            memcpy(rec->bounce, rec->ring + pos * rec->channels, n * rec->channels * sizeof(int16_t));
+            // Order the copy before the re-read, then keep only what was not lapped.
+            atomic_thread_fence(memory_order_acquire);
+            unsigned long long oldest =
+                recorder_oldest(rec, atomic_load_explicit(&rec->written, memory_order_relaxed));
+            if (read_pos < oldest) {
+                recorder_skip_to(rec, &read_pos, oldest, end_pos);
+                continue;
+            }
+            fwrite(rec->bounce, sizeof(int16_t), n * rec->channels, f);
+            read_pos += n;
+            data_frames += n;
+        }
+
+        if (read_pos >= end_pos || stopping) {
+            // Finish the file: patch the RIFF and data sizes.
+            fseek(f, 0, SEEK_SET);
+            write_wav_header(f, rec->rate, rec->channels,
+                             (uint32_t)(data_frames * rec->channels * sizeof(int16_t)));
+            fclose(f);
+            f = NULL;
+            atomic_fetch_add(&rec->files, 1);
+            atomic_store(&rec->trigger_at, 0);
+            atomic_store(&rec->recording, 0);
+            continue;
+        }
+        nanosleep(&idle, NULL);
+    }
+    return NULL;
+}
+
+static int recorder_start(Recorder *rec, unsigned int rate, unsigned int channels,
+                          snd_pcm_uframes_t period, double pre_seconds, double post_seconds) {
+    rec->rate = rate;
+    rec->channels = channels;
+    rec->pre_frames = (unsigned long long)(pre_seconds * rate);
+    rec->post_frames = (unsigned long long)(post_seconds * rate);
+    rec->margin = period;
+    rec->capacity = rec->pre_frames + rec->margin + (unsigned long long)RECORDER_SLACK_SECONDS * rate;
+    rec->ring = calloc(rec->capacity * channels, sizeof(int16_t));
+    rec->bounce = malloc((size_t)RECORDER_BOUNCE_FRAMES * channels * sizeof(int16_t));
+    if (!rec->ring || !rec->bounce) {
+        fprintf(stderr, "Error: cannot allocate the recording ring.\n");
+        free(rec->ring);
+        free(rec->bounce);
+        rec->ring = NULL;
+        rec->bounce = NULL;
+        return -1;
+    }
+    atomic_init(&rec->written, 0);
+    atomic_init(&rec->trigger_at, 0);
+    atomic_init(&rec->recording, 0);
+    atomic_init(&rec->stop, 0);
+    atomic_init(&rec->dropped, 0);
+    atomic_init(&rec->files, 0);
+    if (pthread_create(&rec->thread, NULL, recorder_thread, rec) != 0) {
+        fprintf(stderr, "Error: cannot start the recording thread.\n");
+        free(rec->ring);
+        free(rec->bounce);
+        rec->ring = NULL;
+        rec->bounce = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Flushes a recording in progress (truncating its post-trigger part) and joins the writer.
+static void recorder_stop(Recorder *rec) {
+    if (!rec->ring)
+        return;
+    atomic_store(&rec->stop, 1);
+    pthread_join(rec->thread, NULL);
+    free(rec->ring);
+    free(rec->bounce);
+    rec->ring = NULL;
+    rec->bounce = NULL;
+}
+
+/*
+ * Read routed input lines ("inN from clientX: msg") without blocking and report
+ * whether the recording channel carried a trigger command.
+ */
+static int poll_trigger_command(int sock, int channel) {
+    static char rx[1024];
+    static size_t rx_used = 0;
+    int triggered = 0;
+    if (sock < 0)
+        return 0;
+    ssize_t n = recv(sock, rx + rx_used, sizeof(rx) - 1 - rx_used, MSG_DONTWAIT);
+    if (n <= 0)
+        return 0;
+    rx_used += (size_t)n;
+    rx[rx_used] = '\0';
+    char *line = rx;
+    char *nl;
+    while ((nl = strchr(line, '\n')) != NULL) {
+        *nl = '\0';
+        int ch, client, off = 0;
+        if (sscanf(line, "in%d from client%d: %n", &ch, &client, &off) == 2 && off > 0 && ch == channel) {
+            const char *msg = line + off;
+            if (strncmp(msg, "rec", 3) == 0 || strncmp(msg, "trigger", 7) == 0 || atof(msg) != 0.0)
+                triggered = 1;
+        }
+        line = nl + 1;
+    }
+    rx_used = strlen(line);
+    memmove(rx, line, rx_used);
+    if (rx_used >= sizeof(rx) - 1)
+        rx_used = 0;  // drop an over-long line
+    return triggered;
+}
+
+/*
+ * Convert capture samples of one channel to an S16 plane: sample i is read at
+ * in[i * step], so step = channels de-interleaves and step = 1 copies a plane.
+ */
+static void convert_to_s16(const void *in, snd_pcm_format_t format, size_t step,
+                           int16_t *out, size_t samples) {
+    if (format == SND_PCM_FORMAT_S32_LE) {
+        const int32_t *s = in;
+        for (size_t i = 0; i < samples; i++)
+            out[i] = (int16_t)(s[i * step] >> 16);
+    } else if (format == SND_PCM_FORMAT_FLOAT_LE) {
+        const float *f = in;
+        for (size_t i = 0; i < samples; i++) {
+            float v = f[i * step];
+            if (v > 1.0f) v = 1.0f;
+            if (v < -1.0f) v = -1.0f;
+            out[i] = (int16_t)(v * 32767.0f);
+        }
+    } else if (step == 1) {
+        memcpy(out, in, samples * sizeof(int16_t));
+    } else {
+        const int16_t *s = in;
+        for (size_t i = 0; i < samples; i++)
+            out[i] = s[i * step];
+    }
+}
+
+// Split an interleaved buffer into per-channel S16 planes (plane c at planes + c * stride).
+static void deinterleave_to_planes(const void *in, snd_pcm_format_t format, unsigned int channels,
+                                   int16_t *planes, snd_pcm_uframes_t stride, snd_pcm_uframes_t frames) {
+    size_t bytes = (size_t)snd_pcm_format_physical_width(format) / 8;
+    for (unsigned int c = 0; c < channels; c++)
+        convert_to_s16((const unsigned char *)in + c * bytes, format, channels,
+                       planes + c * stride, frames);
+}
+
+/*
+ * Capture one period in mmap mode: wait until a full period is available, then
+ * convert each channel straight out of the driver's ring into its S16 plane
+ * (plane c at planes + c * frames) and hand the area back. This is the only copy
+ * of the samples. Returns the frames captured (fewer, possibly 0, when the device
+ * delivers nothing for a second) or a negative ALSA error for snd_pcm_recover().
+ */
+static snd_pcm_sframes_t mmap_capture_read(snd_pcm_t *pcm, snd_pcm_format_t format, unsigned int channels,
+                                           int16_t *planes, snd_pcm_uframes_t frames) {
+    unsigned int bits = (unsigned int)snd_pcm_format_physical_width(format);
+    snd_pcm_uframes_t done = 0;
+    while (done < frames) {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm);
+        if (avail < 0)
+            return avail;
+        if ((snd_pcm_uframes_t)avail < frames - done) {
+            // mmap capture is not started by a read: start it after prepare/recover.
+            if (snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED) {
+                int err = snd_pcm_start(pcm);
+                if (err < 0)
+                    return err;
+            }
+            int err = snd_pcm_wait(pcm, 1000);
+            if (err < 0)
+                return err;
+            if (err == 0)
+                return (snd_pcm_sframes_t)done;  // no data for a second: not an xrun
+            continue;
+        }
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset, n = frames - done;
+        int err = snd_pcm_mmap_begin(pcm, &areas, &offset, &n);
+        if (err < 0)
+            return err;
+        // Each channel's area gives its first sample and the distance between samples.
+        for (unsigned int c = 0; c < channels; c++) {
+            const unsigned char *base = (const unsigned char *)areas[c].addr +
+                                        (areas[c].first + offset * areas[c].step) / 8;
+            convert_to_s16(base, format, areas[c].step / bits, planes + c * frames + done, n);
+        }
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(pcm, offset, n);
+        if (committed < 0)
+            return committed;
+        if ((snd_pcm_uframes_t)committed != n)
+            return -EPIPE;
+        done += n;
+    }
+    return (snd_pcm_sframes_t)done;
+}
+
+static const char *format_label(snd_pcm_format_t format) {
+    return format == SND_PCM_FORMAT_S32_LE ? "S32_LE" :
+           format == SND_PCM_FORMAT_FLOAT_LE ? "FLOAT_LE" : "S16_LE";
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [device] [-r rate] [-c channels] [-F s16|s32|f32] [-p period] [-b buffer] [-a ch] [--rw]\n", prog);
+    printf("       %s -i <file|-> [-F s16|f32] [-r rate] [-v view] [--fast] [--bench]\n", prog);
+    printf("Recording: --record <dir> [--pre sec] [--post sec] [--rec-threshold dB] [--rec-channel N]\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *device = "default";
+    const char *input_path = NULL;
+    int bench = 0;
+    int view_mode = 1;  // View modes (only 1: Waveform, 2: FFT, 3: Waterfall are supported)
+
+    // Audio setup
+    AudioSource src;
+    memset(&src, 0, sizeof(src));
+    src.paced = 1;
+    src.rate = 44100;
+    src.channels = 1;
+    snd_pcm_format_t format = SND_PCM_FORMAT_S16_LE;
+    snd_pcm_uframes_t period_size = 1024;
+    snd_pcm_uframes_t buffer_size = 0;
+    int use_mmap = 1;
+    unsigned int analysis_channel = 0;
+
+    Recorder rec;
+    memset(&rec, 0, sizeof(rec));
+    double pre_seconds = 5.0, post_seconds = 5.0;
+    double rec_threshold = 0.0;
+    int use_threshold = 0;
+    int rec_channel = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            input_path = argv[++i];
+        } else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "f32") == 0) {
+                src.file_float = 1;
+                format = SND_PCM_FORMAT_FLOAT_LE;
+            } else if (strcmp(argv[i], "s16") == 0) {
+                src.file_float = 0;
+                format = SND_PCM_FORMAT_S16_LE;
+            } else if (strcmp(argv[i], "s32") == 0) {
+                format = SND_PCM_FORMAT_S32_LE;
+            } else {
+                fprintf(stderr, "Error: unknown sample format '%s' (use s16, s32 or f32)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            int r = atoi(argv[++i]);
+            if (r <= 0) {
+                fprintf(stderr, "Error: invalid rate '%s'\n", argv[i]);
+                return 1;
+            }
+            src.rate = (unsigned int)r;
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            int c = atoi(argv[++i]);
+            if (c <= 0 || c > 64) {
+                fprintf(stderr, "Error: invalid channel count '%s'\n", argv[i]);
+                return 1;
+            }
+            src.channels = (unsigned int)c;
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            long p = atol(argv[++i]);
+            if (p < 16) {
+                fprintf(stderr, "Error: invalid period size '%s'\n", argv[i]);
+                return 1;
+            }
+            period_size = (snd_pcm_uframes_t)p;
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            long b = atol(argv[++i]);
+            if (b < 0) {
+                fprintf(stderr, "Error: invalid buffer size '%s'\n", argv[i]);
+                return 1;
+            }
+            buffer_size = (snd_pcm_uframes_t)b;
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            analysis_channel = (unsigned int)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rw") == 0) {
+            use_mmap = 0;
+        } else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+            view_mode = atoi(argv[++i]);
+            if (view_mode < 1 || view_mode > 3)
+                view_mode = 1;
+        } else if (strcmp(argv[i], "--fast") == 0) {
+            src.paced = 0;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = 1;
+            src.paced = 0;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            rec.dir = argv[++i];
+        } else if (strcmp(argv[i], "--pre") == 0 && i + 1 < argc) {
+            pre_seconds = atof(argv[++i]);
+            if (pre_seconds < 0.0) pre_seconds = 0.0;
+        } else if (strcmp(argv[i], "--post") == 0 && i + 1 < argc) {
+            post_seconds = atof(argv[++i]);
+            if (post_seconds < 0.0) post_seconds = 0.0;
+        } else if (strcmp(argv[i], "--rec-threshold") == 0 && i + 1 < argc) {
+            rec_threshold = atof(argv[++i]);
+            use_threshold = 1;
+        } else if (strcmp(argv[i], "--rec-channel") == 0 && i + 1 < argc) {
+            rec_channel = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (argv[i][0] != '-') {
+            device = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (bench && !input_path) {
+        fprintf(stderr, "Error: --bench requires a file source (-i).\n");
         return 1;
     }
 
+    signal(SIGINT, handle_sigint);
+
+    if (input_path) {
+        if (format == SND_PCM_FORMAT_S32_LE) {
+            fprintf(stderr, "Error: s32 is only supported for ALSA capture.\n");
+            return 1;
+        }
+        if (open_file_source(&src, input_path) < 0)
+            return 1;
+        device = input_path;
+        format = src.file_float ? SND_PCM_FORMAT_FLOAT_LE : SND_PCM_FORMAT_S16_LE;
+        use_mmap = 0;
+    } else {
+        src.pcm = open_capture(device, &src.rate, src.channels, format, &period_size,
+                               &buffer_size, &use_mmap);
+        if (!src.pcm)
+            return 1;
+    }
+    if (analysis_channel >= src.channels)
+        analysis_channel = 0;
+    snd_pcm_t *pcm_handle = src.pcm;
+    unsigned int rate = src.rate;
+    unsigned int channels = src.channels;
+    int err;
+
+    if (rec.dir && recorder_start(&rec, rate, channels, period_size, pre_seconds, post_seconds) < 0) {
+        if (pcm_handle) snd_pcm_close(pcm_handle);
+        return 1;
+    }
+    int above_threshold = 0;
+
+    if (!bench) {
+        atexit(cleanup_alternate_screen);
+        enable_raw_mode();
+    }
+
     // Terminal dimensions
     int term_width = 80, term_height = 24;
     struct winsize ws;
@@ -202,7 +931,7 @@ int main(int argc, char *argv[]) {
     char **graph_lines = malloc(graph_height * sizeof(char *));
     if (!graph_lines) {
         fprintf(stderr, "Error: cannot allocate graph buffer.\n");
-        snd_pcm_close(pcm_handle);
+        if (pcm_handle) snd_pcm_close(pcm_handle);
         return 1;
     }
     for (int i = 0; i < graph_height; i++) {
@@ -212,7 +941,7 @@ int main(int argc, char *argv[]) {
             for (int j = 0; j < i; j++)
                 free(graph_lines[j]);
             free(graph_lines);
-            snd_pcm_close(pcm_handle);
+            if (pcm_handle) snd_pcm_close(pcm_handle);
             return 1;
         }
         memset(graph_lines[i], ' ', term_width);
@@ -220,12 +949,24 @@ int main(int argc, char *argv[]) {
     }
 
     snd_pcm_uframes_t frames = period_size;
-    int16_t *audio_buffer = malloc(frames * channels * snd_pcm_format_width(format) / 8);
-    if (!audio_buffer) {
+    // Per-channel S16 planes for the analysis and the recorder (plane c at
+    // planes + c * frames). Interleaved reads land in audio_buffer first; mono
+    // uses audio_buffer as its only plane, and mmap capture fills the planes directly.
+    int16_t *audio_buffer = malloc(frames * channels * sizeof(int16_t));
+    int16_t *channel_planes = (channels > 1) ? malloc(frames * channels * sizeof(int16_t)) : NULL;
+    int16_t *planes = (channels > 1) ? channel_planes : audio_buffer;
+    // Read/write capture of S32/float needs a staging buffer for the conversion.
+    void *raw_buffer = (pcm_handle && !use_mmap && format != SND_PCM_FORMAT_S16_LE)
+                       ? malloc(frames * channels * (snd_pcm_format_physical_width(format) / 8)) : NULL;
+    if (!audio_buffer || (channels > 1 && !channel_planes) ||
+        (pcm_handle && !use_mmap && format != SND_PCM_FORMAT_S16_LE && !raw_buffer)) {
         fprintf(stderr, "Error: failed to allocate audio buffer\n");
+        free(audio_buffer);
+        free(channel_planes);
+        free(raw_buffer);
         for (int i = 0; i < graph_height; i++) free(graph_lines[i]);
         free(graph_lines);
-        snd_pcm_close(pcm_handle);
+        if (pcm_handle) snd_pcm_close(pcm_handle);
         return 1;
     }
 
@@ -233,10 +974,12 @@ int main(int argc, char *argv[]) {
     if (!vis_line) {
         fprintf(stderr, "Error: failed to allocate visualization line buffer\n");
         free(audio_buffer);
+        free(channel_planes);
+        free(raw_buffer);
         for (int i = 0; i < graph_height; i++)
             free(graph_lines[i]);
         free(graph_lines);
-        snd_pcm_close(pcm_handle);
+        if (pcm_handle) snd_pcm_close(pcm_handle);
         return 1;
     }
 
@@ -249,47 +992,56 @@ int main(int argc, char *argv[]) {
     unsigned int current_fft_size = 0;
 
     // Alternate screen mode
-    printf("\033[?1049h");
-    fflush(stdout);
+    if (!bench) {
+        printf("\033[?1049h");
+        fflush(stdout);
+    }
 
     // --- Establish TCP connection to the switchboard server ---
-    g_server_sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (g_server_sock < 0) {
-        fprintf(stderr, "Error: cannot create socket for server connection.\n");
-        exit(1);
-    }
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(12345); // default server port
-    if (inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr) <= 0) {
-        fprintf(stderr, "Error: invalid server IP address.\n");
-        exit(1);
-    }
-    if (connect(g_server_sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        fprintf(stderr, "Error: cannot connect to server at 127.0.0.1:12345.\n");
-        exit(1);
+    // (skipped in --bench mode, which only measures the analysis path)
+    if (!bench) {
+        g_server_sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (g_server_sock < 0) {
+            fprintf(stderr, "Error: cannot create socket for server connection.\n");
+            exit(1);
+        }
+        struct sockaddr_in server_addr;
+        memset(&server_addr, 0, sizeof(server_addr));
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(12345); // default server port
+        if (inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr) <= 0) {
+            fprintf(stderr, "Error: invalid server IP address.\n");
+            exit(1);
+        }
+        if (connect(g_server_sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+            fprintf(stderr, "Error: cannot connect to server at 127.0.0.1:12345.\n");
+            exit(1);
+        }
     }
     // --- End server connection setup ---
 
-    // View modes (only 1: Waveform, 2: FFT, 3: Waterfall are supported)
-    int view_mode = 1;
-
     // Variables to hold output channel values. They will be reset each loop.
     double out0 = 0.0;  // now holds the dB value for view 1
     long out1 = 0, out2 = 0, out3 = 0, out4 = 0;
 
+    int keyboard = !bench && !(input_path && strcmp(input_path, "-") == 0);
+    unsigned long long frames_processed = 0;
+    double bench_out0 = 0.0;
+    long bench_peaks[3] = {0, 0, 0};
+    struct timespec loop_start;
+    clock_gettime(CLOCK_MONOTONIC, &loop_start);
+
     while (!stop_flag) {
         // Reset output channels to zero
         out0 = 0.0;
         out1 = out2 = out3 = out4 = 0;
 
-        // Check keyboard input
+        // Check keyboard input (not when stdin carries the audio or in --bench)
         fd_set readfds;
         FD_ZERO(&readfds);
         FD_SET(STDIN_FILENO, &readfds);
         struct timeval tv = {0, 0};
-        if (select(STDIN_FILENO + 1, &readfds, NULL, NULL, &tv) > 0) {
+        if (keyboard && select(STDIN_FILENO + 1, &readfds, NULL, NULL, &tv) > 0) {
             char ch;
             if (read(STDIN_FILENO, &ch, 1) == 1) {
                 if (ch == '1') view_mode = 1;
@@ -334,13 +1086,43 @@ int main(int argc, char *argv[]) {
                 else if (ch == 'M' || ch == 'm') {
                     log_scale = !log_scale;
                 }
+                // Cycle the analysed channel
+                else if ((ch == 'C' || ch == 'c') && channels > 1) {
+                    analysis_channel = (analysis_channel + 1) % channels;
+                    free(fft_data);
+                    fft_data = NULL;
+                    current_fft_size = 0;
+                }
+                // Manual recording trigger
+                else if ((ch == 'T' || ch == 't') && rec.ring) {
+                    recorder_trigger(&rec);
+                }
             }
         }
 
         // Audio capture
-        snd_pcm_sframes_t frames_read = snd_pcm_readi(pcm_handle, audio_buffer, frames);
+        snd_pcm_sframes_t frames_read;
+        if (pcm_handle && use_mmap) {
+            frames_read = mmap_capture_read(pcm_handle, format, channels, planes, frames);
+        } else if (pcm_handle && raw_buffer) {
+            frames_read = snd_pcm_readi(pcm_handle, raw_buffer, frames);
+            if (frames_read > 0)
+                deinterleave_to_planes(raw_buffer, format, channels, planes, frames,
+                                       (snd_pcm_uframes_t)frames_read);
+        } else {
+            if (pcm_handle) {
+                frames_read = snd_pcm_readi(pcm_handle, audio_buffer, frames);
+            } else {
+                frames_read = file_source_read(&src, audio_buffer, frames);
+                if (frames_read == 0)
+                    break;  // end of file
+            }
+            if (frames_read > 0 && channels > 1)
+                deinterleave_to_planes(audio_buffer, SND_PCM_FORMAT_S16_LE, channels, planes, frames,
+                                       (snd_pcm_uframes_t)frames_read);
+        }
         if (frames_read < 0) {
-            if ((err = snd_pcm_recover(pcm_handle, frames_read, 0)) < 0) {
+            if ((err = snd_pcm_recover(pcm_handle, (int)frames_read, 0)) < 0) {
                 fprintf(stderr, "Error: audio capture failed (%s)\n", snd_strerror(err));
                 break;
             }
@@ -348,6 +1130,10 @@ int main(int argc, char *argv[]) {
         }
         if (frames_read == 0)
             continue;
+        frames_processed += (unsigned long long)frames_read;
+        if (rec.ring)
+            recorder_push(&rec, planes, frames, (snd_pcm_uframes_t)frames_read);
+        const int16_t *chan = planes + analysis_channel * frames;
 
         //////////////////////////////////////
         //          View Mode Handling      //
@@ -355,8 +1141,8 @@ int main(int argc, char *argv[]) {
         if (view_mode == 1) {
             // Waveform view: compute raw amplitude values
             int16_t peak_pos = 0, peak_neg = 0;
-            for (snd_pcm_sframes_t i = 0; i < frames_read * channels; i++) {
-                int16_t s = audio_buffer[i];
+            for (snd_pcm_sframes_t i = 0; i < frames_read; i++) {
+                int16_t s = chan[i];
                 if (s > peak_pos) peak_pos = s;
                 if (s < peak_neg) peak_neg = s;
             }
@@ -396,11 +1182,11 @@ int main(int argc, char *argv[]) {
                 memset(fft_data, 0, fft_window_size * sizeof(int16_t));
                 current_fft_size = fft_window_size;
             }
-            unsigned int new_samp = frames_read * channels;
+            unsigned int new_samp = frames_read;
             if (new_samp > fft_window_size) new_samp = fft_window_size;
             memmove(fft_data, fft_data + new_samp,
                     (fft_window_size - new_samp) * sizeof(int16_t));
-            memcpy(fft_data + (fft_window_size - new_samp), audio_buffer,
+            memcpy(fft_data + (fft_window_size - new_samp), chan + (frames_read - new_samp),
                    new_samp * sizeof(int16_t));
 
             complex double *fft_in = malloc(fft_window_size * sizeof(complex double));
@@ -581,11 +1367,11 @@ int main(int argc, char *argv[]) {
                 memset(fft_data, 0, fft_window_size * sizeof(int16_t));
                 current_fft_size = fft_window_size;
             }
-            unsigned int new_samp = frames_read * channels;
+            unsigned int new_samp = frames_read;
             if (new_samp > fft_window_size) new_samp = fft_window_size;
             memmove(fft_data, fft_data + new_samp,
                     (fft_window_size - new_samp) * sizeof(int16_t));
-            memcpy(fft_data + (fft_window_size - new_samp), audio_buffer,
+            memcpy(fft_data + (fft_window_size - new_samp), chan + (frames_read - new_samp),
                    new_samp * sizeof(int16_t));
 
             complex double *fft_in = malloc(fft_window_size * sizeof(complex double));
@@ -716,16 +1502,41 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        // Compute dB level from the captured audio (for display only)
-        int16_t peak_pos = 0, peak_neg = 0;
-        for (snd_pcm_sframes_t i = 0; i < frames_read * channels; i++) {
-            int16_t s = audio_buffer[i];
-            if (s > peak_pos) peak_pos = s;
-            if (s < peak_neg) peak_neg = s;
+        // Compute per-channel dB levels from the captured audio (for display only);
+        // db_level follows the analysed channel like out0.
+        char channel_db[128] = "";
+        double db_level = -100.0;
+        for (unsigned int c = 0; c < channels; c++) {
+            const int16_t *plane = planes + c * frames;
+            int16_t peak_pos = 0, peak_neg = 0;
+            for (snd_pcm_sframes_t i = 0; i < frames_read; i++) {
+                int16_t s = plane[i];
+                if (s > peak_pos) peak_pos = s;
+                if (s < peak_neg) peak_neg = s;
+            }
+            int peak_neg_mag = (peak_neg == INT16_MIN) ? INT16_MAX : -peak_neg;
+            int cur_peak = (peak_pos > peak_neg_mag) ? peak_pos : peak_neg_mag;
+            double db = (cur_peak > 0) ? 20.0 * log10((double)cur_peak / 32767.0) : -100.0;
+            if (c == analysis_channel)
+                db_level = db;
+            if (channels > 1) {
+                size_t used = strlen(channel_db);
+                snprintf(channel_db + used, sizeof(channel_db) - used, "%s%.0f", c ? "/" : " [", db);
+            }
+        }
+        if (channels > 1)
+            strncat(channel_db, "]", sizeof(channel_db) - strlen(channel_db) - 1);
+
+        // Recording triggers: out0 dB crossing the threshold or a command on the input channel.
+        if (rec.ring) {
+            if (use_threshold) {
+                if (db_level >= rec_threshold && !above_threshold)
+                    recorder_trigger(&rec);
+                above_threshold = db_level >= rec_threshold;
+            }
+            if (poll_trigger_command(g_server_sock, rec_channel))
+                recorder_trigger(&rec);
         }
-        int peak_neg_mag = (peak_neg == INT16_MIN) ? INT16_MAX : -peak_neg;
-        int cur_peak = (peak_pos > peak_neg_mag) ? peak_pos : peak_neg_mag;
-        double db_level = (cur_peak > 0) ? 20.0 * log10((double)cur_peak / 32767.0) : -100.0;
 
         // For non-waterfall views, compute checksum for display
         unsigned long checksum = 0;
@@ -739,13 +1550,17 @@ int main(int argc, char *argv[]) {
         // Stats line: adjust output based on view mode
         if (view_mode == 2) {
             snprintf(stats_line, term_width + 1,
-                     "Dev:%s Rate:%uHz Per:%lu Ch:%u Fmt:S16_LE dB:%6.2f FFT_Win:%u THD:%5.2f%% %s Scale Csum:0x%08lx",
-                     device, rate, (unsigned long)period_size, channels, db_level, fft_window_size,
+                     "Dev:%s Rate:%uHz Per:%lu Buf:%lu %s Ch:%u/%u Fmt:%s dB:%6.2f%s FFT_Win:%u THD:%5.2f%% %s Scale Csum:0x%08lx",
+                     device, rate, (unsigned long)period_size, (unsigned long)buffer_size,
+                     use_mmap ? "mmap" : "rw", analysis_channel, channels, format_label(format),
+                     db_level, channel_db, fft_window_size,
                      last_thd_percent, log_scale ? "Log" : "Lin", checksum);
         } else {
             snprintf(stats_line, term_width + 1,
-                     "Dev:%s Rate:%uHz Per:%lu Ch:%u Fmt:S16_LE dB:%6.2f FFT_Win:%u %s Scale Csum:0x%08lx",
-                     device, rate, (unsigned long)period_size, channels, db_level, fft_window_size,
+                     "Dev:%s Rate:%uHz Per:%lu Buf:%lu %s Ch:%u/%u Fmt:%s dB:%6.2f%s FFT_Win:%u %s Scale Csum:0x%08lx",
+                     device, rate, (unsigned long)period_size, (unsigned long)buffer_size,
+                     use_mmap ? "mmap" : "rw", analysis_channel, channels, format_label(format),
+                     db_level, channel_db, fft_window_size,
                      log_scale ? "Log" : "Lin", checksum);
         }
 
@@ -754,8 +1569,19 @@ int main(int argc, char *argv[]) {
                                (view_mode == 2) ? "FFT" :
                                (view_mode == 3) ? "Waterfall" : "Unknown";
         snprintf(menu_line, term_width + 1,
-            "View:%s (1:Wave 2:FFT 3:Waterfall 8/9:FFT win  R:Reset  W:Window[%s]  M:%sScale)",
-            view_str, use_window ? "On" : "Off", log_scale ? "Log" : "Lin");
+            "View:%s (1:Wave 2:FFT 3:Waterfall 8/9:FFT win  R:Reset  W:Window[%s]  M:%sScale%s)%s",
+            view_str, use_window ? "On" : "Off", log_scale ? "Log" : "Lin",
+            channels > 1 ? "  C:Channel" : "",
+            !rec.ring ? "" : atomic_load(&rec.recording) ? "  T:Rec [REC]" : "  T:Rec");
+
+        if (bench) {
+            // Keep the analysis results for the end-of-run report.
+            bench_out0 = out0;
+            bench_peaks[0] = out1;
+            bench_peaks[1] = out2;
+            bench_peaks[2] = out3;
+            continue;
+        }
 
         // Print the display
         printf("\033[H"); // move cursor to top-left
@@ -786,10 +1612,21 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    double loop_seconds = elapsed_seconds(&loop_start);
+    int recording = rec.ring != NULL;
+    recorder_stop(&rec);
+
     // Cleanup resources
-    printf("\033[0m\nStopping capture.\n");
-    snd_pcm_close(pcm_handle);
+    if (!bench)
+        printf("\033[0m\nStopping capture.\n");
+    if (pcm_handle)
+        snd_pcm_close(pcm_handle);
+    if (src.file && src.file != stdin)
+        fclose(src.file);
+    free(src.float_buffer);
     free(audio_buffer);
+    free(channel_planes);
+    free(raw_buffer);
     free(vis_line);
     for (int i = 0; i < graph_height; i++)
         free(graph_lines[i]);
@@ -799,5 +1636,25 @@ int main(int argc, char *argv[]) {
         close(g_server_sock);
     }
 
+    // Throughput report for file sources (the alternate screen is already gone).
+    if (input_path) {
+        if (!bench)
+            cleanup_alternate_screen();
+        double fps = (loop_seconds > 0.0) ? frames_processed / loop_seconds : 0.0;
+        printf("Processed %llu frames (%.2f s of audio) in %.3f s: %.0f frames/sec, %.1fx real time "
+               "[view %d, FFT %u]\n",
+               frames_processed, (double)frames_processed / rate, loop_seconds, fps,
+               fps / rate, view_mode, fft_window_size);
+        if (bench)
+            printf("Last outputs: out0=%.2f out1=%ld out2=%ld out3=%ld\n",
+                   bench_out0, bench_peaks[0], bench_peaks[1], bench_peaks[2]);
+    }
+    if (recording) {
+        printf("Recordings saved: %u", atomic_load(&rec.files));
+        if (atomic_load(&rec.dropped) > 0)
+            printf(" (%llu frames lost: writer fell behind)", atomic_load(&rec.dropped));
+        printf("\n");
+    }
+
     return 0;
 }
@@ -15,11 +15,19 @@
  * Each message is sent as a line containing only an integer with the prefix "outX:" (where X is the channel number)
  * and terminated with a newline. Terminal output is prepended with a timestamp (HH:MM:SS).
  *
+ * Plugin mode:
+ *   Built with -DNODE_PLUGIN -fPIC -shared the same source becomes a node plugin for
+ *   node/nodehost (see the ABI notes in node/client.c). The host then owns the switchboard
+ *   connection and the event loop; device events are published through NodeHost.emit().
+ *   All state lives in a JoystickState returned by init(), one per instance.
+ *
  * Compilation Example:
  *   gcc -std=c11 -Wall -Wextra -pedantic -o input_joystick input_joystick.c
+ *   gcc -std=c11 -Wall -Wextra -pedantic -DNODE_PLUGIN -fPIC -shared -o input_joystick.so input_joystick.c
  *
  * Run Example:
  *   ./input_joystick [server_ip]
+ *   ./nodehost node/input_joystick.so
  */
 
 #define _POSIX_C_SOURCE 200809L
@@ -68,13 +76,41 @@ typedef struct {
 #define JS_EVENT_INIT   0x80    // Initial state.
 
 // ---------------------------------------------------------
-// Circular Message Buffer (for terminal output and TCP sending)
+// Node plugin ABI (keep identical in every node and in nodehost.c)
 // ---------------------------------------------------------
-char message_buffer[MAX_BUFFER_ROWS][MAX_MESSAGE_LENGTH];
-size_t buffer_index = 0;  // Next available slot.
+#define NODE_PLUGIN_ABI_VERSION 1
+
+typedef struct NodeHost {
+    int abi_version;
+    void *ctx;                                                  // opaque, pass back to callbacks
+    void (*emit)(void *ctx, int channel, const char *msg);      // publish on outN
+    int  (*watch_fd)(void *ctx, int fd);                        // call on_fd() when fd is readable
+    void (*unwatch_fd)(void *ctx, int fd);
+} NodeHost;
 
-// Global TCP socket.
-int server_sockfd = -1;
+typedef struct NodePlugin {
+    int abi_version;
+    const char *name;
+    int tick_ms;                                                // 0 = no periodic on_tick()
+    void *(*init)(const NodeHost *host, int argc, char **argv); // returns plugin state or NULL
+    void (*on_fd)(void *state, int fd);
+    void (*on_input)(void *state, int channel, const char *msg);
+    void (*on_tick)(void *state);
+    void (*shutdown)(void *state);
+} NodePlugin;
+
+// ---------------------------------------------------------
+// Node state: opened devices, the circular message buffer (for terminal
+// output and TCP sending) and where messages go
+// ---------------------------------------------------------
+typedef struct {
+    const NodeHost *host;        // host callbacks inside nodehost, NULL when standalone
+    int server_sockfd;           // standalone TCP connection, -1 inside nodehost
+    int js_fds[MAX_JOYSTICKS];
+    int js_count;
+    char message_buffer[MAX_BUFFER_ROWS][MAX_MESSAGE_LENGTH];
+    size_t buffer_index;         // next available slot
+} JoystickState;
 
 // ---------------------------------------------------------
 // Helper: Get current timestamp string in HH:MM:SS format.
@@ -86,24 +122,28 @@ static void get_timestamp(char *buffer, size_t size) {
 }
 
 // ---------------------------------------------------------
-// Helper: Add a message to the buffer, print with timestamp, and send via TCP.
+// Helper: Add a message to the buffer, print with timestamp, and send via TCP
+// (or hand it to the host when running as a plugin).
 // ---------------------------------------------------------
-static void add_message(const char *msg) {
-    strncpy(message_buffer[buffer_index], msg, MAX_MESSAGE_LENGTH - 1);
-    message_buffer[buffer_index][MAX_MESSAGE_LENGTH - 1] = '\0';
+static void add_message(JoystickState *st, int channel, int value) {
+    char *line = st->message_buffer[st->buffer_index];
+    snprintf(line, MAX_MESSAGE_LENGTH, "out%d: %d\n", channel, value);
 
     char time_str[16];
     get_timestamp(time_str, sizeof(time_str));
-    printf("[%s] %s", time_str, message_buffer[buffer_index]);
+    printf("[%s] %s", time_str, line);
     fflush(stdout);
 
-    if (server_sockfd >= 0) {
-        ssize_t sent = send(server_sockfd, message_buffer[buffer_index],
-                            strlen(message_buffer[buffer_index]), 0);
+    if (st->host) {
+        char value_str[32];
+        snprintf(value_str, sizeof(value_str), "%d", value);
+        st->host->emit(st->host->ctx, channel, value_str);
+    } else if (st->server_sockfd >= 0) {
+        ssize_t sent = send(st->server_sockfd, line, strlen(line), 0);
         if (sent < 0)
             perror("send");
     }
-    buffer_index = (buffer_index + 1) % MAX_BUFFER_ROWS;
+    st->buffer_index = (st->buffer_index + 1) % MAX_BUFFER_ROWS;
 }
 
 // ---------------------------------------------------------
@@ -119,6 +159,141 @@ static int is_joystick(const char *name) {
     return 1;
 }
 
+// ---------------------------------------------------------
+// Function: Open up to two joystick devices from INPUT_DIR.
+// Returns the number of opened devices.
+// ---------------------------------------------------------
+static int open_joysticks(JoystickState *st) {
+    DIR *dir;
+    struct dirent *entry;
+    char path[256];
+    int *js_fds = st->js_fds;
+    int js_count = 0;
+    st->js_count = 0;
+    for (int i = 0; i < MAX_JOYSTICKS; i++) {
+        js_fds[i] = -1;
+    }
+    dir = opendir(INPUT_DIR);
+    if (!dir) {
+        perror("opendir");
+        return 0;
+    }
+    while ((entry = readdir(dir)) != NULL && js_count < MAX_JOYSTICKS) {
+        if (!is_joystick(entry->d_name))
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", INPUT_DIR, entry->d_name);
+        int fd = open(path, O_RDONLY | O_NONBLOCK);
+        if (fd < 0) {
+            fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+            continue;
+        }
+        js_fds[js_count++] = fd;
+        printf("Opened joystick device %s assigned to physical channel %d\n", path, js_count - 1);
+    }
+    closedir(dir);
+    if (js_count == 0) {
+        fprintf(stderr, "No joystick devices found in %s.\n", INPUT_DIR);
+        return 0;
+    }
+    // We only process up to two devices.
+    if (js_count > 2) {
+        for (int i = 2; i < js_count; i++)
+            close(js_fds[i]);
+        js_count = 2;
+    }
+    st->js_count = js_count;
+    return js_count;
+}
+
+static void close_joysticks(JoystickState *st) {
+    for (int i = 0; i < st->js_count; i++) {
+        if (st->js_fds[i] >= 0)
+            close(st->js_fds[i]);
+        st->js_fds[i] = -1;
+    }
+    st->js_count = 0;
+}
+
+// ---------------------------------------------------------
+// Function: Read one event from a readable device fd and publish it.
+// ---------------------------------------------------------
+static void handle_joystick_fd(JoystickState *st, int fd) {
+    int dev = -1;
+    for (int i = 0; i < st->js_count; i++) {
+        if (st->js_fds[i] == fd)
+            dev = i;
+    }
+    if (dev < 0)
+        return;
+
+    js_event event;
+    ssize_t n = read(fd, &event, sizeof(event));
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            perror("read");
+        return;
+    }
+    if (n != sizeof(event))
+        return;
+
+    int identifier;
+    if (event.type & JS_EVENT_AXIS)
+        identifier = event.number;
+    else if (event.type & JS_EVENT_BUTTON)
+        identifier = event.number + BUTTON_OFFSET;
+    else
+        identifier = event.number; // fallback
+
+    // Device 0 -> channels 0 and 1, device 1 -> channels 2 and 3.
+    add_message(st, dev * 2, identifier);
+    add_message(st, dev * 2 + 1, event.value);
+}
+
+// ---------------------------------------------------------
+// Plugin entry points
+// ---------------------------------------------------------
+static void *joystick_init(const NodeHost *host, int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    JoystickState *st = calloc(1, sizeof(*st));
+    if (!st)
+        return NULL;
+    st->host = host;
+    st->server_sockfd = -1;
+    if (open_joysticks(st) == 0) {
+        free(st);
+        return NULL;
+    }
+    for (int i = 0; i < st->js_count; i++)
+        host->watch_fd(host->ctx, st->js_fds[i]);
+    printf("Listening for joystick events...\n");
+    return st;
+}
+
+static void joystick_on_fd(void *state, int fd) {
+    handle_joystick_fd(state, fd);
+}
+
+static void joystick_shutdown(void *state) {
+    JoystickState *st = state;
+    for (int i = 0; i < st->js_count; i++)
+        st->host->unwatch_fd(st->host->ctx, st->js_fds[i]);
+    close_joysticks(st);
+    free(st);
+}
+
+const NodePlugin node_plugin = {
+    NODE_PLUGIN_ABI_VERSION,
+    "input_joystick",
+    0,
+    joystick_init,
+    joystick_on_fd,
+    NULL,
+    NULL,
+    joystick_shutdown
+};
+
+#ifndef NODE_PLUGIN
 // ---------------------------------------------------------
 // Function: Establish TCP connection to the server.
 // ---------------------------------------------------------
@@ -149,57 +324,30 @@ static int connect_to_server(const char *server_ip, unsigned short port) {
 // Main: Joystick Input Capture and TCP Client Entry Point
 // ---------------------------------------------------------
 int main(int argc, char *argv[]) {
+    static JoystickState state;   // too large for the stack with its message buffer
+    JoystickState *st = &state;
     const char *server_ip = (argc >= 2) ? argv[1] : DEFAULT_SERVER_IP;
-    server_sockfd = connect_to_server(server_ip, SERVER_PORT);
-    if (server_sockfd < 0) {
+    st->server_sockfd = connect_to_server(server_ip, SERVER_PORT);
+    if (st->server_sockfd < 0) {
         fprintf(stderr, "Failed to connect to server %s:%d\n", server_ip, SERVER_PORT);
         return 1;
     }
     printf("Connected to server %s:%d\n", server_ip, SERVER_PORT);
 
-    DIR *dir;
-    struct dirent *entry;
-    char path[256];
-    int js_fds[MAX_JOYSTICKS];
-    int js_count = 0;
-    for (int i = 0; i < MAX_JOYSTICKS; i++) {
-        js_fds[i] = -1;
-    }
-    dir = opendir(INPUT_DIR);
-    if (!dir) {
-        perror("opendir");
-        close(server_sockfd);
+    if (open_joysticks(st) == 0) {
+        close(st->server_sockfd);
         return 1;
     }
-    while ((entry = readdir(dir)) != NULL && js_count < MAX_JOYSTICKS) {
-        if (!is_joystick(entry->d_name))
-            continue;
-        snprintf(path, sizeof(path), "%s/%s", INPUT_DIR, entry->d_name);
-        int fd = open(path, O_RDONLY | O_NONBLOCK);
-        if (fd < 0) {
-            fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
-            continue;
-        }
-        js_fds[js_count++] = fd;
-        printf("Opened joystick device %s assigned to physical channel %d\n", path, js_count - 1);
-    }
-    closedir(dir);
-    if (js_count == 0) {
-        fprintf(stderr, "No joystick devices found in %s.\n", INPUT_DIR);
-        close(server_sockfd);
-        return 1;
-    }
-    // We only process up to two devices.
-    if (js_count > 2)
-        js_count = 2;
-    
+    int *js_fds = st->js_fds;
+    int js_count = st->js_count;
+
     fd_set readfds;
     int maxfd = -1;
     for (int i = 0; i < js_count; i++) {
         if (js_fds[i] > maxfd)
             maxfd = js_fds[i];
     }
-    
+
     printf("Listening for joystick events...\n");
     while (1) {
         FD_ZERO(&readfds);
@@ -213,47 +361,14 @@ int main(int argc, char *argv[]) {
         }
         // Process each device independently.
         for (int i = 0; i < js_count; i++) {
-            if (FD_ISSET(js_fds[i], &readfds)) {
-                js_event event;
-                ssize_t n = read(js_fds[i], &event, sizeof(event));
-                if (n < 0) {
-                    if (errno == EAGAIN || errno == EWOULDBLOCK)
-                        continue;
-                    perror("read");
-                    continue;
-                }
-                if (n == sizeof(event)) {
-                    int identifier;
-                    if (event.type & JS_EVENT_AXIS)
-                        identifier = event.number;
-                    else if (event.type & JS_EVENT_BUTTON)
-                        identifier = event.number + BUTTON_OFFSET;
-                    else
-                        identifier = event.number; // fallback
-
-                    char msg_id[MAX_MESSAGE_LENGTH];
-                    char msg_val[MAX_MESSAGE_LENGTH];
-                    if (i == 0) {
-                        // Device 0 -> channels 0 and 1.
-                        snprintf(msg_id, sizeof(msg_id), "out0: %d\n", identifier);
-                        snprintf(msg_val, sizeof(msg_val), "out1: %d\n", event.value);
-                    } else if (i == 1) {
-                        // Device 1 -> channels 2 and 3.
-                        snprintf(msg_id, sizeof(msg_id), "out2: %d\n", identifier);
-                        snprintf(msg_val, sizeof(msg_val), "out3: %d\n", event.value);
-                    }
-                    add_message(msg_id);
-                    add_message(msg_val);
-                }
-            }
+            if (FD_ISSET(js_fds[i], &readfds))
+                handle_joystick_fd(st, js_fds[i]);
         }
     }
-    
-    for (int i = 0; i < js_count; i++) {
-        if (js_fds[i] >= 0)
-            close(js_fds[i]);
-    }
-    if (server_sockfd >= 0)
-        close(server_sockfd);
+
+    close_joysticks(st);
+    if (st->server_sockfd >= 0)
+        close(st->server_sockfd);
     return 0;
 }
+#endif
@@ -19,6 +19,22 @@
  *         "out0: <x>\n"  and  "out1: <y>\n"
  *     mimicking the client template implementation.
  *
+ * Recorded-frame source:
+ *   - "-i <file|->" replays raw YUYV frames (FRAME_WIDTH x FRAME_HEIGHT, concatenated)
+ *     or a Y4M stream (4:2:2, 4:2:0 or mono planes, converted to YUYV) through the same
+ *     shared-frame capture path and process_frame() as the V4L2 device.
+ *   - Frames are paced at "--fps N" (default 30) and the file loops when seekable.
+ *   - "--bench" plays the file once as fast as possible without a terminal or server
+ *     and reports per-stage timings (copy, background, morphology, centroid, render)
+ *     and the overall FPS.
+ *
+ * Usage:
+ *   input_video [server_ip] [port]
+ *   input_video -i <file|-> [--fps N] [--bench] [--roi] [--threads N] [server_ip] [port]
+ *
+ *   "--roi" (or 'T') switches process_frame() to region-of-interest tracking.
+ *   "--threads N" splits motion detection into N tiles (default 1: no worker threads).
+ *
  * Compilation:
  *   cc -std=c11 -Wall -Wextra -pedantic -pthread -o apps/input_video apps/input_video.c object_recognition.c
  */
@@ -66,6 +82,7 @@ volatile int target_fps = 10;
 // Global flag to enable/disable object detection.
 // 1 = enabled, 0 = disabled.
 volatile int object_detection_enabled = 1;
+volatile int roi_tracking_enabled = 0;   // ROI tracking mode of process_frame()
 
 // Terminal raw mode original settings.
 struct termios orig_termios;
@@ -306,12 +323,13 @@ int visible_length(const char *str) {
 void draw_menu_bar(double fps, int term_cols, int term_rows, int out0, int out1) {
     char menu[512];
     snprintf(menu, sizeof(menu),
-             "\033[%d;1H\033[7m Mode: %d  FPS: %.1f  Target: %d  [Press 1: Fast, 2: Balanced, 3: Quality, 8: - FPS, 9: + FPS, D: ObjDetect %s]  Out0: %d, Out1: %d",
+             "\033[%d;1H\033[7m Mode: %d  FPS: %.1f  Target: %d  [Press 1: Fast, 2: Balanced, 3: Quality, 8: - FPS, 9: + FPS, D: ObjDetect %s, T: Track %s]  Out0: %d, Out1: %d",
              term_rows,
              quality_mode,
              fps,
              target_fps,
              object_detection_enabled ? "On" : "Off",
+             roi_tracking_enabled ? "ROI" : "Full",
              out0,
              out1);
     
@@ -347,6 +365,8 @@ void process_input() {
                 target_fps++;
             } else if (c == 'D' || c == 'd') {
                 object_detection_enabled = !object_detection_enabled;
+            } else if (c == 'T' || c == 't') {
+                roi_tracking_enabled = !roi_tracking_enabled;
             }
         }
     }
@@ -361,107 +381,21 @@ struct capture_context {
     unsigned int n_buffers;
 };
 
-void *capture_thread_func(void *arg) {
-    struct capture_context *ctx = (struct capture_context *)arg;
-    struct v4l2_buffer buf;
-    enum v4l2_buf_type type;
-    
-    while (!stop) {
-        memset(&buf, 0, sizeof(buf));
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        if (ioctl(ctx->fd, VIDIOC_DQBUF, &buf) == -1) {
-            perror("Dequeue Buffer");
-            continue;
-        }
-        pthread_mutex_lock(&frame_mutex);
-        memcpy(shared_frame, ctx->buffers[buf.index].start, buf.bytesused);
-        shared_frame_size = buf.bytesused;
-        frame_ready = 1;
-        pthread_cond_signal(&frame_cond);
-        pthread_mutex_unlock(&frame_mutex);
-        
-        if (ioctl(ctx->fd, VIDIOC_QBUF, &buf) == -1) {
-            perror("Requeue Buffer");
-        }
-    }
-    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    if (ioctl(ctx->fd, VIDIOC_STREAMOFF, &type) == -1) {
-        perror("Stop Capture");
-    }
-    return NULL;
-}
-
-// ---------------------- External Object Recognition ----------------------
-//
-// Forward-declare the Position structure (matching object_recognition.c) and
-// update the extern declaration so that process_frame() returns a Position.
-typedef struct {
-    int x;
-    int y;
-} Position;
-
-extern Position process_frame(unsigned char *frame, size_t frame_size, int frame_width, int frame_height);
-
-// ---------------------- Global Variables for TCP Connection ----------------------
-int tcp_sockfd = -1;  // TCP socket file descriptor
-
-// ---------------------- Main Function ----------------------
-//
-// Now accepts optional command-line arguments for server IP and port.
-// Also sends object detection outputs to the TCP server as "out0:" and "out1:" messages.
-int main(int argc, char *argv[]) {
+/*
+ * Opens /dev/video0 at FRAME_WIDTH x FRAME_HEIGHT YUYV, maps the driver buffers
+ * and starts streaming. Returns 0 on success and fills in the capture context.
+ */
+static int open_v4l2_capture(struct capture_context *ctx) {
     int fd;
     struct v4l2_format fmt;
     struct v4l2_requestbuffers req;
     struct buffer *buffers;
     unsigned int n_buffers;
-    int term_cols, term_rows;
-    const char *server_ip = DEFAULT_SERVER_IP;
-    unsigned short server_port = DEFAULT_SERVER_PORT;
-    
-    // Allow overriding server IP and port via command-line arguments.
-    if (argc >= 2) {
-        server_ip = argv[1];
-    }
-    if (argc >= 3) {
-        server_port = (unsigned short)atoi(argv[2]);
-        if (server_port == 0) {
-            server_port = DEFAULT_SERVER_PORT;
-        }
-    }
-    
-    setbuf(stdout, NULL);
-    
-    enable_raw_mode();
-    atexit(disable_raw_mode);
-    signal(SIGINT, handle_sigint);
-    
-    // Establish TCP connection to the server.
-    tcp_sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (tcp_sockfd < 0) {
-        perror("TCP socket");
-        // Continue without TCP if connection fails.
-    } else {
-        struct sockaddr_in serv_addr;
-        memset(&serv_addr, 0, sizeof(serv_addr));
-        serv_addr.sin_family = AF_INET;
-        serv_addr.sin_port = htons(server_port);
-        if (inet_pton(AF_INET, server_ip, &serv_addr.sin_addr) <= 0) {
-            fprintf(stderr, "Invalid server IP: %s\n", server_ip);
-            close(tcp_sockfd);
-            tcp_sockfd = -1;
-        } else if (connect(tcp_sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-            perror("TCP connect");
-            close(tcp_sockfd);
-            tcp_sockfd = -1;
-        }
-    }
-    
+
     fd = open("/dev/video0", O_RDWR);
     if (fd == -1) {
         perror("Opening video device");
-        return EXIT_FAILURE;
+        return -1;
     }
     
     memset(&fmt, 0, sizeof(fmt));
@@ -473,7 +407,7 @@ int main(int argc, char *argv[]) {
     if (ioctl(fd, VIDIOC_S_FMT, &fmt) == -1) {
         perror("Setting Pixel Format");
         close(fd);
-        return EXIT_FAILURE;
+        return -1;
     }
     
 #ifdef V4L2_CID_LOW_LATENCY
@@ -494,14 +428,14 @@ int main(int argc, char *argv[]) {
     if (ioctl(fd, VIDIOC_REQBUFS, &req) == -1) {
         perror("Requesting Buffer");
         close(fd);
-        return EXIT_FAILURE;
+        return -1;
     }
     
     buffers = calloc(req.count, sizeof(*buffers));
     if (!buffers) {
         perror("Out of memory");
         close(fd);
-        return EXIT_FAILURE;
+        return -1;
     }
     n_buffers = req.count;
     
@@ -515,7 +449,7 @@ int main(int argc, char *argv[]) {
             perror("Querying Buffer");
             free(buffers);
             close(fd);
-            return EXIT_FAILURE;
+            return -1;
         }
         buffers[i].length = buf.length;
         buffers[i].start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE,
@@ -524,7 +458,7 @@ int main(int argc, char *argv[]) {
             perror("Buffer map error");
             free(buffers);
             close(fd);
-            return EXIT_FAILURE;
+            return -1;
         }
     }
     
@@ -538,7 +472,7 @@ int main(int argc, char *argv[]) {
             perror("Queue Buffer");
             free(buffers);
             close(fd);
-            return EXIT_FAILURE;
+            return -1;
         }
     }
     
@@ -547,11 +481,326 @@ int main(int argc, char *argv[]) {
         perror("Start Capture");
         free(buffers);
         close(fd);
+        return -1;
+    }
+
+    ctx->fd = fd;
+    ctx->buffers = buffers;
+    ctx->n_buffers = n_buffers;
+    return 0;
+}
+
+void *capture_thread_func(void *arg) {
+    struct capture_context *ctx = (struct capture_context *)arg;
+    struct v4l2_buffer buf;
+    enum v4l2_buf_type type;
+    
+    while (!stop) {
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        if (ioctl(ctx->fd, VIDIOC_DQBUF, &buf) == -1) {
+            perror("Dequeue Buffer");
+            continue;
+        }
+        pthread_mutex_lock(&frame_mutex);
+        memcpy(shared_frame, ctx->buffers[buf.index].start, buf.bytesused);
+        shared_frame_size = buf.bytesused;
+        frame_ready = 1;
+        pthread_cond_signal(&frame_cond);
+        pthread_mutex_unlock(&frame_mutex);
+        
+        if (ioctl(ctx->fd, VIDIOC_QBUF, &buf) == -1) {
+            perror("Requeue Buffer");
+        }
+    }
+    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (ioctl(ctx->fd, VIDIOC_STREAMOFF, &type) == -1) {
+        perror("Stop Capture");
+    }
+    return NULL;
+}
+
+// ---------------------- Recorded-Frame Capture Thread ----------------------
+//
+// Replays raw YUYV or Y4M frames from a file into shared_frame, exactly like the
+// V4L2 thread does with driver buffers.
+
+#define FRAME_BYTES (FRAME_WIDTH * FRAME_HEIGHT * 2)
+
+struct replay_context {
+    FILE *file;
+    int y4m;                 // 1 = Y4M stream, 0 = raw YUYV frames
+    int chroma;              // Y4M chroma layout: 422, 420 or 0 (mono)
+    long data_start;         // offset of the first frame, -1 if not seekable
+    int fps;                 // pacing; 0 = wait for the consumer (benchmark)
+    unsigned char *planes;   // Y4M planar frame before conversion
+    volatile int done;       // set at end of input
+    unsigned long frames;
+};
+
+// Parses the Y4M stream header. Returns 0 on success.
+static int parse_y4m_header(struct replay_context *rc) {
+    char header[256];
+    if (!fgets(header, sizeof(header), rc->file))
+        return -1;
+    if (strncmp(header, "YUV4MPEG2", 9) != 0)
+        return -1;
+    int width = 0, height = 0;
+    rc->chroma = 420;
+    for (char *tok = strtok(header + 9, " \n"); tok; tok = strtok(NULL, " \n")) {
+        if (tok[0] == 'W')
+            width = atoi(tok + 1);
+        else if (tok[0] == 'H')
+            height = atoi(tok + 1);
+        else if (tok[0] == 'C') {
+            if (strncmp(tok + 1, "422", 3) == 0)
+                rc->chroma = 422;
+            else if (strncmp(tok + 1, "420", 3) == 0)
+                rc->chroma = 420;
+            else if (strncmp(tok + 1, "mono", 4) == 0)
+                rc->chroma = 0;
+            else {
+                fprintf(stderr, "Unsupported Y4M colorspace %s\n", tok);
+                return -1;
+            }
+        }
+    }
+    if (width != FRAME_WIDTH || height != FRAME_HEIGHT) {
+        fprintf(stderr, "Y4M stream is %dx%d, expected %dx%d\n", width, height, FRAME_WIDTH, FRAME_HEIGHT);
+        return -1;
+    }
+    return 0;
+}
+
+// Reads one frame as YUYV into dst. Returns 0 on success, -1 at end of input.
+static int read_replay_frame(struct replay_context *rc, unsigned char *dst) {
+    if (!rc->y4m)
+        return fread(dst, 1, FRAME_BYTES, rc->file) == FRAME_BYTES ? 0 : -1;
+
+    char tag[128];
+    if (!fgets(tag, sizeof(tag), rc->file) || strncmp(tag, "FRAME", 5) != 0)
+        return -1;
+    size_t luma = (size_t)FRAME_WIDTH * FRAME_HEIGHT;
+    size_t chroma_w = FRAME_WIDTH / 2;
+    size_t chroma_h = (rc->chroma == 420) ? FRAME_HEIGHT / 2 : FRAME_HEIGHT;
+    size_t chroma = (rc->chroma == 0) ? 0 : chroma_w * chroma_h;
+    if (fread(rc->planes, 1, luma + 2 * chroma, rc->file) != luma + 2 * chroma)
+        return -1;
+
+    const unsigned char *Y = rc->planes;
+    const unsigned char *U = Y + luma;
+    const unsigned char *V = U + chroma;
+    for (int y = 0; y < FRAME_HEIGHT; y++) {
+        size_t crow = (rc->chroma == 420) ? (size_t)(y / 2) : (size_t)y;
+        unsigned char *out = dst + (size_t)y * FRAME_WIDTH * 2;
+        for (int x = 0; x < FRAME_WIDTH; x += 2) {
+            size_t c = crow * chroma_w + (size_t)x / 2;
+            out[0] = Y[(size_t)y * FRAME_WIDTH + x];
+            out[1] = chroma ? U[c] : 128;
+            out[2] = Y[(size_t)y * FRAME_WIDTH + x + 1];
+            out[3] = chroma ? V[c] : 128;
+            out += 4;
+        }
+    }
+    return 0;
+}
+
+void *replay_thread_func(void *arg) {
+    struct replay_context *rc = (struct replay_context *)arg;
+    unsigned char *frame = malloc(FRAME_BYTES);
+    if (!frame) {
+        rc->done = 1;
+        return NULL;
+    }
+
+    while (!stop) {
+        if (read_replay_frame(rc, frame) != 0) {
+            // Loop seekable files when pacing; a benchmark plays the input once.
+            if (rc->fps > 0 && rc->data_start >= 0 && rc->frames > 0 &&
+                fseek(rc->file, rc->data_start, SEEK_SET) == 0)
+                continue;
+            break;
+        }
+        pthread_mutex_lock(&frame_mutex);
+        // In benchmark mode every frame is consumed: wait for the previous one.
+        while (rc->fps == 0 && frame_ready && !stop)
+            pthread_cond_wait(&frame_cond, &frame_mutex);
+        memcpy(shared_frame, frame, FRAME_BYTES);
+        shared_frame_size = FRAME_BYTES;
+        frame_ready = 1;
+        rc->frames++;
+        pthread_cond_broadcast(&frame_cond);
+        pthread_mutex_unlock(&frame_mutex);
+
+        if (rc->fps > 0)
+            sleep_microseconds(1000000 / rc->fps);
+    }
+    free(frame);
+    pthread_mutex_lock(&frame_mutex);
+    rc->done = 1;
+    pthread_cond_broadcast(&frame_cond);
+    pthread_mutex_unlock(&frame_mutex);
+    return NULL;
+}
+
+static int open_replay(struct replay_context *rc, const char *path) {
+    memset(rc, 0, sizeof(*rc));
+    rc->file = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (!rc->file) {
+        perror(path);
+        return -1;
+    }
+    int c = fgetc(rc->file);
+    if (c == EOF) {
+        fprintf(stderr, "%s: empty input\n", path);
+        return -1;
+    }
+    ungetc(c, rc->file);
+    if (c == 'Y') {
+        rc->y4m = 1;
+        if (parse_y4m_header(rc) != 0) {
+            fprintf(stderr, "%s: invalid Y4M header\n", path);
+            return -1;
+        }
+        rc->planes = malloc(FRAME_BYTES * 2);
+        if (!rc->planes)
+            return -1;
+    }
+    rc->data_start = ftell(rc->file);
+    return 0;
+}
+
+static double elapsed_ms(const struct timespec *a, const struct timespec *b) {
+    return (b->tv_sec - a->tv_sec) * 1000.0 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+// ---------------------- External Object Recognition ----------------------
+//
+// Forward-declare the Position structure (matching object_recognition.c) and
+// update the extern declaration so that process_frame() returns a Position.
+typedef struct {
+    int x;
+    int y;
+} Position;
+
+extern Position process_frame(unsigned char *frame, size_t frame_size, int frame_width, int frame_height);
+
+// Stage timing accumulated by process_frame() (matches libregocnition.c).
+typedef struct {
+    double background_ms;
+    double morphology_ms;
+    double centroid_ms;
+    unsigned long frames;
+    unsigned long roi_frames;
+} StageTimings;
+
+extern void process_frame_enable_timing(int enable);
+extern StageTimings process_frame_get_timing(void);
+extern void process_frame_set_roi_tracking(int enable);
+extern void process_frame_set_threads(int threads);
+
+// ---------------------- Global Variables for TCP Connection ----------------------
+int tcp_sockfd = -1;  // TCP socket file descriptor
+
+// ---------------------- Main Function ----------------------
+//
+// Now accepts optional command-line arguments for server IP and port.
+// Also sends object detection outputs to the TCP server as "out0:" and "out1:" messages.
+int main(int argc, char *argv[]) {
+    struct capture_context cap_ctx = { -1, NULL, 0 };
+    struct replay_context replay;
+    int term_cols, term_rows;
+    const char *server_ip = DEFAULT_SERVER_IP;
+    unsigned short server_port = DEFAULT_SERVER_PORT;
+    const char *input_path = NULL;
+    int replay_fps = 30;
+    int bench = 0;
+    int positional = 0;
+    int detect_threads = 1;   // motion detection tiles; more only with --threads
+    
+    // Allow overriding server IP and port via command-line arguments.
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            input_path = argv[++i];
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            replay_fps = atoi(argv[++i]);
+            if (replay_fps <= 0)
+                replay_fps = 30;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            detect_threads = atoi(argv[++i]);
+            if (detect_threads <= 0)
+                detect_threads = 1;
+        } else if (strcmp(argv[i], "--roi") == 0) {
+            roi_tracking_enabled = 1;
+        } else if (positional == 0) {
+            server_ip = argv[i];
+            positional++;
+        } else if (positional == 1) {
+            server_port = (unsigned short)atoi(argv[i]);
+            if (server_port == 0) {
+                server_port = DEFAULT_SERVER_PORT;
+            }
+            positional++;
+        }
+    }
+    if (bench && !input_path) {
+        fprintf(stderr, "--bench requires a recorded input (-i file)\n");
         return EXIT_FAILURE;
     }
     
+    setbuf(stdout, NULL);
+    
+    if (!bench) {
+        enable_raw_mode();
+        atexit(disable_raw_mode);
+    }
+    signal(SIGINT, handle_sigint);
+    
+    // Establish TCP connection to the server.
+    if (!bench)
+        tcp_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (bench) {
+        // Benchmark runs stay off the switchboard.
+    } else if (tcp_sockfd < 0) {
+        perror("TCP socket");
+        // Continue without TCP if connection fails.
+    } else {
+        struct sockaddr_in serv_addr;
+        memset(&serv_addr, 0, sizeof(serv_addr));
+        serv_addr.sin_family = AF_INET;
+        serv_addr.sin_port = htons(server_port);
+        if (inet_pton(AF_INET, server_ip, &serv_addr.sin_addr) <= 0) {
+            fprintf(stderr, "Invalid server IP: %s\n", server_ip);
+            close(tcp_sockfd);
+            tcp_sockfd = -1;
+        } else if (connect(tcp_sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+            perror("TCP connect");
+            close(tcp_sockfd);
+            tcp_sockfd = -1;
+        }
+    }
+    
+    size_t frame_buf_size;
+    if (input_path) {
+        if (open_replay(&replay, input_path) != 0)
+            return EXIT_FAILURE;
+        replay.fps = bench ? 0 : replay_fps;
+        frame_buf_size = FRAME_BYTES;
+    } else {
+        if (open_v4l2_capture(&cap_ctx) != 0)
+            return EXIT_FAILURE;
+        frame_buf_size = cap_ctx.buffers[0].length;
+    }
+    
     // Initialize terminal parameters and precomputed scaling arrays.
     get_terminal_size(&term_cols, &term_rows);
+    if (term_cols <= 0 || term_rows <= 1) {
+        term_cols = 80;
+        term_rows = 24;
+    }
     int render_rows = term_rows - 1;  // Reserve last row for menu.
     
     fx_arr = malloc(term_cols * sizeof(double));
@@ -578,23 +827,25 @@ int main(int argc, char *argv[]) {
     }
     
     // Allocate local frame buffer for rendering.
-    unsigned char *local_frame = malloc(buffers[0].length);
+    unsigned char *local_frame = calloc(1, frame_buf_size);
     if (!local_frame) {
         perror("Allocating local frame buffer");
         exit(EXIT_FAILURE);
     }
     
     // Allocate shared frame buffer.
-    shared_frame = malloc(buffers[0].length);
+    shared_frame = malloc(frame_buf_size);
     if (!shared_frame) {
         perror("Allocating shared frame buffer");
         exit(EXIT_FAILURE);
     }
     
-    // Set up capture context and start capture thread.
-    struct capture_context cap_ctx = { fd, buffers, n_buffers };
+    // Start the capture thread: V4L2 device or recorded frames.
     pthread_t cap_thread;
-    if (pthread_create(&cap_thread, NULL, capture_thread_func, &cap_ctx) != 0) {
+    int thread_err = input_path
+        ? pthread_create(&cap_thread, NULL, replay_thread_func, &replay)
+        : pthread_create(&cap_thread, NULL, capture_thread_func, &cap_ctx);
+    if (thread_err != 0) {
         perror("Creating capture thread");
         exit(EXIT_FAILURE);
     }
@@ -605,30 +856,71 @@ int main(int argc, char *argv[]) {
     int frame_count = 0;
     double fps = 0.0;
     
+    // Benchmark accumulators (milliseconds).
+    struct timespec bench_start, t0, t1;
+    double copy_ms = 0.0, process_ms = 0.0, render_ms = 0.0;
+    unsigned long bench_frames = 0;
+    if (bench)
+        process_frame_enable_timing(1);
+    clock_gettime(CLOCK_MONOTONIC, &bench_start);
+    
+    // Motion detection runs on the render thread unless --threads asks for tiles.
+    process_frame_set_threads(detect_threads);
+    
+    // ROI tracking follows the 'T' toggle.
+    int roi_applied = roi_tracking_enabled;
+    process_frame_set_roi_tracking(roi_applied);
+    
     // Global outputs (initially set to center).
     int output0 = FRAME_WIDTH / 2;
     int output1 = FRAME_HEIGHT / 2;
     
     // Main rendering loop.
     while (!stop) {
-        process_input();
+        if (!bench)
+            process_input();
         
+        int got_frame = 0;
         pthread_mutex_lock(&frame_mutex);
-        while (!frame_ready && !stop) {
+        while (!frame_ready && !stop && !(input_path && replay.done)) {
             struct timespec ts;
             clock_gettime(CLOCK_REALTIME, &ts);
             ts.tv_nsec += 10 * 1000000; // 10 ms timeout.
+            if (ts.tv_nsec >= 1000000000L) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
             pthread_cond_timedwait(&frame_cond, &frame_mutex, &ts);
         }
+        clock_gettime(CLOCK_MONOTONIC, &t0);
         if (frame_ready) {
             memcpy(local_frame, shared_frame, shared_frame_size);
             frame_ready = 0;
+            got_frame = 1;
+            pthread_cond_broadcast(&frame_cond);
         }
         pthread_mutex_unlock(&frame_mutex);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        
+        if (bench) {
+            if (!got_frame) {
+                if (replay.done)
+                    break;
+                continue;
+            }
+            copy_ms += elapsed_ms(&t0, &t1);
+        }
         
         // Process frame for object recognition and overlay if enabled.
         if (object_detection_enabled) {
+            if (roi_applied != roi_tracking_enabled) {
+                roi_applied = roi_tracking_enabled;
+                process_frame_set_roi_tracking(roi_applied);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t0);
             Position pos = process_frame(local_frame, shared_frame_size, FRAME_WIDTH, FRAME_HEIGHT);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            process_ms += elapsed_ms(&t0, &t1);
             output0 = pos.x;
             output1 = pos.y;
             // Send outputs to server if TCP connection is active.
@@ -645,6 +937,18 @@ int main(int argc, char *argv[]) {
             }
         }
         
+        if (bench) {
+            // Render into the buffer but keep the terminal out of the measurement.
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            frame_to_halfblock_ascii(local_frame, FRAME_WIDTH, FRAME_HEIGHT,
+                                     term_cols, render_rows, quality_mode,
+                                     output_buf, output_buf_size);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            render_ms += elapsed_ms(&t0, &t1);
+            bench_frames++;
+            continue;
+        }
+        
         clear_terminal();
         frame_to_halfblock_ascii(local_frame, FRAME_WIDTH, FRAME_HEIGHT,
                                  term_cols, render_rows, quality_mode,
@@ -666,19 +970,53 @@ int main(int argc, char *argv[]) {
         sleep_microseconds(desired_delay);
     }
     
+    stop = 1;
+    pthread_mutex_lock(&frame_mutex);
+    pthread_cond_broadcast(&frame_cond);
+    pthread_mutex_unlock(&frame_mutex);
     pthread_join(cap_thread, NULL);
     
-    for (unsigned int i = 0; i < n_buffers; i++) {
-        munmap(buffers[i].start, buffers[i].length);
+    if (bench) {
+        struct timespec bench_end;
+        clock_gettime(CLOCK_MONOTONIC, &bench_end);
+        double total_ms = elapsed_ms(&bench_start, &bench_end);
+        StageTimings st = process_frame_get_timing();
+        double n = bench_frames ? (double)bench_frames : 1.0;
+        double other_ms = process_ms - st.background_ms - st.morphology_ms - st.centroid_ms;
+        printf("Frames: %lu (%dx%d, %s), %d detection thread(s)\n", bench_frames, FRAME_WIDTH,
+               FRAME_HEIGHT, replay.y4m ? "Y4M" : "YUYV", detect_threads);
+        printf("Per-frame average (ms):\n");
+        printf("  copy        %8.4f\n", copy_ms / n);
+        printf("  background  %8.4f\n", st.background_ms / n);
+        printf("  morphology  %8.4f\n", st.morphology_ms / n);
+        printf("  centroid    %8.4f\n", st.centroid_ms / n);
+        printf("  marker      %8.4f\n", (other_ms > 0.0 ? other_ms : 0.0) / n);
+        printf("  render      %8.4f  (%dx%d cells, quality %d)\n", render_ms / n,
+               term_cols, render_rows, quality_mode);
+        if (roi_applied)
+            printf("ROI tracking: %lu of %lu frames inside the tracking window\n",
+                   st.roi_frames, st.frames);
+        printf("Overall: %.1f FPS (%.3f s wall time)\n",
+               total_ms > 0.0 ? bench_frames * 1000.0 / total_ms : 0.0, total_ms / 1000.0);
+    }
+    
+    for (unsigned int i = 0; i < cap_ctx.n_buffers; i++) {
+        munmap(cap_ctx.buffers[i].start, cap_ctx.buffers[i].length);
+    }
+    free(cap_ctx.buffers);
+    if (input_path) {
+        if (replay.file != stdin)
+            fclose(replay.file);
+        free(replay.planes);
     }
-    free(buffers);
     free(output_buf);
     free(local_frame);
     free(shared_frame);
     free(fx_arr);
     free(fy_top_arr);
     free(fy_bot_arr);
-    close(fd);
+    if (cap_ctx.fd != -1)
+        close(cap_ctx.fd);
     if (tcp_sockfd != -1)
         close(tcp_sockfd);
     
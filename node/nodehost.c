@@ -0,0 +1,591 @@
+/*
+ * nodehost.c
+ *
+ * In-process multi-node runtime. Loads nodes that were built as shared objects
+ * (see the plugin ABI notes in node/client.c) and runs all of them inside one
+ * process and one epoll() loop, instead of one process, one socket and one
+ * select() loop per node.
+ *
+ * Usage:
+ *   ./nodehost [-s server_ip] [-p port] [-n] [-r routes] plugin.so[:arg[:arg...]] ...
+ *
+ *   -s server_ip   switchboard address (default 127.0.0.1)
+ *   -p port        switchboard port (default 12345)
+ *   -n             do not connect to the switchboard at all (local routes only)
+ *   -r routes      file with co-hosted routes (default "nodehost.rt" if present)
+ *
+ * Each plugin is given a slot number (1..N) in command-line order and, unless -n is
+ * used, its own switchboard connection so it still shows up as a normal client to
+ * server.c (monitor, logging, remote routes). The connections are not multiplexed:
+ * server.c identifies a client, its clientID and its routes by the connection, so
+ * sharing one socket would need a protocol change on the server side. Routes between
+ * co-hosted nodes are read from the routes file, using the same syntax as route.rt
+ * but with slot numbers:
+ *
+ *   route <outSlot> <outCH|all> <inSlot> <inCH|all>
+ *
+ * Such routes never touch a socket: an emitted message is queued and handed straight
+ * to the destination plugin's on_input() from the same loop iteration. Output channels
+ * with a co-hosted route are not sent to the switchboard, so a route that is also in
+ * route.rt does not deliver the message twice.
+ *
+ * Build (plugins are built by "make plugins"):
+ *   gcc -std=c11 -Wall -Wextra -pedantic -o nodehost nodehost.c -ldl
+ *
+ * Design Principles:
+ *   - Plain C (C11) with POSIX and Linux epoll; single source file, no header files.
+ *   - The plugin ABI structs below are copied verbatim from node/client.c.
+ *   - Messages handed between co-hosted nodes are copied once, into the handoff queue.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#define DEFAULT_PORT     12345
+#define DEFAULT_IP       "127.0.0.1"
+#define DEFAULT_ROUTES   "nodehost.rt"
+#define MAX_PLUGINS      16
+#define MAX_PLUGIN_ARGS  8
+#define MAX_WATCHED_FDS  16
+#define CHANNELS_PER_APP 5
+#define MAX_MSG_LENGTH   512
+#define HANDOFF_QUEUE    256
+#define MAX_EVENTS       32
+
+// ---------------------------------------------------------
+// Node plugin ABI (keep identical in every node and in nodehost.c)
+// ---------------------------------------------------------
+#define NODE_PLUGIN_ABI_VERSION 1
+
+typedef struct NodeHost {
+    int abi_version;
+    void *ctx;                                                  // opaque, pass back to callbacks
+    void (*emit)(void *ctx, int channel, const char *msg);      // publish on outN
+    int  (*watch_fd)(void *ctx, int fd);                        // call on_fd() when fd is readable
+    void (*unwatch_fd)(void *ctx, int fd);
+} NodeHost;
+
+typedef struct NodePlugin {
+    int abi_version;
+    const char *name;
+    int tick_ms;                                                // 0 = no periodic on_tick()
+    void *(*init)(const NodeHost *host, int argc, char **argv); // returns plugin state or NULL
+    void (*on_fd)(void *state, int fd);
+    void (*on_input)(void *state, int channel, const char *msg);
+    void (*on_tick)(void *state);
+    void (*shutdown)(void *state);
+} NodePlugin;
+
+// ---------------------------------------------------------
+// Host data structures
+// ---------------------------------------------------------
+typedef struct {
+    int in_slot;     // destination slot (1..N); -1 means no route
+    int in_channel;  // 0..4
+} LocalRoute;
+
+typedef struct {
+    int slot;                          // 1-based, matches route file numbering
+    void *handle;                      // dlopen() handle
+    const NodePlugin *plugin;
+    void *state;
+    NodeHost host;
+    int watched[MAX_WATCHED_FDS];
+    int watched_count;
+    int server_fd;                     // switchboard connection or -1
+    char rx[MAX_MSG_LENGTH * 2];       // partial line buffer for server_fd
+    size_t rx_used;
+    struct timespec next_tick;
+    char *argv[MAX_PLUGIN_ARGS + 1];
+    int argc;
+    char spec[256];
+} HostedNode;
+
+typedef struct {
+    int slot;
+    int channel;
+    char msg[MAX_MSG_LENGTH];
+} Handoff;
+
+// epoll user data: which node owns the fd and whether it is the server socket.
+#define EP_TAG(slot, is_server, fd) (((uint64_t)(slot) << 40) | ((uint64_t)(is_server) << 32) | (uint32_t)(fd))
+#define EP_SLOT(tag)   ((int)((tag) >> 40))
+#define EP_SERVER(tag) ((int)(((tag) >> 32) & 0xff))
+#define EP_FD(tag)     ((int)(uint32_t)(tag))
+
+static HostedNode nodes[MAX_PLUGINS + 1];   // index 0 unused
+static int node_count = 0;
+static LocalRoute routes[MAX_PLUGINS + 1][CHANNELS_PER_APP];
+static Handoff queue[HANDOFF_QUEUE];
+static int queue_head = 0, queue_tail = 0;
+static unsigned long queue_dropped = 0;
+static int epfd = -1;
+static volatile sig_atomic_t stop_flag = 0;
+
+static void handle_sigint(int sig) {
+    (void)sig;
+    stop_flag = 1;
+}
+
+// Remove newline/carriage returns.
+static void trim_newline(char *s) {
+    char *p = strchr(s, '\n');
+    if (p) *p = '\0';
+    p = strchr(s, '\r');
+    if (p) *p = '\0';
+}
+
+// ---------------------------------------------------------
+// Switchboard connection (one per hosted node)
+// ---------------------------------------------------------
+static int connect_to_server(const char *server_ip, unsigned short port) {
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        perror("socket");
+        return -1;
+    }
+    struct sockaddr_in serv_addr;
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, server_ip, &serv_addr.sin_addr) <= 0) {
+        fprintf(stderr, "Invalid address: %s\n", server_ip);
+        close(sockfd);
+        return -1;
+    }
+    if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+        perror("connect");
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+// ---------------------------------------------------------
+// NodeHost callbacks handed to plugins
+// ---------------------------------------------------------
+static void host_emit(void *ctx, int channel, const char *msg) {
+    HostedNode *n = ctx;
+    if (channel < 0 || channel >= CHANNELS_PER_APP)
+        return;
+
+    // Co-hosted route: queue a direct handoff, delivered by drain_queue().
+    LocalRoute r = routes[n->slot][channel];
+    if (r.in_slot >= 1 && r.in_slot <= node_count) {
+        int next = (queue_tail + 1) % HANDOFF_QUEUE;
+        if (next == queue_head) {
+            queue_dropped++;
+            return;
+        }
+        Handoff *h = &queue[queue_tail];
+        h->slot = r.in_slot;
+        h->channel = r.in_channel;
+        strncpy(h->msg, msg, MAX_MSG_LENGTH - 1);
+        h->msg[MAX_MSG_LENGTH - 1] = '\0';
+        queue_tail = next;
+        return;
+    }
+
+    if (n->server_fd >= 0) {
+        char line[MAX_MSG_LENGTH + 16];
+        int len = snprintf(line, sizeof(line), "out%d: %s\n", channel, msg);
+        if (len >= (int)sizeof(line)) {
+            line[sizeof(line) - 2] = '\n';
+            len = (int)sizeof(line) - 1;
+        }
+        if (len > 0 && send(n->server_fd, line, (size_t)len, MSG_NOSIGNAL) < 0)
+            perror("send");
+    }
+}
+
+static int host_watch_fd(void *ctx, int fd) {
+    HostedNode *n = ctx;
+    if (n->watched_count >= MAX_WATCHED_FDS)
+        return -1;
+    // An fd can only be read by one plugin (e.g. two client.so instances on stdin).
+    for (int s = 1; s <= node_count; s++) {
+        for (int i = 0; i < nodes[s].watched_count; i++) {
+            if (nodes[s].watched[i] == fd) {
+                fprintf(stderr, "[%s] fd %d is already watched by slot %d (%s).\n",
+                        n->plugin->name, fd, s, nodes[s].plugin->name);
+                return -1;
+            }
+        }
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = EP_TAG(n->slot, 0, fd);
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl ADD");
+        return -1;
+    }
+    n->watched[n->watched_count++] = fd;
+    return 0;
+}
+
+static void host_unwatch_fd(void *ctx, int fd) {
+    HostedNode *n = ctx;
+    for (int i = 0; i < n->watched_count; i++) {
+        if (n->watched[i] == fd) {
+            epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+            n->watched[i] = n->watched[--n->watched_count];
+            return;
+        }
+    }
+}
+
+// ---------------------------------------------------------
+// Message delivery
+// ---------------------------------------------------------
+// Delivers the handoffs queued before the call. Messages emitted by on_input() wait
+// for the next loop iteration, so a routing cycle cannot starve the event loop.
+static void drain_queue(void) {
+    int end = queue_tail;
+    while (queue_head != end) {
+        Handoff *h = &queue[queue_head];
+        HostedNode *dst = &nodes[h->slot];
+        // Advance first: on_input() may emit and append to the queue.
+        queue_head = (queue_head + 1) % HANDOFF_QUEUE;
+        if (dst->state && dst->plugin->on_input)
+            dst->plugin->on_input(dst->state, h->channel, h->msg);
+    }
+}
+
+// Parse "inN from clientX: msg" lines coming from the switchboard.
+static void handle_server_line(HostedNode *n, char *line) {
+    trim_newline(line);
+    if (strncmp(line, "in", 2) != 0 || !isdigit((unsigned char)line[2]))
+        return;   // greeting or other server chatter
+    int channel = line[2] - '0';
+    if (channel >= CHANNELS_PER_APP)
+        return;
+    const char *msg = strchr(line, ':');
+    msg = msg ? msg + 1 : "";
+    while (*msg == ' ' || *msg == '\t') msg++;
+    if (n->plugin->on_input)
+        n->plugin->on_input(n->state, channel, msg);
+}
+
+static void handle_server_data(HostedNode *n) {
+    ssize_t r = recv(n->server_fd, n->rx + n->rx_used, sizeof(n->rx) - 1 - n->rx_used, 0);
+    if (r <= 0) {
+        printf("[%s] Server disconnected.\n", n->plugin->name);
+        epoll_ctl(epfd, EPOLL_CTL_DEL, n->server_fd, NULL);
+        close(n->server_fd);
+        n->server_fd = -1;
+        return;
+    }
+    n->rx_used += (size_t)r;
+    n->rx[n->rx_used] = '\0';
+    char *start = n->rx;
+    char *nl;
+    while ((nl = strchr(start, '\n')) != NULL) {
+        *nl = '\0';
+        handle_server_line(n, start);
+        start = nl + 1;
+    }
+    size_t remaining = n->rx_used - (size_t)(start - n->rx);
+    if (remaining == sizeof(n->rx) - 1)
+        remaining = 0;   // overlong line without newline: discard it
+    memmove(n->rx, start, remaining);
+    n->rx_used = remaining;
+}
+
+// ---------------------------------------------------------
+// Route file: "route <outSlot> <outCH|all> <inSlot> <inCH|all>"
+// ---------------------------------------------------------
+static int parse_channel(const char *s, const char *prefix) {
+    size_t plen = strlen(prefix);
+    if (strcmp(s, "all") == 0)
+        return CHANNELS_PER_APP;
+    if (isdigit((unsigned char)s[0]))
+        return atoi(s);
+    if (strncmp(s, prefix, plen) == 0 && isdigit((unsigned char)s[plen]))
+        return s[plen] - '0';
+    return -1;
+}
+
+static void load_routes(const char *path, int required) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        if (required)
+            perror(path);
+        return;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        trim_newline(line);
+        char *tok = strtok(line, " \t");
+        if (!tok || strcmp(tok, "route") != 0)
+            continue;
+        char *pOut = strtok(NULL, " \t");
+        char *pOutCh = strtok(NULL, " \t");
+        char *pIn = strtok(NULL, " \t");
+        char *pInCh = strtok(NULL, " \t");
+        if (!pOut || !pOutCh || !pIn || !pInCh) {
+            printf("Incomplete routing command in %s.\n", path);
+            continue;
+        }
+        int out_slot = atoi(pOut), in_slot = atoi(pIn);
+        int out_ch = parse_channel(pOutCh, "out");
+        int in_ch = parse_channel(pInCh, "in");
+        if (out_slot < 1 || out_slot > node_count || in_slot < 1 || in_slot > node_count ||
+            out_ch < 0 || out_ch > CHANNELS_PER_APP || in_ch < 0 || in_ch > CHANNELS_PER_APP) {
+            printf("Invalid route in %s: slots are 1..%d, channels 0..%d or 'all'.\n",
+                   path, node_count, CHANNELS_PER_APP - 1);
+            continue;
+        }
+        for (int ch = 0; ch < CHANNELS_PER_APP; ch++) {
+            if (out_ch != CHANNELS_PER_APP && ch != out_ch)
+                continue;
+            // "all all" maps outN -> inN; "N all" keeps only the last input, as server.c does.
+            routes[out_slot][ch].in_slot = in_slot;
+            if (in_ch != CHANNELS_PER_APP)
+                routes[out_slot][ch].in_channel = in_ch;
+            else
+                routes[out_slot][ch].in_channel = (out_ch == CHANNELS_PER_APP) ? ch : CHANNELS_PER_APP - 1;
+            printf("Local route: %s out%d -> %s in%d\n",
+                   nodes[out_slot].plugin->name, ch,
+                   nodes[in_slot].plugin->name, routes[out_slot][ch].in_channel);
+        }
+    }
+    fclose(fp);
+}
+
+// ---------------------------------------------------------
+// Plugin loading
+// ---------------------------------------------------------
+static int load_plugin(const char *spec, const char *server_ip, unsigned short port, int use_server) {
+    if (node_count >= MAX_PLUGINS) {
+        fprintf(stderr, "Too many plugins (max %d).\n", MAX_PLUGINS);
+        return -1;
+    }
+    HostedNode *n = &nodes[node_count + 1];
+    memset(n, 0, sizeof(*n));
+    n->slot = node_count + 1;
+    n->server_fd = -1;
+
+    // spec = path[:arg[:arg...]]; the path doubles as argv[0].
+    strncpy(n->spec, spec, sizeof(n->spec) - 1);
+    char *save = NULL;
+    for (char *tok = strtok_r(n->spec, ":", &save); tok && n->argc < MAX_PLUGIN_ARGS;
+         tok = strtok_r(NULL, ":", &save))
+        n->argv[n->argc++] = tok;
+    n->argv[n->argc] = NULL;
+    if (n->argc == 0)
+        return -1;
+
+    // dlopen() needs a path to look outside the library search path.
+    char path[300];
+    if (strchr(n->argv[0], '/'))
+        snprintf(path, sizeof(path), "%s", n->argv[0]);
+    else
+        snprintf(path, sizeof(path), "./%s", n->argv[0]);
+    n->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!n->handle) {
+        fprintf(stderr, "dlopen %s: %s\n", path, dlerror());
+        return -1;
+    }
+    n->plugin = dlsym(n->handle, "node_plugin");
+    if (!n->plugin) {
+        fprintf(stderr, "%s: no node_plugin symbol (%s)\n", path, dlerror());
+        dlclose(n->handle);
+        return -1;
+    }
+    if (n->plugin->abi_version != NODE_PLUGIN_ABI_VERSION) {
+        fprintf(stderr, "%s: plugin ABI %d, host ABI %d\n", path,
+                n->plugin->abi_version, NODE_PLUGIN_ABI_VERSION);
+        dlclose(n->handle);
+        return -1;
+    }
+
+    if (use_server) {
+        n->server_fd = connect_to_server(server_ip, port);
+        if (n->server_fd < 0) {
+            fprintf(stderr, "%s: cannot connect to server at %s:%hu\n", path, server_ip, port);
+            dlclose(n->handle);
+            return -1;
+        }
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = EP_TAG(n->slot, 1, n->server_fd);
+        epoll_ctl(epfd, EPOLL_CTL_ADD, n->server_fd, &ev);
+    }
+
+    n->host.abi_version = NODE_PLUGIN_ABI_VERSION;
+    n->host.ctx = n;
+    n->host.emit = host_emit;
+    n->host.watch_fd = host_watch_fd;
+    n->host.unwatch_fd = host_unwatch_fd;
+
+    node_count++;
+    n->state = n->plugin->init(&n->host, n->argc, n->argv);
+    if (!n->state) {
+        fprintf(stderr, "%s: init failed\n", path);
+        node_count--;
+        // Drop whatever the plugin registered before it gave up.
+        while (n->watched_count > 0)
+            epoll_ctl(epfd, EPOLL_CTL_DEL, n->watched[--n->watched_count], NULL);
+        if (n->server_fd >= 0)
+            close(n->server_fd);
+        dlclose(n->handle);
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &n->next_tick);
+    printf("Slot %d: %s (%s)\n", n->slot, n->plugin->name, path);
+    return 0;
+}
+
+static long ms_until(const struct timespec *t, const struct timespec *now) {
+    return (long)(t->tv_sec - now->tv_sec) * 1000 + (t->tv_nsec - now->tv_nsec) / 1000000;
+}
+
+static void add_ms(struct timespec *t, int ms) {
+    t->tv_sec += ms / 1000;
+    t->tv_nsec += (long)(ms % 1000) * 1000000;
+    if (t->tv_nsec >= 1000000000L) {
+        t->tv_sec++;
+        t->tv_nsec -= 1000000000L;
+    }
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [-s server_ip] [-p port] [-n] [-r routes] plugin.so[:arg...] ...\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    const char *server_ip = DEFAULT_IP;
+    unsigned short port = DEFAULT_PORT;
+    const char *route_file = NULL;
+    int use_server = 1;
+    int first_plugin = argc;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            server_ip = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            port = (unsigned short)atoi(argv[++i]);
+            if (port == 0)
+                port = DEFAULT_PORT;
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            route_file = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0) {
+            use_server = 0;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            first_plugin = i;
+            break;
+        }
+    }
+    if (first_plugin >= argc) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGINT, handle_sigint);
+    signal(SIGTERM, handle_sigint);
+    memset(routes, -1, sizeof(routes));
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    // Slot numbers in the route file follow argument order, so any failure is fatal.
+    int load_failed = 0;
+    for (int i = first_plugin; i < argc && !stop_flag; i++) {
+        if (load_plugin(argv[i], server_ip, port, use_server) < 0) {
+            fprintf(stderr, "Failed to load plugin %s\n", argv[i]);
+            load_failed = 1;
+            stop_flag = 1;
+        }
+    }
+    if (!stop_flag) {
+        if (route_file)
+            load_routes(route_file, 1);
+        else
+            load_routes(DEFAULT_ROUTES, 0);
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    while (!stop_flag) {
+        // Sleep until the earliest plugin tick is due.
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long timeout = queue_head != queue_tail ? 0 : -1;   // pending handoffs: just poll
+        for (int s = 1; s <= node_count; s++) {
+            if (!nodes[s].state || nodes[s].plugin->tick_ms <= 0 || !nodes[s].plugin->on_tick)
+                continue;
+            long wait = ms_until(&nodes[s].next_tick, &now);
+            if (wait < 0)
+                wait = 0;
+            if (timeout < 0 || wait < timeout)
+                timeout = wait;
+        }
+
+        int nev = epoll_wait(epfd, events, MAX_EVENTS, (int)timeout);
+        if (nev < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int e = 0; e < nev; e++) {
+            uint64_t tag = events[e].data.u64;
+            HostedNode *n = &nodes[EP_SLOT(tag)];
+            if (!n->state)
+                continue;
+            if (EP_SERVER(tag))
+                handle_server_data(n);
+            else if (n->plugin->on_fd)
+                n->plugin->on_fd(n->state, EP_FD(tag));
+            drain_queue();
+        }
+        drain_queue();   // handoffs left over from the previous iteration
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        for (int s = 1; s <= node_count; s++) {
+            HostedNode *n = &nodes[s];
+            if (!n->state || n->plugin->tick_ms <= 0 || !n->plugin->on_tick)
+                continue;
+            if (ms_until(&n->next_tick, &now) <= 0) {
+                n->plugin->on_tick(n->state);
+                add_ms(&n->next_tick, n->plugin->tick_ms);
+                if (ms_until(&n->next_tick, &now) < 0)
+                    n->next_tick = now;   // fell behind: do not burst
+                drain_queue();
+            }
+        }
+    }
+
+    if (queue_dropped)
+        printf("Handoff queue overflowed %lu times.\n", queue_dropped);
+    for (int s = node_count; s >= 1; s--) {
+        HostedNode *n = &nodes[s];
+        if (n->state && n->plugin->shutdown)
+            n->plugin->shutdown(n->state);
+        if (n->server_fd >= 0)
+            close(n->server_fd);
+        dlclose(n->handle);
+    }
+    close(epfd);
+    return load_failed ? 1 : 0;
+}